@@ -11,13 +11,24 @@ typedef struct {
   PetscSubcommType  psubcommType;
   MatInvType        type;
   MatRegularizationType regtype;
+  PetscInt          explicit_bs;  /* number of columns solved at once in MatInvExplicitly */
   PetscBool         setupcalled,setfromoptionscalled,inner_objects_created;
+  PetscBool         multpending,multsplit;  /* state of MatInvMultBegin/End */
+  PetscInt          nsubksp;                /* with MAT_INV_BLOCKDIAG and several local blocks of MATBLOCKDIAG */
+  KSP               *subksp;                /* owned by PCBJACOBI */
+  PetscInt          *suboffsets;
+  Vec               *subx,*suby;
+  PetscObjectState  Astate,Anzstate;       /* state of A at the last MatInvSetUp */
+  PetscBool         samepattern;            /* A was replaced by MatInvSetMat with a matrix of the same nonzero pattern */
 } Mat_Inv;
 
 typedef struct {
 	Mat localBlock;	                  /* local (sequential) blocks of BlockDiag */
 	Vec xloc, yloc, xloc1, yloc1;            /* local work vectors */ 
   Vec *cols_loc;
+  PetscInt nblocks;                 /* number of independent subdomain blocks within localBlock */
+  PetscInt *blens, *boffsets;       /* their sizes and row offsets, NULL if nblocks == 1 */
+  PetscObjectState locstate, locnzstate; /* state of localBlock last propagated to the MATBLOCKDIAG */
 } Mat_BlockDiag;
 
 typedef struct {         
@@ -26,6 +37,10 @@ typedef struct {
 	const PetscInt *leaves_row; /* row index */
   PetscInt n_nonzeroRow; 
 	PetscInt n_leaves;
+	PetscScalar *leaves_work;  /* leaf buffer for the SF exchange, n_leaves long */
+	const PetscScalar *root_read;  /* root array held between PermonMatMult*Begin and End */
+	PetscScalar *root_write;
+	PetscBool multpending;
 } Mat_Gluing;
 
 typedef struct {
@@ -43,6 +58,9 @@ struct _n_MatCompleteCtx {
 };
 typedef struct _n_MatCompleteCtx *MatCompleteCtx;
 
+FLLOP_INTERN PetscErrorCode PermonMatMatMultDense_Private(Mat A,Mat X,Mat Y);
+FLLOP_INTERN PetscErrorCode MatBlockDiagUpdateState_Private(Mat A);
+
 FLLOP_EXTERN PetscLogEvent Mat_OrthColumns,Mat_Inv_Explicitly,Mat_Inv_SetUp;
 FLLOP_EXTERN PetscLogEvent Mat_Regularize,Mat_GetColumnVectors,Mat_RestoreColumnVectors,Mat_MatMultByColumns,Mat_TransposeMatMultByColumns;
 FLLOP_EXTERN PetscLogEvent Mat_GetMaxEigenvalue,Mat_FilterZeros,Mat_MergeAndDestroy,PermonMat_GetLocalMat;
@@ -21,6 +21,7 @@ struct _QPCOps {
   PetscErrorCode (*project)(QPC,Vec,Vec);
   PetscErrorCode (*feas)(QPC,Vec,Vec,PetscScalar*);
   PetscErrorCode (*grads)(QPC,Vec,Vec,Vec,Vec);
+  PetscErrorCode (*gradsnorms)(QPC,Vec,Vec,Vec,Vec,Vec,PetscReal*);
   PetscErrorCode (*gradreduced)(QPC,Vec,Vec,PetscReal,Vec);
 };
 
@@ -31,6 +32,8 @@ struct _p_QPC {
   PetscReal astol; /* active set tolerance - used e.g. in grad splitting */
   void *data; /* holder for misc stuff associated with a particular constraints type */
   PetscBool setupcalled; /* current state */
+  PetscScalar feas_local,feas_global; /* buffers of split-phase QPCFeasBegin/End */
+  MPI_Request feas_request;
 };
 
 #endif
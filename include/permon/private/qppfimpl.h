@@ -3,6 +3,17 @@
 #include <permonqppf.h>
 #include <permon/private/permonimpl.h>
 
+typedef enum {QPPF_CACHE_OP_Q, QPPF_CACHE_OP_P, QPPF_CACHE_OP_HALFQ, QPPF_CACHE_OP_HALFQT, QPPF_CACHE_OP_GTG, QPPF_CACHE_OP_CP} QPPFCacheOp;
+
+typedef struct {
+    QPPFCacheOp op;
+    PetscObjectId id;
+    PetscObjectState state;
+    PetscInt stamp;               /* time of last use, 0 for an empty entry */
+    Vec result;
+    Vec alpha_tilde;              /* for QPPF_CACHE_OP_Q and QPPF_CACHE_OP_P */
+} QPPFCacheEntry;
+
 struct _p_QPPF {
     PETSCHEADER(int);
     
@@ -12,6 +23,19 @@ struct _p_QPPF {
     PetscBool explicitInv, G_has_orthonormal_rows_explicitly, G_has_orthonormal_rows_implicitly;
     PetscInt  redundancy;
     PetscReal GGt_relative_fill;
+    PetscBool fusedP, fusedP_active;  /* apply P with one MatMultTransposeAdd of G instead of Gt mult + AYPX */
+    QPPFGGtStorage GGt_storage;
+    PetscReal GGt_dense_fill;     /* switch to dense GGt above this fill in auto mode */
+    PetscReal GGt_fill;           /* measured fill of assembled GGt, -1 if unknown */
+    PetscBool GGt_dense;
+
+    /* multilevel mode - GG' solved by CG preconditioned with a cluster coarse problem (H-TFETI) */
+    PetscBool multilevel;
+    PetscInt  ml_cluster_size;    /* number of consecutive ranks aggregated into one cluster */
+    Mat       ml_Z;               /* aggregation of subdomain coarse DOFs into cluster coarse DOFs */
+    Mat       ml_Gcinv;           /* inverse of the cluster coarse problem Z'*GG'*Z */
+    KSP       ml_ksp_local;       /* solver of the rank-local diagonal block of GG' */
+    Vec       ml_xloc, ml_yloc, ml_xc, ml_yc;
 
     PetscBool setupcalled, dataChange, variantChange, explicitInvChange, GChange;
     PetscInt setfromoptionscalled;
@@ -25,9 +49,13 @@ struct _p_QPPF {
     Vec G_left;
     Vec alpha_tilde;
 
-    Vec QPPFApplyQ_last_v;
-    Vec QPPFApplyQ_last_Qv;
-    PetscObjectState QPPFApplyQ_last_v_state;
+    /* LRU cache of applications, keyed on (operation, Vec id, Vec state) */
+    QPPFCacheEntry *cache;
+    PetscInt cache_size, cache_clock;
+    PetscInt cache_hits, cache_misses;
+    PetscObjectId cache_pending_id;       /* key of the input of the split Q/P application between Begin and End, 0 if none */
+    PetscObjectState cache_pending_state;
+    PetscBool cache_pending_started;      /* G*v and the coarse solve of the pending application are in flight (not a cache hit) */
 };
 
 
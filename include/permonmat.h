@@ -53,7 +53,7 @@ FLLOP_EXTERN PetscErrorCode MatCreateTransposePermon(Mat A,Mat *At);
 
 /*   REGULARIZATION   */
 typedef enum {MAT_REG_NONE=0, MAT_REG_EXPLICIT=1, MAT_REG_IMPLICIT=2} MatRegularizationType;
-FLLOP_EXTERN PetscErrorCode MatRegularize(Mat K, Mat R, MatRegularizationType type, Mat *newKreg);
+FLLOP_EXTERN PetscErrorCode MatRegularize(Mat K, Mat R, MatRegularizationType type, MatReuse scall, Mat *newKreg);
 
 /* MATEXTENSION specific methods */
 FLLOP_EXTERN PetscErrorCode MatExtensionCreateCondensedRows(Mat TA,Mat *A,IS *ris_local);
@@ -90,12 +90,18 @@ FLLOP_EXTERN PetscErrorCode MatInvSetNullSpace(Mat imat,Mat R);
 FLLOP_EXTERN PetscErrorCode MatInvExplicitly(Mat imat, PetscBool transpose, MatReuse scall, Mat *imat_explicit);
 FLLOP_EXTERN PetscErrorCode MatInvReset(Mat imat);
 FLLOP_EXTERN PetscErrorCode MatInvSetUp(Mat imat);
+FLLOP_EXTERN PetscErrorCode MatInvMultBegin(Mat imat, Vec right);
+FLLOP_EXTERN PetscErrorCode MatInvMultEnd(Mat imat, Vec right, Vec left);
 FLLOP_EXTERN PetscErrorCode MatInvCreateInnerObjects(Mat imat);
 
 /* MATTIMER specific methods */
 FLLOP_EXTERN PetscErrorCode MatTimerGetMat(Mat W, Mat *A);
 FLLOP_EXTERN PetscErrorCode MatTimerSetOperation(Mat mat,MatOperation op,const char *opname,void(*opf)(void));
 
+/* MATBLOCKDIAG specific methods */
+FLLOP_EXTERN PetscErrorCode MatBlockDiagSetLocalBlockSizes(Mat A,PetscInt nblocks,const PetscInt lens[]);
+FLLOP_EXTERN PetscErrorCode MatBlockDiagGetLocalBlockSizes(Mat A,PetscInt *nblocks,const PetscInt *lens[]);
+
 /* MATGLUING specific methods */
 FLLOP_EXTERN PetscErrorCode MatGluingSetLocalBlock(Mat B,Mat Block,PetscInt nghosts);
 FLLOP_EXTERN PetscErrorCode MatGluingLayoutSetUp(Mat B);
@@ -145,6 +151,10 @@ FLLOP_EXTERN PetscErrorCode PermonMatCreateDenseProductMatrix(Mat A, PetscBool A
 FLLOP_EXTERN PetscErrorCode PermonMatConvertBlocks(Mat A, MatType newtype,MatReuse reuse,Mat *B);
 FLLOP_EXTERN PetscErrorCode PermonMatCopyProperties(Mat A,Mat B);
 FLLOP_EXTERN PetscErrorCode PermonMatSetFromOptions(Mat B);
+FLLOP_EXTERN PetscErrorCode PermonMatMultBegin(Mat A,Vec x,Vec y);
+FLLOP_EXTERN PetscErrorCode PermonMatMultEnd(Mat A,Vec x,Vec y);
+FLLOP_EXTERN PetscErrorCode PermonMatMultTransposeBegin(Mat A,Vec x,Vec y);
+FLLOP_EXTERN PetscErrorCode PermonMatMultTransposeEnd(Mat A,Vec x,Vec y);
 FLLOP_EXTERN PetscErrorCode PermonMatConvertInplace(Mat B, MatType type);
 FLLOP_EXTERN PetscErrorCode MatCheckNullSpace(Mat K,Mat R,PetscReal tol);
 FLLOP_EXTERN PetscErrorCode MatRedistributeRows(Mat mat_from,IS rowperm,PetscInt base,Mat mat_to);
@@ -154,7 +164,7 @@ FLLOP_EXTERN PetscErrorCode MatRemoveGluingOfDirichletDofs(Mat Bgt, Vec cg, Mat
 FLLOP_EXTERN PetscErrorCode MatRemoveGluingOfDirichletDofs_old(Mat Bgt, Vec cg, Mat Bdt, Mat *Bgt_new, Vec *cg_new, IS *is_new);
 
 /*   ORTHONORMALIZATION   */
-typedef enum {MAT_ORTH_NONE=0, MAT_ORTH_GS, MAT_ORTH_GS_LINGEN, MAT_ORTH_CHOLESKY, MAT_ORTH_IMPLICIT, MAT_ORTH_INEXACT} MatOrthType;
+typedef enum {MAT_ORTH_NONE=0, MAT_ORTH_GS, MAT_ORTH_GS_LINGEN, MAT_ORTH_CHOLESKY, MAT_ORTH_IMPLICIT, MAT_ORTH_INEXACT, MAT_ORTH_CHOLQR2, MAT_ORTH_TSQR} MatOrthType;
 typedef enum {MAT_ORTH_FORM_IMPLICIT=0, MAT_ORTH_FORM_EXPLICIT=1} MatOrthForm;
 FLLOP_EXTERN const char *MatOrthTypes[], *MatOrthForms[];
 FLLOP_EXTERN PetscErrorCode MatOrthColumns(Mat mat, MatOrthType type, MatOrthForm form, Mat *matOrth, Mat *T);
@@ -10,6 +10,7 @@ FLLOP_EXTERN PetscClassId QP_CLASSID;
 typedef enum {QP_SCALE_NONE,QP_SCALE_ROWS_NORM_2,QP_SCALE_DDM_MULTIPLICITY} QPScaleType;
 FLLOP_EXTERN const char *QPScaleTypes[];
 typedef enum {QP_DUPLICATE_DO_NOT_COPY,QP_DUPLICATE_COPY_POINTERS} QPDuplicateOption;
+typedef struct _n_QPTReuseCPCtx* QPTReuseCPCtx;
 
 FLLOP_EXTERN PetscErrorCode QPChainAdd(QP qp,QPDuplicateOption opt,QP *newchild);
 FLLOP_EXTERN PetscErrorCode QPChainPop(QP qp);
@@ -98,6 +99,10 @@ FLLOP_EXTERN PetscErrorCode QPTRemoveGluingOfDirichletDofs(QP qp);
 FLLOP_EXTERN PetscErrorCode QPTFetiPrepare(QP qp,PetscBool regularize);
 FLLOP_EXTERN PetscErrorCode QPTFetiPrepareReuseCP(QP qp,PetscBool regularize);
 FLLOP_EXTERN PetscErrorCode QPTFetiPrepareReuseCPReset();
+FLLOP_EXTERN PetscErrorCode QPTFetiPrepareReuseCPWithCtx(QP qp,PetscBool regularize,QPTReuseCPCtx ctx);
+FLLOP_EXTERN PetscErrorCode QPTReuseCPCtxCreate(QPTReuseCPCtx *ctx);
+FLLOP_EXTERN PetscErrorCode QPTReuseCPCtxReset(QPTReuseCPCtx ctx);
+FLLOP_EXTERN PetscErrorCode QPTReuseCPCtxDestroy(QPTReuseCPCtx *ctx);
 FLLOP_EXTERN PetscErrorCode QPTFreezeIneq(QP qp);
 FLLOP_EXTERN PetscErrorCode QPTSplitBE(QP qp);
 FLLOP_EXTERN PetscErrorCode QPTAllInOne(QP qp,MatInvType invType,PetscBool dual,PetscBool project,PetscReal penalty,PetscBool penalty_direct,PetscBool regularize);
@@ -45,8 +45,11 @@ FLLOP_EXTERN PetscErrorCode QPCGetNumberOfConstraints(QPC,PetscInt *num);
 
 FLLOP_EXTERN PetscErrorCode QPCProject(QPC,Vec x,Vec Px);
 FLLOP_EXTERN PetscErrorCode QPCGrads(QPC,Vec x,Vec g,Vec gf,Vec gc);
+FLLOP_EXTERN PetscErrorCode QPCGradsNorms(QPC,Vec x,Vec g,Vec gf,Vec gc,Vec gP,PetscReal dots[]);
 FLLOP_EXTERN PetscErrorCode QPCGradReduced(QPC qpc, Vec x, Vec gf, PetscReal alpha, Vec gr);
 FLLOP_EXTERN PetscErrorCode QPCFeas(QPC,Vec x,Vec d,PetscScalar *alpha);
+FLLOP_EXTERN PetscErrorCode QPCFeasBegin(QPC,Vec x,Vec d);
+FLLOP_EXTERN PetscErrorCode QPCFeasEnd(QPC,PetscScalar *alpha);
 FLLOP_EXTERN PetscErrorCode QPCOuterNormal(QPC,PetscScalar *n_a,PetscScalar *xconstr_a,PetscInt local_idx);
 
 /* BOX */
@@ -54,6 +57,7 @@ FLLOP_EXTERN PetscErrorCode QPCCreateBox(MPI_Comm comm,IS is,Vec lb,Vec ub,QPC *
 FLLOP_EXTERN PetscErrorCode QPCBoxSet(QPC qpc,Vec lb,Vec ub);
 FLLOP_EXTERN PetscErrorCode QPCBoxGet(QPC qpc,Vec *lb,Vec *ub);
 FLLOP_EXTERN PetscErrorCode QPCBoxGetMultipliers(QPC qpc,Vec *llb,Vec *lub);
+FLLOP_EXTERN PetscErrorCode QPCBoxSetReferenceKernels(QPC qpc,PetscBool flg);
 
 #endif
 
@@ -17,5 +17,6 @@ FLLOP_EXTERN PetscErrorCode QPFetiSetDirichlet(QP qp, IS dbcis, QPFetiNumberingT
 FLLOP_EXTERN PetscErrorCode QPFetiSetLocalToGlobalMapping(QP qp, IS l2g_dof_map);
 FLLOP_EXTERN PetscErrorCode QPFetiSetInterfaceToGlobalMapping(QP qp, IS i2g);
 FLLOP_EXTERN PetscErrorCode QPFetiSetUp(QP qp);
+FLLOP_EXTERN PetscErrorCode QPFetiReassemble(QP qp);
 
 #endif
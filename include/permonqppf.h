@@ -4,6 +4,9 @@
 
 typedef struct _p_QPPF* QPPF;
 
+typedef enum {QPPF_GGT_STORAGE_AUTO=0, QPPF_GGT_STORAGE_SPARSE=1, QPPF_GGT_STORAGE_DENSE=2, QPPF_GGT_STORAGE_IMPLICIT=3} QPPFGGtStorage;
+FLLOP_EXTERN const char *QPPFGGtStorages[];
+
 FLLOP_EXTERN PetscClassId QPPF_CLASSID;
 #define QPPF_CLASS_NAME  "qppf"
 
@@ -23,10 +26,21 @@ FLLOP_EXTERN PetscErrorCode QPPFApplyHalfQ(QPPF cp, Vec x, Vec y);
 FLLOP_EXTERN PetscErrorCode QPPFApplyHalfQTranspose(QPPF cp, Vec x, Vec y);
 FLLOP_EXTERN PetscErrorCode QPPFApplyCP(QPPF cp, Vec x, Vec y);
 FLLOP_EXTERN PetscErrorCode QPPFApplyGtG(QPPF cp, Vec v, Vec GtGv);
+FLLOP_EXTERN PetscErrorCode QPPFApplyPBegin(QPPF cp, Vec v);
+FLLOP_EXTERN PetscErrorCode QPPFApplyPEnd(QPPF cp, Vec v, Vec Pv);
+FLLOP_EXTERN PetscErrorCode QPPFApplyQBegin(QPPF cp, Vec v);
+FLLOP_EXTERN PetscErrorCode QPPFApplyQEnd(QPPF cp, Vec v, Vec Qv);
+FLLOP_EXTERN PetscErrorCode QPPFApplyCPBegin(QPPF cp, Vec x);
+FLLOP_EXTERN PetscErrorCode QPPFApplyCPEnd(QPPF cp, Vec x, Vec y);
 
 FLLOP_EXTERN PetscErrorCode QPPFSetG(QPPF cp, Mat G);
 FLLOP_EXTERN PetscErrorCode QPPFSetRedundancy(QPPF cp,PetscInt nred);
+FLLOP_EXTERN PetscErrorCode QPPFSetCacheSize(QPPF cp,PetscInt size);
 FLLOP_EXTERN PetscErrorCode QPPFSetExplicitInv(QPPF cp,PetscBool explicitInv);
+FLLOP_EXTERN PetscErrorCode QPPFSetGGtStorage(QPPF cp,QPPFGGtStorage storage,PetscReal dense_fill);
+FLLOP_EXTERN PetscErrorCode QPPFGetGGtStorage(QPPF cp,QPPFGGtStorage *storage,PetscReal *dense_fill);
+FLLOP_EXTERN PetscErrorCode QPPFSetMultilevel(QPPF cp,PetscBool multilevel,PetscInt cluster_size);
+FLLOP_EXTERN PetscErrorCode QPPFGetMultilevel(QPPF cp,PetscBool *multilevel,PetscInt *cluster_size);
 
 FLLOP_EXTERN PetscErrorCode QPPFCreateQ(QPPF cp, Mat *Q);
 FLLOP_EXTERN PetscErrorCode QPPFCreateP(QPPF cp, Mat *P);
@@ -107,6 +107,8 @@ FLLOP_EXTERN PetscErrorCode QPSMPGPGetGamma(QPS qps,PetscReal *gamma);
 FLLOP_EXTERN PetscErrorCode QPSMPGPGetOperatorMaxEigenvalue(QPS qps,PetscReal *maxeig);
 FLLOP_EXTERN PetscErrorCode QPSMPGPSetOperatorMaxEigenvalue(QPS qps,PetscReal maxeig);
 FLLOP_EXTERN PetscErrorCode QPSMPGPUpdateMaxEigenvalue(QPS qps, PetscReal maxeig_update);
+FLLOP_EXTERN PetscErrorCode QPSMPGPGetGradient(QPS qps,Vec *g);
+FLLOP_EXTERN PetscErrorCode QPSMPGPSetReuseGradient(QPS qps,PetscBool flg);
 FLLOP_EXTERN PetscErrorCode QPSMPGPSetOperatorMaxEigenvalueTolerance(QPS qps,PetscReal tol);
 FLLOP_EXTERN PetscErrorCode QPSMPGPGetOperatorMaxEigenvalueTolerance(QPS qps,PetscReal *tol);
 FLLOP_EXTERN PetscErrorCode QPSMPGPGetOperatorMaxEigenvalueIterations(QPS qps,PetscInt *numit);
@@ -5,6 +5,7 @@
 #define TAG_firstElemGlobIdx 198533
 
 static PetscErrorCode MatGetDiagonalBlock_BlockDiag(Mat,Mat*);
+static PetscErrorCode MatBlockDiagSetLocalBlockSizes_BlockDiag(Mat,PetscInt,const PetscInt[]);
 
 #undef __FUNCT__
 #define __FUNCT__ "MatZeroRowsColumns_BlockDiag"
@@ -173,6 +174,8 @@ static PetscErrorCode PermonMatConvertBlocks_BlockDiag(Mat A, MatType newtype, M
   if (reuse == MAT_INPLACE_MATRIX) cblock = data->localBlock;
   PetscCall(MatConvert(data->localBlock,newtype,reuse,&cblock));
   PetscCall(MatCreateBlockDiag(PetscObjectComm((PetscObject)A),cblock,&B_));
+  /* keep the subdomain blocks; A's data is gone after MatHeaderReplace */
+  PetscCall(MatBlockDiagSetLocalBlockSizes_BlockDiag(B_,data->nblocks,data->blens));
   if (reuse != MAT_INPLACE_MATRIX) {
     PetscCall(MatDestroy(&cblock));
     *B = B_;
@@ -186,12 +189,154 @@ static PetscErrorCode PermonMatConvertBlocks_BlockDiag(Mat A, MatType newtype, M
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatBlockDiagSetLocalBlockSizes_BlockDiag"
+static PetscErrorCode MatBlockDiagSetLocalBlockSizes_BlockDiag(Mat A, PetscInt nblocks, const PetscInt lens[])
+{
+  Mat_BlockDiag *data = (Mat_BlockDiag*) A->data;
+  PetscInt i;
+
+  PetscFunctionBegin;
+  if (nblocks < 1) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_OUTOFRANGE,"number of blocks must be positive, got %" PetscInt_FMT,nblocks);
+  if (A->rmap->n != A->cmap->n) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_SIZ,"local block must be square to be split into subdomain blocks");
+  PetscCall(PetscFree2(data->blens,data->boffsets));
+  data->nblocks = nblocks;
+  if (nblocks == 1) PetscFunctionReturn(0);
+
+  PetscCall(PetscMalloc2(nblocks,&data->blens,nblocks+1,&data->boffsets));
+  data->boffsets[0] = 0;
+  for (i=0; i<nblocks; i++) {
+    data->blens[i] = lens[i];
+    data->boffsets[i+1] = data->boffsets[i] + lens[i];
+  }
+  if (data->boffsets[nblocks] != A->rmap->n) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_SIZ,"sum of block sizes %" PetscInt_FMT " != local size %" PetscInt_FMT,data->boffsets[nblocks],A->rmap->n);
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatBlockDiagSetLocalBlockSizes"
+/*@
+   MatBlockDiagSetLocalBlockSizes - Declares that the local block of a MATBLOCKDIAG matrix
+   consists of several independent diagonal blocks (e.g. several subdomains per rank).
+
+   Not Collective
+
+   Input Parameters:
++  A       - the MATBLOCKDIAG matrix
+.  nblocks - number of blocks on this rank
+-  lens    - sizes of the blocks, must sum up to the local size
+
+   Notes:
+   The blocks are applied concurrently by MatMult() when PETSc is configured with OpenMP,
+   and MATINV of type MAT_INV_BLOCKDIAG factors and solves them separately.
+
+   Level: advanced
+
+.seealso: MatBlockDiagGetLocalBlockSizes(), MatCreateBlockDiag()
+@*/
+PetscErrorCode MatBlockDiagSetLocalBlockSizes(Mat A, PetscInt nblocks, const PetscInt lens[])
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(A,MAT_CLASSID,1);
+  if (nblocks > 1) PetscValidIntPointer(lens,3);
+  PetscUseMethod(A,"MatBlockDiagSetLocalBlockSizes_BlockDiag_C",(Mat,PetscInt,const PetscInt[]),(A,nblocks,lens));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatBlockDiagGetLocalBlockSizes_BlockDiag"
+static PetscErrorCode MatBlockDiagGetLocalBlockSizes_BlockDiag(Mat A, PetscInt *nblocks, const PetscInt *lens[])
+{
+  Mat_BlockDiag *data = (Mat_BlockDiag*) A->data;
+
+  PetscFunctionBegin;
+  if (nblocks) *nblocks = data->nblocks;
+  if (lens) *lens = data->blens;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatBlockDiagGetLocalBlockSizes"
+/*@
+   MatBlockDiagGetLocalBlockSizes - Returns the local subdomain blocks set with MatBlockDiagSetLocalBlockSizes().
+
+   Not Collective
+
+   Input Parameter:
+.  A       - the MATBLOCKDIAG matrix
+
+   Output Parameters:
++  nblocks - number of blocks on this rank
+-  lens    - sizes of the blocks, NULL if nblocks is 1
+
+   Level: advanced
+
+.seealso: MatBlockDiagSetLocalBlockSizes()
+@*/
+PetscErrorCode MatBlockDiagGetLocalBlockSizes(Mat A, PetscInt *nblocks, const PetscInt *lens[])
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(A,MAT_CLASSID,1);
+  PetscUseMethod(A,"MatBlockDiagGetLocalBlockSizes_BlockDiag_C",(Mat,PetscInt*,const PetscInt*[]),(A,nblocks,lens));
+  PetscFunctionReturn(0);
+}
+
+#if defined(PETSC_HAVE_OPENMP)
+#undef __FUNCT__
+#define __FUNCT__ "MatMultBlocks_BlockDiag_SeqAIJ"
+/* y = A_loc*x with the subdomain blocks processed concurrently; dynamic scheduling balances blocks of uneven size */
+static PetscErrorCode MatMultBlocks_BlockDiag_SeqAIJ(Mat mat, Vec right, Vec left)
+{
+  Mat_BlockDiag *data = (Mat_BlockDiag*) mat->data;
+  const PetscInt *ia, *ja, *boffsets = data->boffsets;
+  const PetscScalar *aa, *x;
+  PetscScalar *y;
+  PetscInt n, b;
+  PetscBool done;
+
+  PetscFunctionBegin;
+  PetscCall(MatGetRowIJ(data->localBlock,0,PETSC_FALSE,PETSC_FALSE,&n,&ia,&ja,&done));
+  if (!done) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_PLIB,"MatGetRowIJ failed");
+  PetscCall(MatSeqAIJGetArrayRead(data->localBlock,&aa));
+  PetscCall(VecGetArrayRead(right,&x));
+  PetscCall(VecGetArrayWrite(left,&y));
+#pragma omp parallel for schedule(dynamic,1)
+  for (b=0; b<data->nblocks; b++) {
+    PetscInt i, k;
+    PetscScalar sum;
+
+    for (i=boffsets[b]; i<boffsets[b+1]; i++) {
+      sum = 0.0;
+      for (k=ia[i]; k<ia[i+1]; k++) sum += aa[k]*x[ja[k]];
+      y[i] = sum;
+    }
+  }
+  PetscCall(PetscLogFlops(2.0*ia[n]-n));
+  PetscCall(VecRestoreArrayWrite(left,&y));
+  PetscCall(VecRestoreArrayRead(right,&x));
+  PetscCall(MatSeqAIJRestoreArrayRead(data->localBlock,&aa));
+  PetscCall(MatRestoreRowIJ(data->localBlock,0,PETSC_FALSE,PETSC_FALSE,&n,&ia,&ja,&done));
+  PetscFunctionReturn(0);
+}
+#endif
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatMult_BlockDiag"
 PetscErrorCode MatMult_BlockDiag(Mat mat, Vec right, Vec left) {
   Mat_BlockDiag *data = (Mat_BlockDiag*) mat->data;
 
   PetscFunctionBegin;
+#if defined(PETSC_HAVE_OPENMP)
+  if (data->nblocks > 1) {
+    PetscBool flg;
+
+    PetscCall(PetscObjectTypeCompare((PetscObject)data->localBlock,MATSEQAIJ,&flg));
+    if (flg) {
+      PetscCall(MatMultBlocks_BlockDiag_SeqAIJ(mat,right,left));
+      PetscFunctionReturn(0);
+    }
+  }
+#endif
   PetscCall(VecGetLocalVectorRead(right,data->xloc));
   PetscCall(VecGetLocalVector(left,data->yloc));
   PetscCall(MatMult(data->localBlock, data->xloc, data->yloc));
@@ -419,6 +564,48 @@ static PetscErrorCode MatProductSetFromOptions_BlockDiag(Mat C)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatProductNumeric_BlockDiag_Dense"
+static PetscErrorCode MatProductNumeric_BlockDiag_Dense(Mat C)
+{
+  Mat_Product    *product = C->product;
+  Mat            A=product->A,B=product->B;
+  Mat_BlockDiag  *data = (Mat_BlockDiag*)A->data;
+  Mat            B_loc,C_loc;
+
+  PetscFunctionBegin;
+  /* no communication, the local block multiplies the local rows of B as one block */
+  PetscCall(MatDenseGetLocalMatrix(B,&B_loc));
+  PetscCall(MatDenseGetLocalMatrix(C,&C_loc));
+  PetscCall(PermonMatMatMultDense_Private(data->localBlock,B_loc,C_loc));
+  PetscCall(PetscObjectStateIncrease((PetscObject)C));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSymbolic_BlockDiag_Dense"
+static PetscErrorCode MatProductSymbolic_BlockDiag_Dense(Mat C)
+{
+  Mat_Product    *product = C->product;
+  Mat            A=product->A,B=product->B;
+
+  PetscFunctionBegin;
+  PetscCall(MatSetSizes(C,A->rmap->n,B->cmap->n,A->rmap->N,B->cmap->N));
+  if (!((PetscObject)C)->type_name) PetscCall(MatSetType(C,MATDENSE));
+  PetscCall(MatSetUp(C));
+  C->ops->productnumeric  = MatProductNumeric_BlockDiag_Dense;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSetFromOptions_BlockDiag_Dense"
+static PetscErrorCode MatProductSetFromOptions_BlockDiag_Dense(Mat C)
+{
+  PetscFunctionBegin;
+  if (C->product->type == MATPRODUCT_AB) C->ops->productsymbolic = MatProductSymbolic_BlockDiag_Dense;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatDestroy_BlockDiag"
 PetscErrorCode MatDestroy_BlockDiag(Mat mat) {
@@ -431,6 +618,7 @@ PetscErrorCode MatDestroy_BlockDiag(Mat mat) {
   PetscCall(VecDestroy(&data->yloc));
   PetscCall(VecDestroy(&data->xloc1));
   PetscCall(VecDestroy(&data->yloc1));
+  PetscCall(PetscFree2(data->blens,data->boffsets));
   PetscCall(PetscFree(data));
   PetscFunctionReturn(0);
 }
@@ -455,16 +643,44 @@ PetscErrorCode MatDuplicate_BlockDiag(Mat matin,MatDuplicateOption cpvalues,Mat
   PetscCall(VecDuplicate(datain->yloc,&dataout->yloc));
   PetscCall(VecDuplicate(datain->yloc1,&dataout->yloc1));
   PetscCall(VecDuplicate(datain->xloc,&dataout->xloc));
+  PetscCall(MatBlockDiagSetLocalBlockSizes_BlockDiag(matout,datain->nblocks,datain->blens));
+  PetscCall(PetscObjectStateGet((PetscObject)dataout->localBlock,&dataout->locstate));
+  dataout->locnzstate = dataout->localBlock->nonzerostate;
   *newmat = matout;
   PetscFunctionReturn(0);  
 }
 
+#undef __FUNCT__  
+#define __FUNCT__ "MatBlockDiagUpdateState_Private"
+/* propagate changes made directly to the local block into the state and nonzero state of A; no-op for other types */
+PetscErrorCode MatBlockDiagUpdateState_Private(Mat A) {
+  Mat_BlockDiag    *data;
+  PetscObjectState state;
+  PetscBool        flg;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectTypeCompare((PetscObject)A,MATBLOCKDIAG,&flg));
+  if (!flg) PetscFunctionReturn(0);
+  data = (Mat_BlockDiag*) A->data;
+  PetscCall(PetscObjectStateGet((PetscObject)data->localBlock,&state));
+  if (state != data->locstate) {
+    PetscCall(PetscObjectStateIncrease((PetscObject)A));
+    data->locstate = state;
+  }
+  if (data->localBlock->nonzerostate != data->locnzstate) {
+    A->nonzerostate++;
+    data->locnzstate = data->localBlock->nonzerostate;
+  }
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatGetDiagonalBlock_BlockDiag"
 static PetscErrorCode MatGetDiagonalBlock_BlockDiag(Mat A, Mat *A_loc) {
   Mat_BlockDiag *data = (Mat_BlockDiag*) A->data;
 
   PetscFunctionBegin;
+  PetscCall(MatBlockDiagUpdateState_Private(A));
   *A_loc = data->localBlock;
   PetscFunctionReturn(0);
 }
@@ -594,6 +810,7 @@ PetscErrorCode MatAssemblyEnd_BlockDiag(Mat mat, MatAssemblyType type)
   
   PetscFunctionBegin;
   PetscCall(MatAssemblyEnd(bd->localBlock, type));
+  PetscCall(MatBlockDiagUpdateState_Private(mat));
   PetscFunctionReturn(0);
 }
 
@@ -718,6 +935,11 @@ FLLOP_EXTERN PetscErrorCode MatCreate_BlockDiag(Mat B) {
   data->yloc                 = NULL;
   data->xloc1                = NULL;
   data->yloc1                = NULL;
+  data->nblocks              = 1;
+  data->blens                = NULL;
+  data->boffsets             = NULL;
+  data->locstate             = 0;
+  data->locnzstate           = 0;
 
   /* Set operations of matrix. */
   B->ops->destroy            = MatDestroy_BlockDiag;
@@ -745,9 +967,15 @@ FLLOP_EXTERN PetscErrorCode MatCreate_BlockDiag(Mat B) {
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MaProductSetFromOptions_blockdiag_aij_C",MatProductSetFromOptions_BlockDiag_AIJ));
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MaProductSetFromOptions_blockdiag_seqaij_C",MatProductSetFromOptions_BlockDiag_AIJ));
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MaProductSetFromOptions_blockdiag_mpiaij",MatProductSetFromOptions_BlockDiag_AIJ));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatProductSetFromOptions_blockdiag_seqdense_C",MatProductSetFromOptions_BlockDiag_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatProductSetFromOptions_blockdiag_mpidense_C",MatProductSetFromOptions_BlockDiag_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatProductSetFromOptions_blockdiag_seqdensepermon_C",MatProductSetFromOptions_BlockDiag_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatProductSetFromOptions_blockdiag_mpidensepermon_C",MatProductSetFromOptions_BlockDiag_Dense));
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatConvert_blockdiag_aij_C",MatConvert_BlockDiag_AIJ));
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatOrthColumns_C",MatOrthColumns_BlockDiag));
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"PermonMatConvertBlocks_C",PermonMatConvertBlocks_BlockDiag));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatBlockDiagSetLocalBlockSizes_BlockDiag_C",MatBlockDiagSetLocalBlockSizes_BlockDiag));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatBlockDiagGetLocalBlockSizes_BlockDiag_C",MatBlockDiagGetLocalBlockSizes_BlockDiag));
   PetscFunctionReturn(0);
 }
 
@@ -779,6 +1007,8 @@ PetscErrorCode MatCreateBlockDiag(MPI_Comm comm, Mat block, Mat *B_new) {
       PetscCall(PetscObjectReference((PetscObject) block));
   }
   data->localBlock = block;
+  PetscCall(PetscObjectStateGet((PetscObject)block,&data->locstate));
+  data->locnzstate = block->nonzerostate;
 
   /* Set up row layout */
   PetscCall(PetscLayoutSetBlockSize(B->rmap,block->rmap->bs));
@@ -36,16 +36,17 @@ PetscErrorCode MatProdGetMat(Mat A,PetscInt i,Mat *Ai)
   PetscFunctionReturn(0);
 }
 
-#undef __FUNCT__  
-#define __FUNCT__ "MatMult_Prod"
-PetscErrorCode MatMult_Prod(Mat A,Vec x,Vec y)
+#undef __FUNCT__
+#define __FUNCT__ "MatMultBegin_Prod"
+/* start the split-phase multiplication by the first factor; its communication can overlap with the caller's work */
+static PetscErrorCode MatMultBegin_Prod(Mat A,Vec x,Vec y)
 {
-  Mat_Composite     *shell = (Mat_Composite*)A->data;  
-  Mat_CompositeLink next = shell->head;
+  Mat_Composite     *shell = (Mat_Composite*)A->data;
+  Mat_CompositeLink head = shell->head;
   Vec               in,out;
 
   PetscFunctionBegin;
-  if (!next) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_WRONGSTATE,"Must provide at least one matrix with MatCompositeAddMat()");
+  if (!head) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_WRONGSTATE,"Must provide at least one matrix with MatCompositeAddMat()");
   in = x;
   if (shell->right) {
     if (!shell->rightwork) {
@@ -54,16 +55,45 @@ PetscErrorCode MatMult_Prod(Mat A,Vec x,Vec y)
     PetscCall(VecPointwiseMult(shell->rightwork,shell->right,in));
     in   = shell->rightwork;
   }
-  while (next->next) {
-    if (!next->work) { /* should reuse previous work if the same size */
-      PetscCall(MatCreateVecs(next->mat,NULL,&next->work));
+  if (head->next) {
+    if (!head->work) { /* should reuse previous work if the same size */
+      PetscCall(MatCreateVecs(head->mat,NULL,&head->work));
+    }
+    out = head->work;
+  } else {
+    out = y;
+  }
+  PetscCall(PermonMatMultBegin(head->mat,in,out));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultEnd_Prod"
+static PetscErrorCode MatMultEnd_Prod(Mat A,Vec x,Vec y)
+{
+  Mat_Composite     *shell = (Mat_Composite*)A->data;
+  Mat_CompositeLink next = shell->head;
+  Vec               in,out;
+
+  PetscFunctionBegin;
+  in = shell->right ? shell->rightwork : x;
+  out = next->next ? next->work : y;
+  PetscCall(PermonMatMultEnd(next->mat,in,out));
+  in   = out;
+  next = next->next;
+  while (next) {
+    if (next->next) {
+      if (!next->work) { /* should reuse previous work if the same size */
+        PetscCall(MatCreateVecs(next->mat,NULL,&next->work));
+      }
+      out = next->work;
+    } else {
+      out = y;
     }
-    out = next->work;
     PetscCall(MatMult(next->mat,in,out));
     in   = out;
     next = next->next;
   }
-  PetscCall(MatMult(next->mat,in,y));
   if (shell->left) {
     PetscCall(VecPointwiseMult(y,shell->left,y));
   }
@@ -72,10 +102,20 @@ PetscErrorCode MatMult_Prod(Mat A,Vec x,Vec y)
 }
 
 #undef __FUNCT__  
-#define __FUNCT__ "MatMultTranspose_Prod"
-PetscErrorCode MatMultTranspose_Prod(Mat A,Vec x,Vec y)
+#define __FUNCT__ "MatMult_Prod"
+PetscErrorCode MatMult_Prod(Mat A,Vec x,Vec y)
 {
-  Mat_Composite     *shell = (Mat_Composite*)A->data;  
+  PetscFunctionBegin;
+  PetscCall(MatMultBegin_Prod(A,x,y));
+  PetscCall(MatMultEnd_Prod(A,x,y));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTransposeBegin_Prod"
+static PetscErrorCode MatMultTransposeBegin_Prod(Mat A,Vec x,Vec y)
+{
+  Mat_Composite     *shell = (Mat_Composite*)A->data;
   Mat_CompositeLink tail = shell->tail;
   Vec               in,out;
 
@@ -89,16 +129,45 @@ PetscErrorCode MatMultTranspose_Prod(Mat A,Vec x,Vec y)
     PetscCall(VecPointwiseMult(shell->leftwork,shell->left,in));
     in   = shell->leftwork;
   }
-  while (tail->prev) {
+  if (tail->prev) {
     if (!tail->prev->work) { /* should reuse previous work if the same size */
       PetscCall(MatCreateVecs(tail->mat,&tail->prev->work,NULL));
     }
     out = tail->prev->work;
+  } else {
+    out = y;
+  }
+  PetscCall(PermonMatMultTransposeBegin(tail->mat,in,out));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTransposeEnd_Prod"
+static PetscErrorCode MatMultTransposeEnd_Prod(Mat A,Vec x,Vec y)
+{
+  Mat_Composite     *shell = (Mat_Composite*)A->data;
+  Mat_CompositeLink tail = shell->tail;
+  Vec               in,out;
+
+  PetscFunctionBegin;
+  in = shell->left ? shell->leftwork : x;
+  out = tail->prev ? tail->prev->work : y;
+  PetscCall(PermonMatMultTransposeEnd(tail->mat,in,out));
+  in   = out;
+  tail = tail->prev;
+  while (tail) {
+    if (tail->prev) {
+      if (!tail->prev->work) { /* should reuse previous work if the same size */
+        PetscCall(MatCreateVecs(tail->mat,&tail->prev->work,NULL));
+      }
+      out = tail->prev->work;
+    } else {
+      out = y;
+    }
     PetscCall(MatMultTranspose(tail->mat,in,out));
     in   = out;
     tail = tail->prev;
   }
-  PetscCall(MatMultTranspose(tail->mat,in,y));
   if (shell->right) {
     PetscCall(VecPointwiseMult(y,shell->right,y));
   }
@@ -106,6 +175,16 @@ PetscErrorCode MatMultTranspose_Prod(Mat A,Vec x,Vec y)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__  
+#define __FUNCT__ "MatMultTranspose_Prod"
+PetscErrorCode MatMultTranspose_Prod(Mat A,Vec x,Vec y)
+{
+  PetscFunctionBegin;
+  PetscCall(MatMultTransposeBegin_Prod(A,x,y));
+  PetscCall(MatMultTransposeEnd_Prod(A,x,y));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatMultAdd_Prod"
 PetscErrorCode MatMultAdd_Prod(Mat A,Vec x,Vec y,Vec z)
@@ -144,6 +223,96 @@ PetscErrorCode MatMultTransposeAdd_Prod(Mat A,Vec x,Vec y, Vec z)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatCompositeDenseDestroy_Private"
+PetscErrorCode MatCompositeDenseDestroy_Private(void *data)
+{
+  Mat_CompositeDense *ctx = (Mat_CompositeDense*)data;
+  PetscInt           i;
+
+  PetscFunctionBegin;
+  for (i=0; i<ctx->nwork; i++) {
+    PetscCall(MatDestroy(&ctx->work[i]));
+  }
+  PetscCall(PetscFree(ctx->work));
+  PetscCall(MatDestroy(&ctx->Bright));
+  PetscCall(PetscFree(ctx));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductNumeric_Prod_Dense"
+/* the whole block goes through each factor at once, e.g. one KSPMatSolve for MATINV and one SpMM for AIJ factors */
+static PetscErrorCode MatProductNumeric_Prod_Dense(Mat C)
+{
+  Mat_Product        *product = C->product;
+  Mat                A=product->A,B=product->B;
+  Mat_Composite      *shell = (Mat_Composite*)A->data;
+  Mat_CompositeDense *ctx = (Mat_CompositeDense*)product->data;
+  Mat_CompositeLink  next;
+  Mat                in,out;
+  PetscInt           i;
+
+  PetscFunctionBegin;
+  in = B;
+  if (shell->right) {
+    PetscCall(MatCopy(B,ctx->Bright,SAME_NONZERO_PATTERN));
+    PetscCall(MatDiagonalScale(ctx->Bright,shell->right,NULL));
+    in = ctx->Bright;
+  }
+  for (next=shell->head,i=0; next; next=next->next,i++) {
+    out = next->next ? ctx->work[i] : C;
+    PetscCall(PermonMatMatMultDense_Private(next->mat,in,out));
+    in = out;
+  }
+  if (shell->left) {
+    PetscCall(MatDiagonalScale(C,shell->left,NULL));
+  }
+  PetscCall(MatScale(C,shell->scale));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSymbolic_Prod_Dense"
+static PetscErrorCode MatProductSymbolic_Prod_Dense(Mat C)
+{
+  Mat_Product        *product = C->product;
+  Mat                A=product->A,B=product->B;
+  Mat_Composite      *shell = (Mat_Composite*)A->data;
+  Mat_CompositeDense *ctx;
+  Mat_CompositeLink  next;
+  PetscInt           i;
+
+  PetscFunctionBegin;
+  if (!shell->head) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_WRONGSTATE,"Must provide at least one matrix with MatCompositeAddMat()");
+  PetscCall(MatSetSizes(C,A->rmap->n,B->cmap->n,A->rmap->N,B->cmap->N));
+  if (!((PetscObject)C)->type_name) PetscCall(MatSetType(C,MATDENSE));
+  PetscCall(MatSetUp(C));
+
+  PetscCall(PetscNew(&ctx));
+  for (next=shell->head; next->next; next=next->next) ctx->nwork++;
+  PetscCall(PetscCalloc1(ctx->nwork,&ctx->work));
+  for (next=shell->head,i=0; next->next; next=next->next,i++) {
+    PetscCall(MatCreateDense(PetscObjectComm((PetscObject)A),next->mat->rmap->n,B->cmap->n,next->mat->rmap->N,B->cmap->N,NULL,&ctx->work[i]));
+  }
+  if (shell->right) {
+    PetscCall(MatDuplicate(B,MAT_DO_NOT_COPY_VALUES,&ctx->Bright));
+  }
+  product->data    = ctx;
+  product->destroy = MatCompositeDenseDestroy_Private;
+  C->ops->productnumeric = MatProductNumeric_Prod_Dense;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSetFromOptions_Prod_Dense"
+static PetscErrorCode MatProductSetFromOptions_Prod_Dense(Mat C)
+{
+  PetscFunctionBegin;
+  if (C->product->type == MATPRODUCT_AB) C->ops->productsymbolic = MatProductSymbolic_Prod_Dense;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatCreate_Prod"
 FLLOP_EXTERN PetscErrorCode  MatCreate_Prod(Mat A)
@@ -164,6 +333,14 @@ FLLOP_EXTERN PetscErrorCode  MatCreate_Prod(Mat A)
   composite->type            = MAT_COMPOSITE_MULTIPLICATIVE;
 
   PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProdGetMat_Prod_C",MatProdGetMat_Prod));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"PermonMatMultBegin_C",MatMultBegin_Prod));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"PermonMatMultEnd_C",MatMultEnd_Prod));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"PermonMatMultTransposeBegin_C",MatMultTransposeBegin_Prod));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"PermonMatMultTransposeEnd_C",MatMultTransposeEnd_Prod));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_prod_seqdense_C",MatProductSetFromOptions_Prod_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_prod_mpidense_C",MatProductSetFromOptions_Prod_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_prod_seqdensepermon_C",MatProductSetFromOptions_Prod_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_prod_mpidensepermon_C",MatProductSetFromOptions_Prod_Dense));
 
   composite->type           = MAT_COMPOSITE_MULTIPLICATIVE;
   composite->head           = NULL;
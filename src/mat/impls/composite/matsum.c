@@ -133,6 +133,76 @@ PetscErrorCode MatMultTransposeAdd_Sum(Mat A,Vec x,Vec y,Vec z)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatProductNumeric_Sum_Dense"
+static PetscErrorCode MatProductNumeric_Sum_Dense(Mat C)
+{
+  Mat_Product        *product = C->product;
+  Mat                A=product->A,B=product->B;
+  Mat_Composite      *shell = (Mat_Composite*)A->data;
+  Mat_CompositeDense *ctx = (Mat_CompositeDense*)product->data;
+  Mat_CompositeLink  next = shell->head;
+  Mat                in;
+
+  PetscFunctionBegin;
+  in = B;
+  if (shell->right) {
+    PetscCall(MatCopy(B,ctx->Bright,SAME_NONZERO_PATTERN));
+    PetscCall(MatDiagonalScale(ctx->Bright,shell->right,NULL));
+    in = ctx->Bright;
+  }
+  PetscCall(PermonMatMatMultDense_Private(next->mat,in,C));
+  while ((next = next->next)) {
+    PetscCall(PermonMatMatMultDense_Private(next->mat,in,ctx->work[0]));
+    PetscCall(MatAXPY(C,1.0,ctx->work[0],SAME_NONZERO_PATTERN));
+  }
+  if (shell->left) {
+    PetscCall(MatDiagonalScale(C,shell->left,NULL));
+  }
+  PetscCall(MatScale(C,shell->scale));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSymbolic_Sum_Dense"
+static PetscErrorCode MatProductSymbolic_Sum_Dense(Mat C)
+{
+  Mat_Product        *product = C->product;
+  Mat                A=product->A,B=product->B;
+  Mat_Composite      *shell = (Mat_Composite*)A->data;
+  Mat_CompositeDense *ctx;
+
+  PetscFunctionBegin;
+  if (!shell->head) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_WRONGSTATE,"Must provide at least one matrix with MatCompositeAddMat()");
+  PetscCall(MatSetSizes(C,A->rmap->n,B->cmap->n,A->rmap->N,B->cmap->N));
+  if (!((PetscObject)C)->type_name) PetscCall(MatSetType(C,MATDENSE));
+  PetscCall(MatSetUp(C));
+
+  PetscCall(PetscNew(&ctx));
+  if (shell->head->next) {
+    /* same type as C so that MatAXPY takes the dense kernel */
+    ctx->nwork = 1;
+    PetscCall(PetscMalloc1(1,&ctx->work));
+    PetscCall(MatDuplicate(C,MAT_DO_NOT_COPY_VALUES,&ctx->work[0]));
+  }
+  if (shell->right) {
+    PetscCall(MatDuplicate(B,MAT_DO_NOT_COPY_VALUES,&ctx->Bright));
+  }
+  product->data    = ctx;
+  product->destroy = MatCompositeDenseDestroy_Private;
+  C->ops->productnumeric = MatProductNumeric_Sum_Dense;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSetFromOptions_Sum_Dense"
+static PetscErrorCode MatProductSetFromOptions_Sum_Dense(Mat C)
+{
+  PetscFunctionBegin;
+  if (C->product->type == MATPRODUCT_AB) C->ops->productsymbolic = MatProductSymbolic_Sum_Dense;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatCreate_Sum"
 FLLOP_EXTERN PetscErrorCode  MatCreate_Sum(Mat A)
@@ -146,6 +216,10 @@ FLLOP_EXTERN PetscErrorCode  MatCreate_Sum(Mat A)
   composite = (Mat_Composite*)A->data;
 
   PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatSumGetMat_Sum_C",MatSumGetMat_Sum));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_sum_seqdense_C",MatProductSetFromOptions_Sum_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_sum_mpidense_C",MatProductSetFromOptions_Sum_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_sum_seqdensepermon_C",MatProductSetFromOptions_Sum_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)A,"MatProductSetFromOptions_sum_mpidensepermon_C",MatProductSetFromOptions_Sum_Dense));
 
   A->ops->mult              = MatMult_Sum;
   A->ops->multtranspose     = MatMultTranspose_Sum;
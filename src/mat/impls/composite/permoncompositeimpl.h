@@ -18,4 +18,13 @@ typedef struct {
   Vec               leftwork,rightwork;
 } Mat_Composite;
 
+/* work matrices of a MATPROD/MATSUM times dense block product, kept in Mat_Product data between numeric phases */
+typedef struct {
+  PetscInt nwork;
+  Mat      *work;   /* MATPROD: intermediate results of the inner factors; MATSUM: one term */
+  Mat      Bright;  /* right-scaled copy of B */
+} Mat_CompositeDense;
+
+FLLOP_INTERN PetscErrorCode MatCompositeDenseDestroy_Private(void*);
+
 #endif
@@ -8,6 +8,21 @@ typedef struct {
   Vec cwork, rwork;
   VecScatter cscatter, rscatter;
   PetscBool setupcalled, rows_use_global_numbering;
+  PetscBool multpending;  /* between PermonMatMult*Begin and End */
+  PetscBool multadd;
+
+  /* zero-copy multiplication: where cis/ris are contiguous within the local ownership range,
+     the local part of c/r is accessed in place through calias/ralias instead of scattering;
+     the *scatter_mult scatters only the remaining ranks and are NULL if there are none */
+  PetscBool ccontig, rcontig, cfull, rfull;
+  PetscInt coff, roff;
+  Vec calias, ralias;
+  VecScatter cscatter_mult, rscatter_mult;
+
+  /* dense block product: work blocks and cscatter/rscatter replicated for all columns, kept for the last N and leading dimensions */
+  Mat Bw, Cw;
+  PetscSF csf_dense, rsf_dense;
+  PetscInt dense_N, dense_ldb, dense_ldc;
 } Mat_Extension;
 
 #undef __FUNCT__
@@ -229,6 +244,49 @@ PetscErrorCode MatExtensionSetCondensed(Mat TA,Mat A)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatExtensionSetUpZeroCopy_Private"
+/* checks if the local part of is is a contiguous range of the owned part of the global vector x;
+   the scatter between x and the work vector w is then needed only on the other ranks */
+static PetscErrorCode MatExtensionSetUpZeroCopy_Private(Mat TA,IS is,PetscLayout map,Vec w,Vec x,PetscBool w_to_x,PetscBool *contig,PetscBool *full,PetscInt *off,Vec *alias,VecScatter *sc)
+{
+  PetscInt  n,start=0;
+  PetscBool any_scatter;
+  IS        is_scatter,is_w=NULL;
+
+  PetscFunctionBegin;
+  PetscCall(ISGetLocalSize(is,&n));
+  if (n) {
+    PetscCall(ISContiguousLocal(is,map->rstart,map->rend,&start,contig));
+  } else {
+    *contig = PETSC_TRUE;
+  }
+  *off  = start;
+  *full = (PetscBool)(*contig && n == map->n);
+  if (*contig) PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF,1,n,NULL,alias));
+
+  any_scatter = (PetscBool)!*contig;
+  PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,&any_scatter,1,MPIU_BOOL,MPI_LOR,PetscObjectComm((PetscObject)TA)));
+  *sc = NULL;
+  if (!any_scatter) PetscFunctionReturn(0);
+  if (*contig) {
+    /* this rank does not take part in the scatter */
+    PetscCall(ISCreateStride(PETSC_COMM_SELF,0,0,1,&is_scatter));
+    PetscCall(ISCreateStride(PETSC_COMM_SELF,0,0,1,&is_w));
+  } else {
+    PetscCall(PetscObjectReference((PetscObject)is));
+    is_scatter = is;
+  }
+  if (w_to_x) {
+    PetscCall(VecScatterCreate(w,is_w,x,is_scatter,sc));
+  } else {
+    PetscCall(VecScatterCreate(x,is_scatter,w,is_w,sc));
+  }
+  PetscCall(ISDestroy(&is_scatter));
+  PetscCall(ISDestroy(&is_w));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatExtensionSetUp_Extension"
 static PetscErrorCode MatExtensionSetUp_Extension(Mat TA)
@@ -264,6 +322,12 @@ static PetscErrorCode MatExtensionSetUp_Extension(Mat TA)
   PetscCall(MatCreateVecs(TA,&c,&r));
   PetscCall(VecScatterCreate(c,data->cis,data->cwork,NULL,&data->cscatter));
   PetscCall(VecScatterCreate(data->rwork,NULL,r,data->ris,&data->rscatter));
+
+  PetscCall(MatExtensionSetUpZeroCopy_Private(TA,data->cis,TA->cmap,data->cwork,c,PETSC_FALSE,&data->ccontig,&data->cfull,&data->coff,&data->calias,&data->cscatter_mult));
+  PetscCall(MatExtensionSetUpZeroCopy_Private(TA,data->ris,TA->rmap,data->rwork,r,PETSC_TRUE,&data->rcontig,&data->rfull,&data->roff,&data->ralias,&data->rscatter_mult));
+  PetscCall(PetscInfo(TA,"zero-copy columns: %s, zero-copy rows: %s, column scatter %s, row scatter %s\n",
+    data->ccontig?"yes":"no",data->rcontig?"yes":"no",data->cscatter_mult?"kept":"skipped",data->rscatter_mult?"kept":"skipped"));
+
   PetscCall(VecDestroy(&c));
   PetscCall(VecDestroy(&r));
   data->setupcalled = PETSC_TRUE;
@@ -334,6 +398,77 @@ PetscErrorCode MatConvertFrom_Extension(Mat A,MatType type,MatReuse reuse,Mat *n
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatExtensionSetValues_Private"
+/* adds the condensed rows of Aloc to B at the global rows ris and columns cis; the rows of several ranks may overlap */
+static PetscErrorCode MatExtensionSetValues_Private(Mat Aloc,const PetscInt ridx[],const PetscInt cidx[],PetscInt gcols[],Mat B)
+{
+  PetscInt          i,j,m,ncols;
+  const PetscInt    *cols;
+  const PetscScalar *vals;
+
+  PetscFunctionBegin;
+  PetscCall(MatGetLocalSize(Aloc,&m,NULL));
+  for (i=0; i<m; i++) {
+    PetscCall(MatGetRow(Aloc,i,&ncols,&cols,&vals));
+    for (j=0; j<ncols; j++) gcols[j] = cidx[cols[j]];
+    PetscCall(MatSetValues(B,1,&ridx[i],ncols,gcols,vals,ADD_VALUES));
+    PetscCall(MatRestoreRow(Aloc,i,&ncols,&cols,&vals));
+  }
+  PetscCall(MatAssemblyBegin(B,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(B,MAT_FINAL_ASSEMBLY));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatConvert_Extension_AIJ"
+static PetscErrorCode MatConvert_Extension_AIJ(Mat TA,MatType newtype,MatReuse reuse,Mat *newB)
+{
+  Mat_Extension  *data = (Mat_Extension*) TA->data;
+  MPI_Comm       comm;
+  Mat            Aloc,P,B;
+  const PetscInt *ridx,*cidx;
+  PetscInt       *gcols;
+
+  PetscFunctionBegin;
+  PetscCall(MatExtensionSetUp(TA));
+  PetscCall(PetscObjectGetComm((PetscObject)TA,&comm));
+  PetscCall(MatConvert(data->A,MATSEQAIJ,MAT_INITIAL_MATRIX,&Aloc));
+  PetscCall(ISGetIndices(data->ris,&ridx));
+  PetscCall(ISGetIndices(data->cis,&cidx));
+  PetscCall(PetscMalloc1(Aloc->cmap->n,&gcols));
+
+  /* the pattern is collected by a preallocator since the rows may belong to other ranks */
+  PetscCall(MatCreate(comm,&P));
+  PetscCall(MatSetSizes(P,TA->rmap->n,TA->cmap->n,TA->rmap->N,TA->cmap->N));
+  PetscCall(MatSetType(P,MATPREALLOCATOR));
+  PetscCall(MatSetUp(P));
+  PetscCall(MatExtensionSetValues_Private(Aloc,ridx,cidx,gcols,P));
+
+  PetscCall(MatCreate(comm,&B));
+  PetscCall(MatSetSizes(B,TA->rmap->n,TA->cmap->n,TA->rmap->N,TA->cmap->N));
+  PetscCall(MatSetType(B,MATAIJ));
+  PetscCall(MatPreallocatorPreallocate(P,PETSC_TRUE,B));
+  PetscCall(MatDestroy(&P));
+  PetscCall(MatExtensionSetValues_Private(Aloc,ridx,cidx,gcols,B));
+
+  PetscCall(PetscFree(gcols));
+  PetscCall(ISRestoreIndices(data->ris,&ridx));
+  PetscCall(ISRestoreIndices(data->cis,&cidx));
+  PetscCall(MatDestroy(&Aloc));
+
+  if (reuse == MAT_INPLACE_MATRIX) {
+#if PETSC_VERSION_MINOR < 7
+    PetscCall(MatHeaderReplace(TA,B));
+#else
+    PetscCall(MatHeaderReplace(TA,&B));
+#endif
+  } else {
+    *newB = B;
+  }
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatConvert_NestPermon_Extension"
 PETSC_EXTERN PetscErrorCode MatConvert_NestPermon_Extension(Mat A,MatType type,MatReuse reuse,Mat *newmat)
@@ -495,66 +630,174 @@ PETSC_EXTERN PetscErrorCode MatConvert_NestPermon_Extension(Mat A,MatType type,M
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "MatMult_Extension"
-PetscErrorCode MatMult_Extension(Mat TA, Vec c, Vec r) {
+#define __FUNCT__ "MatMultBegin_Extension_Private"
+/* r = TA*c (+ r if add); the column scatter is left in flight until MatMultEnd_Extension */
+static PetscErrorCode MatMultBegin_Extension_Private(Mat TA, Vec c, PetscBool add, Vec r) {
   Mat_Extension *data = (Mat_Extension*) TA->data;
 
   PetscFunctionBegin;
+  if (data->multpending) SETERRQ(PetscObjectComm((PetscObject)TA),PETSC_ERR_ORDER,"previous split-phase multiplication not finished");
   PetscCall(MatExtensionSetUp(TA));
-  PetscCall(VecZeroEntries(r));
-  PetscCall(VecScatterBegin(data->cscatter,c,data->cwork,INSERT_VALUES,SCATTER_FORWARD));
-  PetscCall(VecScatterEnd(  data->cscatter,c,data->cwork,INSERT_VALUES,SCATTER_FORWARD));
-  PetscCall(MatMult(data->A,data->cwork,data->rwork));
-  PetscCall(VecScatterBegin(data->rscatter,data->rwork,r,ADD_VALUES,SCATTER_FORWARD));
-  PetscCall(VecScatterEnd(  data->rscatter,data->rwork,r,ADD_VALUES,SCATTER_FORWARD));
+  if (data->cscatter_mult) PetscCall(VecScatterBegin(data->cscatter_mult,c,data->cwork,INSERT_VALUES,SCATTER_FORWARD));
+  /* rows covered in place are overwritten in MatMultEnd_Extension */
+  if (!add && !data->rfull) PetscCall(VecZeroEntries(r));
+  data->multadd = add;
+  data->multpending = PETSC_TRUE;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultEnd_Extension"
+static PetscErrorCode MatMultEnd_Extension(Mat TA, Vec c, Vec r) {
+  Mat_Extension *data = (Mat_Extension*) TA->data;
+  const PetscScalar *ca=NULL;
+  PetscScalar *ra;
+  Vec x;
+
+  PetscFunctionBegin;
+  if (!data->multpending) SETERRQ(PetscObjectComm((PetscObject)TA),PETSC_ERR_ORDER,"split-phase multiplication not started");
+  if (data->cscatter_mult) PetscCall(VecScatterEnd(data->cscatter_mult,c,data->cwork,INSERT_VALUES,SCATTER_FORWARD));
+  data->multpending = PETSC_FALSE;
+  x = data->cwork;
+  if (data->ccontig) {
+    PetscCall(VecGetArrayRead(c,&ca));
+    PetscCall(VecPlaceArray(data->calias,ca+data->coff));
+    x = data->calias;
+  }
+  if (data->rcontig) {
+    PetscCall(VecGetArray(r,&ra));
+    PetscCall(VecPlaceArray(data->ralias,ra+data->roff));
+    if (data->rfull && !data->multadd) {
+      PetscCall(MatMult(data->A,x,data->ralias));
+    } else {
+      PetscCall(MatMultAdd(data->A,x,data->ralias,data->ralias));
+    }
+    PetscCall(VecResetArray(data->ralias));
+    PetscCall(VecRestoreArray(r,&ra));
+  } else {
+    PetscCall(MatMult(data->A,x,data->rwork));
+  }
+  if (data->ccontig) {
+    PetscCall(VecResetArray(data->calias));
+    PetscCall(VecRestoreArrayRead(c,&ca));
+  }
+  if (data->rscatter_mult) {
+    PetscCall(VecScatterBegin(data->rscatter_mult,data->rwork,r,ADD_VALUES,SCATTER_FORWARD));
+    PetscCall(VecScatterEnd(  data->rscatter_mult,data->rwork,r,ADD_VALUES,SCATTER_FORWARD));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultBegin_Extension"
+static PetscErrorCode MatMultBegin_Extension(Mat TA, Vec c, Vec r) {
+  PetscFunctionBegin;
+  PetscCall(MatMultBegin_Extension_Private(TA,c,PETSC_FALSE,r));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMult_Extension"
+PetscErrorCode MatMult_Extension(Mat TA, Vec c, Vec r) {
+  PetscFunctionBegin;
+  PetscCall(MatMultBegin_Extension_Private(TA,c,PETSC_FALSE,r));
+  PetscCall(MatMultEnd_Extension(TA,c,r));
   PetscFunctionReturn(0);
 }
 
 #undef __FUNCT__
 #define __FUNCT__ "MatMultAdd_Extension"
 PetscErrorCode MatMultAdd_Extension(Mat TA, Vec c, Vec r1, Vec r) {
+  PetscFunctionBegin;
+  PetscCall(VecCopy(r1,r));
+  PetscCall(MatMultBegin_Extension_Private(TA,c,PETSC_TRUE,r));
+  PetscCall(MatMultEnd_Extension(TA,c,r));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTransposeBegin_Extension_Private"
+/* c = TA'*r (+ c if add); the row scatter is left in flight until MatMultTransposeEnd_Extension */
+static PetscErrorCode MatMultTransposeBegin_Extension_Private(Mat TA, Vec r, PetscBool add, Vec c) {
   Mat_Extension *data = (Mat_Extension*) TA->data;
 
   PetscFunctionBegin;
+  if (data->multpending) SETERRQ(PetscObjectComm((PetscObject)TA),PETSC_ERR_ORDER,"previous split-phase multiplication not finished");
   PetscCall(MatExtensionSetUp(TA));
-  PetscCall(VecCopy(r1,r));
-  PetscCall(VecScatterBegin(data->cscatter,c,data->cwork,INSERT_VALUES,SCATTER_FORWARD));
-  PetscCall(VecScatterEnd(  data->cscatter,c,data->cwork,INSERT_VALUES,SCATTER_FORWARD));
-  PetscCall(MatMult(data->A,data->cwork,data->rwork));
-  PetscCall(VecScatterBegin(data->rscatter,data->rwork,r,ADD_VALUES,SCATTER_FORWARD));
-  PetscCall(VecScatterEnd(  data->rscatter,data->rwork,r,ADD_VALUES,SCATTER_FORWARD));
+  if (data->rscatter_mult) PetscCall(VecScatterBegin(data->rscatter_mult,r,data->rwork,INSERT_VALUES,SCATTER_REVERSE));
+  /* columns covered in place are overwritten in MatMultTransposeEnd_Extension */
+  if (!add && !data->cfull) PetscCall(VecZeroEntries(c));
+  data->multadd = add;
+  data->multpending = PETSC_TRUE;
   PetscFunctionReturn(0);
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "MatMultTranspose_Extension"
-PetscErrorCode MatMultTranspose_Extension(Mat TA, Vec r, Vec c) {
+#define __FUNCT__ "MatMultTransposeEnd_Extension"
+static PetscErrorCode MatMultTransposeEnd_Extension(Mat TA, Vec r, Vec c) {
   Mat_Extension *data = (Mat_Extension*) TA->data;
+  const PetscScalar *ra=NULL;
+  PetscScalar *ca;
+  Vec x;
 
   PetscFunctionBegin;
-  PetscCall(MatExtensionSetUp(TA));
-  PetscCall(VecZeroEntries(c));
-  PetscCall(VecScatterBegin(data->rscatter,r,data->rwork,INSERT_VALUES,SCATTER_REVERSE));
-  PetscCall(VecScatterEnd(  data->rscatter,r,data->rwork,INSERT_VALUES,SCATTER_REVERSE));
-  PetscCall(MatMultTranspose(data->A,data->rwork,data->cwork));
-  PetscCall(VecScatterBegin(data->cscatter,data->cwork,c,ADD_VALUES,SCATTER_REVERSE));
-  PetscCall(VecScatterEnd(  data->cscatter,data->cwork,c,ADD_VALUES,SCATTER_REVERSE));
+  if (!data->multpending) SETERRQ(PetscObjectComm((PetscObject)TA),PETSC_ERR_ORDER,"split-phase multiplication not started");
+  if (data->rscatter_mult) PetscCall(VecScatterEnd(data->rscatter_mult,r,data->rwork,INSERT_VALUES,SCATTER_REVERSE));
+  data->multpending = PETSC_FALSE;
+  x = data->rwork;
+  if (data->rcontig) {
+    PetscCall(VecGetArrayRead(r,&ra));
+    PetscCall(VecPlaceArray(data->ralias,ra+data->roff));
+    x = data->ralias;
+  }
+  if (data->ccontig) {
+    PetscCall(VecGetArray(c,&ca));
+    PetscCall(VecPlaceArray(data->calias,ca+data->coff));
+    if (data->cfull && !data->multadd) {
+      PetscCall(MatMultTranspose(data->A,x,data->calias));
+    } else {
+      PetscCall(MatMultTransposeAdd(data->A,x,data->calias,data->calias));
+    }
+    PetscCall(VecResetArray(data->calias));
+    PetscCall(VecRestoreArray(c,&ca));
+  } else {
+    PetscCall(MatMultTranspose(data->A,x,data->cwork));
+  }
+  if (data->rcontig) {
+    PetscCall(VecResetArray(data->ralias));
+    PetscCall(VecRestoreArrayRead(r,&ra));
+  }
+  if (data->cscatter_mult) {
+    PetscCall(VecScatterBegin(data->cscatter_mult,data->cwork,c,ADD_VALUES,SCATTER_REVERSE));
+    PetscCall(VecScatterEnd(  data->cscatter_mult,data->cwork,c,ADD_VALUES,SCATTER_REVERSE));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTransposeBegin_Extension"
+static PetscErrorCode MatMultTransposeBegin_Extension(Mat TA, Vec r, Vec c) {
+  PetscFunctionBegin;
+  PetscCall(MatMultTransposeBegin_Extension_Private(TA,r,PETSC_FALSE,c));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTranspose_Extension"
+PetscErrorCode MatMultTranspose_Extension(Mat TA, Vec r, Vec c) {
+  PetscFunctionBegin;
+  PetscCall(MatMultTransposeBegin_Extension_Private(TA,r,PETSC_FALSE,c));
+  PetscCall(MatMultTransposeEnd_Extension(TA,r,c));
   PetscFunctionReturn(0);
 }
 
 #undef __FUNCT__
 #define __FUNCT__ "MatMultTransposeAdd_Extension"
 PetscErrorCode MatMultTransposeAdd_Extension(Mat TA, Vec r, Vec c1, Vec c) {
-  Mat_Extension *data = (Mat_Extension*) TA->data;
-
   PetscFunctionBegin;
-  PetscCall(MatExtensionSetUp(TA));
   PetscCall(VecCopy(c1,c));
-  PetscCall(VecScatterBegin(data->rscatter,r,data->rwork,INSERT_VALUES,SCATTER_REVERSE));
-  PetscCall(VecScatterEnd(  data->rscatter,r,data->rwork,INSERT_VALUES,SCATTER_REVERSE));
-  PetscCall(MatMultTranspose(data->A,data->rwork,data->cwork));
-  PetscCall(VecScatterBegin(data->cscatter,data->cwork,c,ADD_VALUES,SCATTER_REVERSE));
-  PetscCall(VecScatterEnd(  data->cscatter,data->cwork,c,ADD_VALUES,SCATTER_REVERSE));
+  PetscCall(MatMultTransposeBegin_Extension_Private(TA,r,PETSC_TRUE,c));
+  PetscCall(MatMultTransposeEnd_Extension(TA,r,c));
   PetscFunctionReturn(0);
 }
 
@@ -1092,6 +1335,81 @@ static PetscErrorCode MatProductSetFromOptions_Extension(Mat C) {
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatProductNumeric_Extension_Dense"
+static PetscErrorCode MatProductNumeric_Extension_Dense(Mat C)
+{
+  Mat_Product       *product = C->product;
+  Mat               TA=product->A,B=product->B;
+  Mat_Extension     *data = (Mat_Extension*) TA->data;
+  const PetscScalar *xa;
+  PetscScalar       *ya;
+  PetscInt          N=B->cmap->N,ldb,ldc;
+
+  PetscFunctionBegin;
+  PetscCall(MatExtensionSetUp(TA));
+  PetscCall(MatDenseGetLDA(B,&ldb));
+  PetscCall(MatDenseGetLDA(C,&ldc));
+  if (data->Bw && (data->dense_N != N || data->dense_ldb != ldb || data->dense_ldc != ldc)) {
+    PetscCall(MatDestroy(&data->Bw));
+    PetscCall(MatDestroy(&data->Cw));
+    PetscCall(PetscSFDestroy(&data->csf_dense));
+    PetscCall(PetscSFDestroy(&data->rsf_dense));
+  }
+  if (!data->Bw) {
+    PetscCall(MatCreateSeqDense(PETSC_COMM_SELF,data->A->cmap->n,N,NULL,&data->Bw));
+    PetscCall(MatCreateSeqDense(PETSC_COMM_SELF,data->A->rmap->n,N,NULL,&data->Cw));
+    PetscCall(PetscSFCreateStridedSF(data->cscatter,N,ldb,data->A->cmap->n,&data->csf_dense));
+    PetscCall(PetscSFCreateStridedSF(data->rscatter,N,data->A->rmap->n,ldc,&data->rsf_dense));
+    data->dense_N   = N;
+    data->dense_ldb = ldb;
+    data->dense_ldc = ldc;
+  }
+
+  /* all columns are scattered in one pass */
+  PetscCall(MatDenseGetArrayRead(B,&xa));
+  PetscCall(MatDenseGetArrayWrite(data->Bw,&ya));
+  PetscCall(PetscSFBcastBegin(data->csf_dense,MPIU_SCALAR,xa,ya,MPI_REPLACE));
+  PetscCall(PetscSFBcastEnd(  data->csf_dense,MPIU_SCALAR,xa,ya,MPI_REPLACE));
+  PetscCall(MatDenseRestoreArrayWrite(data->Bw,&ya));
+  PetscCall(MatDenseRestoreArrayRead(B,&xa));
+
+  /* the condensed matrix is applied to all columns at once */
+  PetscCall(PermonMatMatMultDense_Private(data->A,data->Bw,data->Cw));
+
+  PetscCall(MatZeroEntries(C));
+  PetscCall(MatDenseGetArrayRead(data->Cw,&xa));
+  PetscCall(MatDenseGetArray(C,&ya));
+  PetscCall(PetscSFBcastBegin(data->rsf_dense,MPIU_SCALAR,xa,ya,MPIU_SUM));
+  PetscCall(PetscSFBcastEnd(  data->rsf_dense,MPIU_SCALAR,xa,ya,MPIU_SUM));
+  PetscCall(MatDenseRestoreArray(C,&ya));
+  PetscCall(MatDenseRestoreArrayRead(data->Cw,&xa));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSymbolic_Extension_Dense"
+static PetscErrorCode MatProductSymbolic_Extension_Dense(Mat C)
+{
+  Mat_Product *product = C->product;
+  Mat         A=product->A,B=product->B;
+
+  PetscFunctionBegin;
+  PetscCall(MatSetSizes(C,A->rmap->n,B->cmap->n,A->rmap->N,B->cmap->N));
+  if (!((PetscObject)C)->type_name) PetscCall(MatSetType(C,MATDENSE));
+  PetscCall(MatSetUp(C));
+  C->ops->productnumeric  = MatProductNumeric_Extension_Dense;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSetFromOptions_Extension_Dense"
+static PetscErrorCode MatProductSetFromOptions_Extension_Dense(Mat C) {
+  PetscFunctionBegin;
+  if (C->product->type == MATPRODUCT_AB) C->ops->productsymbolic = MatProductSymbolic_Extension_Dense;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatDestroy_Extension"
 PetscErrorCode MatDestroy_Extension(Mat TA) {
@@ -1106,6 +1424,14 @@ PetscErrorCode MatDestroy_Extension(Mat TA) {
   PetscCall(VecDestroy(&data->rwork));
   PetscCall(VecScatterDestroy(&data->cscatter));
   PetscCall(VecScatterDestroy(&data->rscatter));
+  PetscCall(MatDestroy(&data->Bw));
+  PetscCall(MatDestroy(&data->Cw));
+  PetscCall(PetscSFDestroy(&data->csf_dense));
+  PetscCall(PetscSFDestroy(&data->rsf_dense));
+  PetscCall(VecScatterDestroy(&data->cscatter_mult));
+  PetscCall(VecScatterDestroy(&data->rscatter_mult));
+  PetscCall(VecDestroy(&data->calias));
+  PetscCall(VecDestroy(&data->ralias));
   PetscCall(PetscFree(data));
   PetscFunctionReturn(0);
 }
@@ -1136,7 +1462,21 @@ FLLOP_EXTERN PetscErrorCode MatCreate_Extension(Mat TA)
   data->rwork                 = NULL;
   data->cscatter              = NULL;
   data->rscatter              = NULL;
+  data->Bw                    = NULL;
+  data->Cw                    = NULL;
+  data->csf_dense             = NULL;
+  data->rsf_dense             = NULL;
   data->setupcalled           = PETSC_FALSE;
+  data->multpending           = PETSC_FALSE;
+  data->multadd               = PETSC_FALSE;
+  data->ccontig               = PETSC_FALSE;
+  data->rcontig               = PETSC_FALSE;
+  data->cfull                 = PETSC_FALSE;
+  data->rfull                 = PETSC_FALSE;
+  data->calias                = NULL;
+  data->ralias                = NULL;
+  data->cscatter_mult         = NULL;
+  data->rscatter_mult         = NULL;
 
   /* set type-specific implementations of general Mat methods */
   TA->ops->destroy            = MatDestroy_Extension;
@@ -1149,6 +1489,7 @@ FLLOP_EXTERN PetscErrorCode MatCreate_Extension(Mat TA)
 
   /* set type-specific methods */
   PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatConvert_nestpermon_extension_C", MatConvert_NestPermon_Extension));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatConvert_extension_aij_C", MatConvert_Extension_AIJ));
   PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatExtensionCreateCondensedRows_Extension_C",MatExtensionCreateCondensedRows_Extension));
   PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatExtensionCreateLocalMat_Extension_C",MatExtensionCreateLocalMat_Extension));
   PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatExtensionGetColumnIS_Extension_C",MatExtensionGetColumnIS_Extension));
@@ -1160,6 +1501,14 @@ FLLOP_EXTERN PetscErrorCode MatCreate_Extension(Mat TA)
   PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatExtensionSetCondensed_Extension_C",MatExtensionSetCondensed_Extension));
   PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatExtensionSetUp_Extension_C",MatExtensionSetUp_Extension));
   PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatProductSetFromOptions_blockdiag_extension_C",MatProductSetFromOptions_BlockDiag_Extension));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatProductSetFromOptions_extension_seqdense_C",MatProductSetFromOptions_Extension_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatProductSetFromOptions_extension_mpidense_C",MatProductSetFromOptions_Extension_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatProductSetFromOptions_extension_seqdensepermon_C",MatProductSetFromOptions_Extension_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"MatProductSetFromOptions_extension_mpidensepermon_C",MatProductSetFromOptions_Extension_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"PermonMatMultBegin_C",MatMultBegin_Extension));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"PermonMatMultEnd_C",MatMultEnd_Extension));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"PermonMatMultTransposeBegin_C",MatMultTransposeBegin_Extension));
+  PetscCall(PetscObjectComposeFunction((PetscObject)TA,"PermonMatMultTransposeEnd_C",MatMultTransposeEnd_Extension));
   PetscFunctionReturn(0);
 }
 
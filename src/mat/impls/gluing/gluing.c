@@ -49,129 +49,181 @@ static PetscErrorCode FllopMatGetLocalMat_Gluing(Mat A,Mat *Aloc)
 }
 
 
-#undef __FUNCT__  
-#define __FUNCT__ "MatMult_Gluing"
-PetscErrorCode MatMult_Gluing(Mat mat, Vec right, Vec left)
+#undef __FUNCT__
+#define __FUNCT__ "MatConvert_Gluing_AIJ"
+/* each leaf is one +-1 entry in its local row and in the column of its root */
+static PetscErrorCode MatConvert_Gluing_AIJ(Mat A, MatType newtype, MatReuse reuse, Mat *newB)
 {
+  Mat_Gluing *data = (Mat_Gluing*) A->data;
+  Mat B;
+  PetscInt i, m, n, rstart, cstart, cend, row;
+  PetscInt *leafcol, *rootdata, *d_nnz, *o_nnz;
+  PetscScalar v;
+
+  PetscFunctionBegin;
+  PetscCall(MatGetLocalSize(A, &m, &n));
+  PetscCall(MatGetOwnershipRange(A, &rstart, NULL));
+  PetscCall(MatGetOwnershipRangeColumn(A, &cstart, &cend));
+  PetscCall(PetscMalloc2(data->n_leaves, &leafcol, n, &rootdata));
+  for (i=0; i<n; i++) rootdata[i] = cstart + i;
+  PetscCall(PetscSFBcastBegin(data->SF, MPIU_INT, rootdata, leafcol, MPI_REPLACE));
+  PetscCall(PetscSFBcastEnd(data->SF, MPIU_INT, rootdata, leafcol, MPI_REPLACE));
+
+  PetscCall(PetscCalloc2(m, &d_nnz, m, &o_nnz));
+  for (i=0; i<data->n_leaves; i++) {
+    if (leafcol[i] >= cstart && leafcol[i] < cend) d_nnz[data->leaves_row[i]]++;
+    else o_nnz[data->leaves_row[i]]++;
+  }
+  for (i=0; i<m; i++) {
+    d_nnz[i] = PetscMin(d_nnz[i], n);
+    o_nnz[i] = PetscMin(o_nnz[i], A->cmap->N - n);
+  }
+  PetscCall(MatCreateAIJ(PetscObjectComm((PetscObject)A), m, n, A->rmap->N, A->cmap->N, 0, d_nnz, 0, o_nnz, &B));
+  PetscCall(PetscFree2(d_nnz, o_nnz));
+
+  for (i=0; i<data->n_leaves; i++) {
+    row = rstart + data->leaves_row[i];
+    v   = data->leaves_sign[i];
+    PetscCall(MatSetValues(B, 1, &row, 1, &leafcol[i], &v, ADD_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(B, MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(B, MAT_FINAL_ASSEMBLY));
+  PetscCall(PetscFree2(leafcol, rootdata));
+
+  if (reuse == MAT_INPLACE_MATRIX) {
+    PetscCall(MatHeaderReplace(A, &B));
+  } else {
+    *newB = B;
+  }
+  PetscFunctionReturn(0);
+}
 
+#undef __FUNCT__
+#define __FUNCT__ "MatMultBegin_Gluing_Private"
+/* left = B*right (+ left if add); the broadcast is left in flight until MatMultEnd_Gluing */
+static PetscErrorCode MatMultBegin_Gluing_Private(Mat mat, Vec right, PetscBool add, Vec left)
+{
   Mat_Gluing *data = (Mat_Gluing*) mat->data;
-  PetscScalar      *x_onleaves, *lambda_root, *lambda_onleaves;
-  PetscInt i, start, *idxX;
 
   PetscFunctionBegin;
+  if (data->multpending) SETERRQ(PetscObjectComm((PetscObject)mat),PETSC_ERR_ORDER,"previous split-phase multiplication not finished");
   //right=lambda left=x
+  PetscCall(VecGetArrayRead(right, &data->root_read));
+  PetscCall(PetscSFBcastBegin(data->SF, MPIU_SCALAR, data->root_read, data->leaves_work, MPI_REPLACE));
+  if (!add) PetscCall(VecZeroEntries(left));
+  data->multpending = PETSC_TRUE;
+  PetscFunctionReturn(0);
+}
 
-  PetscCall(VecGetArray(right, &lambda_root));
-  PetscCall(VecGetOwnershipRange(left, &start,NULL));
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscScalar), &lambda_onleaves));
+#undef __FUNCT__
+#define __FUNCT__ "MatMultEnd_Gluing"
+/* left is accumulated in place by local row index, no assembly needed */
+static PetscErrorCode MatMultEnd_Gluing(Mat mat, Vec right, Vec left)
+{
+  Mat_Gluing *data = (Mat_Gluing*) mat->data;
+  PetscScalar *x, *lambda_onleaves = data->leaves_work;
+  PetscInt i;
 
-  PetscCall(PetscSFBcastBegin(data->SF, MPIU_SCALAR, lambda_root, lambda_onleaves, MPI_REPLACE));
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscInt), &idxX));
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscScalar), &x_onleaves));
-  PetscCall(VecZeroEntries(left));
-  PetscCall(PetscSFBcastEnd(data->SF, MPIU_SCALAR, lambda_root, lambda_onleaves, MPI_REPLACE));
-  PetscCall(VecRestoreArray(right,  &lambda_root));
+  PetscFunctionBegin;
+  if (!data->multpending) SETERRQ(PetscObjectComm((PetscObject)mat),PETSC_ERR_ORDER,"split-phase multiplication not started");
+  PetscCall(PetscSFBcastEnd(data->SF, MPIU_SCALAR, data->root_read, lambda_onleaves, MPI_REPLACE));
+  PetscCall(VecRestoreArrayRead(right, &data->root_read));
+  data->multpending = PETSC_FALSE;
 
+  PetscCall(VecGetArray(left, &x));
   for (i=0; i<data->n_leaves; i++) {
-    idxX[i]= start + data->leaves_row[i];
-    x_onleaves[i ] = lambda_onleaves[i] *data->leaves_sign[i];
+    x[data->leaves_row[i]] += lambda_onleaves[i] * data->leaves_sign[i];
   }
+  PetscCall(VecRestoreArray(left, &x));
+  PetscFunctionReturn(0);
+}
 
-  PetscCall(VecZeroEntries( left ));
-  PetscCall(VecSetValues(left, data->n_leaves, idxX, x_onleaves, ADD_VALUES););
-  PetscCall(VecAssemblyBegin(left));
-  PetscCall(VecAssemblyEnd(left));
-
-  PetscCall(PetscFree(idxX));
-  PetscCall(PetscFree(x_onleaves));
-  PetscCall(PetscFree(lambda_onleaves));
+#undef __FUNCT__
+#define __FUNCT__ "MatMultBegin_Gluing"
+static PetscErrorCode MatMultBegin_Gluing(Mat mat, Vec right, Vec left)
+{
+  PetscFunctionBegin;
+  PetscCall(MatMultBegin_Gluing_Private(mat, right, PETSC_FALSE, left));
+  PetscFunctionReturn(0);
+}
 
+#undef __FUNCT__  
+#define __FUNCT__ "MatMult_Gluing"
+PetscErrorCode MatMult_Gluing(Mat mat, Vec right, Vec left)
+{
+  PetscFunctionBegin;
+  PetscCall(MatMultBegin_Gluing_Private(mat, right, PETSC_FALSE, left));
+  PetscCall(MatMultEnd_Gluing(mat, right, left));
   PetscFunctionReturn(0);
 }
 
 #undef __FUNCT__  
 #define __FUNCT__ "MatMultAdd_Gluing"
-PetscErrorCode MatMultAdd_Gluing(Mat mat, Vec right, Vec add, Vec left) {
-
- Mat_Gluing *data = (Mat_Gluing*) mat->data;
-  PetscScalar      *x_onleaves, *lambda_root, *lambda_onleaves;
-  PetscInt i, start, *idxX;
-
-  PetscFunctionBegin; 
-   //right=lambda left=x
-
-  PetscCall(VecGetArray(right, &lambda_root));
-  PetscCall(VecGetOwnershipRange(left, &start,NULL));    
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscScalar), &lambda_onleaves));
-  
-  PetscCall(PetscSFBcastBegin(data->SF, MPIU_SCALAR, lambda_root, lambda_onleaves, MPI_REPLACE));
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscInt), &idxX));
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscScalar), &x_onleaves));
-  PetscCall(VecZeroEntries(left));
-  PetscCall(PetscSFBcastEnd(data->SF, MPIU_SCALAR, lambda_root, lambda_onleaves, MPI_REPLACE));
-  PetscCall(VecRestoreArray(right,  &lambda_root));
-  
-  for (i=0; i<data->n_leaves; i++) {
-    idxX[i]= start + data->leaves_row[i];
-    x_onleaves[i ] = lambda_onleaves[i] *data->leaves_sign[i];
-  } 
-  
-  PetscCall(VecZeroEntries( left ));
-  PetscCall(VecSetValues(left, data->n_leaves, idxX, x_onleaves, ADD_VALUES););
-  PetscCall(VecAssemblyBegin(left));
-  PetscCall(VecAssemblyEnd(left)); 
-  
-  PetscCall(PetscFree(idxX)); 
-  PetscCall(PetscFree(x_onleaves)); 
-  PetscCall(PetscFree(lambda_onleaves));  
-  
-  PetscCall(VecAXPY(left, 1, add));
-  
+PetscErrorCode MatMultAdd_Gluing(Mat mat, Vec right, Vec add, Vec left)
+{
+  PetscFunctionBegin;
+  if (add != left) PetscCall(VecCopy(add, left));
+  PetscCall(MatMultBegin_Gluing_Private(mat, right, PETSC_TRUE, left));
+  PetscCall(MatMultEnd_Gluing(mat, right, left));
   PetscFunctionReturn(0);
 }
 
-#undef __FUNCT__  
-#define __FUNCT__ "MatMultTranspose_Gluing"
-PetscErrorCode MatMultTranspose_Gluing(Mat mat, Vec right, Vec left)
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTransposeBegin_Gluing_Private"
+/* left = B'*right (+ left if add); the SF reduction sums directly into the array of left */
+static PetscErrorCode MatMultTransposeBegin_Gluing_Private(Mat mat, Vec right, PetscBool add, Vec left)
 {
   Mat_Gluing *data = (Mat_Gluing*) mat->data;
-  PetscScalar     *x, *lambda_onroot, *lambda_onleaves;
-  PetscInt i, start, n_col, *idxL;
+  const PetscScalar *x;
+  PetscScalar *lambda_onleaves = data->leaves_work;
+  PetscInt i;
 
   PetscFunctionBegin;
+  if (data->multpending) SETERRQ(PetscObjectComm((PetscObject)mat),PETSC_ERR_ORDER,"previous split-phase multiplication not finished");
   //right=x left=lambda
-  PetscCall(VecGetArray(right, &x));
-  PetscCall(VecGetOwnershipRange(left, &start,NULL));
-  PetscCall(MatGetLocalSize(mat, NULL, &n_col));
-
-  PetscCall(PetscMalloc(n_col*sizeof(PetscScalar), &lambda_onroot));
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscScalar), &lambda_onleaves));
-
-  for (i=0; i<n_col; i++) {
-    lambda_onroot[i]=0;
+  PetscCall(VecGetArrayRead(right, &x));
+  for (i=0; i<data->n_leaves; i++) {
+    lambda_onleaves[i] = x[data->leaves_row[i]] * data->leaves_sign[i];
   }
+  PetscCall(VecRestoreArrayRead(right, &x));
 
-  for ( i=0; i<data->n_leaves; i++) {
-    lambda_onleaves[i]= x[ data->leaves_row[i] ] * data->leaves_sign[i];
-  }
+  if (!add) PetscCall(VecZeroEntries(left));
+  PetscCall(VecGetArray(left, &data->root_write));
+  PetscCall(PetscSFReduceBegin(data->SF, MPIU_SCALAR, lambda_onleaves, data->root_write, MPI_SUM));
+  data->multpending = PETSC_TRUE;
+  PetscFunctionReturn(0);
+}
 
-  PetscCall(PetscSFReduceBegin(data->SF, MPIU_SCALAR, lambda_onleaves, lambda_onroot, MPI_SUM));
-  PetscCall(PetscMalloc(n_col*sizeof(PetscInt), &idxL));
-  for (i=0; i<n_col; i++) {
-    idxL[i]=start+i;
-  }
-  PetscCall(PetscSFReduceEnd(data->SF, MPIU_SCALAR, lambda_onleaves, lambda_onroot, MPI_SUM));
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTransposeEnd_Gluing"
+static PetscErrorCode MatMultTransposeEnd_Gluing(Mat mat, Vec right, Vec left)
+{
+  Mat_Gluing *data = (Mat_Gluing*) mat->data;
 
-  PetscCall(VecZeroEntries( left ));
-  PetscCall(VecSetValues(left, n_col, idxL, lambda_onroot, INSERT_VALUES));
-  PetscCall(VecAssemblyBegin(left));
-  PetscCall(VecAssemblyEnd(left));
+  PetscFunctionBegin;
+  if (!data->multpending) SETERRQ(PetscObjectComm((PetscObject)mat),PETSC_ERR_ORDER,"split-phase multiplication not started");
+  PetscCall(PetscSFReduceEnd(data->SF, MPIU_SCALAR, data->leaves_work, data->root_write, MPI_SUM));
+  PetscCall(VecRestoreArray(left, &data->root_write));
+  data->multpending = PETSC_FALSE;
+  PetscFunctionReturn(0);
+}
 
-  PetscCall(VecRestoreArray(right, &x));
-  PetscCall(PetscFree(lambda_onroot));
-  PetscCall(PetscFree(lambda_onleaves));
-  PetscCall(PetscFree(idxL));
+#undef __FUNCT__
+#define __FUNCT__ "MatMultTransposeBegin_Gluing"
+static PetscErrorCode MatMultTransposeBegin_Gluing(Mat mat, Vec right, Vec left)
+{
+  PetscFunctionBegin;
+  PetscCall(MatMultTransposeBegin_Gluing_Private(mat, right, PETSC_FALSE, left));
+  PetscFunctionReturn(0);
+}
 
+#undef __FUNCT__  
+#define __FUNCT__ "MatMultTranspose_Gluing"
+PetscErrorCode MatMultTranspose_Gluing(Mat mat, Vec right, Vec left)
+{
+  PetscFunctionBegin;
+  PetscCall(MatMultTransposeBegin_Gluing_Private(mat, right, PETSC_FALSE, left));
+  PetscCall(MatMultTransposeEnd_Gluing(mat, right, left));
   PetscFunctionReturn(0);
 }
 
@@ -179,46 +231,10 @@ PetscErrorCode MatMultTranspose_Gluing(Mat mat, Vec right, Vec left)
 #define __FUNCT__ "MatMultTransposeAdd_Gluing"
 PetscErrorCode MatMultTransposeAdd_Gluing(Mat mat, Vec right, Vec add, Vec left)
 {
-
-  Mat_Gluing *data = (Mat_Gluing*) mat->data;
-  PetscScalar     *x, *lambda_onroot, *lambda_onleaves;
-  PetscInt i, start, n_col, *idxL;
-
   PetscFunctionBegin;
-  //right=x left=lambda
-  PetscCall(VecGetArray(right, &x));
-  PetscCall(VecGetOwnershipRange(left, &start,NULL));
-  PetscCall(MatGetLocalSize(mat, NULL, &n_col));
-
-  PetscCall(PetscMalloc(n_col*sizeof(PetscScalar), &lambda_onroot));
-  PetscCall(PetscMalloc(data->n_leaves*sizeof(PetscScalar), &lambda_onleaves));
-
-  for (i=0; i<n_col; i++) {
-    lambda_onroot[i]=0;
-  }
-
-  for ( i=0; i<data->n_leaves; i++) {
-    lambda_onleaves[i]= x[ data->leaves_row[i] ] * data->leaves_sign[i];
-  }
-
-  PetscCall(PetscSFReduceBegin(data->SF, MPIU_SCALAR, lambda_onleaves, lambda_onroot, MPI_SUM));
-  PetscCall(PetscMalloc(n_col*sizeof(PetscInt), &idxL));
-  for (i=0; i<n_col; i++) {
-    idxL[i]=start+i;
-  }
-  PetscCall(PetscSFReduceEnd(data->SF, MPIU_SCALAR, lambda_onleaves, lambda_onroot, MPI_SUM));
-  PetscCall(VecZeroEntries( left ));
-  PetscCall(VecSetValues(left, n_col, idxL, lambda_onroot, ADD_VALUES));
-  PetscCall(VecAssemblyBegin(left));
-  PetscCall(VecAssemblyEnd(left));
-
-  PetscCall(VecRestoreArray(right, &x));
-  PetscCall(PetscFree(lambda_onroot));
-  PetscCall(PetscFree(lambda_onleaves));
-  PetscCall(PetscFree(idxL));
-
-  PetscCall(VecAXPY(left, 1, add));
-
+  if (add != left) PetscCall(VecCopy(add, left));
+  PetscCall(MatMultTransposeBegin_Gluing_Private(mat, right, PETSC_TRUE, left));
+  PetscCall(MatMultTransposeEnd_Gluing(mat, right, left));
   PetscFunctionReturn(0);
 }
 
@@ -232,6 +248,7 @@ PetscErrorCode MatDestroy_Gluing(Mat mat)
   PetscCall(PetscSFDestroy(&data->SF));  
   PetscCall(PetscFree(data->leaves_row));
   PetscCall(PetscFree(data->leaves_sign));
+  PetscCall(PetscFree(data->leaves_work));
   PetscCall(PetscFree(data));
   PetscFunctionReturn(0);
 }
@@ -261,6 +278,7 @@ PetscErrorCode MatCreateGluing(MPI_Comm comm, PetscInt n_x_localRow, PetscInt n_
   PetscCall(PetscMalloc1(n_l+1,&ls));
   PetscCall(PetscMemcpy(ls,leaves_sign,(n_l+1)*sizeof(PetscReal)));  
   PetscCall(PetscObjectReference((PetscObject)SF));
+  PetscCall(PetscMalloc1(n_l+1,&data->leaves_work));
   
   data->n_leaves=n_l+1;
   data->n_nonzeroRow=n_nonzeroRow;
@@ -298,6 +316,10 @@ FLLOP_EXTERN PetscErrorCode MatCreate_Gluing(Mat B) {
   data->SF               = NULL; 
   data->leaves_row      = NULL;
   data->leaves_sign      = NULL; 
+  data->leaves_work      = NULL;
+  data->root_read        = NULL;
+  data->root_write       = NULL;
+  data->multpending      = PETSC_FALSE;
   data->n_leaves=0; 
   data->n_nonzeroRow=0;
   
@@ -308,6 +330,11 @@ FLLOP_EXTERN PetscErrorCode MatCreate_Gluing(Mat B) {
   B->ops->multadd            = MatMultAdd_Gluing;
   B->ops->multtransposeadd   = MatMultTransposeAdd_Gluing;
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"FllopMatGetLocalMat_C",FllopMatGetLocalMat_Gluing));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatConvert_gluing_aij_C",MatConvert_Gluing_AIJ));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"PermonMatMultBegin_C",MatMultBegin_Gluing));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"PermonMatMultEnd_C",MatMultEnd_Gluing));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"PermonMatMultTransposeBegin_C",MatMultTransposeBegin_Gluing));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"PermonMatMultTransposeEnd_C",MatMultTransposeEnd_Gluing));
  
   PetscFunctionReturn(0);
 } 
@@ -3,14 +3,36 @@
 #include <permon/private/petscimpl.h>
 #include <permonksp.h>
 #include <petsc/private/pcimpl.h>
+#include <petsc/private/kspimpl.h>
 #if defined(PETSC_HAVE_MUMPS)
 #include <permon/private/petsc/mat/mumpsimpl.h>
 #endif
 
 PetscLogEvent Mat_Inv_Explicitly, Mat_Inv_SetUp;
 
+/* subdomain blocks are factored and solved concurrently only if PETSc calls are safe from OpenMP threads;
+   at run time MPI must also provide MPI_THREAD_MULTIPLE, see MatInvThreadedBlocks_Private() */
+#if defined(PETSC_HAVE_OPENMP) && defined(PETSC_HAVE_THREADSAFETY)
+#define MATINV_THREADED_BLOCKS
+#endif
+
 static PetscErrorCode MatInvCreateInnerObjects_Inv(Mat imat);
 
+#if defined(MATINV_THREADED_BLOCKS)
+#undef __FUNCT__
+#define __FUNCT__ "MatInvThreadedBlocks_Private"
+/* the subdomain solvers communicate on their own (PETSC_COMM_SELF) communicators, so the threads may call MPI concurrently */
+static PetscErrorCode MatInvThreadedBlocks_Private(PetscBool *flg)
+{
+  int provided;
+
+  PetscFunctionBegin;
+  PetscCallMPI(MPI_Query_thread(&provided));
+  *flg = (PetscBool)(provided == MPI_THREAD_MULTIPLE);
+  PetscFunctionReturn(0);
+}
+#endif
+
 #undef __FUNCT__
 #define __FUNCT__ "MatInvKSPSetOptionsPrefix_Inv"
 static PetscErrorCode MatInvKSPSetOptionsPrefix_Inv(Mat imat)
@@ -18,10 +40,16 @@ static PetscErrorCode MatInvKSPSetOptionsPrefix_Inv(Mat imat)
   Mat_Inv        *inv = (Mat_Inv*)imat->data;
   const char     *prefix;
 
+  PetscInt       i;
+
   PetscFunctionBegin;
   PetscCall(MatGetOptionsPrefix(imat,&prefix));
   PetscCall(KSPSetOptionsPrefix(inv->innerksp,prefix));
   PetscCall(KSPAppendOptionsPrefix(inv->innerksp,"mat_inv_"));
+  for (i=1; i<inv->nsubksp; i++) {
+    PetscCall(KSPSetOptionsPrefix(inv->subksp[i],prefix));
+    PetscCall(KSPAppendOptionsPrefix(inv->subksp[i],"mat_inv_"));
+  }
   PetscFunctionReturn(0);
 }
 
@@ -287,16 +315,104 @@ static PetscErrorCode MatInvGetPC_Inv(Mat imat, PC *pc)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatInvSameNonzeroPatternSeqAIJ_Private"
+static PetscErrorCode MatInvSameNonzeroPatternSeqAIJ_Private(Mat A, Mat B, PetscBool *same)
+{
+  PetscInt na, nb;
+  const PetscInt *ia, *ja, *ib, *jb;
+  PetscBool done;
+
+  PetscFunctionBegin;
+  *same = PETSC_FALSE;
+  PetscCall(MatGetRowIJ(A, 0, PETSC_FALSE, PETSC_FALSE, &na, &ia, &ja, &done));
+  if (!done) PetscFunctionReturn(0);
+  PetscCall(MatGetRowIJ(B, 0, PETSC_FALSE, PETSC_FALSE, &nb, &ib, &jb, &done));
+  if (done) {
+    if (na == nb) PetscCall(PetscArraycmp(ia, ib, na+1, same));
+    if (*same) PetscCall(PetscArraycmp(ja, jb, ia[na], same));
+    PetscCall(MatRestoreRowIJ(B, 0, PETSC_FALSE, PETSC_FALSE, &nb, &ib, &jb, &done));
+  }
+  PetscCall(MatRestoreRowIJ(A, 0, PETSC_FALSE, PETSC_FALSE, &na, &ia, &ja, &done));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatInvSameNonzeroPattern_Private"
+/* collective; PETSC_FALSE for types that cannot be compared cheaply */
+static PetscErrorCode MatInvSameNonzeroPattern_Private(Mat A, Mat B, PetscBool *same)
+{
+  PetscBool flg, flgB;
+  PetscInt M, N, m, n, MB, NB, mb, nb;
+  Mat Ad, Ao, Bd, Bo;
+  const PetscInt *garrayA, *garrayB;
+
+  PetscFunctionBegin;
+  *same = PETSC_FALSE;
+  PetscCall(MatGetSize(A, &M, &N));
+  PetscCall(MatGetSize(B, &MB, &NB));
+  PetscCall(MatGetLocalSize(A, &m, &n));
+  PetscCall(MatGetLocalSize(B, &mb, &nb));
+  if (M != MB || N != NB || m != mb || n != nb) goto reduce;
+
+  PetscCall(PetscObjectTypeCompare((PetscObject)A, MATSEQAIJ, &flg));
+  PetscCall(PetscObjectTypeCompare((PetscObject)B, MATSEQAIJ, &flgB));
+  if (flg && flgB) {
+    PetscCall(MatInvSameNonzeroPatternSeqAIJ_Private(A, B, same));
+    goto reduce;
+  }
+  PetscCall(PetscObjectTypeCompare((PetscObject)A, MATMPIAIJ, &flg));
+  PetscCall(PetscObjectTypeCompare((PetscObject)B, MATMPIAIJ, &flgB));
+  if (flg && flgB) {
+    PetscCall(MatMPIAIJGetSeqAIJ(A, &Ad, &Ao, &garrayA));
+    PetscCall(MatMPIAIJGetSeqAIJ(B, &Bd, &Bo, &garrayB));
+    if (Ao->cmap->n != Bo->cmap->n) goto reduce;
+    PetscCall(PetscArraycmp(garrayA, garrayB, Ao->cmap->n, same));
+    if (*same) PetscCall(MatInvSameNonzeroPatternSeqAIJ_Private(Ad, Bd, same));
+    if (*same) PetscCall(MatInvSameNonzeroPatternSeqAIJ_Private(Ao, Bo, same));
+    goto reduce;
+  }
+  PetscCall(PetscObjectTypeCompare((PetscObject)A, MATBLOCKDIAG, &flg));
+  PetscCall(PetscObjectTypeCompare((PetscObject)B, MATBLOCKDIAG, &flgB));
+  if (flg && flgB) {
+    PetscCall(MatGetDiagonalBlock(A, &Ad));
+    PetscCall(MatGetDiagonalBlock(B, &Bd));
+    PetscCall(PetscObjectTypeCompare((PetscObject)Ad, MATSEQAIJ, &flg));
+    PetscCall(PetscObjectTypeCompare((PetscObject)Bd, MATSEQAIJ, &flgB));
+    if (flg && flgB) PetscCall(MatInvSameNonzeroPatternSeqAIJ_Private(Ad, Bd, same));
+  }
+
+  reduce:
+  PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE, same, 1, MPIU_BOOL, MPI_LAND, PetscObjectComm((PetscObject)A)));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatInvSetMat_Inv"
 static PetscErrorCode MatInvSetMat_Inv(Mat imat, Mat A)
 {
   Mat_Inv *inv = (Mat_Inv*) imat->data;
   PetscInt m, n, M, N;
+  Mat Aop;
+  PetscBool same = PETSC_FALSE;
 
   PetscFunctionBegin;
   if (A == inv->A) PetscFunctionReturn(0);
 
+  /* if the inner operator is a private copy of A, keep it and its factorization pattern for A of the same nonzero pattern */
+  if (inv->setupcalled && inv->inner_objects_created && inv->regtype != MAT_REG_IMPLICIT) {
+    PetscCall(KSPGetOperators(inv->ksp, &Aop, NULL));
+    if (Aop != inv->A) PetscCall(MatInvSameNonzeroPattern_Private(A, inv->A, &same));
+  }
+  if (same) {
+    PetscCall(PetscInfo(imat,"new matrix has the same nonzero pattern, symbolic factorization will be reused\n"));
+    PetscCall(PetscObjectReference((PetscObject)A));
+    PetscCall(MatDestroy(&inv->A));
+    inv->A = A;
+    inv->samepattern = PETSC_TRUE;
+    PetscFunctionReturn(0);
+  }
+
   PetscCall(MatInvReset(imat));
   PetscCall(MatGetSize(A, &M, &N));
   PetscCall(MatGetLocalSize(A, &m, &n));
@@ -394,6 +510,27 @@ static PetscErrorCode MatInvSetType_Inv(Mat imat, MatInvType type)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatInvResetBlocks_Private"
+static PetscErrorCode MatInvResetBlocks_Private(Mat imat)
+{
+  Mat_Inv *inv = (Mat_Inv*) imat->data;
+  PetscInt i;
+
+  PetscFunctionBegin;
+  if (inv->subx) {
+    for (i=0; i<inv->nsubksp; i++) {
+      PetscCall(VecDestroy(&inv->subx[i]));
+      PetscCall(VecDestroy(&inv->suby[i]));
+    }
+  }
+  PetscCall(PetscFree2(inv->subx,inv->suby));
+  PetscCall(PetscFree(inv->suboffsets));
+  inv->nsubksp = 0;
+  inv->subksp = NULL;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatInvReset_Inv"
 static PetscErrorCode MatInvReset_Inv(Mat imat)
@@ -401,30 +538,90 @@ static PetscErrorCode MatInvReset_Inv(Mat imat)
   Mat_Inv *inv = (Mat_Inv*) imat->data;
 
   PetscFunctionBeginI;
+  PetscCall(MatInvResetBlocks_Private(imat));
   PetscCall(KSPReset(inv->ksp));
   inv->setupcalled = PETSC_FALSE;
+  inv->inner_objects_created = PETSC_FALSE;
+  inv->samepattern = PETSC_FALSE;
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatInvUpdateInnerMat_Private"
+/* copy new values of A to the inner operator without changing its nonzero pattern, so that PCSetUp refactors numerically only */
+static PetscErrorCode MatInvUpdateInnerMat_Private(Mat imat)
+{
+  Mat_Inv *inv = (Mat_Inv*) imat->data;
+  Mat Aop;
+
+  PetscFunctionBegin;
+  PetscCall(KSPGetOperators(inv->ksp, &Aop, NULL));
+  if (Aop == inv->A) PetscFunctionReturn(0);
+  if (inv->regtype == MAT_REG_NONE) {
+    PetscCall(MatCopy(inv->A, Aop, SAME_NONZERO_PATTERN));
+  } else {
+    /* MAT_REG_IMPLICIT operator references A, but its rho*Q part depends on A as well */
+    PetscCall(MatRegularize(inv->A, inv->R, inv->regtype, MAT_REUSE_MATRIX, &Aop));
+  }
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatInvSetUp_Inv"
 static PetscErrorCode MatInvSetUp_Inv(Mat imat)
 {
   Mat_Inv *inv = (Mat_Inv*) imat->data;
 
+  PetscObjectState state, nzstate;
+  PetscBool update = PETSC_FALSE;
+
   FllopTracedFunctionBegin;
-  if (inv->setupcalled) PetscFunctionReturn(0);
+  if (inv->setupcalled) {
+    /* changes made directly to the local block of MATBLOCKDIAG A */
+    PetscCall(MatBlockDiagUpdateState_Private(inv->A));
+    PetscCall(PetscObjectStateGet((PetscObject)inv->A, &state));
+    if (!inv->samepattern && state == inv->Astate) PetscFunctionReturn(0);
+    PetscCall(MatGetNonzeroState(inv->A, &nzstate));
+    /* values of A changed, only the numeric factorization needs to be redone */
+    update = (PetscBool)(inv->samepattern || nzstate == inv->Anzstate);
+  }
   if (inv->type == MAT_INV_BLOCKDIAG && inv->redundancy > 0) SETERRQ(PetscObjectComm((PetscObject)imat),PETSC_ERR_SUP, "Cannot use MAT_INV_BLOCKDIAG and redundancy at the same time");
   if (inv->regtype && !inv->R) SETERRQ(PetscObjectComm((PetscObject)imat),PETSC_ERR_ARG_WRONGSTATE,"regularization is requested but nullspace is not set");
 
   FllopTraceBegin;
   PetscCall(PetscLogEventBegin(Mat_Inv_SetUp,imat,0,0,0));
+  if (update) {
+    PetscCall(PetscInfo(imat,"nonzero pattern of A unchanged, reusing symbolic factorization\n"));
+    PetscCall(MatInvUpdateInnerMat_Private(imat));
+  } else if (inv->setupcalled) {
+    PetscCall(MatInvReset_Inv(imat));
+  }
   {
     PetscCall(MatInvCreateInnerObjects_Inv(imat));
     PetscCall(KSPSetUp(inv->ksp));
+#if defined(MATINV_THREADED_BLOCKS)
+    if (inv->nsubksp > 1) {
+      PetscInt  i;
+      int       err = 0;
+      PetscBool threaded;
+
+      /* factor the subdomain blocks concurrently, KSPSetUpOnBlocks then finds them set up */
+      PetscCall(MatInvThreadedBlocks_Private(&threaded));
+      if (threaded) {
+#pragma omp parallel for schedule(dynamic,1) reduction(|:err)
+        for (i=0; i<inv->nsubksp; i++) err |= (int)KSPSetUp(inv->subksp[i]);
+        if (err) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_LIB,"KSPSetUp of a subdomain block failed");
+      } else {
+        for (i=0; i<inv->nsubksp; i++) PetscCall(KSPSetUp(inv->subksp[i]));
+      }
+    }
+#endif
     PetscCall(KSPSetUpOnBlocks(inv->ksp));
   }
 
+  PetscCall(PetscObjectStateGet((PetscObject)inv->A, &inv->Astate));
+  PetscCall(MatGetNonzeroState(inv->A, &inv->Anzstate));
+  inv->samepattern = PETSC_FALSE;
   inv->setupcalled = PETSC_TRUE;
   PetscCall(MatInheritSymmetry(inv->A,imat));
   PetscCall(PetscLogEventEnd(Mat_Inv_SetUp,imat,0,0,0));
@@ -457,7 +654,7 @@ static PetscErrorCode MatInvCreateInnerObjects_Inv(Mat imat)
   }
 
   own = ((PetscObject)inv->A)->refct == 1 ? PETSC_TRUE : PETSC_FALSE;
-  PetscCall(MatRegularize(inv->A,inv->R,inv->regtype,&Areg));
+  PetscCall(MatRegularize(inv->A,inv->R,inv->regtype,MAT_INITIAL_MATRIX,&Areg));
   PetscCall(PetscOptionsHasName(NULL,((PetscObject)imat)->prefix,"-mat_inv_mat_type",&flg));
   if (inv->setfromoptionscalled && flg && inv->A == Areg && !own) {
     PetscCall(PetscInfo(fllop,"duplicating inner matrix to allow to apply options only internally\n"));
@@ -557,11 +754,22 @@ static PetscErrorCode MatInvCreateInnerObjects_Inv(Mat imat)
     PetscCall(PCSetOptionsPrefix(pc,prefix));
     PetscCall(PCAppendOptionsPrefix(pc,"mat_inv_"));
     if (inv->type == MAT_INV_BLOCKDIAG) {
-      KSP *kspp;
+      PetscInt nblocks = 1, i;
+      const PetscInt *lens = NULL;
+
       PetscCall(PCSetType(pc, PCBJACOBI));
+      /* one sub-KSP per subdomain block of MATBLOCKDIAG */
+      PetscCall(PetscObjectTypeCompare((PetscObject)Areg, MATBLOCKDIAG, &flg));
+      if (flg) PetscCall(MatBlockDiagGetLocalBlockSizes(Areg, &nblocks, &lens));
+      if (nblocks > 1) PetscCall(PCBJacobiSetLocalBlocks(pc, nblocks, lens));
       PetscCall(PCSetUp(pc));
-      PetscCall(PCBJacobiGetSubKSP(pc, PETSC_IGNORE, PETSC_IGNORE, &kspp));
-      inv->innerksp = *kspp;
+      PetscCall(PCBJacobiGetSubKSP(pc, &inv->nsubksp, PETSC_IGNORE, &inv->subksp));
+      inv->innerksp = inv->subksp[0];
+      if (inv->nsubksp > 1) {
+        PetscCall(PetscMalloc1(inv->nsubksp+1, &inv->suboffsets));
+        inv->suboffsets[0] = 0;
+        for (i=0; i<inv->nsubksp; i++) inv->suboffsets[i+1] = inv->suboffsets[i] + lens[i];
+      }
     } else {
       char stri[1024];
       PetscCall(PetscSNPrintf(stri, sizeof(stri), "-%smat_inv_psubcomm_type %s",prefix,PetscSubcommTypes[inv->psubcommType]));
@@ -574,17 +782,23 @@ static PetscErrorCode MatInvCreateInnerObjects_Inv(Mat imat)
   } else {
     inv->innerksp = inv->ksp;
   }
-  PetscCall(KSPGetPC(inv->innerksp,&pc));
-
-  PetscCall(KSPSetType(inv->innerksp,default_ksptype));
-  PetscCall(PCSetType(pc,default_pctype));
-  PetscCall(PCFactorSetMatSolverType(pc,default_pkg));
+  {
+    PetscInt i, nksp = inv->nsubksp > 1 ? inv->nsubksp : 1;
+    KSP      *kspp = inv->nsubksp > 1 ? inv->subksp : &inv->innerksp;
+
+    for (i=0; i<nksp; i++) {
+      PetscCall(KSPGetPC(kspp[i],&pc));
+      PetscCall(KSPSetType(kspp[i],default_ksptype));
+      PetscCall(PCSetType(pc,default_pctype));
+      PetscCall(PCFactorSetMatSolverType(pc,default_pkg));
+    }
 
-  PetscCall(KSPSetTolerances(inv->ksp, PETSC_SMALL, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT));
+    PetscCall(KSPSetTolerances(inv->ksp, PETSC_SMALL, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT));
 
-  PetscCall(MatInvKSPSetOptionsPrefix_Inv(imat));
-  if (inv->setfromoptionscalled) {
-    PetscCall(KSPSetFromOptions(inv->innerksp));
+    PetscCall(MatInvKSPSetOptionsPrefix_Inv(imat));
+    if (inv->setfromoptionscalled) {
+      for (i=0; i<nksp; i++) PetscCall(KSPSetFromOptions(kspp[i]));
+    }
   }
 
   PetscCall(MatDestroy(&Areg));
@@ -592,78 +806,98 @@ static PetscErrorCode MatInvCreateInnerObjects_Inv(Mat imat)
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatInvIdentityBlock_Private"
+/* fill the dense matrix E with columns [cbegin, cbegin+N) of eye(M), E has the row layout of the inverted operator */
+static PetscErrorCode MatInvIdentityBlock_Private(PetscInt cbegin, Mat E)
+{
+  PetscInt    k, N, ilo, ihi, lda;
+  PetscScalar *e;
+
+  PetscFunctionBegin;
+  PetscCall(MatGetSize(E, NULL, &N));
+  PetscCall(MatGetOwnershipRange(E, &ilo, &ihi));
+  PetscCall(MatDenseGetLDA(E, &lda));
+  PetscCall(MatDenseGetArrayWrite(E, &e));
+  for (k = 0; k < N; k++) {
+    PetscCall(PetscArrayzero(e + k*lda, ihi - ilo));
+    if (cbegin + k >= ilo && cbegin + k < ihi) e[cbegin + k - ilo + k*lda] = 1.0;
+  }
+  PetscCall(MatDenseRestoreArrayWrite(E, &e));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatInvExplicitly_Private"
-static PetscErrorCode MatInvExplicitly_Private(KSP ksp, Mat imat_explicit)
+static PetscErrorCode MatInvExplicitly_Private(KSP ksp, PetscInt bs, Mat imat_explicit)
 {
-  PetscInt m, M, i, ilo, ihi;
-  PetscInt *rows;
-  PetscScalar *v;
-  Mat A;
-  Vec col_I, col_imat;
+  PetscInt m, M, j, nb;
+  Mat A, E = NULL, X;
+  MPI_Comm comm;
 
   PetscFunctionBeginI;
   PetscCall(KSPGetOperators(ksp, &A, NULL));
+  PetscCall(PetscObjectGetComm((PetscObject)A, &comm));
   PetscCall(MatGetSize(     A, &M, NULL));
   PetscCall(MatGetLocalSize(A, &m, NULL));
-  PetscCall(MatGetOwnershipRange(A, &ilo, &ihi));
-
-  PetscCall(PetscMalloc(m*sizeof(PetscInt), &rows));
-  for (i=0; i<m; i++) rows[i] = ilo + i;
-
-  /* col_I is a j-th column of eye(M) */
-  PetscCall(MatCreateVecs(A, &col_imat, &col_I));
-  PetscCall(VecZeroEntries(col_I));
-  for (i = 0; i < M; i++) {
-    if (i >= ilo && i < ihi) PetscCall(VecSetValue(col_I, i, 1, INSERT_VALUES));
-    if (i > ilo && i <= ihi) PetscCall(VecSetValue(col_I, i - 1, 0, INSERT_VALUES));
-    PetscCall(VecAssemblyBegin(col_I));
-    PetscCall(VecAssemblyEnd(  col_I));
-
-    PetscCall(KSPSolve(ksp, col_I, col_imat));
-    PetscCall(VecGetArray(col_imat, &v));
-    PetscCall(MatSetValues(imat_explicit, m, rows, 1, &i, v, INSERT_VALUES));
-    PetscCall(VecRestoreArray(col_imat, &v));
+
+  /* solve for blocks of bs columns of eye(M) at once, the solution is written directly to the columns of imat_explicit */
+  for (j = 0; j < M; j += bs) {
+    nb = PetscMin(bs, M - j);
+    if (!E || nb != bs) {
+      PetscCall(MatDestroy(&E));
+      PetscCall(MatCreateDensePermon(comm, m, PETSC_DECIDE, M, nb, NULL, &E));
+    }
+    PetscCall(MatInvIdentityBlock_Private(j, E));
+    PetscCall(MatDenseGetSubMatrix(imat_explicit, PETSC_DECIDE, PETSC_DECIDE, j, j + nb, &X));
+    PetscCall(KSPMatSolve(ksp, E, X));
+    PetscCall(MatDenseRestoreSubMatrix(imat_explicit, &X));
   }
-  PetscCall(VecDestroy(&col_imat));
-  PetscCall(VecDestroy(&col_I));
-  PetscFree(rows);
+  PetscCall(MatDestroy(&E));
   PetscFunctionReturnI(0);
 }
 
 #undef __FUNCT__  
 #define __FUNCT__ "MatInvExplicitlyTranspose_Private"
-static PetscErrorCode MatInvExplicitlyTranspose_Private(PetscInt ilo, PetscInt ihi, KSP ksp, Mat imat_explicit)
+static PetscErrorCode MatInvExplicitlyTranspose_Private(PetscInt ilo, PetscInt ihi, KSP ksp, PetscInt bs, Mat imat_explicit)
 {
-  PetscInt i, Ailo, Aihi, localSize;
+  PetscInt i, j, k, nb, M, Ailo, Aihi, localSize, lda;
   PetscInt *idxn;
-  PetscScalar *v;
-  Mat A;
-  Vec col_I, row_imat;
+  const PetscScalar *x;
+  Mat A, E = NULL, X = NULL;
+  MPI_Comm comm;
 
   PetscFunctionBeginI;
   PetscCall(KSPGetOperators(ksp, &A, NULL));
+  PetscCall(PetscObjectGetComm((PetscObject)A, &comm));
+  PetscCall(MatGetSize(A, &M, NULL));
   PetscCall(MatGetOwnershipRange(A, &Ailo, &Aihi));
   localSize = Aihi-Ailo;
   
   PetscCall(PetscMalloc(localSize * sizeof(PetscInt), &idxn));
   for (i = 0; i < localSize; i++) idxn[i] = i+Ailo;
 
-  /* col_I is a j-th column of eye(M) */
-  PetscCall(MatCreateVecs(A, &col_I, &row_imat));
-  PetscCall(VecZeroEntries(col_I));
-  for (i = ilo; i < ihi; i++) {
-    PetscCall(VecSetValue(col_I, i, 1, INSERT_VALUES));
-    if (i > ilo) PetscCall(VecSetValue(col_I, i - 1, 0, INSERT_VALUES));
-    PetscCall(VecAssemblyBegin(col_I));
-    PetscCall(VecAssemblyEnd(  col_I));
-    PetscCall(KSPSolve(ksp, col_I, row_imat));
-    PetscCall(VecGetArray(row_imat, &v));
-    PetscCall(MatSetValues(imat_explicit, 1, &i, localSize, idxn, v, INSERT_VALUES));
-    PetscCall(VecRestoreArray(row_imat, &v));
+  /* solve for blocks of bs columns of eye(M) at once, the j-th solution is the j-th row of imat_explicit */
+  for (j = ilo; j < ihi; j += bs) {
+    nb = PetscMin(bs, ihi - j);
+    if (!E || nb != bs) {
+      PetscCall(MatDestroy(&E));
+      PetscCall(MatDestroy(&X));
+      PetscCall(MatCreateDensePermon(comm, localSize, PETSC_DECIDE, M, nb, NULL, &E));
+      PetscCall(MatDuplicate(E, MAT_DO_NOT_COPY_VALUES, &X));
+    }
+    PetscCall(MatInvIdentityBlock_Private(j, E));
+    PetscCall(KSPMatSolve(ksp, E, X));
+    PetscCall(MatDenseGetLDA(X, &lda));
+    PetscCall(MatDenseGetArrayRead(X, &x));
+    for (k = 0; k < nb; k++) {
+      i = j + k;
+      PetscCall(MatSetValues(imat_explicit, 1, &i, localSize, idxn, x + k*lda, INSERT_VALUES));
+    }
+    PetscCall(MatDenseRestoreArrayRead(X, &x));
   }
-  PetscCall(VecDestroy(&row_imat));
-  PetscCall(VecDestroy(&col_I));
+  PetscCall(MatDestroy(&E));
+  PetscCall(MatDestroy(&X));
   PetscFree(idxn);
   PetscFunctionReturnI(0);
 }
@@ -679,6 +913,7 @@ static PetscErrorCode MatInvExplicitly_Inv(Mat imat, PetscBool transpose, MatReu
   KSP ksp;
   PetscInt iloihi[2];
   PetscInt redundancy;
+  PetscInt bs = ((Mat_Inv*)imat->data)->explicit_bs;
   Mat B;
 
   PetscFunctionBeginI;
@@ -693,6 +928,8 @@ static PetscErrorCode MatInvExplicitly_Inv(Mat imat, PetscBool transpose, MatReu
   PetscCall(MatInvGetRedundancy(imat, &redundancy));
 
   if (imat==*imat_explicit) SETERRQ(comm, PETSC_ERR_ARG_IDN, "Arguments #1 and #3 cannot be the same matrix.");
+  if (bs == PETSC_DECIDE || bs > M) bs = M;
+  bs = PetscMax(bs, 1);
 
   if (scall == MAT_INITIAL_MATRIX) {
     PetscCall(MatCreateDensePermon(comm, m, m, M, M, NULL, &B));
@@ -720,9 +957,9 @@ static PetscErrorCode MatInvExplicitly_Inv(Mat imat, PetscBool transpose, MatReu
       iloihi[0] = 0;
       iloihi[1] = M;
     }
-    PetscCall(MatInvExplicitlyTranspose_Private(iloihi[0], iloihi[1], ksp, B));
+    PetscCall(MatInvExplicitlyTranspose_Private(iloihi[0], iloihi[1], ksp, bs, B));
   } else {
-    PetscCall(MatInvExplicitly_Private(         ksp, B));
+    PetscCall(MatInvExplicitly_Private(         ksp, bs, B));
   }
   PetscCall(PetscInfo(fllop,"calling MatAssemblyBegin\n"));
   PetscCall(MatAssemblyBegin(B, MAT_FINAL_ASSEMBLY));
@@ -734,16 +971,224 @@ static PetscErrorCode MatInvExplicitly_Inv(Mat imat, PetscBool transpose, MatReu
 }
 
 
+#undef __FUNCT__
+#define __FUNCT__ "MatInvSetPreonlyResult_Private"
+/* the split and per-block solve paths bypass KSPSolve() of the outer KSPPREONLY; record its iteration count and reason as KSPSolve() would */
+static PetscErrorCode MatInvSetPreonlyResult_Private(Mat imat, PetscBool failed)
+{
+  Mat_Inv *inv = (Mat_Inv*) imat->data;
+  KSP     ksp = inv->ksp;
+
+  PetscFunctionBegin;
+  if (failed) {
+    ksp->its    = 0;
+    ksp->reason = KSP_DIVERGED_PC_FAILED;
+    if (ksp->errorifnotconverged) SETERRQ(PetscObjectComm((PetscObject)imat),PETSC_ERR_NOT_CONVERGED,"inner solve of MATINV did not converge");
+  } else {
+    ksp->its    = 1;
+    ksp->reason = KSP_CONVERGED_ITS;
+  }
+  ksp->totalits += ksp->its;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatInvSolve_Private"
+static PetscErrorCode MatInvSolve_Private(Mat imat, Vec right, Vec left)
+{
+  Mat_Inv *inv = (Mat_Inv*) imat->data;
+
+  PetscFunctionBegin;
+#if defined(MATINV_THREADED_BLOCKS)
+  if (inv->nsubksp > 1) {
+    const PetscScalar  *x;
+    PetscScalar        *y;
+    PetscInt           i, n;
+    int                err = 0;
+    PetscBool          threaded, preonly, bjacobi, failed = PETSC_FALSE;
+    PC                 pc;
+    KSPConvergedReason reason;
+
+    /* applying the subdomain solves directly is equivalent only if the outer KSP is still preonly with PCBJACOBI */
+    PetscCall(KSPGetPC(inv->ksp,&pc));
+    PetscCall(PetscObjectTypeCompare((PetscObject)inv->ksp,KSPPREONLY,&preonly));
+    PetscCall(PetscObjectTypeCompare((PetscObject)pc,PCBJACOBI,&bjacobi));
+    if (!preonly || !bjacobi) {
+      PetscCall(KSPSolve(inv->ksp, right, left));
+      PetscFunctionReturn(0);
+    }
+    PetscCall(MatInvThreadedBlocks_Private(&threaded));
+    if (!inv->subx) {
+      PetscCall(PetscMalloc2(inv->nsubksp,&inv->subx,inv->nsubksp,&inv->suby));
+      for (i=0; i<inv->nsubksp; i++) {
+        n = inv->suboffsets[i+1] - inv->suboffsets[i];
+        PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF,1,n,NULL,&inv->subx[i]));
+        PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF,1,n,NULL,&inv->suby[i]));
+      }
+    }
+    PetscCall(VecGetArrayRead(right,&x));
+    PetscCall(VecGetArray(left,&y));
+    if (threaded) {
+#pragma omp parallel for schedule(dynamic,1) reduction(|:err)
+      for (i=0; i<inv->nsubksp; i++) {
+        err |= (int)VecPlaceArray(inv->subx[i],x+inv->suboffsets[i]);
+        err |= (int)VecPlaceArray(inv->suby[i],y+inv->suboffsets[i]);
+        err |= (int)KSPSolve(inv->subksp[i],inv->subx[i],inv->suby[i]);
+        err |= (int)VecResetArray(inv->subx[i]);
+        err |= (int)VecResetArray(inv->suby[i]);
+      }
+    } else {
+      for (i=0; i<inv->nsubksp; i++) {
+        PetscCall(VecPlaceArray(inv->subx[i],x+inv->suboffsets[i]));
+        PetscCall(VecPlaceArray(inv->suby[i],y+inv->suboffsets[i]));
+        PetscCall(KSPSolve(inv->subksp[i],inv->subx[i],inv->suby[i]));
+        PetscCall(VecResetArray(inv->subx[i]));
+        PetscCall(VecResetArray(inv->suby[i]));
+      }
+    }
+    PetscCall(VecRestoreArray(left,&y));
+    PetscCall(VecRestoreArrayRead(right,&x));
+    if (err) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_LIB,"KSPSolve of a subdomain block failed");
+    for (i=0; i<inv->nsubksp; i++) {
+      PetscCall(KSPGetConvergedReason(inv->subksp[i],&reason));
+      if (reason < 0) failed = PETSC_TRUE;
+    }
+    PetscCall(MatInvSetPreonlyResult_Private(imat,failed));
+    PetscFunctionReturn(0);
+  }
+#endif
+  PetscCall(KSPSolve(inv->ksp, right, left));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatMult_Inv"
 PetscErrorCode MatMult_Inv(Mat imat, Vec right, Vec left)
 {
-  Mat_Inv *inv;
+  PetscFunctionBegin;
+  PetscCall(MatInvSetUp_Inv(imat));
+  PetscCall(MatInvSolve_Private(imat, right, left));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatInvMultBegin_Inv"
+static PetscErrorCode MatInvMultBegin_Inv(Mat imat, Vec right)
+{
+  Mat_Inv      *inv = (Mat_Inv*) imat->data;
+  PC           pc;
+  PC_Redundant *red;
+  PetscBool    flg;
 
   PetscFunctionBegin;
-  inv = (Mat_Inv*) imat->data;
+  if (inv->multpending) SETERRQ(PetscObjectComm((PetscObject)imat),PETSC_ERR_ORDER,"MatInvMultEnd() must be called before the next MatInvMultBegin()");
   PetscCall(MatInvSetUp_Inv(imat));
-  PetscCall(KSPSolve(inv->ksp, right, left));
+  inv->multpending = PETSC_TRUE;
+  inv->multsplit = PETSC_FALSE;
+  if (!inv->redundancy) PetscFunctionReturn(0);
+
+  /* with redundancy, start gathering the right-hand side to the subcommunicators; the rest of PCApply_Redundant is done in MatInvMultEnd;
+     KSPSolve() of the outer KSP is bypassed, which is equivalent only if it is preonly */
+  PetscCall(PetscObjectTypeCompare((PetscObject)inv->ksp, KSPPREONLY, &flg));
+  if (!flg) PetscFunctionReturn(0);
+  PetscCall(KSPGetPC(inv->ksp, &pc));
+  PetscCall(PetscObjectTypeCompare((PetscObject)pc, PCREDUNDANT, &flg));
+  if (!flg) PetscFunctionReturn(0);
+  red = (PC_Redundant*)pc->data;
+  if (!red->useparallelmat) PetscFunctionReturn(0);
+  PetscCall(VecScatterBegin(red->scatterin, right, red->xdup, INSERT_VALUES, SCATTER_FORWARD));
+  inv->multsplit = PETSC_TRUE;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatInvMultEnd_Inv"
+static PetscErrorCode MatInvMultEnd_Inv(Mat imat, Vec right, Vec left)
+{
+  Mat_Inv      *inv = (Mat_Inv*) imat->data;
+  PC           pc;
+  PC_Redundant *red;
+  PetscScalar  *array;
+  KSPConvergedReason reason;
+
+  PetscFunctionBegin;
+  if (!inv->multpending) SETERRQ(PetscObjectComm((PetscObject)imat),PETSC_ERR_ORDER,"MatInvMultBegin() must be called first");
+  inv->multpending = PETSC_FALSE;
+  if (!inv->multsplit) {
+    PetscCall(MatInvSolve_Private(imat, right, left));
+    PetscFunctionReturn(0);
+  }
+
+  PetscCall(KSPGetPC(inv->ksp, &pc));
+  red = (PC_Redundant*)pc->data;
+  PetscCall(VecScatterEnd(red->scatterin, right, red->xdup, INSERT_VALUES, SCATTER_FORWARD));
+
+  /* solve on each subcommunicator */
+  PetscCall(VecGetArray(red->xdup, &array));
+  PetscCall(VecPlaceArray(red->xsub, (const PetscScalar*)array));
+  PetscCall(KSPSolve(red->ksp, red->xsub, red->ysub));
+  PetscCall(VecResetArray(red->xsub));
+  PetscCall(VecRestoreArray(red->xdup, &array));
+
+  /* scatter the solution back */
+  PetscCall(VecGetArray(red->ysub, &array));
+  PetscCall(VecPlaceArray(red->ydup, (const PetscScalar*)array));
+  PetscCall(VecScatterBegin(red->scatterout, red->ydup, left, INSERT_VALUES, SCATTER_FORWARD));
+  PetscCall(VecScatterEnd(  red->scatterout, red->ydup, left, INSERT_VALUES, SCATTER_FORWARD));
+  PetscCall(VecResetArray(red->ydup));
+  PetscCall(VecRestoreArray(red->ysub, &array));
+  inv->multsplit = PETSC_FALSE;
+
+  PetscCall(KSPGetConvergedReason(red->ksp, &reason));
+  PetscCall(MatInvSetPreonlyResult_Private(imat, (PetscBool)(reason < 0)));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultBegin_Inv"
+static PetscErrorCode PermonMatMultBegin_Inv(Mat imat, Vec right, Vec left)
+{
+  PetscFunctionBegin;
+  PetscCall(MatInvMultBegin_Inv(imat, right));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductNumeric_Inv_Dense"
+static PetscErrorCode MatProductNumeric_Inv_Dense(Mat C)
+{
+  Mat_Product *product = C->product;
+  Mat         A=product->A,B=product->B;
+  Mat_Inv     *inv = (Mat_Inv*) A->data;
+
+  PetscFunctionBegin;
+  PetscCall(MatInvSetUp_Inv(A));
+  /* all columns of B are solved at once, i.e. one multi-RHS MatMatSolve if the inner PC is a factorization */
+  PetscCall(KSPMatSolve(inv->ksp, B, C));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSymbolic_Inv_Dense"
+static PetscErrorCode MatProductSymbolic_Inv_Dense(Mat C)
+{
+  Mat_Product *product = C->product;
+  Mat         A=product->A,B=product->B;
+
+  PetscFunctionBegin;
+  PetscCall(MatSetSizes(C,A->rmap->n,B->cmap->n,A->rmap->N,B->cmap->N));
+  if (!((PetscObject)C)->type_name) PetscCall(MatSetType(C,MATDENSE));
+  PetscCall(MatSetUp(C));
+  C->ops->productnumeric  = MatProductNumeric_Inv_Dense;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatProductSetFromOptions_Inv_Dense"
+static PetscErrorCode MatProductSetFromOptions_Inv_Dense(Mat C)
+{
+  PetscFunctionBegin;
+  if (C->product->type == MATPRODUCT_AB) C->ops->productsymbolic = MatProductSymbolic_Inv_Dense;
   PetscFunctionReturn(0);
 }
 
@@ -792,6 +1237,7 @@ PetscErrorCode MatDestroy_Inv(Mat imat)
   inv = (Mat_Inv*) imat->data;
   PetscCall(MatDestroy(&inv->A));
   PetscCall(MatDestroy(&inv->R));
+  PetscCall(MatInvResetBlocks_Private(imat));
   PetscCall(KSPDestroy(&inv->ksp));
   PetscCall(PetscFree(inv));
   PetscFunctionReturn(0);
@@ -811,6 +1257,7 @@ PetscErrorCode MatSetFromOptions_Inv(Mat imat,PetscOptionItems *PetscOptionsObje
   
   PetscCall(PetscOptionsEnum("-mat_inv_psubcomm_type", "subcommunicator type", "", PetscSubcommTypes, (PetscEnum) inv->psubcommType, (PetscEnum*)&psubcommType, &set));
   if (set) MatInvSetPsubcommType(imat, psubcommType);
+  PetscCall(PetscOptionsInt("-mat_inv_explicit_block_size", "number of columns solved at once in MatInvExplicitly", "MatInvExplicitly", inv->explicit_bs, &inv->explicit_bs, NULL));
 
   inv->setfromoptionscalled = PETSC_TRUE;
 
@@ -975,6 +1422,14 @@ FLLOP_EXTERN PetscErrorCode MatCreate_Inv(Mat imat)
   PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatInvSetPsubcommType_Inv_C",MatInvSetPsubcommType_Inv));
   PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatInvGetType_Inv_C",MatInvGetType_Inv));
   PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatInvSetType_Inv_C",MatInvSetType_Inv));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatInvMultBegin_Inv_C",MatInvMultBegin_Inv));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatInvMultEnd_Inv_C",MatInvMultEnd_Inv));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"PermonMatMultBegin_C",PermonMatMultBegin_Inv));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"PermonMatMultEnd_C",MatInvMultEnd_Inv));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatProductSetFromOptions_inv_seqdense_C",MatProductSetFromOptions_Inv_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatProductSetFromOptions_inv_mpidense_C",MatProductSetFromOptions_Inv_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatProductSetFromOptions_inv_seqdensepermon_C",MatProductSetFromOptions_Inv_Dense));
+  PetscCall(PetscObjectComposeFunction((PetscObject)imat,"MatProductSetFromOptions_inv_mpidensepermon_C",MatProductSetFromOptions_Inv_Dense));
 
   /* set default values of inner inv */
   inv->A                            = NULL;
@@ -988,6 +1443,17 @@ FLLOP_EXTERN PetscErrorCode MatCreate_Inv(Mat imat)
   inv->type                         = MAT_INV_MONOLITHIC;
   inv->innerksp                     = NULL;
   inv->ksp                          = NULL;
+  inv->explicit_bs                  = 256;
+  inv->multpending                  = PETSC_FALSE;
+  inv->multsplit                    = PETSC_FALSE;
+  inv->Astate                       = 0;
+  inv->Anzstate                     = 0;
+  inv->samepattern                  = PETSC_FALSE;
+  inv->nsubksp                      = 0;
+  inv->subksp                       = NULL;
+  inv->suboffsets                   = NULL;
+  inv->subx                         = NULL;
+  inv->suby                         = NULL;
   PetscFunctionReturn(0);
 }
 
@@ -1027,6 +1493,30 @@ PetscErrorCode MatInvExplicitly(Mat imat, PetscBool transpose, MatReuse scall, M
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatInvMultBegin"
+/* split-phase MatMult; with redundancy the gather of right to the subcommunicators overlaps the work done before MatInvMultEnd */
+PetscErrorCode MatInvMultBegin(Mat imat, Vec right)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(imat,MAT_CLASSID,1);
+  PetscValidHeaderSpecific(right,VEC_CLASSID,2);
+  PetscUseMethod(imat,"MatInvMultBegin_Inv_C",(Mat,Vec),(imat,right));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatInvMultEnd"
+PetscErrorCode MatInvMultEnd(Mat imat, Vec right, Vec left)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(imat,MAT_CLASSID,1);
+  PetscValidHeaderSpecific(right,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(left,VEC_CLASSID,3);
+  PetscUseMethod(imat,"MatInvMultEnd_Inv_C",(Mat,Vec,Vec),(imat,right,left));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatInvReset"
 PetscErrorCode MatInvReset(Mat imat)
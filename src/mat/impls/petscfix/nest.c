@@ -2,6 +2,13 @@
 #include <permon/private/permonmatimpl.h>
 #include <permon/private/petscimpl.h>
 
+/* subvectors and work vectors kept between MatMultBegin_NestPermon() and MatMultEnd_NestPermon() */
+typedef struct {
+  PetscInt  nr,nc;
+  Vec       *bx,*by,*w;
+  PetscBool split;
+} MatNestPermonSplitCtx;
+
 #undef __FUNCT__
 #define __FUNCT__ "MatGetColumnVectors_NestPermon"
 static PetscErrorCode MatGetColumnVectors_NestPermon(Mat A, Vec *cols_new[])
@@ -601,6 +608,123 @@ static PetscErrorCode MatExtensionCreateCondensedRows_NestPermon(Mat TA,Mat *A,I
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatNestPermonSplitCtxDestroy_Private"
+static PetscErrorCode MatNestPermonSplitCtxDestroy_Private(void *ptr)
+{
+  MatNestPermonSplitCtx *ctx = (MatNestPermonSplitCtx*)ptr;
+  PetscInt              i;
+
+  PetscFunctionBegin;
+  for (i=0; i<ctx->nr*ctx->nc; i++) PetscCall(VecDestroy(&ctx->w[i]));
+  PetscCall(PetscFree3(ctx->bx,ctx->by,ctx->w));
+  PetscCall(PetscFree(ctx));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatNestPermonGetSplitCtx_Private"
+static PetscErrorCode MatNestPermonGetSplitCtx_Private(Mat A,MatNestPermonSplitCtx **ctx_out)
+{
+  Mat_Nest              *bA = (Mat_Nest*)A->data;
+  MatNestPermonSplitCtx *ctx;
+  PetscContainer        ctr;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectQuery((PetscObject)A,"MatNestPermonSplitCtx",(PetscObject*)&ctr));
+  if (!ctr) {
+    PetscCall(PetscNew(&ctx));
+    ctx->nr = bA->nr;
+    ctx->nc = bA->nc;
+    PetscCall(PetscCalloc3(bA->nc,&ctx->bx,bA->nr,&ctx->by,bA->nr*bA->nc,&ctx->w));
+    PetscCall(PetscContainerCreate(PetscObjectComm((PetscObject)A),&ctr));
+    PetscCall(PetscContainerSetPointer(ctr,ctx));
+    PetscCall(PetscContainerSetUserDestroy(ctr,MatNestPermonSplitCtxDestroy_Private));
+    PetscCall(PetscObjectCompose((PetscObject)A,"MatNestPermonSplitCtx",(PetscObject)ctr));
+    PetscCall(PetscObjectDereference((PetscObject)ctr));
+  }
+  PetscCall(PetscContainerGetPointer(ctr,(void**)ctx_out));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultBegin_NestPermon"
+/* start the split-phase multiplication by all blocks; the first block of each block row writes to the subvector of y,
+   the others to work vectors which are added in MatMultEnd_NestPermon;
+   a block appearing twice cannot be in flight twice, so such nests fall back to MatMult in the end phase */
+static PetscErrorCode MatMultBegin_NestPermon(Mat A,Vec x,Vec y)
+{
+  Mat_Nest              *bA = (Mat_Nest*)A->data;
+  MatNestPermonSplitCtx *ctx;
+  PetscInt              i,j,k,l;
+  PetscBool             first;
+  Vec                   out;
+
+  PetscFunctionBegin;
+  PetscCall(MatNestPermonGetSplitCtx_Private(A,&ctx));
+  ctx->split = PETSC_TRUE;
+  for (k=0; k<bA->nr*bA->nc && ctx->split; k++) {
+    if (!bA->m[k/bA->nc][k%bA->nc]) continue;
+    for (l=0; l<k; l++) {
+      if (bA->m[l/bA->nc][l%bA->nc] == bA->m[k/bA->nc][k%bA->nc]) ctx->split = PETSC_FALSE;
+    }
+  }
+  if (!ctx->split) PetscFunctionReturn(0);
+
+  for (j=0; j<bA->nc; j++) PetscCall(VecGetSubVector(x,bA->isglobal.col[j],&ctx->bx[j]));
+  for (i=0; i<bA->nr; i++) {
+    PetscCall(VecGetSubVector(y,bA->isglobal.row[i],&ctx->by[i]));
+    first = PETSC_TRUE;
+    for (j=0; j<bA->nc; j++) {
+      if (!bA->m[i][j]) continue;
+      if (first) {
+        out = ctx->by[i];
+        first = PETSC_FALSE;
+      } else {
+        if (!ctx->w[i*bA->nc+j]) PetscCall(MatCreateVecs(bA->m[i][j],NULL,&ctx->w[i*bA->nc+j]));
+        out = ctx->w[i*bA->nc+j];
+      }
+      PetscCall(PermonMatMultBegin(bA->m[i][j],ctx->bx[j],out));
+    }
+    if (first) PetscCall(VecZeroEntries(ctx->by[i]));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatMultEnd_NestPermon"
+static PetscErrorCode MatMultEnd_NestPermon(Mat A,Vec x,Vec y)
+{
+  Mat_Nest              *bA = (Mat_Nest*)A->data;
+  MatNestPermonSplitCtx *ctx;
+  PetscInt              i,j;
+  PetscBool             first;
+
+  PetscFunctionBegin;
+  PetscCall(MatNestPermonGetSplitCtx_Private(A,&ctx));
+  if (!ctx->split) {
+    PetscCall(MatMult(A,x,y));
+    PetscFunctionReturn(0);
+  }
+
+  for (i=0; i<bA->nr; i++) {
+    first = PETSC_TRUE;
+    for (j=0; j<bA->nc; j++) {
+      if (!bA->m[i][j]) continue;
+      if (first) {
+        PetscCall(PermonMatMultEnd(bA->m[i][j],ctx->bx[j],ctx->by[i]));
+        first = PETSC_FALSE;
+      } else {
+        PetscCall(PermonMatMultEnd(bA->m[i][j],ctx->bx[j],ctx->w[i*bA->nc+j]));
+        PetscCall(VecAXPY(ctx->by[i],1.0,ctx->w[i*bA->nc+j]));
+      }
+    }
+    PetscCall(VecRestoreSubVector(y,bA->isglobal.row[i],&ctx->by[i]));
+  }
+  for (j=0; j<bA->nc; j++) PetscCall(VecRestoreSubVector(x,bA->isglobal.col[j],&ctx->bx[j]));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatConvert_Nest_NestPermon"
 PETSC_EXTERN PetscErrorCode MatConvert_Nest_NestPermon(Mat A,MatType type,MatReuse reuse,Mat *newmat)
@@ -630,6 +754,8 @@ PETSC_EXTERN PetscErrorCode MatConvert_Nest_NestPermon(Mat A,MatType type,MatReu
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatNestSetVecType_C",  MatNestSetVecType_NestPermon));
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatConvert_nest_nestpermon_C", MatConvert_Nest_NestPermon));
   PetscCall(PetscObjectComposeFunction((PetscObject)B,"MatExtensionCreateCondensedRows_Extension_C",MatExtensionCreateCondensedRows_NestPermon));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"PermonMatMultBegin_C",MatMultBegin_NestPermon));
+  PetscCall(PetscObjectComposeFunction((PetscObject)B,"PermonMatMultEnd_C",MatMultEnd_NestPermon));
 
   *newmat = B;
   PetscFunctionReturn(0);
@@ -49,6 +49,51 @@ PetscErrorCode MatMultTransposeAdd_Timer(Mat W, Vec x, Vec y, Vec z) {
     PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultBegin_Timer"
+/* the split-phase events span from Begin to End, including the work the caller overlaps with them */
+static PetscErrorCode PermonMatMultBegin_Timer(Mat W, Vec x, Vec y) {
+    Mat_Timer *ctx;
+    PetscFunctionBegin;
+    PetscCall(MatShellGetContext(W, (void*) &ctx));
+    PetscCall(PetscLogEventBegin(ctx->events[MATOP_MULT],ctx->A,x,y,0));
+    PetscCall(PermonMatMultBegin(ctx->A,x,y));
+    PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultEnd_Timer"
+static PetscErrorCode PermonMatMultEnd_Timer(Mat W, Vec x, Vec y) {
+    Mat_Timer *ctx;
+    PetscFunctionBegin;
+    PetscCall(MatShellGetContext(W, (void*) &ctx));
+    PetscCall(PermonMatMultEnd(ctx->A,x,y));
+    PetscCall(PetscLogEventEnd(  ctx->events[MATOP_MULT],ctx->A,x,y,0));
+    PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultTransposeBegin_Timer"
+static PetscErrorCode PermonMatMultTransposeBegin_Timer(Mat W, Vec x, Vec y) {
+    Mat_Timer *ctx;
+    PetscFunctionBegin;
+    PetscCall(MatShellGetContext(W, (void*) &ctx));
+    PetscCall(PetscLogEventBegin(ctx->events[MATOP_MULT_TRANSPOSE],ctx->A,x,y,0));
+    PetscCall(PermonMatMultTransposeBegin(ctx->A,x,y));
+    PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultTransposeEnd_Timer"
+static PetscErrorCode PermonMatMultTransposeEnd_Timer(Mat W, Vec x, Vec y) {
+    Mat_Timer *ctx;
+    PetscFunctionBegin;
+    PetscCall(MatShellGetContext(W, (void*) &ctx));
+    PetscCall(PermonMatMultTransposeEnd(ctx->A,x,y));
+    PetscCall(PetscLogEventEnd(  ctx->events[MATOP_MULT_TRANSPOSE],ctx->A,x,y,0));
+    PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatDestroy_Timer"
 PetscErrorCode MatDestroy_Timer(Mat W) {
@@ -91,10 +136,15 @@ PetscErrorCode MatCreateTimer(Mat A, Mat *B) {
     PetscCall(FllopPetscObjectInheritName((PetscObject)W,(PetscObject)A,NULL));
 
     PetscCall(MatShellSetOperation(W,MATOP_DESTROY,(void(*)(void))MatDestroy_Timer));
+    PetscCall(PetscObjectComposeFunction((PetscObject)W,"MatTimerGetMat_C",MatTimerGetMat));
     PetscCall(MatTimerSetOperation(W,MATOP_MULT,"MatMult",(void(*)(void))MatMult_Timer));
     PetscCall(MatTimerSetOperation(W,MATOP_MULT_ADD,"MatMultAdd",(void(*)(void))MatMultAdd_Timer));
     PetscCall(MatTimerSetOperation(W,MATOP_MULT_TRANSPOSE,"MatMultTr",(void(*)(void))MatMultTranspose_Timer));
     PetscCall(MatTimerSetOperation(W,MATOP_MULT_TRANSPOSE_ADD,"MatMultTrAdd",(void(*)(void))MatMultTransposeAdd_Timer));
+    PetscCall(PetscObjectComposeFunction((PetscObject)W,"PermonMatMultBegin_C",PermonMatMultBegin_Timer));
+    PetscCall(PetscObjectComposeFunction((PetscObject)W,"PermonMatMultEnd_C",PermonMatMultEnd_Timer));
+    PetscCall(PetscObjectComposeFunction((PetscObject)W,"PermonMatMultTransposeBegin_C",PermonMatMultTransposeBegin_Timer));
+    PetscCall(PetscObjectComposeFunction((PetscObject)W,"PermonMatMultTransposeEnd_C",PermonMatMultTransposeEnd_Timer));
     
     *B = W;
     PetscFunctionReturn(0);
@@ -113,6 +113,103 @@ PetscErrorCode MatRestoreColumnVectors(Mat A, PetscInt *ncols, Vec *cols_new[])
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatDenseGetPlainView_Private"
+/* wrap the storage of a dense matrix into a plain MATSEQDENSE/MATMPIDENSE sharing the same array;
+   a plain X is returned itself only if reuse is allowed - a product must never be created on a matrix
+   whose own product numeric may be running (e.g. C in MatProductNumeric_Prod_Dense) */
+static PetscErrorCode MatDenseGetPlainView_Private(Mat X, PetscBool reuse, Mat *Xp)
+{
+  MPI_Comm    comm;
+  PetscMPIInt size;
+  PetscScalar *array;
+  PetscInt    lda;
+  PetscBool   plain;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectTypeCompareAny((PetscObject)X,&plain,MATSEQDENSE,MATMPIDENSE,""));
+  if (plain && reuse) {
+    PetscCall(PetscObjectReference((PetscObject)X));
+    *Xp = X;
+    PetscFunctionReturn(0);
+  }
+  PetscCall(PetscObjectGetComm((PetscObject)X,&comm));
+  PetscCallMPI(MPI_Comm_size(comm,&size));
+  PetscCall(MatDenseGetLDA(X,&lda));
+  PetscCall(MatDenseGetArray(X,&array));
+  if (size > 1) {
+    PetscCall(MatCreateDense(comm,X->rmap->n,X->cmap->n,X->rmap->N,X->cmap->N,array,Xp));
+  } else {
+    PetscCall(MatCreateSeqDense(comm,X->rmap->n,X->cmap->n,array,Xp));
+  }
+  PetscCall(MatDenseSetLDA(*Xp,lda));
+  PetscCall(MatDenseRestoreArray(X,&array));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMatMultDense_Private"
+/*
+   Y = A*X for dense X and Y. If A knows how to multiply a dense block (PETSc AIJ/dense kernels or a composed
+   MatProductSetFromOptions_<A>_<dense>_C, e.g. MATINV, MATBLOCKDIAG, MATEXTENSION, MATPROD, MATSUM),
+   all columns are processed at once; otherwise falls back to MatMult column by column.
+   MATTIMER is forwarded to the wrapped matrix and MATTRANSPOSEVIRTUAL of an AIJ/dense matrix uses its AtB kernel.
+*/
+PetscErrorCode PermonMatMatMultDense_Private(Mat A, Mat X, Mat Y)
+{
+  PetscErrorCode (*f)(Mat) = NULL;
+  PetscErrorCode (*getmat)(Mat,Mat*) = NULL;
+  char           name[256];
+  Mat            Xp,Yp,At;
+  Vec            x,y;
+  PetscInt       j;
+  PetscBool      native,trans;
+  MatProductType ptype = MATPRODUCT_AB;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectQueryFunction((PetscObject)A,"MatTimerGetMat_C",&getmat));
+  if (getmat) {
+    PetscCall((*getmat)(A,&At));
+    PetscCall(PermonMatMatMultDense_Private(At,X,Y));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(PetscObjectTypeCompare((PetscObject)A,MATTRANSPOSEVIRTUAL,&trans));
+  if (trans) {
+    PetscCall(MatTransposeGetMat(A,&At));
+    PetscCall(PetscObjectTypeCompareAny((PetscObject)At,&native,MATSEQAIJ,MATMPIAIJ,MATSEQDENSE,MATMPIDENSE,""));
+    if (native) {
+      A     = At;
+      ptype = MATPRODUCT_AtB;
+    }
+  }
+
+  PetscCall(MatDenseGetPlainView_Private(X,PETSC_TRUE,&Xp));
+  PetscCall(MatDenseGetPlainView_Private(Y,PETSC_FALSE,&Yp));
+  PetscCall(PetscSNPrintf(name,sizeof(name),"MatProductSetFromOptions_%s_%s_C",((PetscObject)A)->type_name,((PetscObject)Xp)->type_name));
+  PetscCall(PetscObjectQueryFunction((PetscObject)A,name,&f));
+  PetscCall(PetscObjectTypeCompareAny((PetscObject)A,&native,MATSEQAIJ,MATMPIAIJ,MATSEQDENSE,MATMPIDENSE,""));
+  if (f || native) {
+    PetscCall(MatProductCreateWithMat(A,Xp,NULL,Yp));
+    PetscCall(MatProductSetType(Yp,ptype));
+    PetscCall(MatProductSetFromOptions(Yp));
+    PetscCall(MatProductSymbolic(Yp));
+    PetscCall(MatProductNumeric(Yp));
+    PetscCall(MatProductClear(Yp));
+  } else {
+    for (j=0; j<X->cmap->N; j++) {
+      PetscCall(MatDenseGetColumnVecRead(Xp,j,&x));
+      PetscCall(MatDenseGetColumnVecWrite(Yp,j,&y));
+      PetscCall(MatMult(A,x,y));
+      PetscCall(MatDenseRestoreColumnVecWrite(Yp,j,&y));
+      PetscCall(MatDenseRestoreColumnVecRead(Xp,j,&x));
+    }
+  }
+  PetscCall(MatDestroy(&Xp));
+  PetscCall(MatDestroy(&Yp));
+  PetscCall(PetscObjectStateIncrease((PetscObject)Y));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatMatMultByColumns_MatMult_Private"
 static inline PetscErrorCode MatMatMultByColumns_MatMult_Private(Mat A, PetscBool A_transpose, Mat B, Mat C)
@@ -120,10 +217,18 @@ static inline PetscErrorCode MatMatMultByColumns_MatMult_Private(Mat A, PetscBoo
   PetscInt N,N1,j;
   Vec *B_cols,*C_cols;
   PetscErrorCode (*f)(Mat,Vec,Vec);
+  PetscBool dense;
   
   PetscFunctionBeginI;
   f = A_transpose ? MatMultTranspose : MatMult;
   N = B->cmap->N;
+
+  /* A times a dense block is forwarded to A's own block kernel if it has one */
+  PetscCall(PetscObjectBaseTypeCompareAny((PetscObject)B,&dense,MATSEQDENSE,MATMPIDENSE,""));
+  if (!A_transpose && dense) {
+    PetscCall(PermonMatMatMultDense_Private(A,B,C));
+    PetscFunctionReturnI(0);
+  }
   
   PetscCall(MatGetColumnVectors(B,&N1,&B_cols)); PERMON_ASSERT(N1==N,"N1==N (%d != %d)",N1,N);
   PetscCall(MatGetColumnVectors(C,&N1,&C_cols)); PERMON_ASSERT(N1==N,"N1==N (%d != %d)",N1,N);
@@ -4,7 +4,7 @@
 
 PetscLogEvent Mat_OrthColumns;
 
-const char *MatOrthTypes[]={"none","gs","gslingen","cholesky","implicit","inexact","MatOrthType","MAT_ORTH_",0};
+const char *MatOrthTypes[]={"none","gs","gslingen","cholesky","implicit","inexact","cholqr2","tsqr","MatOrthType","MAT_ORTH_",0};
 const char *MatOrthForms[]={"implicit","explicit","MatOrthForm","MAT_ORTH_",0};
 
 #undef __FUNCT__
@@ -369,6 +369,277 @@ static PetscErrorCode MatOrthColumns_GS(Mat A, MatOrthType type, MatOrthForm for
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatOrthColumns_CholQR_Pass_Private"
+/*
+   One CholQR pass on the local rows q (m x N, column-major): W = q'*q with a single reduction, R = chol(W),
+   q = q*inv(R), s = s*inv(R). If shift > 0, R = chol(W + shift*I). *ok is false if the Cholesky
+   factorization broke down or, if strict, R is too ill-conditioned for CholQR to be accurate; q and s are then untouched.
+*/
+static PetscErrorCode MatOrthColumns_CholQR_Pass_Private(MPI_Comm comm, PetscInt m, PetscInt N, PetscScalar q[], PetscInt lda, PetscScalar s[], PetscReal shift, PetscBool strict, PetscScalar W[], PetscScalar T[], PetscScalar work[], PetscBool *ok)
+{
+  PetscBLASInt   bm,bN,blda,info;
+  PetscMPIInt    nW;
+  PetscReal      rmin,rmax;
+  PetscInt       i,j,NN;
+
+  PetscFunctionBegin;
+  PetscCall(PetscBLASIntCast(m,&bm));
+  PetscCall(PetscBLASIntCast(N,&bN));
+  PetscCall(PetscBLASIntCast(PetscMax(lda,1),&blda));
+  /* the whole Gram matrix goes in one reduction, its size must fit the MPI count */
+  PetscCall(PetscIntMultError(N,N,&NN));
+  PetscCall(PetscMPIIntCast(NN,&nW));
+  *ok = PETSC_FALSE;
+
+  /* Gram matrix */
+  if (m) {
+    PetscCallBLAS("BLASgemm",BLASgemm_("C","N",&bN,&bN,&bm,&_DOne,q,&blda,q,&blda,&_DZero,W,&bN));
+  } else {
+    PetscCall(PetscArrayzero(W,NN));
+  }
+  PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,W,nW,MPIU_SCALAR,MPIU_SUM,comm));
+  for (i=0; i<N; i++) W[i+i*N] += shift;
+
+  PetscCallBLAS("LAPACKpotrf",LAPACKpotrf_("U",&bN,W,&bN,&info));
+  if (info) PetscFunctionReturn(0);
+  rmin = rmax = PetscAbsScalar(W[0]);
+  for (i=1; i<N; i++) {
+    rmin = PetscMin(rmin,PetscAbsScalar(W[i+i*N]));
+    rmax = PetscMax(rmax,PetscAbsScalar(W[i+i*N]));
+  }
+  /* CholQR loses orthogonality as cond(A)^2, the diagonal of R underestimates cond(A) */
+  if (strict && rmin < 1e2*PetscSqrtReal(PETSC_MACHINE_EPSILON)*rmax) PetscFunctionReturn(0);
+  if (rmin < 1e2*PETSC_MACHINE_EPSILON*rmax) SETERRQ(comm,PETSC_ERR_NOT_CONVERGED,"MatOrthColumns has not converged, columns are linearly dependent");
+
+  /* T = inv(R) */
+  PetscCall(PetscArrayzero(T,N*N));
+  for (i=0; i<N; i++) T[i+i*N] = 1.0;
+  PetscCallBLAS("LAPACKtrtrs",LAPACKtrtrs_("U","N","N",&bN,&bN,W,&bN,T,&bN,&info));
+  PetscCheck(!info,PETSC_COMM_SELF,PETSC_ERR_LIB,"Error in LAPACK routine trtrs %d",(int)info);
+
+  /* q = q*T, s = s*T */
+  if (m) {
+    PetscCallBLAS("BLASgemm",BLASgemm_("N","N",&bm,&bN,&bN,&_DOne,q,&blda,T,&bN,&_DZero,work,&bm));
+    for (j=0; j<N; j++) PetscCall(PetscArraycpy(q+j*lda,work+j*m,m));
+  }
+  PetscCallBLAS("BLASgemm",BLASgemm_("N","N",&bN,&bN,&bN,&_DOne,s,&bN,T,&bN,&_DZero,W,&bN));
+  PetscCall(PetscArraycpy(s,W,N*N));
+  *ok = PETSC_TRUE;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatOrthColumns_CholQR2_Private"
+/* CholQR2, with shifted CholQR3 as the fallback for ill-conditioned A; one reduction per pass */
+static PetscErrorCode MatOrthColumns_CholQR2_Private(MPI_Comm comm, PetscInt M, PetscInt m, PetscInt N, PetscScalar q[], PetscInt lda, PetscScalar s[])
+{
+  PetscScalar    *W,*T,*work;
+  PetscReal      shift=0.0;
+  PetscInt       i,passes=2;
+  PetscBool      ok;
+
+  PetscFunctionBegin;
+  PetscCall(PetscMalloc3(N*N,&W,N*N,&T,PetscMax(m*N,1),&work));
+  PetscCall(MatOrthColumns_CholQR_Pass_Private(comm,m,N,q,lda,s,0.0,PETSC_TRUE,W,T,work,&ok));
+  if (!ok) {
+    /* shift by 11*(M*N+N*(N+1))*eps*||A||^2, ||A||^2 <= ||A||_F^2 */
+    if (m) {
+      PetscBLASInt bm,one=1;
+
+      PetscCall(PetscBLASIntCast(m,&bm));
+      for (i=0; i<N; i++) shift += PetscRealPart(BLASdot_(&bm,q+i*lda,&one,q+i*lda,&one));
+    }
+    PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,&shift,1,MPIU_REAL,MPIU_SUM,comm));
+    shift *= 11.0*((PetscReal)M*N + (PetscReal)N*(N+1))*PETSC_MACHINE_EPSILON;
+    PetscCall(MatOrthColumns_CholQR_Pass_Private(comm,m,N,q,lda,s,shift,PETSC_FALSE,W,T,work,&ok));
+    if (!ok) SETERRQ(comm,PETSC_ERR_NOT_CONVERGED,"MatOrthColumns has not converged, shifted Cholesky QR broke down");
+    PetscCall(PetscInfo(fllop,"CholQR2 falls back to shifted CholQR3, shift %g\n",(double)shift));
+  } else {
+    passes = 1;
+  }
+  for (i=0; i<passes; i++) {
+    PetscCall(MatOrthColumns_CholQR_Pass_Private(comm,m,N,q,lda,s,0.0,PETSC_FALSE,W,T,work,&ok));
+    if (!ok) SETERRQ(comm,PETSC_ERR_NOT_CONVERGED,"MatOrthColumns has not converged, Cholesky QR broke down in the reorthogonalization pass");
+  }
+  PetscCall(PetscFree3(W,T,work));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatOrthColumns_TSQR_Private"
+/*
+   TSQR: local Householder QR of the rows q (m x N), then a binary reduction tree over the N x N R factors
+   (one message per tree level) and the same tree backwards to form the explicit Q. On exit s = inv(R) on all ranks.
+*/
+static PetscErrorCode MatOrthColumns_TSQR_Private(MPI_Comm comm, PetscMPIInt tag, PetscInt m, PetscInt N, PetscScalar q[], PetscInt lda, PetscScalar s[])
+{
+  PetscMPIInt    rank,size,step,parent=-1,*child,nR;
+  PetscBLASInt   bm,bN,b2N,bk,blda,bldq,lwork,info;
+  PetscScalar    *V,*tau,*R,*C,*Cn,*work,**Vl,**taul;
+  PetscReal      rmin,rmax;
+  PetscInt       i,j,k,l,nl=0,maxl=0,NN;
+
+  PetscFunctionBegin;
+  PetscCallMPI(MPI_Comm_rank(comm,&rank));
+  PetscCallMPI(MPI_Comm_size(comm,&size));
+  for (step=1; step<size; step*=2) maxl++;
+  k = PetscMin(m,N);
+  PetscCall(PetscBLASIntCast(m,&bm));
+  PetscCall(PetscBLASIntCast(N,&bN));
+  PetscCall(PetscBLASIntCast(2*N,&b2N));
+  PetscCall(PetscBLASIntCast(k,&bk));
+  PetscCall(PetscBLASIntCast(PetscMax(m,1),&blda));
+  PetscCall(PetscBLASIntCast(PetscMax(lda,1),&bldq));
+  PetscCall(PetscBLASIntCast(64*PetscMax(N,1),&lwork));
+  /* the N x N blocks go in single messages, their size must fit the MPI count */
+  PetscCall(PetscIntMultError(N,N,&NN));
+  PetscCall(PetscMPIIntCast(NN,&nR));
+  PetscCall(PetscMalloc6(PetscMax(m*N,1),&V,N,&tau,N*N,&R,N*N,&C,2*N*N,&Cn,lwork,&work));
+  PetscCall(PetscCalloc3(maxl,&Vl,maxl,&taul,maxl,&child));
+
+  /* local QR, V holds the reflectors, R the padded N x N triangular factor */
+  PetscCall(PetscArrayzero(R,N*N));
+  if (m) {
+    for (j=0; j<N; j++) PetscCall(PetscArraycpy(V+j*m,q+j*lda,m));
+    PetscCallBLAS("LAPACKgeqrf",LAPACKgeqrf_(&bm,&bN,V,&blda,tau,work,&lwork,&info));
+    PetscCheck(!info,PETSC_COMM_SELF,PETSC_ERR_LIB,"Error in LAPACK routine geqrf %d",(int)info);
+    for (j=0; j<N; j++) for (i=0; i<=PetscMin(j,k-1); i++) R[i+j*N] = V[i+j*m];
+  }
+
+  /* up the tree: stack [R; R_child], factorize, keep the reflectors of each level */
+  for (step=1, l=0; step<size; step*=2, l++) {
+    if (rank % (2*step)) {
+      parent = rank - step;
+      PetscCallMPI(MPI_Send(R,nR,MPIU_SCALAR,parent,tag,comm));
+      break;
+    }
+    if (rank + step >= size) continue;
+    child[nl] = rank + step;
+    PetscCall(PetscMalloc2(2*N*N,&Vl[nl],N,&taul[nl]));
+    PetscCallMPI(MPI_Recv(Cn,nR,MPIU_SCALAR,child[nl],tag,comm,MPI_STATUS_IGNORE));
+    for (j=0; j<N; j++) {
+      PetscCall(PetscArraycpy(Vl[nl]+j*2*N,R+j*N,N));
+      PetscCall(PetscArraycpy(Vl[nl]+j*2*N+N,Cn+j*N,N));
+    }
+    PetscCallBLAS("LAPACKgeqrf",LAPACKgeqrf_(&b2N,&bN,Vl[nl],&b2N,taul[nl],work,&lwork,&info));
+    PetscCheck(!info,PETSC_COMM_SELF,PETSC_ERR_LIB,"Error in LAPACK routine geqrf %d",(int)info);
+    PetscCall(PetscArrayzero(R,N*N));
+    for (j=0; j<N; j++) for (i=0; i<=j; i++) R[i+j*N] = Vl[nl][i+j*2*N];
+    nl++;
+  }
+  PetscCallMPI(MPI_Bcast(R,nR,MPIU_SCALAR,0,comm));
+
+  /* down the tree: C is the N x N block of the tree Q belonging to this rank */
+  if (parent < 0) {
+    PetscCall(PetscArrayzero(C,N*N));
+    for (i=0; i<N; i++) C[i+i*N] = 1.0;
+  } else {
+    PetscCallMPI(MPI_Recv(C,nR,MPIU_SCALAR,parent,tag,comm,MPI_STATUS_IGNORE));
+  }
+  for (l=nl-1; l>=0; l--) {
+    PetscCallBLAS("LAPACKorgqr",LAPACKorgqr_(&b2N,&bN,&bN,Vl[l],&b2N,taul[l],work,&lwork,&info));
+    PetscCheck(!info,PETSC_COMM_SELF,PETSC_ERR_LIB,"Error in LAPACK routine orgqr %d",(int)info);
+    PetscCallBLAS("BLASgemm",BLASgemm_("N","N",&b2N,&bN,&bN,&_DOne,Vl[l],&b2N,C,&bN,&_DZero,Cn,&b2N));
+    for (j=0; j<N; j++) {
+      PetscCall(PetscArraycpy(C+j*N,Cn+j*2*N,N));
+      PetscCall(PetscArraycpy(Vl[l]+j*N,Cn+j*2*N+N,N));
+    }
+    PetscCallMPI(MPI_Send(Vl[l],nR,MPIU_SCALAR,child[l],tag,comm));
+    PetscCall(PetscFree2(Vl[l],taul[l]));
+  }
+
+  /* q = Q_loc*C */
+  if (m) {
+    PetscCallBLAS("LAPACKorgqr",LAPACKorgqr_(&bm,&bk,&bk,V,&blda,tau,work,&lwork,&info));
+    PetscCheck(!info,PETSC_COMM_SELF,PETSC_ERR_LIB,"Error in LAPACK routine orgqr %d",(int)info);
+    PetscCallBLAS("BLASgemm",BLASgemm_("N","N",&bm,&bN,&bk,&_DOne,V,&blda,C,&bN,&_DZero,q,&bldq));
+  }
+
+  /* s = inv(R) */
+  rmin = rmax = PetscAbsScalar(R[0]);
+  for (i=1; i<N; i++) {
+    rmin = PetscMin(rmin,PetscAbsScalar(R[i+i*N]));
+    rmax = PetscMax(rmax,PetscAbsScalar(R[i+i*N]));
+  }
+  if (rmin < 1e2*PETSC_MACHINE_EPSILON*rmax) SETERRQ(comm,PETSC_ERR_NOT_CONVERGED,"MatOrthColumns has not converged, columns are linearly dependent");
+  PetscCall(PetscArrayzero(s,N*N));
+  for (i=0; i<N; i++) s[i+i*N] = 1.0;
+  PetscCallBLAS("LAPACKtrtrs",LAPACKtrtrs_("U","N","N",&bN,&bN,R,&bN,s,&bN,&info));
+  PetscCheck(!info,PETSC_COMM_SELF,PETSC_ERR_LIB,"Error in LAPACK routine trtrs %d",(int)info);
+
+  PetscCall(PetscFree3(Vl,taul,child));
+  PetscCall(PetscFree6(V,tau,R,C,Cn,work));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatOrthColumns_Block"
+/* communication-avoiding variants working on the local dense rows of A at once, S is formed redundantly */
+static PetscErrorCode MatOrthColumns_Block(Mat A, MatOrthType type, MatOrthForm form, Mat *Q_new, Mat *S_new)
+{
+  MPI_Comm       comm;
+  Mat            Q=NULL, S=NULL, Q1;
+  PetscInt       M, N, m, n, i, j, lda, Slo, Shi;
+  PetscScalar    *q, *s, *sarr;
+  PetscMPIInt    tag;
+  PetscBool      computeS = (PetscBool)(form==MAT_ORTH_FORM_IMPLICIT || S_new);
+
+  PetscFunctionBeginI;
+  PetscCall(PetscObjectGetComm((PetscObject)A,&comm));
+  PetscCall(MatGetSize(A, &M, &N));
+  PetscCall(MatGetLocalSize(A, &m, &n));
+
+  PetscCall(PermonMatConvertBlocks(A, MATDENSE, MAT_INITIAL_MATRIX, &Q1));
+  PetscCall(PermonMatConvertBlocks(Q1, MATDENSEPERMON, MAT_INITIAL_MATRIX, &Q));
+  PetscCall(MatDestroy(&Q1));
+
+  PetscCall(PetscMalloc1(N*N, &s));
+  PetscCall(PetscArrayzero(s, N*N));
+  for (i = 0; i < N; i++) s[i+i*N] = 1.0;
+  PetscCall(MatDenseGetLDA(Q, &lda));
+  PetscCall(MatDenseGetArray(Q, &q));
+  if (N) {
+    switch (type) {
+      case MAT_ORTH_CHOLQR2:
+        PetscCall(MatOrthColumns_CholQR2_Private(comm, M, m, N, q, lda, s)); break;
+      case MAT_ORTH_TSQR:
+        PetscCall(PetscObjectGetNewTag((PetscObject)A, &tag));
+        PetscCall(MatOrthColumns_TSQR_Private(comm, tag, m, N, q, lda, s)); break;
+      default:
+        PERMON_ASSERT(0,"this should never happen");
+    }
+  }
+  PetscCall(MatDenseRestoreArray(Q, &q));
+
+  if (computeS) {
+    PetscCall(MatCreateDensePermon(comm, n, n, N, N, NULL, &S));
+    PetscCall(MatGetOwnershipRange(S, &Slo, &Shi));
+    PetscCall(MatDenseGetLDA(S, &lda));
+    PetscCall(MatDenseGetArrayWrite(S, &sarr));
+    for (j = 0; j < N; j++) for (i = Slo; i < Shi; i++) sarr[i-Slo+j*lda] = s[i+j*N];
+    PetscCall(MatDenseRestoreArrayWrite(S, &sarr));
+  }
+  PetscCall(PetscFree(s));
+
+  if (Q_new) {
+    if (form == MAT_ORTH_FORM_IMPLICIT) {
+      Mat mats[2] = {S, A};
+      PetscCall(MatDestroy(&Q));
+      PetscCall(MatCreateProd(comm,2,mats,&Q));
+    }
+    *Q_new = Q;
+  } else {
+    PetscCall(MatDestroy(&Q));
+  }
+  if (S_new) {
+    *S_new = S;
+  } else {
+    PetscCall(MatDestroy(&S));
+  }
+  PetscFunctionReturnI(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatOrthColumns"
 /*@
@@ -379,7 +650,8 @@ static PetscErrorCode MatOrthColumns_GS(Mat A, MatOrthType type, MatOrthForm for
    Input Parameter:
 +  A - the matrix whose columns will be orthonormalized
 .  type - the algorithm used for orthonormalization
-     (one of MAT_ORTH_NONE, MAT_ORTH_GS, MAT_ORTH_CHOLESKY, MAT_ORTH_CHOLESKY_EXPLICIT)
+     (one of MAT_ORTH_NONE, MAT_ORTH_GS, MAT_ORTH_GS_LINGEN, MAT_ORTH_CHOLESKY, MAT_ORTH_CHOLQR2, MAT_ORTH_TSQR,
+      MAT_ORTH_IMPLICIT, MAT_ORTH_INEXACT)
 -  form - specify whether Q is computed explicitly or as an implicit product of A and S
      (one of MAT_ORTH_FORM_IMPLICIT, MAT_ORTH_FORM_EXPLICIT)
  
@@ -390,6 +662,11 @@ static PetscErrorCode MatOrthColumns_GS(Mat A, MatOrthType type, MatOrthForm for
    Notes:
    This routine computes Q and S so that A = Q*inv(S), Q = A*S.
 
+   MAT_ORTH_GS and MAT_ORTH_GS_LINGEN orthogonalize one column at a time, i.e. need O(N) global reductions.
+   MAT_ORTH_CHOLQR2 (Cholesky QR applied twice, shifted Cholesky QR3 if A is ill-conditioned) needs one reduction
+   per pass, MAT_ORTH_TSQR (tall-skinny Householder QR) one reduction tree. Both work on the local dense rows
+   and are suitable for tall matrices with moderate N only, as N x N matrices are formed on each process.
+
    Level: intermediate
 
 .seealso: MatOrthRows(), MatOrthType
@@ -430,6 +707,9 @@ PetscErrorCode MatOrthColumns(Mat A, MatOrthType type, MatOrthForm form, Mat *Q_
       case MAT_ORTH_IMPLICIT:
       case MAT_ORTH_INEXACT:
         f = MatOrthColumns_Implicit_Default; break;
+      case MAT_ORTH_CHOLQR2:
+      case MAT_ORTH_TSQR:
+        f = MatOrthColumns_Block; break;
       case MAT_ORTH_NONE:
         PERMON_ASSERT(0,"this should never happen");
     }
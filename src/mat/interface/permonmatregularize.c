@@ -5,28 +5,24 @@ PetscLogEvent Mat_Regularize;
 
 #undef __FUNCT__  
 #define __FUNCT__ "MatRegularize_GetPivots_Private"
+/* full pivoting Gaussian elimination of R from the last column, performed in place on the column-major dense array */
 static PetscErrorCode MatRegularize_GetPivots_Private(Mat R, IS *pivots) {
 
-  PetscInt p, npivots, maxdp;
+  PetscInt p, npivots, lda;
   PetscInt *idx_arr;
-  PetscScalar *v1, *v2, *v1p, *v2p;
+  PetscScalar *a, *cj, *cJ, *cjp;
   PetscScalar vpivot, alpha, t;
-  PetscInt i, j, II, J, ipivot, jpivot;
-  PetscInt *all, *perm;
+  PetscInt i, j, II, J, ipivot=0, jpivot=0, tp;
+  PetscInt *perm;
+  PetscBool deficient = PETSC_FALSE;
   Mat R_work;
 
   PetscFunctionBeginI;
-  PetscCall(MatConvert(R,MATDENSEPERMON,MAT_INITIAL_MATRIX,&R_work));
+  PetscCall(MatConvert(R,MATSEQDENSE,MAT_INITIAL_MATRIX,&R_work));
   PetscCall(MatGetSize(R_work, &p, &npivots));
-  maxdp = PetscMax(npivots, p);
-  PetscCall(PetscMalloc(maxdp * sizeof (PetscInt),    &all));
-  PetscCall(PetscMalloc(p     * sizeof (PetscInt),    &perm));
-  PetscCall(PetscMalloc(p     * sizeof (PetscScalar), &v1));
-  PetscCall(PetscMalloc(p     * sizeof (PetscScalar), &v2));
-
-  /* all = 0 : max(d,p)-1 */
-  for (i = 0; i < maxdp; i++)
-    all[i] = i;
+  PetscCall(MatDenseGetLDA(R_work, &lda));
+  PetscCall(MatDenseGetArray(R_work, &a));
+  PetscCall(PetscMalloc(p * sizeof (PetscInt), &perm));
 
   /* perm = 0 : p-1 */
   for (i = 0; i < p; i++)
@@ -35,70 +31,62 @@ static PetscErrorCode MatRegularize_GetPivots_Private(Mat R, IS *pivots) {
   /* main iteration through all columns from the last to the first */
   for (J = npivots - 1, II = p - 1; J >= 0; J--, II--) {
 
-    /* find i,j,v of a pivot */
+    /* [vpivot,ipivot,jpivot] = max(abs(R(0:II, 0:J))) */
     vpivot = 0.0;
     for (j = 0; j <= J; j++) {
-      PetscCall(MatGetValues(R_work, p, all, 1, &j, v1));
-
-      /* [vpivot,ipivot] = max(abs(R(0:p-1, j))) */
+      cj = a + j*lda;
       for (i = 0; i <= II; i++) {
-        if (PetscAbsScalar(v1[i]) > PetscAbsScalar(vpivot)) {
+        if (PetscAbsScalar(cj[i]) > PetscAbsScalar(vpivot)) {
           ipivot = i;
           jpivot = j;
-          vpivot = v1[i];
+          vpivot = cj[i];
         }
       }
     }
+    if (vpivot == 0.0) {
+      deficient = PETSC_TRUE;
+      break;
+    }
 
-    /* swap rows ipivot and II:
-     * v1 = R(ipivot,:);  R(ipivot,:) = R(II,:);  R(II,:) = v1;
-     * t  = perm(ipivot); perm(ipivot)= perm(II); perm(II) = t;
-     */
-    PetscCall(MatGetValues(R_work, 1, &ipivot, J + 1, all, v1));
-    PetscCall(MatGetValues(R_work, 1, &II,      J + 1, all, v2));
-    PetscCall(MatSetValues(R_work, 1, &ipivot, J + 1, all, v2, INSERT_VALUES));
-    PetscCall(MatSetValues(R_work, 1, &II,      J + 1, all, v1, INSERT_VALUES));
-    PetscCall(MatAssemblyBegin(R_work, MAT_FINAL_ASSEMBLY));
-    PetscCall(MatAssemblyEnd(  R_work, MAT_FINAL_ASSEMBLY));
-    t = perm[ipivot];
-    perm[ipivot] = perm[II];
-    perm[II] = t;
-
-    /* swap columns jpivot and J:
-     * v1 = R(:,jpivot);  R(:,jpivot) = R(:,J); R(:,J) = v1;
-     */
-    PetscCall(MatGetValues(R_work, II + 1, all, 1, &jpivot, v1));
-    PetscCall(MatGetValues(R_work, II + 1, all, 1, &J,      v2));
-    PetscCall(MatSetValues(R_work, II + 1, all, 1, &J,      v1, INSERT_VALUES));
-    PetscCall(MatSetValues(R_work, II + 1, all, 1, &jpivot, v2, INSERT_VALUES));
-    PetscCall(MatAssemblyBegin(R_work, MAT_FINAL_ASSEMBLY));
-    PetscCall(MatAssemblyEnd(  R_work, MAT_FINAL_ASSEMBLY));
-
-    /* columnwise elimination of the row II */
-    for (j = 0; j <= J - 1; j++) {
-      /* v2 = R(:,j) */
-      PetscCall(MatGetValues(R_work, II + 1, all, 1, &j, v2));
+    /* swap rows ipivot and II in columns 0:J, and in perm */
+    if (ipivot != II) {
+      for (j = 0; j <= J; j++) {
+        cj = a + j*lda;
+        t = cj[ipivot]; cj[ipivot] = cj[II]; cj[II] = t;
+      }
+      tp = perm[ipivot]; perm[ipivot] = perm[II]; perm[II] = tp;
+    }
+
+    /* swap columns jpivot and J in rows 0:II */
+    cJ = a + J*lda;
+    if (jpivot != J) {
+      cj = a + jpivot*lda;
+      for (i = 0; i <= II; i++) {
+        t = cj[i]; cj[i] = cJ[i]; cJ[i] = t;
+      }
+    }
 
-      if (PetscAbsScalar(v2[II]) < PETSC_MACHINE_EPSILON)
+    /* columnwise elimination of the row II: R(0:II,j) = -(vpivot/R(II,j)) * R(0:II,j) + R(0:II,J) */
+    for (j = 0; j <= J - 1; j++) {
+      cj = a + j*lda;
+      if (PetscAbsScalar(cj[II]) < PETSC_MACHINE_EPSILON)
         continue;
 
-      /* v2 = -(vpivot/v2(II)) * v2 */
-      alpha = -vpivot / v2[II];
-      v1p = v1;
-      v2p = v2;
+      alpha = -vpivot / cj[II];
+      cjp = cj;
       for (i = 0; i <= II; i++) {
-        *v2p *= alpha;
-        *v2p += *v1p;
-        v1p++;
-        v2p++;
+        *cjp *= alpha;
+        *cjp += cJ[i];
+        cjp++;
       }
-
-      /* R(:,j) = v2 */
-      PetscCall(MatSetValues(R_work, II + 1, all, 1, &j, v2, INSERT_VALUES));
-      PetscCall(MatAssemblyBegin(R_work, MAT_FINAL_ASSEMBLY));
-      PetscCall(MatAssemblyEnd(  R_work, MAT_FINAL_ASSEMBLY));
     }
   }
+  PetscCall(MatDenseRestoreArray(R_work, &a));
+  if (deficient) {
+    PetscCall(MatDestroy(&R_work));
+    PetscCall(PetscFree(perm));
+    SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_WRONG,"R does not have full column rank");
+  }
 
   /* idx_arr points to last d entries of perm */
   idx_arr = &(perm[p - npivots]);
@@ -107,10 +95,7 @@ static PetscErrorCode MatRegularize_GetPivots_Private(Mat R, IS *pivots) {
   PetscCall(ISSort(*pivots));
 
   PetscCall(MatDestroy(&R_work));
-  PetscCall(PetscFree(all));
   PetscCall(PetscFree(perm));
-  PetscCall(PetscFree(v1));
-  PetscCall(PetscFree(v2));
   PetscFunctionReturnI(0);
 }
 
@@ -198,13 +183,51 @@ static PetscErrorCode MatRegularize_GetRegularization_Private(Mat K_loc, Mat R_l
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatRegularize_GetQ_Private"
+/* Q_loc depends only on R_loc, so it is composed with R_loc and reused until R_loc changes */
+static PetscErrorCode MatRegularize_GetQ_Private(Mat K_loc, Mat R_loc, PetscInt valid_id, Mat *Q_loc)
+{
+  IS              pivots;
+  Mat             Q = NULL;
+  MatType         K_type;
+  PetscBool       valid = PETSC_FALSE, flg = PETSC_FALSE;
+  PETSC_UNUSED PetscInt valid_int;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectComposedDataGetInt((PetscObject)R_loc,valid_id,valid_int,valid));
+  if (valid) PetscCall(PetscObjectQuery((PetscObject)R_loc,"MatRegularize_Q_loc",(PetscObject*)&Q));
+  if (Q) {
+    PetscCall(MatGetType(K_loc,&K_type));
+    PetscCall(PetscObjectTypeCompare((PetscObject)Q,K_type,&flg));
+  }
+  if (flg) {
+    PetscCall(PetscInfo(R_loc,"reusing pivots and regularization matrix\n"));
+    PetscCall(PetscObjectReference((PetscObject)Q));
+    *Q_loc = Q;
+    PetscFunctionReturn(0);
+  }
+
+  PetscCall(MatRegularize_GetPivots_Private(R_loc, &pivots));
+  PetscCall(MatRegularize_GetRegularization_Private(K_loc, R_loc, pivots, &Q));
+  PetscCall(ISDestroy(&pivots));
+  PetscCall(PetscObjectCompose((PetscObject)R_loc,"MatRegularize_Q_loc",(PetscObject)Q));
+  PetscCall(PetscObjectComposedDataSetInt((PetscObject)R_loc,valid_id,PETSC_TRUE));
+  *Q_loc = Q;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__  
 #define __FUNCT__ "MatRegularize"
-PetscErrorCode MatRegularize(Mat K, Mat R, MatRegularizationType type, Mat *newKreg) {
+/*
+   With MAT_REUSE_MATRIX, *newKreg must come from a previous MatRegularize call with the same R and a K
+   with the same nonzero pattern; only its values are updated, so its nonzero state stays unchanged
+   and a factorization of it can be redone numerically only.
+*/
+PetscErrorCode MatRegularize(Mat K, Mat R, MatRegularizationType type, MatReuse scall, Mat *newKreg) {
   static PetscBool      registered = PETSC_FALSE;
-  static PetscInt       regularized_id;
+  static PetscInt       regularized_id, q_valid_id;
   MPI_Comm              comm;
-  IS                    pivots;
   Mat                   Q_loc, Kreg;
   PetscScalar           rho;
   Mat                   K_loc, R_loc;
@@ -214,10 +237,15 @@ PetscErrorCode MatRegularize(Mat K, Mat R, MatRegularizationType type, Mat *newK
   FllopTracedFunctionBegin;
   PetscValidHeaderSpecific(K,MAT_CLASSID,1);
   PetscValidLogicalCollectiveEnum(K,type,3);
-  PetscValidPointer(newKreg,4);
+  PetscValidLogicalCollectiveEnum(K,scall,4);
+  PetscValidPointer(newKreg,5);
 
   if (type == MAT_REG_NONE) {
     PetscCall(PetscInfo(K,"MatRegularizationType set to MAT_REG_NONE, returning input matrix\n"));
+    if (scall == MAT_REUSE_MATRIX) {
+      if (*newKreg != K) SETERRQ(PetscObjectComm((PetscObject)K),PETSC_ERR_ARG_WRONG,"MAT_REUSE_MATRIX with MAT_REG_NONE requires *newKreg == K");
+      PetscFunctionReturn(0);
+    }
     *newKreg = K;
     PetscCall(PetscObjectReference((PetscObject)K));
     PetscFunctionReturn(0);
@@ -227,10 +255,11 @@ PetscErrorCode MatRegularize(Mat K, Mat R, MatRegularizationType type, Mat *newK
     PetscCall(PetscLogEventRegister(__FUNCT__, MAT_CLASSID, &Mat_Regularize));
     registered = PETSC_TRUE;
     PetscCall(PetscObjectComposedDataRegister(&regularized_id));
+    PetscCall(PetscObjectComposedDataRegister(&q_valid_id));
   }
 
   PetscCall(PetscObjectComposedDataGetInt((PetscObject)K,regularized_id,regularized_int,regularized));
-  if (regularized) {
+  if (regularized && scall == MAT_INITIAL_MATRIX) {
     PetscCall(PetscInfo(K,"matrix marked as regularized, returning input matrix\n"));
     *newKreg = K;
     PetscCall(PetscObjectReference((PetscObject)K));
@@ -250,38 +279,67 @@ PetscErrorCode MatRegularize(Mat K, Mat R, MatRegularizationType type, Mat *newK
   PetscCall(MatGetDiagonalBlock(K,&K_loc));
   PetscCall(MatGetDiagonalBlock(R,&R_loc));
 
-  PetscCall(MatRegularize_GetPivots_Private(R_loc, &pivots));
-  PetscCall(MatRegularize_GetRegularization_Private(K_loc, R_loc, pivots, &Q_loc));
+  PetscCall(MatRegularize_GetQ_Private(K_loc, R_loc, q_valid_id, &Q_loc));
 
   /* Kreg_loc = K_loc + rho*Q_loc */
   //TODO parametrize
   PetscCall(MatGetMaxEigenvalue(K_loc, NULL, &rho, 1, 20));
-  PetscCall(MatScale(Q_loc, rho));
   if (type == MAT_REG_EXPLICIT)
   {
     Mat Kreg_loc;
     
-    PetscCall(MatDuplicate(K, MAT_COPY_VALUES, &Kreg));
-    PetscCall(MatGetDiagonalBlock(Kreg,&Kreg_loc));
+    if (scall == MAT_REUSE_MATRIX) {
+      /* pattern of Kreg already contains pattern of both K and Q */
+      PetscBool blockdiag;
+
+      Kreg = *newKreg;
+      PetscCall(MatGetDiagonalBlock(Kreg,&Kreg_loc));
+      PetscCall(PetscObjectTypeCompare((PetscObject)K,MATBLOCKDIAG,&blockdiag));
+      if (blockdiag) {
+        PetscCall(MatCopy(K_loc, Kreg_loc, SUBSET_NONZERO_PATTERN));
+      } else {
+        PetscCall(MatCopy(K, Kreg, SUBSET_NONZERO_PATTERN));
+      }
+      PetscCall(MatAXPY(Kreg_loc, rho, Q_loc, SUBSET_NONZERO_PATTERN));
+      PetscCall(PetscObjectStateIncrease((PetscObject)Kreg));
+    } else {
+      PetscCall(MatDuplicate(K, MAT_COPY_VALUES, &Kreg));
+      PetscCall(MatGetDiagonalBlock(Kreg,&Kreg_loc));
     
-    //TODO avoid adding new nonzeros - do preallocation of Kreg
-    PetscCall(MatSetOption(Kreg_loc, MAT_NEW_NONZERO_LOCATION_ERR, PETSC_FALSE));
-    PetscCall(MatAXPY(Kreg_loc, rho, Q_loc, DIFFERENT_NONZERO_PATTERN));
+      //TODO avoid adding new nonzeros - do preallocation of Kreg
+      PetscCall(MatSetOption(Kreg_loc, MAT_NEW_NONZERO_LOCATION_ERR, PETSC_FALSE));
+      PetscCall(MatAXPY(Kreg_loc, rho, Q_loc, DIFFERENT_NONZERO_PATTERN));
+    }
     PetscCall(MatAssemblyBegin(Kreg_loc, MAT_FINAL_ASSEMBLY));
     PetscCall(MatAssemblyEnd(  Kreg_loc, MAT_FINAL_ASSEMBLY));
+    /* Kreg_loc was changed directly, for MATBLOCKDIAG Kreg propagate it */
+    PetscCall(MatBlockDiagUpdateState_Private(Kreg));
   }
   else  /* type == MAT_REG_IMPLICIT */
   {
-    Mat Q, Kreg_arr[2];
+    Mat Q, Qs_loc, Kreg_arr[2];
     
-    PetscCall(MatCreateBlockDiag(comm,Q_loc,&Q));
-    Kreg_arr[0]=Q; Kreg_arr[1]=K;
-    PetscCall(MatCreateSum(comm,2,Kreg_arr,&Kreg));
-    PetscCall(MatDestroy(&Q));
+    if (scall == MAT_REUSE_MATRIX) {
+      /* Kreg = Q + K references K, only rho*Q is refilled as rho depends on K */
+      Kreg = *newKreg;
+      PetscCall(MatSumGetMat(Kreg,0,&Q));
+      PetscCall(MatGetDiagonalBlock(Q,&Qs_loc));
+      PetscCall(MatCopy(Q_loc, Qs_loc, SAME_NONZERO_PATTERN));
+      PetscCall(MatScale(Qs_loc, rho));
+      PetscCall(MatBlockDiagUpdateState_Private(Q));
+      PetscCall(PetscObjectStateIncrease((PetscObject)Kreg));
+    } else {
+      PetscCall(MatDuplicate(Q_loc, MAT_COPY_VALUES, &Qs_loc));
+      PetscCall(MatScale(Qs_loc, rho));
+      PetscCall(MatCreateBlockDiag(comm,Qs_loc,&Q));
+      Kreg_arr[0]=Q; Kreg_arr[1]=K;
+      PetscCall(MatCreateSum(comm,2,Kreg_arr,&Kreg));
+      PetscCall(MatDestroy(&Q));
+      PetscCall(MatDestroy(&Qs_loc));
+    }
   }
   PetscCall(MatInheritSymmetry(K,Kreg));
   PetscCall(MatDestroy(&Q_loc));
-  PetscCall(ISDestroy(&pivots));
   
   /* mark the matrix as regularized */
   PetscCall(PetscObjectComposedDataSetInt((PetscObject)Kreg,regularized_id,PETSC_TRUE));
@@ -1,5 +1,8 @@
 
 #include <permon/private/permonmatimpl.h>
+#include <permon/private/petscimpl.h>
+#include <../src/mat/impls/composite/permoncompositeimpl.h>
+#include <petscblaslapack.h>
 
 PetscLogEvent Mat_GetMaxEigenvalue,Mat_FilterZeros,Mat_MergeAndDestroy,PermonMat_GetLocalMat;
 PetscInt MatGetMaxEigenvalue_composed_id;
@@ -424,11 +427,210 @@ PetscErrorCode MatMatIsZero(Mat A, Mat B, PetscReal tol, PetscInt ntrials, Petsc
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "MatGetMaxEigenvalue_Power_Private"
+static PetscErrorCode MatGetMaxEigenvalue_Power_Private(Mat A, Vec v, PetscScalar *lambda_out, PetscReal tol, PetscInt maxits, PetscBool *converged)
+{
+  Vec Av;
+  PetscInt  i;
+  PetscScalar  lambda, lambda0;
+  PetscReal  err, relerr;
+  Vec y_v[2];
+  PetscReal vAv_vv[2];
+  PetscRandom rand=NULL;
+
+  PetscFunctionBegin;
+  lambda = lambda0 = err = relerr = 0.0;
+  PetscCall(VecDuplicate(v,&Av));
+  y_v[0] = Av; y_v[1] = v;
+
+  for(i=1; i <= maxits; i++) {
+    lambda0 = lambda;
+    PetscCall(MatMult(A, v, Av));         /* y = A*v */
+    /* lambda = (v,A*v)/(v,v) */
+    PetscCall(VecMDot(v,2,y_v,vAv_vv));
+    lambda = vAv_vv[0]/vAv_vv[1];
+    if (lambda < PETSC_MACHINE_EPSILON) {
+      PetscCall(PetscInfo(fllop,"hit nullspace of A and setting A*v to random vector in iteration %d\n",i));
+
+      if (!rand) {
+        PetscCall(PetscRandomCreate(PetscObjectComm((PetscObject)A),&rand));
+        PetscCall(PetscRandomSetType(rand,PETSCRAND48));
+      }
+      PetscCall(VecSetRandom(Av,rand));
+      PetscCall(VecDot(v, Av, &vAv_vv[0]));
+    }
+
+    err = PetscAbsScalar(lambda-lambda0);
+    relerr = err / PetscAbsScalar(lambda);
+    if (relerr < tol) break;
+
+    /* v = A*v/||A*v||  replaced by v = A*v/||v|| */
+    PetscCall(VecCopy(Av, v));
+    PetscCall(VecScale(v, 1.0/PetscSqrtReal(vAv_vv[1])));
+  }
+
+  PetscCall(PetscInfo(fllop,"%s  lambda = %.12e  [err relerr reltol] = [%.12e %.12e %.12e]  actual/max iterations = %d/%d\n", (i<=maxits)?"CONVERGED":"NOT CONVERGED", lambda,err,relerr,tol,i,maxits));
+  *lambda_out = lambda;
+  *converged = (PetscBool)(i<=maxits);
+
+  PetscCall(VecDestroy(&Av));
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatGetMaxEigenvalue_Lanczos_Private"
+/* Lanczos process without reorthogonalization, sufficient for the extremal eigenvalue; A is assumed symmetric.
+   At most maxbasis Lanczos vectors are kept; when they are exhausted, the process is restarted from the current Ritz vector.
+   On input, v is the starting vector, on output the Ritz vector of the largest Ritz value with unit norm. */
+static PetscErrorCode MatGetMaxEigenvalue_Lanczos_Private(Mat A, Vec v, PetscScalar *lambda_out, PetscReal tol, PetscInt maxits, PetscInt maxbasis, PetscBool safety, PetscBool *converged_out)
+{
+  Vec          *V,w;
+  PetscReal    *alpha,*beta,*d,*e,*Z,*work;
+  PetscScalar  *z,dot;
+  PetscReal    theta=0.0,theta0=0.0,relerr=1.0,resid=0.0,nrm;
+  PetscInt     i,j,k,n=0,nb,its=0;
+  PetscBLASInt bn,info;
+  PetscBool    converged=PETSC_FALSE,restarted=PETSC_FALSE;
+  PetscRandom  rand=NULL;
+
+  PetscFunctionBegin;
+  nb = PetscMax(PetscMin(maxits,maxbasis),1);
+  PetscCall(PetscCalloc1(nb,&V));
+  PetscCall(PetscMalloc7(nb,&alpha,nb,&beta,nb,&d,nb,&e,nb*nb,&Z,PetscMax(2*nb-2,1),&work,nb,&z));
+  PetscCall(VecDuplicate(v,&w));
+
+  PetscCall(VecNormalize(v,&nrm));
+  if (nrm == 0.0) {
+    PetscCall(PetscRandomCreate(PetscObjectComm((PetscObject)A),&rand));
+    PetscCall(PetscRandomSetType(rand,PETSCRAND48));
+    PetscCall(VecSetRandom(v,rand));
+    PetscCall(VecNormalize(v,NULL));
+  }
+  PetscCall(VecDuplicate(v,&V[0]));
+
+  while (its < maxits) {
+    PetscCall(VecCopy(v,V[0]));
+    for (k=0; k<nb; k++) {
+      /* w = A*v_k - beta_{k-1}*v_{k-1} - alpha_k*v_k */
+      PetscCall(MatMult(A,V[k],w));
+      if (k) PetscCall(VecAXPY(w,-beta[k-1],V[k-1]));
+      PetscCall(VecDot(w,V[k],&dot));
+      alpha[k] = PetscRealPart(dot);
+      if (!k && !restarted && alpha[0] < PETSC_MACHINE_EPSILON) {
+        /* starting vector in the nullspace of A */
+        PetscCall(PetscInfo(fllop,"hit nullspace of A and restarting from random vector\n"));
+        if (!rand) {
+          PetscCall(PetscRandomCreate(PetscObjectComm((PetscObject)A),&rand));
+          PetscCall(PetscRandomSetType(rand,PETSCRAND48));
+        }
+        PetscCall(VecSetRandom(V[0],rand));
+        PetscCall(VecNormalize(V[0],NULL));
+        restarted = PETSC_TRUE;
+        k--;
+        continue;
+      }
+      PetscCall(VecAXPY(w,-alpha[k],V[k]));
+      PetscCall(VecNorm(w,NORM_2,&beta[k]));
+      n = k+1;
+      its++;
+
+      /* largest eigenpair of the tridiagonal T_n, eigenvalues are returned in ascending order */
+      for (i=0; i<n; i++) d[i] = alpha[i];
+      for (i=0; i<n-1; i++) e[i] = beta[i];
+      PetscCall(PetscBLASIntCast(n,&bn));
+      PetscCall(PetscFPTrapPush(PETSC_FP_TRAP_OFF));
+      PetscCallBLAS("LAPACKstev",LAPACKstev_("V",&bn,d,e,Z,&bn,work,&info));
+      PetscCall(PetscFPTrapPop());
+      PetscCheck(!info,PETSC_COMM_SELF,PETSC_ERR_LIB,"Error in LAPACK routine stev %d",(int)info);
+      theta0 = theta;
+      theta  = d[n-1];
+      resid  = beta[k]*PetscAbsReal(Z[(n-1)*n+n-1]);   /* ||A*y - theta*y|| of the Ritz pair */
+
+      relerr = k ? PetscAbsReal(theta-theta0)/PetscAbsReal(theta) : 1.0;
+      if (relerr < tol || resid <= tol*PetscAbsReal(theta) || beta[k] <= PETSC_MACHINE_EPSILON*PetscAbsReal(theta)) {
+        converged = PETSC_TRUE;
+        break;
+      }
+      if (k == nb-1 || its == maxits) break;
+
+      if (!V[k+1]) PetscCall(VecDuplicate(v,&V[k+1]));
+      PetscCall(VecCopy(w,V[k+1]));
+      PetscCall(VecScale(V[k+1],1.0/beta[k]));
+    }
+
+    /* Ritz vector v = V*z */
+    for (j=0; j<n; j++) z[j] = Z[(n-1)*n+j];
+    PetscCall(VecSet(v,0.0));
+    PetscCall(VecMAXPY(v,n,z,V));
+    PetscCall(VecNormalize(v,NULL));
+    if (converged) break;
+    if (its < maxits) PetscCall(PetscInfo(fllop,"Lanczos basis of %d vectors exhausted after %d iterations, restarting from the Ritz vector\n",nb,its));
+  }
+
+  PetscCall(PetscInfo(fllop,"%s  lambda = %.12e  [relerr resid reltol] = [%.12e %.12e %.12e]  actual/max iterations = %d/%d\n", converged?"CONVERGED":"NOT CONVERGED", theta,relerr,resid,tol,its,maxits));
+  /* the interval [theta-resid, theta+resid] contains an eigenvalue of A */
+  if (safety) {
+    PetscCall(PetscInfo(fllop,"adding Ritz residual to the estimate, lambda = %.12e\n",theta+resid));
+    theta += resid;
+  }
+  *lambda_out = theta;
+  *converged_out = converged;
+
+  for (j=0; j<nb; j++) PetscCall(VecDestroy(&V[j]));
+  PetscCall(PetscFree(V));
+  PetscCall(PetscFree7(alpha,beta,d,e,Z,work,z));
+  PetscCall(VecDestroy(&w));
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatGetMaxEigenvalueState_Private"
+/* sum of the object states of A and of all matrices its action is composed of (MATPROD, MATSUM, MATTIMER, MATINV, MATTRANSPOSEVIRTUAL, local block of MATBLOCKDIAG);
+   states never decrease, so the sum changes whenever any of them changes; it may differ among ranks */
+static PetscErrorCode MatGetMaxEigenvalueState_Private(Mat A, PetscObjectState *state)
+{
+  PetscObjectState  s;
+  PetscBool         flg;
+  Mat               inner=NULL;
+  Mat_CompositeLink ilink;
+  PetscErrorCode    (*f)(Mat,Mat*)=NULL;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectStateGet((PetscObject)A,state));
+  PetscCall(PetscObjectTypeCompareAny((PetscObject)A,&flg,MATPROD,MATSUM,""));
+  if (flg) {
+    for (ilink=((Mat_Composite*)A->data)->head; ilink; ilink=ilink->next) {
+      PetscCall(MatGetMaxEigenvalueState_Private(ilink->mat,&s));
+      *state += s;
+    }
+    PetscFunctionReturn(0);
+  }
+  PetscCall(PetscObjectQueryFunction((PetscObject)A,"MatTimerGetMat_C",&f));
+  if (f) {
+    PetscCall(MatTimerGetMat(A,&inner));
+  } else {
+    PetscCall(PetscObjectTypeCompare((PetscObject)A,MATINV,&flg));
+    if (flg) PetscCall(MatInvGetMat(A,&inner));
+    PetscCall(PetscObjectTypeCompare((PetscObject)A,MATTRANSPOSEVIRTUAL,&flg));
+    if (flg) PetscCall(MatTransposeGetMat(A,&inner));
+    PetscCall(PetscObjectTypeCompare((PetscObject)A,MATBLOCKDIAG,&flg));
+    if (flg) PetscCall(MatGetDiagonalBlock(A,&inner));
+  }
+  if (inner) {
+    PetscCall(MatGetMaxEigenvalueState_Private(inner,&s));
+    *state += s;
+  }
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatGetMaxEigenvalue"
 /*@
    MatGetMaxEigenvalue - Computes approximate maximum eigenvalue lambda
-   and its associated eigenvector v (i.e. A*v = lambda*v) with basic power method.
+   and its associated eigenvector v (i.e. A*v = lambda*v) with the Lanczos method or basic power method.
 
    Collective on Mat
 
@@ -442,30 +644,55 @@ PetscErrorCode MatMatIsZero(Mat A, Mat B, PetscReal tol, PetscInt ntrials, Petsc
 +  lambda - approximate maximum eigenvalue of A (optional)
 -  v - corresponding eigenvector (optional)
 
+   Options Database Keys (read at the first call):
++  -mat_get_max_eigenvalue_lanczos - use the Lanczos method for symmetric A which typically needs far fewer iterations than the default power method
+.  -mat_get_max_eigenvalue_lanczos_max_basis <20> - maximum number of stored Lanczos vectors, the method is restarted from the Ritz vector when they are exhausted
+-  -mat_get_max_eigenvalue_safety - add the Ritz residual norm to the Lanczos estimate, giving an upper estimate in practice
+
+   Notes:
+   A converged estimate is stashed in A together with tol and returned by subsequent calls without v and with the same or looser tol,
+   as long as neither A nor the matrices it is composed of (factors of MATPROD and MATSUM, inner matrices of MATTIMER, MATINV,
+   MATTRANSPOSEVIRTUAL and MATBLOCKDIAG) are changed. Other implicit matrices must increase their object state when their action changes. The final eigenvector estimate is kept in A and used as the initial guess
+   by subsequent calls without v, e.g. after A has been scaled or updated.
+
    Level: intermediate
 @*/
 PetscErrorCode MatGetMaxEigenvalue(Mat A, Vec v, PetscScalar *lambda_out, PetscReal tol, PetscInt maxits)
 {
   static PetscBool registered = PETSC_FALSE;
-  Vec Av;
-  PetscInt  i;
-  PetscScalar  lambda, lambda0;
-  PetscReal  err, relerr;
-  Vec y_v[2];
-  PetscReal vAv_vv[2];
-  PetscBool destroy_v=PETSC_FALSE;
-  PetscBool flg;
-  PetscRandom rand=NULL;
+  static PetscInt  tol_composed_id,state_composed_id;
+  static PetscBool lanczos=PETSC_FALSE,safety=PETSC_FALSE;
+  static PetscInt  lanczos_max_basis=20;
+  PetscScalar      lambda;
+  PetscReal        tol_stashed;
+  PetscInt         state_stashed;
+  PetscObjectState state;
+  PetscBool        destroy_v=PETSC_FALSE;
+  PetscBool        flg,flg_tol,flg_state,converged;
+  Vec              ritz=NULL;
 
   PetscFunctionBeginI;
-  lambda = lambda0 = err = relerr = 0.0;
   if (!registered) {
     PetscCall(PetscLogEventRegister("MatGetMaxEig",MAT_CLASSID,&Mat_GetMaxEigenvalue));
     PetscCall(PetscObjectComposedDataRegister(&MatGetMaxEigenvalue_composed_id));
+    PetscCall(PetscObjectComposedDataRegister(&tol_composed_id));
+    PetscCall(PetscObjectComposedDataRegister(&state_composed_id));
+    PetscCall(PetscOptionsGetBool(NULL,NULL,"-mat_get_max_eigenvalue_lanczos",&lanczos,NULL));
+    PetscCall(PetscOptionsGetInt(NULL,NULL,"-mat_get_max_eigenvalue_lanczos_max_basis",&lanczos_max_basis,NULL));
+    PetscCall(PetscOptionsGetBool(NULL,NULL,"-mat_get_max_eigenvalue_safety",&safety,NULL));
     registered = PETSC_TRUE;
   }
+  if (tol==PETSC_DECIDE || tol == PETSC_DEFAULT)    tol = 1e-4;
+  if (maxits==PETSC_DECIDE || maxits == PETSC_DEFAULT) maxits = 50;
+
+  PetscCall(MatGetMaxEigenvalueState_Private(A,&state));
   if (lambda_out && !v) {
     PetscCall(PetscObjectComposedDataGetScalar((PetscObject)A,MatGetMaxEigenvalue_composed_id,lambda,flg));
+    PetscCall(PetscObjectComposedDataGetReal((PetscObject)A,tol_composed_id,tol_stashed,flg_tol));
+    PetscCall(PetscObjectComposedDataGetInt((PetscObject)A,state_composed_id,state_stashed,flg_state));
+    flg = (PetscBool)(flg && flg_tol && tol_stashed <= tol && flg_state && state_stashed == (PetscInt)state);
+    /* states of local blocks may change on some ranks only */
+    PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,&flg,1,MPIU_BOOL,MPI_LAND,PetscObjectComm((PetscObject)A)));
     if (flg) {
       PetscCall(PetscInfo(fllop,"returning stashed estimate ||A|| = %.12e\n",lambda));
       *lambda_out = lambda;
@@ -474,53 +701,41 @@ PetscErrorCode MatGetMaxEigenvalue(Mat A, Vec v, PetscScalar *lambda_out, PetscR
   }
 
   PetscCall(PetscLogEventBegin(Mat_GetMaxEigenvalue,A,0,0,0));
-
-  if (tol==PETSC_DECIDE || tol == PETSC_DEFAULT)    tol = 1e-4;
-  if (maxits==PETSC_DECIDE || maxits == PETSC_DEFAULT) maxits = 50;
+  PetscCall(PetscObjectQuery((PetscObject)A,"MatGetMaxEigenvalue_RitzVec",(PetscObject*)&ritz));
   if (!v) {
     PetscCall(MatCreateVecs(A,&v,NULL));
-    PetscCall(VecSet(v, 1.0));
+    if (ritz) {
+      PetscCall(PetscInfo(fllop,"starting from the stashed eigenvector estimate\n"));
+      PetscCall(VecCopy(ritz,v));
+    } else {
+      PetscCall(VecSet(v, 1.0));
+    }
     destroy_v = PETSC_TRUE;
   }
-  PetscCall(VecDuplicate(v,&Av));
-  y_v[0] = Av; y_v[1] = v;
-
-  lambda = 0.0;
-  for(i=1; i <= maxits; i++) {
-    lambda0 = lambda;
-    PetscCall(MatMult(A, v, Av));         /* y = A*v */
-    /* lambda = (v,A*v)/(v,v) */
-    //PetscCall(VecDot(v, y, &vAv));
-    //PetscCall(VecDot(v, v, &vv));
-    PetscCall(VecMDot(v,2,y_v,vAv_vv));
-    lambda = vAv_vv[0]/vAv_vv[1];
-    if (lambda < PETSC_MACHINE_EPSILON) {
-      PetscCall(PetscInfo(fllop,"hit nullspace of A and setting A*v to random vector in iteration %d\n",i));
 
-      if (!rand) {
-        PetscCall(PetscRandomCreate(PetscObjectComm((PetscObject)A),&rand));
-        PetscCall(PetscRandomSetType(rand,PETSCRAND48));
-      }
-      PetscCall(VecSetRandom(Av,rand));
-      PetscCall(VecDot(v, Av, &vAv_vv[0]));
-    }
-
-    err = PetscAbsScalar(lambda-lambda0);
-    relerr = err / PetscAbsScalar(lambda);
-    if (relerr < tol) break;
-
-    /* v = A*v/||A*v||  replaced by v = A*v/||v|| */
-    PetscCall(VecCopy(Av, v));
-    PetscCall(VecScale(v, 1.0/PetscSqrtReal(vAv_vv[1])));
+  if (lanczos) {
+    PetscCall(MatGetMaxEigenvalue_Lanczos_Private(A,v,&lambda,tol,maxits,lanczos_max_basis,safety,&converged));
+  } else {
+    PetscCall(MatGetMaxEigenvalue_Power_Private(A,v,&lambda,tol,maxits,&converged));
   }
 
-  PetscCall(PetscInfo(fllop,"%s  lambda = %.12e  [err relerr reltol] = [%.12e %.12e %.12e]  actual/max iterations = %d/%d\n", (i<=maxits)?"CONVERGED":"NOT CONVERGED", lambda,err,relerr,tol,i,maxits));
+  if (!ritz) {
+    PetscCall(VecDuplicate(v,&ritz));
+    PetscCall(PetscObjectCompose((PetscObject)A,"MatGetMaxEigenvalue_RitzVec",(PetscObject)ritz));
+    PetscCall(VecDestroy(&ritz));
+    PetscCall(PetscObjectQuery((PetscObject)A,"MatGetMaxEigenvalue_RitzVec",(PetscObject*)&ritz));
+  }
+  PetscCall(VecCopy(v,ritz));
+  /* an estimate that did not reach tol must not be returned to later calls requesting tol */
+  if (converged) {
+    PetscCall(PetscObjectComposedDataSetScalar((PetscObject)A,MatGetMaxEigenvalue_composed_id,lambda));
+    PetscCall(PetscObjectComposedDataSetReal((PetscObject)A,tol_composed_id,tol));
+    PetscCall(PetscObjectComposedDataSetInt((PetscObject)A,state_composed_id,(PetscInt)state));
+  }
 
   if (lambda_out) *lambda_out = lambda;
 
   if (destroy_v) PetscCall(VecDestroy(&v));
-  PetscCall(VecDestroy(&Av));
-  PetscCall(PetscRandomDestroy(&rand));
   PetscCall(PetscLogEventEnd(Mat_GetMaxEigenvalue,A,0,0,0));
   PetscFunctionReturnI(0);
 }
@@ -1271,3 +1486,246 @@ PetscErrorCode MatRedistributeRows(Mat mat_from,IS rowperm,PetscInt base,Mat mat
   PetscCall(MatDenseRestoreArray(mat_from,&arr_from));
   PetscFunctionReturn(0);
 }
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultBegin_MPIAIJ"
+/* same steps as MatMult_MPIAIJ, split after the diagonal block product */
+static PetscErrorCode PermonMatMultBegin_MPIAIJ(Mat A,Vec x,Vec y)
+{
+  Mat_MPIAIJ *a = (Mat_MPIAIJ*)A->data;
+
+  PetscFunctionBegin;
+  PetscCall(VecScatterBegin(a->Mvctx,x,a->lvec,INSERT_VALUES,SCATTER_FORWARD));
+  PetscCall((*a->A->ops->mult)(a->A,x,y));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultEnd_MPIAIJ"
+static PetscErrorCode PermonMatMultEnd_MPIAIJ(Mat A,Vec x,Vec y)
+{
+  Mat_MPIAIJ *a = (Mat_MPIAIJ*)A->data;
+
+  PetscFunctionBegin;
+  PetscCall(VecScatterEnd(a->Mvctx,x,a->lvec,INSERT_VALUES,SCATTER_FORWARD));
+  PetscCall((*a->B->ops->multadd)(a->B,a->lvec,y,y));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultTransposeBegin_MPIAIJ"
+/* same steps as MatMultTranspose_MPIAIJ, split before the reverse scatter is finished */
+static PetscErrorCode PermonMatMultTransposeBegin_MPIAIJ(Mat A,Vec x,Vec y)
+{
+  Mat_MPIAIJ *a = (Mat_MPIAIJ*)A->data;
+
+  PetscFunctionBegin;
+  PetscCall((*a->B->ops->multtranspose)(a->B,x,a->lvec));
+  PetscCall((*a->A->ops->multtranspose)(a->A,x,y));
+  PetscCall(VecScatterBegin(a->Mvctx,a->lvec,y,ADD_VALUES,SCATTER_REVERSE));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultTransposeEnd_MPIAIJ"
+static PetscErrorCode PermonMatMultTransposeEnd_MPIAIJ(Mat A,Vec x,Vec y)
+{
+  Mat_MPIAIJ *a = (Mat_MPIAIJ*)A->data;
+
+  PetscFunctionBegin;
+  PetscCall(VecScatterEnd(a->Mvctx,a->lvec,y,ADD_VALUES,SCATTER_REVERSE));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultGetSplitType_Private"
+/* types split directly by the PermonMatMult* dispatchers: plain assembled MPIAIJ and the virtual transpose */
+static PetscErrorCode PermonMatMultGetSplitType_Private(Mat A,PetscBool *mpiaij,PetscBool *trans)
+{
+  PetscFunctionBegin;
+  PetscCall(PetscObjectTypeCompare((PetscObject)A,MATMPIAIJ,mpiaij));
+  if (*mpiaij) *mpiaij = (PetscBool)(A->assembled && ((Mat_MPIAIJ*)A->data)->Mvctx);
+  PetscCall(PetscObjectTypeCompare((PetscObject)A,MATTRANSPOSEVIRTUAL,trans));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultBegin"
+/*@
+   PermonMatMultBegin - Starts the split-phase computation of y = A*x.
+
+   Collective on Mat
+
+   Input Parameters:
++  A - the matrix
+.  x - the vector to be multiplied
+-  y - the result vector
+
+   Notes:
+   Must be followed by PermonMatMultEnd() with the same arguments.
+   Between the two calls, x must not be modified and y must not be accessed;
+   the caller may do independent local work there while the communication of A proceeds.
+   Split-phase support is provided by MATMPIAIJ, MATTRANSPOSEVIRTUAL (through the split transpose of the inner matrix),
+   MATGLUING, MATEXTENSION, MATINV, MATPROD, MATNESTPERMON and MATTIMER (through their blocks or inner matrices).
+   For other types, this is a no-op and PermonMatMultEnd() calls MatMult().
+
+   Level: advanced
+
+.seealso: PermonMatMultEnd(), PermonMatMultTransposeBegin(), MatMult()
+@*/
+PetscErrorCode PermonMatMultBegin(Mat A,Vec x,Vec y)
+{
+  PetscErrorCode (*f)(Mat,Vec,Vec);
+  Mat            At;
+  PetscBool      mpiaij,trans;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(A,MAT_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(y,VEC_CLASSID,3);
+  if (x == y) SETERRQ(PetscObjectComm((PetscObject)A),PETSC_ERR_ARG_IDN,"x and y must be different vectors");
+  PetscCall(PetscObjectQueryFunction((PetscObject)A,"PermonMatMultBegin_C",&f));
+  if (f) {
+    PetscCall((*f)(A,x,y));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(PermonMatMultGetSplitType_Private(A,&mpiaij,&trans));
+  if (mpiaij) {
+    PetscCall(PermonMatMultBegin_MPIAIJ(A,x,y));
+  } else if (trans) {
+    PetscCall(MatTransposeGetMat(A,&At));
+    PetscCall(PermonMatMultTransposeBegin(At,x,y));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultEnd"
+/*@
+   PermonMatMultEnd - Finishes the split-phase computation of y = A*x started with PermonMatMultBegin().
+
+   Collective on Mat
+
+   Input Parameters:
++  A - the matrix
+.  x - the vector to be multiplied
+-  y - the result vector
+
+   Level: advanced
+
+.seealso: PermonMatMultBegin(), MatMult()
+@*/
+PetscErrorCode PermonMatMultEnd(Mat A,Vec x,Vec y)
+{
+  PetscErrorCode (*f)(Mat,Vec,Vec);
+  Mat            At;
+  PetscBool      mpiaij,trans;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(A,MAT_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(y,VEC_CLASSID,3);
+  PetscCall(PetscObjectQueryFunction((PetscObject)A,"PermonMatMultEnd_C",&f));
+  if (f) {
+    PetscCall((*f)(A,x,y));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(PermonMatMultGetSplitType_Private(A,&mpiaij,&trans));
+  if (mpiaij) {
+    PetscCall(PermonMatMultEnd_MPIAIJ(A,x,y));
+  } else if (trans) {
+    PetscCall(MatTransposeGetMat(A,&At));
+    PetscCall(PermonMatMultTransposeEnd(At,x,y));
+  } else {
+    PetscCall(MatMult(A,x,y));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultTransposeBegin"
+/*@
+   PermonMatMultTransposeBegin - Starts the split-phase computation of y = A'*x.
+
+   Collective on Mat
+
+   Input Parameters:
++  A - the matrix
+.  x - the vector to be multiplied
+-  y - the result vector
+
+   Notes:
+   See PermonMatMultBegin() for the rules between the two phases.
+
+   Level: advanced
+
+.seealso: PermonMatMultTransposeEnd(), PermonMatMultBegin(), MatMultTranspose()
+@*/
+PetscErrorCode PermonMatMultTransposeBegin(Mat A,Vec x,Vec y)
+{
+  PetscErrorCode (*f)(Mat,Vec,Vec);
+  Mat            At;
+  PetscBool      mpiaij,trans;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(A,MAT_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(y,VEC_CLASSID,3);
+  if (x == y) SETERRQ(PetscObjectComm((PetscObject)A),PETSC_ERR_ARG_IDN,"x and y must be different vectors");
+  PetscCall(PetscObjectQueryFunction((PetscObject)A,"PermonMatMultTransposeBegin_C",&f));
+  if (f) {
+    PetscCall((*f)(A,x,y));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(PermonMatMultGetSplitType_Private(A,&mpiaij,&trans));
+  if (mpiaij) {
+    PetscCall(PermonMatMultTransposeBegin_MPIAIJ(A,x,y));
+  } else if (trans) {
+    PetscCall(MatTransposeGetMat(A,&At));
+    PetscCall(PermonMatMultBegin(At,x,y));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PermonMatMultTransposeEnd"
+/*@
+   PermonMatMultTransposeEnd - Finishes the split-phase computation of y = A'*x started with PermonMatMultTransposeBegin().
+
+   Collective on Mat
+
+   Input Parameters:
++  A - the matrix
+.  x - the vector to be multiplied
+-  y - the result vector
+
+   Level: advanced
+
+.seealso: PermonMatMultTransposeBegin(), MatMultTranspose()
+@*/
+PetscErrorCode PermonMatMultTransposeEnd(Mat A,Vec x,Vec y)
+{
+  PetscErrorCode (*f)(Mat,Vec,Vec);
+  Mat            At;
+  PetscBool      mpiaij,trans;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(A,MAT_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(y,VEC_CLASSID,3);
+  PetscCall(PetscObjectQueryFunction((PetscObject)A,"PermonMatMultTransposeEnd_C",&f));
+  if (f) {
+    PetscCall((*f)(A,x,y));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(PermonMatMultGetSplitType_Private(A,&mpiaij,&trans));
+  if (mpiaij) {
+    PetscCall(PermonMatMultTransposeEnd_MPIAIJ(A,x,y));
+  } else if (trans) {
+    PetscCall(MatTransposeGetMat(A,&At));
+    PetscCall(PermonMatMultEnd(At,x,y));
+  } else {
+    PetscCall(MatMultTranspose(A,x,y));
+  }
+  PetscFunctionReturn(0);
+}
@@ -2,7 +2,7 @@
 #include <permon/private/permonpcimpl.h>
 #include <petscmat.h>
 
-const char *PCDualTypes[]={"none","lumped","PCDualType","PC_DUAL_",0};
+const char *PCDualTypes[]={"none","lumped","dirichlet","PCDualType","PC_DUAL_",0};
 
 PetscLogEvent PC_Dual_Apply, PC_Dual_MatMultSchur;
 
@@ -10,8 +10,28 @@ PetscLogEvent PC_Dual_Apply, PC_Dual_MatMultSchur;
 typedef struct {
   PetscBool setfromoptionscalled;
   PCDualType pcdualtype;
-  Mat C_bb, At;
+  Mat At;
   Vec xwork,ywork;
+
+  /* optional primal multiplicity scaling, applied after At and before At' */
+  PetscBool multiplicity_scaling;
+  Vec scaling;
+
+  /* the local Schur complement acts only on the interface DOFs (touched by B):
+     PC_DUAL_LUMPED uses S_bb = K_bb, PC_DUAL_DIRICHLET S_bb = K_bb - K_bi*inv(K_ii)*K_ib */
+  IS  isB, isI;            /* interface and interior DOFs, local numbering */
+  Mat Kbb, Kbi, Kib, Kii;
+  KSP ksp_ii;
+  Vec xloc, yloc;          /* local parts of xwork, ywork */
+  Vec xB, yB, xI, yI;
+
+  /* B restricted to the interface columns, so that the apply works only on interface-sized vectors;
+     NULL if B cannot be assembled as AIJ, then At is applied to full primal vectors */
+  Mat Bb;
+  Vec xBg, yBg, scalingB;
+
+  /* lumped preconditioner with MATMPIAIJ K coupled across ranks applies the whole K */
+  Mat K;
 } PC_Dual;
 
 #undef __FUNCT__
@@ -59,20 +79,265 @@ PetscErrorCode PCDualGetType(PC pc,PCDualType *type)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "PCDualMatMultSchurB_Private"
+/* yB = S_bb*xB */
+static PetscErrorCode PCDualMatMultSchurB_Private(PC_Dual *ctx)
+{
+  PetscFunctionBegin;
+  if (ctx->pcdualtype == PC_DUAL_DIRICHLET) {
+    /* yB = K_bb*xB - K_bi*inv(K_ii)*K_ib*xB */
+    PetscCall(MatMult(ctx->Kib,ctx->xB,ctx->xI));
+    PetscCall(KSPSolve(ctx->ksp_ii,ctx->xI,ctx->yI));
+    PetscCall(MatMult(ctx->Kbi,ctx->yI,ctx->yB));
+    PetscCall(VecScale(ctx->yB,-1.0));
+    PetscCall(MatMultAdd(ctx->Kbb,ctx->xB,ctx->yB,ctx->yB));
+  } else {
+    /* yB = K_bb*xB */
+    PetscCall(MatMult(ctx->Kbb,ctx->xB,ctx->yB));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PCDualMatMultSchur_Private"
+/* y = S*x with S = blockdiag(S_bb) extended by zeros to the interior DOFs; x is zero there */
+static PetscErrorCode PCDualMatMultSchur_Private(PC_Dual *ctx,Vec x,Vec y)
+{
+  const PetscScalar *xa;
+  PetscScalar       *ya;
+
+  PetscFunctionBegin;
+  PetscCall(VecGetArrayRead(x,&xa));
+  PetscCall(VecPlaceArray(ctx->xloc,xa));
+  PetscCall(VecISCopy(ctx->xloc,ctx->isB,SCATTER_REVERSE,ctx->xB));
+  PetscCall(VecResetArray(ctx->xloc));
+  PetscCall(VecRestoreArrayRead(x,&xa));
+
+  PetscCall(PCDualMatMultSchurB_Private(ctx));
+
+  PetscCall(VecZeroEntries(y));
+  PetscCall(VecGetArray(y,&ya));
+  PetscCall(VecPlaceArray(ctx->yloc,ya));
+  PetscCall(VecISCopy(ctx->yloc,ctx->isB,SCATTER_FORWARD,ctx->yB));
+  PetscCall(VecResetArray(ctx->yloc));
+  PetscCall(VecRestoreArray(y,&ya));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PCDualSetUpMultiplicityScaling_Private"
+/* scaling = 1/m where m is 1 + number of gluing multipliers attached to the DOF, as in QPGetEqMultiplicityScaling();
+   only the gluing block Bg is counted, Dirichlet and inequality rows do not contribute; scalingB is its interface part */
+static PetscErrorCode PCDualSetUpMultiplicityScaling_Private(PC pc,Mat Bg)
+{
+  PC_Dual           *ctx = (PC_Dual*)pc->data;
+  Mat               Bgt;
+  PetscInt          i,j,k,ilo,ihi,ncols,n_B;
+  const PetscInt    *idx;
+  const PetscScalar *vals;
+  PetscScalar       *sa,*sb;
+
+  PetscFunctionBegin;
+  PetscCall(PermonMatTranspose(Bg,MAT_TRANSPOSE_EXPLICIT,&Bgt));
+  PetscCall(VecDuplicate(ctx->xwork,&ctx->scaling));
+  PetscCall(MatGetOwnershipRange(Bgt,&ilo,&ihi));
+  PetscCall(VecGetArray(ctx->scaling,&sa));
+  for (i=ilo; i<ihi; i++) {
+    PetscCall(MatGetRow(Bgt,i,&ncols,NULL,&vals));
+    k=0;
+    for (j=0; j<ncols; j++) {
+      if (vals[j]) k++;
+    }
+    PetscCall(MatRestoreRow(Bgt,i,&ncols,NULL,&vals));
+    sa[i-ilo] = 1.0/(k+1);
+  }
+  PetscCall(VecRestoreArray(ctx->scaling,&sa));
+  PetscCall(MatDestroy(&Bgt));
+
+  if (ctx->Bb) {
+    PetscCall(VecDuplicate(ctx->xBg,&ctx->scalingB));
+    PetscCall(ISGetLocalSize(ctx->isB,&n_B));
+    PetscCall(ISGetIndices(ctx->isB,&idx));
+    PetscCall(VecGetArray(ctx->scaling,&sa));
+    PetscCall(VecGetArrayWrite(ctx->scalingB,&sb));
+    for (i=0; i<n_B; i++) sb[i] = sa[idx[i]];
+    PetscCall(VecRestoreArrayWrite(ctx->scalingB,&sb));
+    PetscCall(VecRestoreArray(ctx->scaling,&sa));
+    PetscCall(ISRestoreIndices(ctx->isB,&idx));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PCDualSetUpInterface_Private"
+/* finds the interface DOFs and extracts K_bb from the local block of K */
+static PetscErrorCode PCDualSetUpInterface_Private(PC pc,Mat Bt,Mat K_loc)
+{
+  PC_Dual           *ctx = (PC_Dual*)pc->data;
+  Vec               r;
+  PetscRandom       rand;
+  const PetscScalar *xa;
+  PetscInt          i,n,n_B,n_I,*idx_B,*idx_I;
+
+  PetscFunctionBegin;
+  /* interface DOFs are those touched by B; Bt is applied to a random positive vector so that entries of opposite signs do not cancel */
+  PetscCall(MatCreateVecs(Bt,&r,NULL));
+  PetscCall(PetscRandomCreate(PetscObjectComm((PetscObject)pc),&rand));
+  PetscCall(PetscRandomSetInterval(rand,1.0,2.0));
+  PetscCall(VecSetRandom(r,rand));
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscCall(MatMult(Bt,r,ctx->xwork));
+  PetscCall(VecDestroy(&r));
+
+  PetscCall(VecGetLocalSize(ctx->xwork,&n));
+  PetscCall(PetscMalloc2(n,&idx_B,n,&idx_I));
+  PetscCall(VecGetArrayRead(ctx->xwork,&xa));
+  for (i=0, n_B=0, n_I=0; i<n; i++) {
+    if (xa[i] != 0.0) {
+      idx_B[n_B++] = i;
+    } else {
+      idx_I[n_I++] = i;
+    }
+  }
+  PetscCall(VecRestoreArrayRead(ctx->xwork,&xa));
+  PetscCall(ISCreateGeneral(PETSC_COMM_SELF,n_B,idx_B,PETSC_COPY_VALUES,&ctx->isB));
+  PetscCall(ISCreateGeneral(PETSC_COMM_SELF,n_I,idx_I,PETSC_COPY_VALUES,&ctx->isI));
+  PetscCall(PetscFree2(idx_B,idx_I));
+  PetscCall(PetscInfo(pc,"%" PetscInt_FMT " interface and %" PetscInt_FMT " interior DOFs on this rank\n",n_B,n_I));
+
+  PetscCall(MatCreateSubMatrix(K_loc,ctx->isB,ctx->isB,MAT_INITIAL_MATRIX,&ctx->Kbb));
+  PetscCall(MatCreateVecs(ctx->Kbb,&ctx->xB,&ctx->yB));
+  PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF,1,n,NULL,&ctx->xloc));
+  PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF,1,n,NULL,&ctx->yloc));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PCDualSetUp_Dirichlet_Private"
+static PetscErrorCode PCDualSetUp_Dirichlet_Private(PC pc,Mat K_loc)
+{
+  PC_Dual           *ctx = (PC_Dual*)pc->data;
+  PetscBool         set,flg;
+  PC                pc_ii;
+  const char        *prefix;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateSubMatrix(K_loc,ctx->isB,ctx->isI,MAT_INITIAL_MATRIX,&ctx->Kbi));
+  PetscCall(MatCreateSubMatrix(K_loc,ctx->isI,ctx->isB,MAT_INITIAL_MATRIX,&ctx->Kib));
+  PetscCall(MatCreateSubMatrix(K_loc,ctx->isI,ctx->isI,MAT_INITIAL_MATRIX,&ctx->Kii));
+
+  /* K_ii is factored once */
+  PetscCall(KSPCreate(PETSC_COMM_SELF,&ctx->ksp_ii));
+  PetscCall(PetscObjectIncrementTabLevel((PetscObject)ctx->ksp_ii,(PetscObject)pc,1));
+  PetscCall(PCGetOptionsPrefix(pc,&prefix));
+  PetscCall(KSPSetOptionsPrefix(ctx->ksp_ii,prefix));
+  PetscCall(KSPAppendOptionsPrefix(ctx->ksp_ii,"pc_dual_dirichlet_"));
+  PetscCall(KSPSetOperators(ctx->ksp_ii,ctx->Kii,ctx->Kii));
+  PetscCall(KSPSetType(ctx->ksp_ii,KSPPREONLY));
+  PetscCall(KSPGetPC(ctx->ksp_ii,&pc_ii));
+  PetscCall(MatIsSymmetricKnown(K_loc,&set,&flg));
+  if (set && flg) {
+    PetscCall(MatSetOption(ctx->Kii,MAT_SYMMETRIC,PETSC_TRUE));
+    PetscCall(PCSetType(pc_ii,PCCHOLESKY));
+  } else {
+    PetscCall(PCSetType(pc_ii,PCLU));
+  }
+  PetscCall(KSPSetFromOptions(ctx->ksp_ii));
+  PetscCall(KSPSetUp(ctx->ksp_ii));
+
+  PetscCall(MatCreateVecs(ctx->Kii,&ctx->xI,&ctx->yI));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "PCDualSetUpInterfaceB_Private"
+/* extracts B_b, the interface columns of B, if B can be assembled as AIJ */
+static PetscErrorCode PCDualSetUpInterfaceB_Private(PC pc,Mat Bt)
+{
+  PC_Dual           *ctx = (PC_Dual*)pc->data;
+  Mat               B;
+  IS                isrow,iscol;
+  const PetscInt    *idx;
+  PetscInt          i,n_B,cstart,*gidx;
+  PetscBool         flg;
+
+  PetscFunctionBegin;
+  PetscCall(PermonMatTranspose(Bt,MAT_TRANSPOSE_EXPLICIT,&B));
+  PetscCall(PetscObjectTypeCompareAny((PetscObject)B,&flg,MATSEQAIJ,MATMPIAIJ,""));
+  if (!flg) {
+    PetscCall(PetscObjectTypeCompareAny((PetscObject)B,&flg,MATNEST,MATGLUING,MATEXTENSION,""));
+    if (flg) PetscCall(MatConvert(B,MATAIJ,MAT_INPLACE_MATRIX,&B));
+  }
+  if (!flg) {
+    PetscCall(PetscInfo(pc,"B of type %s not assembled as AIJ, Bt is applied to full primal vectors\n",((PetscObject)B)->type_name));
+    PetscCall(MatDestroy(&B));
+    PetscFunctionReturn(0);
+  }
+
+  /* the interface DOFs in the global numbering of the columns of B */
+  PetscCall(MatGetOwnershipRangeColumn(B,&cstart,NULL));
+  PetscCall(ISGetLocalSize(ctx->isB,&n_B));
+  PetscCall(ISGetIndices(ctx->isB,&idx));
+  PetscCall(PetscMalloc1(n_B,&gidx));
+  for (i=0; i<n_B; i++) gidx[i] = cstart + idx[i];
+  PetscCall(ISRestoreIndices(ctx->isB,&idx));
+  PetscCall(ISCreateGeneral(PetscObjectComm((PetscObject)B),n_B,gidx,PETSC_OWN_POINTER,&iscol));
+  PetscCall(MatGetOwnershipIS(B,&isrow,NULL));
+  PetscCall(MatCreateSubMatrix(B,isrow,iscol,MAT_INITIAL_MATRIX,&ctx->Bb));
+  PetscCall(ISDestroy(&isrow));
+  PetscCall(ISDestroy(&iscol));
+  PetscCall(MatDestroy(&B));
+  PetscCall(MatCreateVecs(ctx->Bb,&ctx->xBg,NULL));
+  PetscCall(VecDuplicate(ctx->xBg,&ctx->yBg));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "PCApply_Dual"
 static PetscErrorCode PCApply_Dual(PC pc,Vec x,Vec y)
 {
-  PC_Dual         *ctx = (PC_Dual*)pc->data;
+  PC_Dual           *ctx = (PC_Dual*)pc->data;
+  const PetscScalar *xa;
+  PetscScalar       *ya;
 
   PetscFunctionBegin;
   PetscCall(PetscLogEventBegin(PC_Dual_Apply,pc,x,y,0));
+  if (ctx->Bb) {
+    /* only the interface part of B'*x is formed */
+    PetscCall(MatMultTranspose(ctx->Bb,x,ctx->xBg));
+    if (ctx->scalingB) PetscCall(VecPointwiseMult(ctx->xBg,ctx->xBg,ctx->scalingB));
+
+    PetscCall(PetscLogEventBegin(PC_Dual_MatMultSchur,pc,x,y,0));
+    PetscCall(VecGetArrayRead(ctx->xBg,&xa));
+    PetscCall(VecGetArrayWrite(ctx->yBg,&ya));
+    PetscCall(VecPlaceArray(ctx->xB,xa));
+    PetscCall(VecPlaceArray(ctx->yB,ya));
+    PetscCall(PCDualMatMultSchurB_Private(ctx));
+    PetscCall(VecResetArray(ctx->xB));
+    PetscCall(VecResetArray(ctx->yB));
+    PetscCall(VecRestoreArrayWrite(ctx->yBg,&ya));
+    PetscCall(VecRestoreArrayRead(ctx->xBg,&xa));
+    PetscCall(PetscLogEventEnd(PC_Dual_MatMultSchur,pc,x,y,0));
+
+    if (ctx->scalingB) PetscCall(VecPointwiseMult(ctx->yBg,ctx->yBg,ctx->scalingB));
+    PetscCall(MatMult(ctx->Bb,ctx->yBg,y));
+    PetscCall(PetscLogEventEnd(PC_Dual_Apply,pc,x,y,0));
+    PetscFunctionReturn(0);
+  }
+
   PetscCall(MatMult(ctx->At,x,ctx->xwork));
+  if (ctx->scaling) PetscCall(VecPointwiseMult(ctx->xwork,ctx->xwork,ctx->scaling));
 
   PetscCall(PetscLogEventBegin(PC_Dual_MatMultSchur,pc,x,y,0));
-  PetscCall(MatMult(ctx->C_bb,ctx->xwork,ctx->ywork));
+  if (ctx->K) {
+    PetscCall(MatMult(ctx->K,ctx->xwork,ctx->ywork));
+  } else {
+    PetscCall(PCDualMatMultSchur_Private(ctx,ctx->xwork,ctx->ywork));
+  }
   PetscCall(PetscLogEventEnd(PC_Dual_MatMultSchur,pc,x,y,0));
 
+  if (ctx->scaling) PetscCall(VecPointwiseMult(ctx->ywork,ctx->ywork,ctx->scaling));
   PetscCall(MatMultTranspose(ctx->At,ctx->ywork,y));
   PetscCall(PetscLogEventEnd(PC_Dual_Apply,pc,x,y,0));
   PetscFunctionReturn(0);
@@ -87,15 +352,56 @@ static PetscErrorCode PCApply_Dual_None(PC pc,Vec x,Vec y)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "PCDualGetLocalK_Private"
+/* the local Schur complements are built from the diagonal block of K, which is exact only if K has no off-process coupling:
+   K is MATBLOCKDIAG, lives on a single rank, or is MPIAIJ with an empty off-diagonal part on all ranks;
+   for MPIAIJ K with the coupling, K_loc is NULL and the lumped preconditioner applies the whole K */
+static PetscErrorCode PCDualGetLocalK_Private(PC pc,Mat K,Mat *K_loc)
+{
+  PC_Dual     *ctx = (PC_Dual*)pc->data;
+  MPI_Comm    comm;
+  PetscMPIInt size;
+  PetscBool   flg;
+  Mat         Kd,Ko;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectGetComm((PetscObject)K,&comm));
+  PetscCallMPI(MPI_Comm_size(comm,&size));
+  PetscCall(PetscObjectTypeCompare((PetscObject)K,MATBLOCKDIAG,&flg));
+  if (!flg && size > 1) {
+    PetscCall(PetscObjectTypeCompare((PetscObject)K,MATMPIAIJ,&flg));
+    if (flg) {
+      PetscCall(MatMPIAIJGetSeqAIJ(K,&Kd,&Ko,NULL));
+      flg = (PetscBool)(Ko->cmap->n == 0);
+      PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,&flg,1,MPIU_BOOL,MPI_LAND,comm));
+      if (!flg) {
+        if (ctx->pcdualtype != PC_DUAL_LUMPED) SETERRQ(PetscObjectComm((PetscObject)pc),PETSC_ERR_SUP,"PCDUAL type %s needs K without off-process coupling but the off-diagonal part of MATMPIAIJ K is not empty",PCDualTypes[ctx->pcdualtype]);
+        PetscCall(PetscInfo(pc,"MATMPIAIJ K has off-process coupling, the lumped preconditioner applies the whole K\n"));
+        *K_loc = NULL;
+        PetscFunctionReturn(0);
+      }
+    } else {
+      SETERRQ(PetscObjectComm((PetscObject)pc),PETSC_ERR_SUP,"PCDUAL needs K of type %s, %s without off-process coupling, or on a single rank; K is %s",MATBLOCKDIAG,MATMPIAIJ,((PetscObject)K)->type_name);
+    }
+  }
+  PetscCall(MatGetDiagonalBlock(K,K_loc));
+  PetscFunctionReturn(0);
+}
+
+static PetscErrorCode PCReset_Dual(PC pc);
+
 #undef __FUNCT__
 #define __FUNCT__ "PCSetUp_Dual"
 static PetscErrorCode PCSetUp_Dual(PC pc)
 {
   PC_Dual *ctx = (PC_Dual*)pc->data;
   Mat F = pc->mat;
-  Mat Bt, K;
+  Mat Bt, K, K_loc;
 
   PetscFunctionBegin;
+  /* drop data of a previous setup */
+  PetscCall(PCReset_Dual(pc));
   PetscCall(PetscInfo(pc,"using PCDualType %s\n",PCDualTypes[ctx->pcdualtype]));
 
   if (ctx->pcdualtype == PC_DUAL_NONE) {
@@ -108,12 +414,28 @@ static PetscErrorCode PCSetUp_Dual(PC pc)
   PetscCall(PetscObjectQuery((PetscObject)F,"Bt",(PetscObject*)&Bt));
   PetscCall(PetscObjectQuery((PetscObject)F,"K",(PetscObject*)&K));
 
-  if (ctx->pcdualtype == PC_DUAL_LUMPED) {
-    ctx->At = Bt;
-    PetscCall(PetscObjectReference((PetscObject)Bt));
-    ctx->C_bb = K;
+  ctx->At = Bt;
+  PetscCall(PetscObjectReference((PetscObject)Bt));
+  PetscCall(MatCreateVecs(K,&ctx->xwork,&ctx->ywork));
+
+  PetscCall(PCDualGetLocalK_Private(pc,K,&K_loc));
+  if (K_loc) {
+    PetscCall(PCDualSetUpInterface_Private(pc,Bt,K_loc));
+    if (ctx->pcdualtype == PC_DUAL_DIRICHLET) {
+      PetscCall(PCDualSetUp_Dirichlet_Private(pc,K_loc));
+    }
+    PetscCall(PCDualSetUpInterfaceB_Private(pc,Bt));
+  } else {
+    ctx->K = K;
     PetscCall(PetscObjectReference((PetscObject)K));
-    PetscCall(MatCreateVecs(ctx->C_bb,&ctx->xwork,&ctx->ywork));
+  }
+
+  if (ctx->multiplicity_scaling) {
+    Mat Bg;
+
+    PetscCall(PetscObjectQuery((PetscObject)F,"Bg",(PetscObject*)&Bg));
+    if (!Bg) SETERRQ(PetscObjectComm((PetscObject)pc),PETSC_ERR_ARG_WRONGSTATE,"multiplicity scaling needs the gluing matrix Bg composed by QPFetiSetUp() and passed to the dual operator by QPTDualize()");
+    PetscCall(PCDualSetUpMultiplicityScaling_Private(pc,Bg));
   }
   PetscFunctionReturn(0);
 }
@@ -126,9 +448,27 @@ static PetscErrorCode PCReset_Dual(PC pc)
 
   PetscFunctionBegin;
   PetscCall(MatDestroy(&ctx->At));
-  PetscCall(MatDestroy(&ctx->C_bb));
   PetscCall(VecDestroy(&ctx->xwork));
   PetscCall(VecDestroy(&ctx->ywork));
+  PetscCall(VecDestroy(&ctx->scaling));
+  PetscCall(ISDestroy(&ctx->isB));
+  PetscCall(ISDestroy(&ctx->isI));
+  PetscCall(MatDestroy(&ctx->Kbb));
+  PetscCall(MatDestroy(&ctx->Kbi));
+  PetscCall(MatDestroy(&ctx->Kib));
+  PetscCall(MatDestroy(&ctx->Kii));
+  PetscCall(KSPDestroy(&ctx->ksp_ii));
+  PetscCall(VecDestroy(&ctx->xloc));
+  PetscCall(VecDestroy(&ctx->yloc));
+  PetscCall(VecDestroy(&ctx->xB));
+  PetscCall(VecDestroy(&ctx->yB));
+  PetscCall(VecDestroy(&ctx->xI));
+  PetscCall(VecDestroy(&ctx->yI));
+  PetscCall(MatDestroy(&ctx->Bb));
+  PetscCall(VecDestroy(&ctx->xBg));
+  PetscCall(VecDestroy(&ctx->yBg));
+  PetscCall(VecDestroy(&ctx->scalingB));
+  PetscCall(MatDestroy(&ctx->K));
   PetscFunctionReturn(0);
 }
 
@@ -143,6 +483,19 @@ static PetscErrorCode PCView_Dual(PC pc,PetscViewer viewer)
   PetscCall(PetscObjectTypeCompare((PetscObject)viewer,PETSCVIEWERASCII,&iascii));
   if (!iascii) PetscFunctionReturn(0);
   PetscCall(PetscViewerASCIIPrintf(viewer,"  PCDualType: %d (%s)\n",ctx->pcdualtype,PCDualTypes[ctx->pcdualtype]));
+  if (ctx->multiplicity_scaling) PetscCall(PetscViewerASCIIPrintf(viewer,"  multiplicity scaling\n"));
+  if (ctx->ksp_ii) {
+    PetscViewer sviewer;
+    PetscMPIInt rank;
+
+    PetscCallMPI(MPI_Comm_rank(PetscObjectComm((PetscObject)pc),&rank));
+    PetscCall(PetscViewerASCIIPrintf(viewer,"  interior solver on rank 0:\n"));
+    PetscCall(PetscViewerASCIIPushTab(viewer));
+    PetscCall(PetscViewerGetSubViewer(viewer,PETSC_COMM_SELF,&sviewer));
+    if (!rank) PetscCall(KSPView(ctx->ksp_ii,sviewer));
+    PetscCall(PetscViewerRestoreSubViewer(viewer,PETSC_COMM_SELF,&sviewer));
+    PetscCall(PetscViewerASCIIPopTab(viewer));
+  }
   PetscFunctionReturn(0);
 }
 
@@ -167,6 +520,7 @@ PetscErrorCode PCSetFromOptions_Dual(PC pc,PetscOptionItems *PetscOptionsObject)
   PetscFunctionBegin;
   PetscOptionsHeadBegin(PetscOptionsObject,"PCDUAL options");
   PetscCall(PetscOptionsEnum("-pc_dual_type", "PCDUAL type", "PCDualSetType", PCDualTypes, (PetscEnum)ctx->pcdualtype, (PetscEnum*)&ctx->pcdualtype, NULL));
+  PetscCall(PetscOptionsBool("-pc_dual_multiplicity_scaling", "scale by inverse DOF multiplicities", NULL, ctx->multiplicity_scaling, &ctx->multiplicity_scaling, NULL));
   PetscOptionsHeadEnd();
   ctx->setfromoptionscalled = PETSC_TRUE;
   PetscFunctionReturn(0);
@@ -187,6 +541,7 @@ FLLOP_EXTERN PetscErrorCode PCCreate_Dual(PC pc)
   
   ctx->setfromoptionscalled = PETSC_FALSE;
   ctx->pcdualtype = PC_DUAL_NONE;
+  ctx->multiplicity_scaling = PETSC_FALSE;
   
   /* set general PC functions already implemented for this PC type */
   pc->ops->apply               = PCApply_Dual;
@@ -27,21 +27,69 @@ PetscErrorCode QPFetiCtxCreate(QPFetiCtx *ctxout)
   ctx->l2g = NULL;
   ctx->i2g_map = NULL;
   ctx->l2g_map = NULL;
+  ctx->gluing = NULL;
+  ctx->dir_in_A = PETSC_FALSE;
+  ctx->Bg = NULL;
+  ctx->Bd = NULL;
+  ctx->cd = NULL;
   ctx->setupcalled = PETSC_FALSE;
   *ctxout = ctx;
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiGluingPatternReset_Private"
+static PetscErrorCode QPFetiGluingPatternReset_Private(QPFetiGluingPattern *pat)
+{
+  PetscFunctionBegin;
+  PetscCall(PetscFree(pat->dirmask));
+  PetscCall(PetscFree(pat->local_idx));
+  PetscCall(PetscFree(pat->condensed_local_idx));
+  PetscCall(PetscFree(pat->root_degree_onleaves_fromSF1onSF2));
+  PetscCall(PetscFree(pat->ris_array));
+  PetscCall(PetscFree(pat->prealloc_seqEX));
+  PetscCall(PetscFree(pat->link_onleaves));
+  PetscCall(PetscFree(pat->division));
+  PetscCall(PetscFree(pat->max_rank_onleaves_linkSF));
+  PetscCall(PetscFree3(pat->prealloc_diag, pat->prealloc_ofdiag, pat->prealloc_seq));
+  PetscCall(PetscSFDestroy(&pat->link_SF));
+  PetscCall(ISDestroy(&pat->myneighbors));
+  PetscCall(PetscMemzero(pat,sizeof(QPFetiGluingPattern)));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiGluingDestroy_Private"
+static PetscErrorCode QPFetiGluingDestroy_Private(QPFetiGluing *gl)
+{
+  PetscInt t;
+
+  PetscFunctionBegin;
+  if (!*gl) PetscFunctionReturn(0);
+  for (t=0; t<3; t++) PetscCall(QPFetiGluingPatternReset_Private(&(*gl)->pattern[t]));
+  PetscCall(ISDestroy(&(*gl)->i2g));
+  PetscCall(ISDestroy(&(*gl)->i2l));
+  PetscCall(PetscSFDestroy(&(*gl)->SF1));
+  PetscCall(PetscLayoutDestroy(&(*gl)->layout_SF1));
+  PetscCall(PetscFree3((*gl)->root_degree_onroots_SF1, (*gl)->root_degree_onleaves_SF1, (*gl)->dirmask));
+  PetscCall(PetscFree(*gl));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPFetiCtxDestroy"
 PetscErrorCode QPFetiCtxDestroy(QPFetiCtx ctx)
 {
   PetscFunctionBegin;
+  PetscCall(QPFetiGluingDestroy_Private(&ctx->gluing));
   PetscCall(ISDestroy(&ctx->i2g));
   PetscCall(ISDestroy(&ctx->l2g));
   PetscCall(ISLocalToGlobalMappingDestroy(&ctx->i2g_map));
   PetscCall(ISLocalToGlobalMappingDestroy(&ctx->l2g_map));
   PetscCall(QPFetiDirichletDestroy(&ctx->dbc));
+  PetscCall(MatDestroy(&ctx->Bg));
+  PetscCall(MatDestroy(&ctx->Bd));
+  PetscCall(VecDestroy(&ctx->cd));
   PetscCall(PetscFree(ctx));
   PetscFunctionReturn(0);
 }
@@ -78,8 +126,11 @@ PetscErrorCode QPFetiSetLocalToGlobalMapping(QP qp, IS l2g)
   PetscValidHeaderSpecific(qp,QP_CLASSID,1);
   PetscValidHeaderSpecific(l2g,IS_CLASSID,2);
   PetscCall(QPFetiGetCtx(qp,&ctx));
-  ctx->l2g = l2g;
   PetscCall(PetscObjectReference((PetscObject)l2g));
+  PetscCall(ISDestroy(&ctx->l2g));
+  PetscCall(ISLocalToGlobalMappingDestroy(&ctx->l2g_map));
+  PetscCall(QPFetiGluingDestroy_Private(&ctx->gluing));
+  ctx->l2g = l2g;
   PetscCall(ISLocalToGlobalMappingCreateIS(l2g,&ctx->l2g_map));
   ctx->setupcalled = PETSC_FALSE;
   PetscFunctionReturn(0);
@@ -95,8 +146,11 @@ PetscErrorCode QPFetiSetInterfaceToGlobalMapping(QP qp, IS i2g)
   PetscValidHeaderSpecific(qp,QP_CLASSID,1);
   PetscValidHeaderSpecific(i2g,IS_CLASSID,2);
   PetscCall(QPFetiGetCtx(qp,&ctx));
-  ctx->i2g = i2g;
   PetscCall(PetscObjectReference((PetscObject)i2g));
+  PetscCall(ISDestroy(&ctx->i2g));
+  PetscCall(ISLocalToGlobalMappingDestroy(&ctx->i2g_map));
+  PetscCall(QPFetiGluingDestroy_Private(&ctx->gluing));
+  ctx->i2g = i2g;
   PetscCall(ISLocalToGlobalMappingCreateIS(i2g,&ctx->i2g_map));
   ctx->setupcalled = PETSC_FALSE;
   PetscFunctionReturn(0);
@@ -275,14 +329,12 @@ PetscErrorCode QPFetiAssembleDirichlet(QP qp)
     PetscCall(PetscObjectSetName((PetscObject)B,"Bd"));
     PetscCall(MatDestroy(&Bt));
 
-    PetscCall(PetscLogEventBegin(QP_AddEq,qp,0,0,0));
     PetscCall(MatCreateVecs(B,NULL,&c));
     PetscCall(MatMult(B,qp->x,c));
-    PetscCall(QPAddEq(qp, B, c));
-    PetscCall(PetscLogEventEnd(QP_AddEq,qp,0,0,0));
 
-    PetscCall(VecDestroy(&c));
-    PetscCall(MatDestroy(&B));
+    /* added to BE together with Bg by QPFetiSetUp() */
+    ctx->Bd = B;
+    ctx->cd = c;
 
     /* parent is matis -> add dirichlet IS */
     if (qp->parent) {
@@ -292,6 +344,7 @@ PetscErrorCode QPFetiAssembleDirichlet(QP qp)
           PetscCall(MatGetLocalToGlobalMapping(qp->A,&l2dg,NULL));
           PetscCall(ISGlobalToLocalMappingApplyIS(l2dg,IS_GTOLM_DROP,dbc_dg,&dbc_l));
         }
+        PetscCall(ISDestroy(&((QPTMatISToBlockDiag_Ctx*)qp->postSolveCtx)->isDir));
         ((QPTMatISToBlockDiag_Ctx*)qp->postSolveCtx)->isDir = dbc_dg;
         PetscCall(PetscObjectReference((PetscObject)dbc_dg));
       }
@@ -300,6 +353,7 @@ PetscErrorCode QPFetiAssembleDirichlet(QP qp)
     Vec d;
     PetscScalar alpha;
 
+    if (ctx->dir_in_A) SETERRQ(PetscObjectComm((PetscObject)qp),PETSC_ERR_SUP,"Dirichlet conditions already enforced in the operator cannot be reassembled");
     /* alpha=max(abs(diag(A)) */
     PetscCall(MatCreateVecs(qp->A,NULL,&d));
     PetscCall(MatGetDiagonal(qp->A,d));
@@ -309,6 +363,7 @@ PetscErrorCode QPFetiAssembleDirichlet(QP qp)
 
     PetscCall(MatZeroRowsColumnsIS(qp->A, dbc_dg, alpha, qp->x, qp->b));
     PetscCall(QPFetiAssembleDirichlet_ModifyR_Private(qp, dbc_dg));
+    ctx->dir_in_A = PETSC_TRUE;
   }
 
   PetscCall(ISDestroy(&dbc_dg));
@@ -317,6 +372,109 @@ PetscErrorCode QPFetiAssembleDirichlet(QP qp)
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiSetUpLocalBlocks_Private"
+/* several subdomains per rank: split the local block of the block-diagonal operator into the contiguous index ranges
+   not coupled by any nonzero, so that they are multiplied and factored separately, see MatBlockDiagSetLocalBlockSizes();
+   ranges smaller than -feti_local_blocks_min_size (e.g. decoupled Dirichlet rows) are merged with the following one;
+   opt-in with -feti_local_blocks, as it changes the local solvers of the operator */
+static PetscErrorCode QPFetiSetUpLocalBlocks_Private(QP qp)
+{
+  Mat            Aloc;
+  PetscBool      flg, detect = PETSC_FALSE;
+  PetscInt       i, j, n, ncols, nblocks, start, minsize = 16, reach, *lens, *sufmin;
+  const PetscInt *cols;
+
+  PetscFunctionBegin;
+  PetscCall(PetscOptionsGetBool(NULL,NULL,"-feti_local_blocks",&detect,NULL));
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-feti_local_blocks_min_size",&minsize,NULL));
+  PetscCall(PetscObjectTypeCompare((PetscObject)qp->A,MATBLOCKDIAG,&flg));
+  if (!detect || !flg) PetscFunctionReturn(0);
+  PetscCall(MatBlockDiagGetLocalBlockSizes(qp->A,&nblocks,NULL));
+  if (nblocks > 1) PetscFunctionReturn(0); /* set by the user */
+  PetscCall(MatGetDiagonalBlock(qp->A,&Aloc));
+  PetscCall(MatGetLocalSize(Aloc,&n,NULL));
+  if (!n) PetscFunctionReturn(0);
+
+  /* sufmin[i] = smallest column index in rows i..n-1 */
+  PetscCall(PetscMalloc2(n+1,&sufmin,n,&lens));
+  sufmin[n] = n;
+  for (i=n-1; i>=0; i--) {
+    sufmin[i] = PetscMin(i,sufmin[i+1]);
+    PetscCall(MatGetRow(Aloc,i,&ncols,&cols,NULL));
+    for (j=0; j<ncols; j++) sufmin[i] = PetscMin(sufmin[i],cols[j]);
+    PetscCall(MatRestoreRow(Aloc,i,&ncols,&cols,NULL));
+  }
+
+  /* a block ends after row i if no row up to i reaches beyond i and no row after i reaches back */
+  nblocks = 0; start = 0; reach = -1;
+  for (i=0; i<n; i++) {
+    reach = PetscMax(reach,i);
+    PetscCall(MatGetRow(Aloc,i,&ncols,&cols,NULL));
+    for (j=0; j<ncols; j++) reach = PetscMax(reach,cols[j]);
+    PetscCall(MatRestoreRow(Aloc,i,&ncols,&cols,NULL));
+    if (reach <= i && sufmin[i+1] > i && i+1-start >= minsize) {
+      lens[nblocks++] = i+1-start;
+      start = i+1;
+    }
+  }
+  if (start < n) {
+    if (nblocks) lens[nblocks-1] += n-start;
+    else lens[nblocks++] = n;
+  }
+  if (nblocks > 1) {
+    PetscCall(PetscInfo(qp,"local block of the operator consists of %" PetscInt_FMT " decoupled subdomains\n",nblocks));
+    PetscCall(MatBlockDiagSetLocalBlockSizes(qp->A,nblocks,lens));
+  }
+  PetscCall(PetscFree2(sufmin,lens));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiSetEq_Private"
+/* put ctx->Bg and ctx->Bd in place of Bg_old and Bd_old in BE; Bg comes first as assumed by QPGetEqMultiplicityScaling(),
+   other equality constraints are kept in their order */
+static PetscErrorCode QPFetiSetEq_Private(QP qp, QPFetiCtx ctx, Mat Bg_old, Mat Bd_old)
+{
+  Mat      *Bu=NULL, Bi;
+  Vec      *cu=NULL, ci;
+  PetscInt i, M, nu=0;
+
+  PetscFunctionBegin;
+  if (qp->BE) {
+    M = qp->BE_nest_count ? qp->BE_nest_count : 1;
+    PetscCall(PetscCalloc2(M,&Bu,M,&cu));
+    for (i=0; i<M; i++) {
+      Bi = qp->BE;
+      ci = qp->cE;
+      if (qp->BE_nest_count) {
+        PetscCall(MatNestGetSubMat(qp->BE,i,0,&Bi));
+        ci = NULL;
+        if (qp->cE) PetscCall(VecNestGetSubVec(qp->cE,i,&ci));
+      }
+      if (Bi == Bg_old || Bi == Bd_old) continue;
+      PetscCall(PetscObjectReference((PetscObject)Bi));
+      if (ci) PetscCall(PetscObjectReference((PetscObject)ci));
+      Bu[nu] = Bi;
+      cu[nu] = ci;
+      nu++;
+    }
+  }
+
+  PetscCall(PetscLogEventBegin(QP_AddEq,qp,0,0,0));
+  PetscCall(QPSetEq(qp,NULL,NULL));
+  PetscCall(QPAddEq(qp,ctx->Bg,NULL));
+  if (ctx->Bd) PetscCall(QPAddEq(qp,ctx->Bd,ctx->cd));
+  for (i=0; i<nu; i++) {
+    PetscCall(QPAddEq(qp,Bu[i],cu[i]));
+    PetscCall(MatDestroy(&Bu[i]));
+    PetscCall(VecDestroy(&cu[i]));
+  }
+  PetscCall(PetscLogEventEnd(QP_AddEq,qp,0,0,0));
+  PetscCall(PetscFree2(Bu,cu));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPFetiSetUp"
 PetscErrorCode QPFetiSetUp(QP qp)
@@ -324,7 +482,7 @@ PetscErrorCode QPFetiSetUp(QP qp)
   MPI_Comm comm;
   static PetscBool registered = PETSC_FALSE;
   QPFetiCtx ctx;
-  Mat Bg;
+  Mat Bg_old, Bd_old;
   PetscInt nlocaldofs;
   FetiGluingType type = FETI_GLUING_FULL;
   PetscBool exclude_dir = PETSC_FALSE;
@@ -348,16 +506,24 @@ PetscErrorCode QPFetiSetUp(QP qp)
   PetscCall(PetscOptionsGetEnum(NULL,NULL,"-feti_gluing_type",FetiGluingTypes,(PetscEnum*)&type, NULL));
   PetscCall(PetscOptionsGetBool(NULL,NULL,"-feti_gluing_exclude_dirichlet",&exclude_dir,NULL));
   PetscCall(PetscPrintf(comm, "============\n FETI gluing type: %s\n excluding Dirichlet DOFs? %d\n",FetiGluingTypes[type],exclude_dir));
+
+  /* blocks of a previous assembly, to be replaced */
+  Bg_old = ctx->Bg; ctx->Bg = NULL;
+  Bd_old = ctx->Bd; ctx->Bd = NULL;
+  PetscCall(VecDestroy(&ctx->cd));
   PetscCall(QPFetiAssembleDirichlet(qp));
+  PetscCall(QPFetiSetUpLocalBlocks_Private(qp));
   
   if (!ctx->l2g) SETERRQ(PetscObjectComm((PetscObject)qp),PETSC_ERR_ARG_WRONGSTATE,"L2G mapping must be set first - call QPFetiSetLocalToGlobalMapping before QPFetiSetUp");
   if (!ctx->i2g) SETERRQ(PetscObjectComm((PetscObject)qp),PETSC_ERR_ARG_WRONGSTATE,"I2G mapping must be set first - call QPFetiSetInterfaceToGlobalMapping before QPFetiSetUp");
-  PetscCall(QPFetiAssembleGluing(qp, type, exclude_dir, &Bg));
+  PetscCall(QPFetiAssembleGluing(qp, type, exclude_dir, &ctx->Bg));
   PetscCall(PetscPrintf(comm, "============\n"));
 
-  PetscCall(PetscObjectSetName((PetscObject)Bg,"Bg"));
-  PetscCall(QPAddEq(qp,Bg,NULL));
-  PetscCall(MatDestroy(&Bg));
+  PetscCall(PetscObjectSetName((PetscObject)ctx->Bg,"Bg"));
+  PetscCall(PetscObjectCompose((PetscObject)qp,"Bg",(PetscObject)ctx->Bg));
+  PetscCall(QPFetiSetEq_Private(qp, ctx, Bg_old, Bd_old));
+  PetscCall(MatDestroy(&Bg_old));
+  PetscCall(MatDestroy(&Bd_old));
 
   if (!qp->BE) printf("child (BE) is needed for dualization\n");
   ctx->setupcalled = PETSC_TRUE;
@@ -365,6 +531,39 @@ PetscErrorCode QPFetiSetUp(QP qp)
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiReassemble"
+/*@
+   QPFetiReassemble - Reassembles the FETI gluing and Dirichlet constraints of the QP, e.g. after QPFetiSetDirichlet()
+   or with a different -feti_gluing_type.
+
+   Collective on QP
+
+   Input Parameter:
+.  qp - the QP
+
+   Notes:
+   Bg and Bd assembled by the previous QPFetiSetUp() are replaced in the equality constraints of qp, other equality constraints are kept.
+   The interface analysis and communication patterns cached in the FETI context of qp are reused
+   as long as the local-to-global and interface-to-global mappings are not changed.
+   Dirichlet conditions enforced by modifying the operator (enforce_by_B = PETSC_FALSE) cannot be reassembled.
+
+   Level: advanced
+
+.seealso QPFetiSetUp(), QPFetiSetDirichlet()
+@*/
+PetscErrorCode QPFetiReassemble(QP qp)
+{
+  QPFetiCtx ctx;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qp,QP_CLASSID,1);
+  PetscCall(QPFetiGetCtx(qp,&ctx));
+  ctx->setupcalled = PETSC_FALSE;
+  PetscCall(QPFetiSetUp(qp));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPFetiGetI2Lmapping"
 PetscErrorCode QPFetiGetI2Lmapping(MPI_Comm comm, IS l2g,  IS i2g,  IS *i2l_new)
@@ -409,6 +608,84 @@ PetscErrorCode QPFetiGetI2Lmapping(MPI_Comm comm, IS l2g,  IS i2g,  IS *i2l_new)
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiGluingSetUp_Private"
+/* interface analysis independent of the gluing type and Dirichlet exclusion - the SF of interface DOFs and their multiplicities */
+static PetscErrorCode QPFetiGluingSetUp_Private(MPI_Comm comm, QPFetiCtx ctx)
+{
+  QPFetiGluing gl;
+  PetscInt     Nu, Nug;
+  const PetscInt *i2g_array, *root_degree;
+
+  PetscFunctionBegin;
+  if (ctx->gluing) PetscFunctionReturn(0);
+  PetscCall(PetscNew(&gl));
+
+  gl->i2g = ctx->i2g;
+  PetscCall(PetscObjectReference((PetscObject)ctx->i2g));
+  PetscCall(ISGetLocalSize(ctx->l2g, &gl->nl));
+
+  /* get i2l from l2g and i2g */
+  PetscCall(QPFetiGetI2Lmapping(comm, ctx->l2g, ctx->i2g, &gl->i2l));
+
+  PetscCall(ISGetMinMax(ctx->i2g,NULL,&Nu));
+  PetscCallMPI(MPI_Allreduce(&Nu, &Nug, 1, MPIU_INT, MPIU_MAX, comm));
+  gl->Nu = Nug+1;
+
+  // first SF (all nodes from i2g) /STEP 1/
+  PetscCall(ISGetLocalSize(ctx->i2g, &gl->nleaves_SF1));
+  PetscCall(ISGetIndices(ctx->i2g, &i2g_array));
+  PetscCall(PetscLayoutCreate(comm, &gl->layout_SF1));
+  PetscCall(PetscLayoutSetBlockSize(gl->layout_SF1, 1));
+  PetscCall(PetscLayoutSetSize(gl->layout_SF1, gl->Nu));
+  PetscCall(PetscLayoutSetUp(gl->layout_SF1));
+  PetscCall(PetscLayoutGetLocalSize(gl->layout_SF1, &gl->nroots_SF1));
+  PetscCall(PetscSFCreate(comm, &gl->SF1));
+  PetscCall(PetscSFSetGraphLayout(gl->SF1, gl->layout_SF1, gl->nleaves_SF1, NULL, PETSC_COPY_VALUES, i2g_array));
+  PetscCall(PetscSFSetRankOrder(gl->SF1, PETSC_TRUE));
+  PetscCall(ISRestoreIndices(ctx->i2g, &i2g_array));
+
+  // find out root's degree and send to leaves /STEP 2/
+  PetscCall(PetscMalloc3(gl->nroots_SF1, &gl->root_degree_onroots_SF1, gl->nleaves_SF1, &gl->root_degree_onleaves_SF1, gl->nroots_SF1, &gl->dirmask));
+  PetscCall(PetscSFComputeDegreeBegin(gl->SF1, &root_degree));
+  PetscCall(PetscSFComputeDegreeEnd(gl->SF1, &root_degree));
+  PetscCall(PetscArraycpy(gl->root_degree_onroots_SF1, root_degree, gl->nroots_SF1));
+  PetscCall(PetscArrayzero(gl->dirmask, gl->nroots_SF1));
+  PetscCall(PetscSFBcastBegin(gl->SF1, MPIU_INT, gl->root_degree_onroots_SF1, gl->root_degree_onleaves_SF1, MPI_REPLACE));
+  PetscCall(PetscSFBcastEnd(gl->SF1, MPIU_INT, gl->root_degree_onroots_SF1, gl->root_degree_onleaves_SF1, MPI_REPLACE));
+
+  ctx->gluing = gl;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiGluingSetDirichlet_Private"
+/* mark roots of SF1 which are Dirichlet DOFs; they are excluded from gluing as a whole since the exclusion is by global index */
+static PetscErrorCode QPFetiGluingSetDirichlet_Private(QP qp, QPFetiCtx ctx, PetscBool exclude_dir)
+{
+  QPFetiGluing   gl = ctx->gluing;
+  IS             global_dir, all_dir;
+  const PetscInt *all_dir_array;
+  PetscInt       i, n, rstart, rend;
+
+  PetscFunctionBegin;
+  PetscCall(PetscArrayzero(gl->dirmask, gl->nroots_SF1));
+  if (!exclude_dir || !ctx->dbc) PetscFunctionReturn(0);
+
+  PetscCall(QPFetiGetGlobalDir(qp, ctx->dbc->is, ctx->dbc->numtype, &global_dir));
+  PetscCall(ISAllGather(global_dir, &all_dir));
+  PetscCall(ISDestroy(&global_dir));
+  PetscCall(PetscLayoutGetRange(gl->layout_SF1, &rstart, &rend));
+  PetscCall(ISGetLocalSize(all_dir, &n));
+  PetscCall(ISGetIndices(all_dir, &all_dir_array));
+  for (i=0; i<n; i++) {
+    if (all_dir_array[i] >= rstart && all_dir_array[i] < rend) gl->dirmask[all_dir_array[i]-rstart] = PETSC_TRUE;
+  }
+  PetscCall(ISRestoreIndices(all_dir, &all_dir_array));
+  PetscCall(ISDestroy(&all_dir));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPFetiAssembleGluing"
 PetscErrorCode QPFetiAssembleGluing(QP qp, FetiGluingType type, PetscBool exclude_dir, Mat *Bg_new)
@@ -416,10 +693,6 @@ PetscErrorCode QPFetiAssembleGluing(QP qp, FetiGluingType type, PetscBool exclud
   static PetscBool registered = PETSC_FALSE;
   QPFetiCtx   ctx;
   Mat         Bgt;
-  PetscInt    nl, Nu, Nug;
-  IS          i2l, i2g_less, all_dir;
-  PetscMPIInt commsize;
-  IS          l2g, i2g, global_dir;
   MPI_Comm    comm;
 
   PetscFunctionBeginI;
@@ -431,31 +704,13 @@ PetscErrorCode QPFetiAssembleGluing(QP qp, FetiGluingType type, PetscBool exclud
 
   PetscCall(PetscObjectGetComm((PetscObject)qp,&comm));
   PetscCall(QPFetiGetCtx(qp,&ctx));
-  l2g = ctx->l2g;
-  i2g = ctx->i2g;
-  PetscCallMPI(MPI_Comm_size(comm, &commsize));  
-  PetscCall(ISGetLocalSize(l2g, &nl)); 
-  
-  if (exclude_dir) {
-    PetscCall(QPFetiGetGlobalDir( qp, ctx->dbc->is, ctx->dbc->numtype, &global_dir));
-    PetscCall(ISAllGather(global_dir, &all_dir));
-    PetscCall(ISSortRemoveDups(all_dir));
-    PetscCall(ISDifference(i2g,all_dir,&i2g_less));
-    PetscCall(ISDestroy(&global_dir));
-  } else {
-    PetscCall(PetscObjectReference((PetscObject)i2g));
-    i2g_less=i2g;
-  }     
-  
-  /* get i2l from l2g and i2g */
-  PetscCall(QPFetiGetI2Lmapping(comm, ctx->l2g, i2g_less, &i2l));
+
+  /* interface analysis is cached in ctx until l2g or i2g is changed */
+  PetscCall(QPFetiGluingSetUp_Private(comm, ctx));
+  PetscCall(QPFetiGluingSetDirichlet_Private(qp, ctx, exclude_dir));
 
   /* create Adt using SF */
-  PetscCall(ISGetMinMax(i2g_less,NULL,&Nu));
-  PetscCallMPI(MPI_Allreduce(&Nu, &Nug, 1, MPIU_INT, MPIU_MAX, comm));
-  Nu = Nug+1;
-   
-  PetscCall(QPFetiGetBgtSF(comm, i2g_less, Nu, i2l, nl, type, &Bgt));
+  PetscCall(QPFetiGetBgtSF(comm, ctx->gluing, type, &Bgt));
 
   PetscCall(PetscObjectSetName((PetscObject)Bgt,"Bgt"));
 
@@ -463,8 +718,6 @@ PetscErrorCode QPFetiAssembleGluing(QP qp, FetiGluingType type, PetscBool exclud
   PetscCall(MatCreateTranspose(Bgt,Bg_new));
   PetscCall(PetscObjectSetName((PetscObject)*Bg_new,"Bg"));
 
-  PetscCall(ISDestroy(&i2l));
-  PetscCall(ISDestroy(&i2g_less));
   PetscCall(MatDestroy(&Bgt));
 
   PetscCall(PetscLogEventEnd(QP_Feti_AssemGluing,0,0,0,0));
@@ -472,73 +725,56 @@ PetscErrorCode QPFetiAssembleGluing(QP qp, FetiGluingType type, PetscBool exclud
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPFetiGetBgtSF"
-PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscInt nl, FetiGluingType type, Mat *Bgt_out)
+#define __FUNCT__ "QPFetiGluingPatternSetUp_Private"
+/* links between interface DOFs for the given gluing type and Dirichlet exclusion; reused if neither has changed */
+static PetscErrorCode QPFetiGluingPatternSetUp_Private(MPI_Comm comm, QPFetiGluing gl, FetiGluingType type)
 {
-  static PetscBool registered = PETSC_FALSE;
-  Mat         At, Bgt;
+  QPFetiGluingPattern *pat = &gl->pattern[type];
   PetscMPIInt commsize, rank;
+  PetscBool   same;
   PetscInt    i, j, k, idx, idx2, data_scat_size, rstart, rend;
-  PetscInt    nleaves_SF1, nroots_SF1, n_link=0, nleaves_SF2=0, nleaves_SF2_unique=0;
-  const  PetscInt *i2g_array, *i2l_array, *root_degree_onroots_SF1, *root_degree_onroots_SF2;
-  PetscInt    *root_degree_onleaves_SF1, *future_leavesSF2_onleaves, *future_leavesSF2_onroots;
-  PetscInt    *leaves_SF2, *local_idx, *condensed_local_idx, *root_degree_onleaves_fromSF1onSF2, *ris_array;
-  PetscInt    *link_onroot, *link_onleaves, *division, *max_rank_onroot_linkSF, *max_rank_onleaves_linkSF;
-  PetscInt    *prealloc_seqEX; // for Extension type
-  PetscInt    *prealloc_diag, *prealloc_ofdiag, *prealloc_seq; // only for notExtension type
-  PetscReal   *values;
-  PetscLayout layout_SF1, links;
-  PetscSF SF1, SF2, link_SF;
-  IS myneighbors;
+  PetscInt    nroots_SF1 = gl->nroots_SF1, nleaves_SF1 = gl->nleaves_SF1, n_link=0, nleaves_SF2=0, nleaves_SF2_unique=0;
+  const  PetscInt *i2g_array, *i2l_array, *root_degree_onroots_SF2;
+  PetscInt    *root_degree_onroots_SF1, *future_leavesSF2_onleaves, *future_leavesSF2_onroots;
+  PetscInt    *leaves_SF2, *link_onroot, *max_rank_onroot_linkSF;
+  PetscLayout links;
+  PetscSF     SF2;
 
-  PetscFunctionBeginI;
-  if (!registered) {
-    PetscCall(PetscLogEventRegister("QPFetiGetBgtSF",QP_CLASSID,&QP_Feti_GetBgtSF));
-    registered = PETSC_TRUE;
+  PetscFunctionBegin;
+  if (pat->valid) {
+    PetscCall(PetscArraycmp(pat->dirmask, gl->dirmask, nroots_SF1, &same));
+    PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE, &same, 1, MPIU_BOOL, MPI_LAND, comm));
+    if (same) PetscFunctionReturn(0);
   }
-  PetscCall(PetscLogEventBegin(QP_Feti_GetBgtSF,0,0,0,0)); 
+  PetscCall(QPFetiGluingPatternReset_Private(pat));
+  PetscCall(PetscMalloc1(nroots_SF1, &pat->dirmask));
+  PetscCall(PetscArraycpy(pat->dirmask, gl->dirmask, nroots_SF1));
 
   PetscCallMPI(MPI_Comm_size(comm, &commsize));
   PetscCallMPI(MPI_Comm_rank(comm, &rank));
+  PetscCall(ISGetIndices(gl->i2g, &i2g_array));
+  PetscCall(ISGetIndices(gl->i2l, &i2l_array));
 
-  // first SF (all nodes from i2g) /STEP 1/
-  PetscCall(ISGetLocalSize(i2g, &nleaves_SF1));
-  PetscCall(ISGetIndices(i2g, &i2g_array));
-  PetscCall(ISGetIndices(i2l, &i2l_array));
-
-  PetscCall(PetscLayoutCreate(comm, &layout_SF1));
-  PetscCall(PetscLayoutSetBlockSize(layout_SF1, 1));
-  PetscCall(PetscLayoutSetSize(layout_SF1, Nu));
-  PetscCall(PetscLayoutSetUp(layout_SF1));
-  PetscCall(PetscSFCreate(comm, &SF1));
-  PetscCall(PetscLayoutGetLocalSize(layout_SF1, &nroots_SF1));
-  PetscCall(PetscSFSetGraphLayout(SF1, layout_SF1, nleaves_SF1, NULL, PETSC_COPY_VALUES, i2g_array));
-  PetscCall(PetscSFSetRankOrder(SF1, PETSC_TRUE));
+  // root's degree with Dirichlet roots excluded
+  PetscCall(PetscMalloc1(nroots_SF1, &root_degree_onroots_SF1));
+  for (i=0; i<nroots_SF1; i++) root_degree_onroots_SF1[i] = gl->dirmask[i] ? 0 : gl->root_degree_onroots_SF1[i];
 
-  // find out root's degree and send to leaves /STEP 2/
-  PetscCall(PetscSFComputeDegreeBegin(SF1, &root_degree_onroots_SF1));
-  // work between communication   
-  PetscCall(PetscMalloc2( nleaves_SF1, &root_degree_onleaves_SF1, nleaves_SF1, &future_leavesSF2_onleaves));
-  for (i=0; i<nleaves_SF1; i++) {
-    root_degree_onleaves_SF1[i] = -1;
-    future_leavesSF2_onleaves[i] = -1;
-  }
-  PetscCall(PetscSFComputeDegreeEnd(SF1, &root_degree_onroots_SF1));
-
-  PetscCall(PetscSFBcastBegin(SF1, MPIU_INT, root_degree_onroots_SF1, root_degree_onleaves_SF1, MPI_REPLACE));
-  // work between communication  
-  // scatter - how much i will sent? 
+  // scatter - how much i will sent?
   for (i=0, data_scat_size=0; i<nroots_SF1; i++) {
-    data_scat_size += root_degree_onroots_SF1[i];
+    data_scat_size += gl->root_degree_onroots_SF1[i];
   }
-  PetscCall(PetscMalloc1( data_scat_size, &future_leavesSF2_onroots));
+  PetscCall(PetscMalloc1(data_scat_size, &future_leavesSF2_onroots));
+  PetscCall(PetscMalloc1(nleaves_SF1, &future_leavesSF2_onleaves));
+  for (i=0; i<nleaves_SF1; i++) future_leavesSF2_onleaves[i] = -1;
 
   // what I will scatter? different multiplicity of leaf for full/non-redundant or orthonormal   /STEP 2 continues/
   idx=0;
   for (i=0; i<nroots_SF1; i++) {
-    if (root_degree_onroots_SF1[i] == 1) { //leaves with degree==1 will be deleted (degree==0 dont exist)
-      future_leavesSF2_onroots[idx] = 0;
-      idx++;
+    if (root_degree_onroots_SF1[i] <= 1) { //leaves with degree==1 and excluded Dirichlet leaves will be deleted
+      for (j=0; j<gl->root_degree_onroots_SF1[i]; j++) {
+        future_leavesSF2_onroots[idx] = 0;
+        idx++;
+      }
     } else if (root_degree_onroots_SF1[i]==2) { //leaves with degree==2, are not multiplied for all type 
       future_leavesSF2_onroots[idx] = 1;
       future_leavesSF2_onroots[idx+1] = 1;
@@ -573,9 +809,8 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
       }
     }
   }
-  PetscCall(PetscSFBcastEnd(SF1, MPIU_INT, root_degree_onroots_SF1, root_degree_onleaves_SF1, MPI_REPLACE));
   // scatter itself /STEP 3/
-  PetscCall(PetscSFScatterBegin(SF1, MPIU_INT, future_leavesSF2_onroots, future_leavesSF2_onleaves));
+  PetscCall(PetscSFScatterBegin(gl->SF1, MPIU_INT, future_leavesSF2_onroots, future_leavesSF2_onleaves));
   // work between communication
   // find out actual number of links on processor /STEP 4/
   for (i=0; i<nroots_SF1; i++) {
@@ -600,7 +835,7 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
   PetscCall(PetscLayoutSetLocalSize(links, n_link));
   PetscCall(PetscLayoutSetUp(links));
   PetscCall(PetscLayoutGetRange(links, &rstart, NULL));
-  PetscCall(PetscSFScatterEnd(SF1, MPIU_INT, future_leavesSF2_onroots, future_leavesSF2_onleaves));
+  PetscCall(PetscSFScatterEnd(gl->SF1, MPIU_INT, future_leavesSF2_onroots, future_leavesSF2_onleaves));
 
   // "make" leaves for SF2, create local indexes  /STEP 5/
   for (i=0; i<nleaves_SF1; i++) {
@@ -608,30 +843,33 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     if (future_leavesSF2_onleaves[i]>0) nleaves_SF2_unique++;
   }
 
-  PetscCall(PetscMalloc4(nleaves_SF2, &leaves_SF2, nleaves_SF2, &local_idx, nleaves_SF2, &condensed_local_idx, nleaves_SF2, &root_degree_onleaves_fromSF1onSF2));
-  PetscCall(PetscMalloc1(nleaves_SF2_unique, &ris_array));
-  PetscCall(PetscMalloc1(nleaves_SF2_unique, &prealloc_seqEX));
+  PetscCall(PetscMalloc1(nleaves_SF2, &leaves_SF2));
+  PetscCall(PetscMalloc1(nleaves_SF2, &pat->local_idx));
+  PetscCall(PetscMalloc1(nleaves_SF2, &pat->condensed_local_idx));
+  PetscCall(PetscMalloc1(nleaves_SF2, &pat->root_degree_onleaves_fromSF1onSF2));
+  PetscCall(PetscMalloc1(nleaves_SF2_unique, &pat->ris_array));
+  PetscCall(PetscMalloc1(nleaves_SF2_unique, &pat->prealloc_seqEX));
 
   for (i=0, idx=0, idx2=0; i<nleaves_SF1; i++) {
     for (j=0; j<future_leavesSF2_onleaves[i]; j++) {
       if (j==0) {
-        ris_array[idx2]=i2l_array[i];
+        pat->ris_array[idx2]=i2l_array[i];
       }
       leaves_SF2[idx]=i2g_array[i];
-      local_idx[idx]=i;
-      condensed_local_idx[idx]=idx2;
-      root_degree_onleaves_fromSF1onSF2[idx]=root_degree_onleaves_SF1[i];
+      pat->local_idx[idx]=i;
+      pat->condensed_local_idx[idx]=idx2;
+      pat->root_degree_onleaves_fromSF1onSF2[idx]=gl->root_degree_onleaves_SF1[i];
       idx++;
     }
     if (future_leavesSF2_onleaves[i]!=0) {
-      prealloc_seqEX[idx2]=future_leavesSF2_onleaves[i];
+      pat->prealloc_seqEX[idx2]=future_leavesSF2_onleaves[i];
       idx2++;
     }
   }
 
   // second SF with same layout
   PetscCall(PetscSFCreate(comm, &SF2));
-  PetscCall(PetscSFSetGraphLayout(SF2, layout_SF1, nleaves_SF2, NULL, PETSC_COPY_VALUES, leaves_SF2));
+  PetscCall(PetscSFSetGraphLayout(SF2, gl->layout_SF1, nleaves_SF2, NULL, PETSC_COPY_VALUES, leaves_SF2));
   PetscCall(PetscSFSetRankOrder(SF2, PETSC_TRUE));
 
   // scatter links /STEP 6/
@@ -643,8 +881,8 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     data_scat_size += root_degree_onroots_SF2[i];
   }
   PetscCall(PetscMalloc1(data_scat_size, &link_onroot));
-  PetscCall(PetscMalloc1(nleaves_SF2, &link_onleaves));
-  for (i=0; i<nleaves_SF2; i++) link_onleaves[i] = -1;
+  PetscCall(PetscMalloc1(nleaves_SF2, &pat->link_onleaves));
+  for (i=0; i<nleaves_SF2; i++) pat->link_onleaves[i] = -1;
 
   // what I will sent?  
   idx2=rstart;
@@ -698,7 +936,7 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     }
   } 
 
-  PetscCall(PetscSFScatterBegin(SF2, MPIU_INT, link_onroot, link_onleaves));
+  PetscCall(PetscSFScatterBegin(SF2, MPIU_INT, link_onroot, pat->link_onleaves));
   // work between communication  
   // new layout for links 
   PetscCall(PetscLayoutGetSize(links, &n_link));
@@ -708,72 +946,67 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
   PetscCall(PetscLayoutSetSize(links, n_link));
   PetscCall(PetscLayoutSetUp(links));
   // compute divison - only orthonormal /STEP 6.5/  
-  PetscCall(PetscMalloc1(nleaves_SF2, &division));
+  PetscCall(PetscMalloc1(nleaves_SF2, &pat->division));
   if (type == FETI_GLUING_ORTH) {
     j=0;
     for (i=0; i<nleaves_SF2; i++) {
       if (j==0) { 
-        division[i] = root_degree_onleaves_fromSF1onSF2[i]-1;
-        if (root_degree_onleaves_fromSF1onSF2[i]>2) {
-          j=root_degree_onleaves_fromSF1onSF2[i]-2;
+        pat->division[i] = pat->root_degree_onleaves_fromSF1onSF2[i]-1;
+        if (pat->root_degree_onleaves_fromSF1onSF2[i]>2) {
+          j=pat->root_degree_onleaves_fromSF1onSF2[i]-2;
         }
       } else if (j>=1) {
 
         if (leaves_SF2[i]==leaves_SF2[i-1]) {
-          division[i] = j;
+          pat->division[i] = j;
           j--;
         } else {
-          division[i] = root_degree_onleaves_fromSF1onSF2[i]-1;
-          if (root_degree_onleaves_fromSF1onSF2[i]>2) {
-            j=root_degree_onleaves_fromSF1onSF2[i]-2;
+          pat->division[i] = pat->root_degree_onleaves_fromSF1onSF2[i]-1;
+          if (pat->root_degree_onleaves_fromSF1onSF2[i]>2) {
+            j=pat->root_degree_onleaves_fromSF1onSF2[i]-2;
           }
         }
       }
     }
   }
-  PetscCall(PetscSFScatterEnd(SF2, MPIU_INT, link_onroot, link_onleaves));
-  PetscCall(PetscSortInt( nleaves_SF2, link_onleaves));
+  PetscCall(PetscSFScatterEnd(SF2, MPIU_INT, link_onroot, pat->link_onleaves));
+  PetscCall(PetscSortInt( nleaves_SF2, pat->link_onleaves));
   // link SF /STEP 7/
-  PetscCall(PetscSFCreate(comm, &link_SF));
-  PetscCall(PetscSFSetGraphLayout(link_SF, links, nleaves_SF2, NULL, PETSC_COPY_VALUES, link_onleaves));
-  PetscCall(PetscSFSetRankOrder(link_SF, PETSC_TRUE));
+  PetscCall(PetscSFCreate(comm, &pat->link_SF));
+  PetscCall(PetscSFSetGraphLayout(pat->link_SF, links, nleaves_SF2, NULL, PETSC_COPY_VALUES, pat->link_onleaves));
+  PetscCall(PetscSFSetRankOrder(pat->link_SF, PETSC_TRUE));
 
   //get max ranks of leaves (find out if + or -) /STEP 8/
-  PetscCall(PetscMalloc2(n_link, &max_rank_onroot_linkSF, nleaves_SF2, &max_rank_onleaves_linkSF));
+  PetscCall(PetscMalloc1(n_link, &max_rank_onroot_linkSF));
+  PetscCall(PetscMalloc1(nleaves_SF2, &pat->max_rank_onleaves_linkSF));
   for (i=0; i<n_link; i++) max_rank_onroot_linkSF[i] = -1;
-  for (i=0; i<nleaves_SF2; i++) max_rank_onleaves_linkSF[i] = rank;
+  for (i=0; i<nleaves_SF2; i++) pat->max_rank_onleaves_linkSF[i] = rank;
 
-  PetscCall(PetscSFReduceBegin(link_SF, MPIU_INT, max_rank_onleaves_linkSF, max_rank_onroot_linkSF, MPIU_MAX));
+  PetscCall(PetscSFReduceBegin(pat->link_SF, MPIU_INT, pat->max_rank_onleaves_linkSF, max_rank_onroot_linkSF, MPIU_MAX));
   // work between communication  
   PetscCall(PetscLayoutGetRange(links, &rstart, &rend));
   PetscCall(PetscLayoutGetLocalSize(links, &n_link));
-  PetscCall(PetscMalloc3(nleaves_SF1, &prealloc_diag, nleaves_SF1, &prealloc_ofdiag, nleaves_SF1, &prealloc_seq));
+  PetscCall(PetscMalloc3(nleaves_SF1, &pat->prealloc_diag, nleaves_SF1, &pat->prealloc_ofdiag, nleaves_SF1, &pat->prealloc_seq));
   for (i=0; i<nleaves_SF1; i++) {
-    prealloc_diag[i] = 0;
-    prealloc_ofdiag[i] = 0;
-    prealloc_seq[i] = 0;
+    pat->prealloc_diag[i] = 0;
+    pat->prealloc_ofdiag[i] = 0;
+    pat->prealloc_seq[i] = 0;
   }
-  PetscCall(PetscSFReduceEnd(link_SF, MPIU_INT, max_rank_onleaves_linkSF, max_rank_onroot_linkSF, MPIU_MAX));
+  PetscCall(PetscSFReduceEnd(pat->link_SF, MPIU_INT, pat->max_rank_onleaves_linkSF, max_rank_onroot_linkSF, MPIU_MAX));
 
-  PetscCall(PetscSFBcastBegin(link_SF, MPIU_INT, max_rank_onroot_linkSF, max_rank_onleaves_linkSF, MPI_REPLACE));
+  PetscCall(PetscSFBcastBegin(pat->link_SF, MPIU_INT, max_rank_onroot_linkSF, pat->max_rank_onleaves_linkSF, MPI_REPLACE));
   // work between communication  
   // get preallocation pattern 
   for (i=0; i<nleaves_SF2; i++) {
-    if (link_onleaves[i]>=rstart && link_onleaves[i]<rend) {
-      prealloc_diag[local_idx[i]]++;
-      prealloc_seq[local_idx[i]]++;
+    if (pat->link_onleaves[i]>=rstart && pat->link_onleaves[i]<rend) {
+      pat->prealloc_diag[pat->local_idx[i]]++;
+      pat->prealloc_seq[pat->local_idx[i]]++;
     } else {
-      prealloc_ofdiag[local_idx[i]]++;
-      prealloc_seq[local_idx[i]]++;
+      pat->prealloc_ofdiag[pat->local_idx[i]]++;
+      pat->prealloc_seq[pat->local_idx[i]]++;
     }
   }
-  PetscCall(PetscMalloc1(nleaves_SF2, &values));
-
-  PetscCall(PetscSFBcastEnd(link_SF, MPIU_INT, max_rank_onroot_linkSF, max_rank_onleaves_linkSF, MPI_REPLACE));
-
-  PetscBool flg_SCALE_ON=PETSC_TRUE;
-  PetscCall(PetscOptionsGetBool(NULL,NULL,"-SCALE_ON",&flg_SCALE_ON,NULL));
-  if (flg_SCALE_ON && (type==FETI_GLUING_NONRED || type==FETI_GLUING_FULL)) PetscCall(PetscPrintf(PETSC_COMM_WORLD," SCALING\n"));
+  PetscCall(PetscSFBcastEnd(pat->link_SF, MPIU_INT, max_rank_onroot_linkSF, pat->max_rank_onleaves_linkSF, MPI_REPLACE));
 
 /* compose array of neighbors to Bg */
   {
@@ -786,58 +1019,105 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     for (i=0; i<nleaves_SF2; i++) rank_onleaves_linkSF[i] = rank;
     for (i=nleaves_SF2; i<2*nleaves_SF2; i++) rank_onleaves_linkSF[i] = commsize;
 
-    PetscCall(PetscSFReduceBegin(link_SF, MPIU_INT, rank_onleaves_linkSF, rank_onroot_linkSF, MPIU_MIN));
-    PetscCall(PetscSFReduceEnd(link_SF, MPIU_INT, rank_onleaves_linkSF, rank_onroot_linkSF, MPIU_MIN));
-    PetscCall(PetscSFBcastBegin(link_SF, MPIU_INT, rank_onroot_linkSF, rank_onleaves_linkSF, MPI_REPLACE));
-    PetscCall(PetscSFBcastEnd(link_SF, MPIU_INT, rank_onroot_linkSF, rank_onleaves_linkSF, MPI_REPLACE));
-    PetscCall(PetscMemcpy(&rank_onleaves_linkSF[nleaves_SF2],max_rank_onleaves_linkSF,nleaves_SF2*sizeof(PetscInt)));
+    PetscCall(PetscSFReduceBegin(pat->link_SF, MPIU_INT, rank_onleaves_linkSF, rank_onroot_linkSF, MPIU_MIN));
+    PetscCall(PetscSFReduceEnd(pat->link_SF, MPIU_INT, rank_onleaves_linkSF, rank_onroot_linkSF, MPIU_MIN));
+    PetscCall(PetscSFBcastBegin(pat->link_SF, MPIU_INT, rank_onroot_linkSF, rank_onleaves_linkSF, MPI_REPLACE));
+    PetscCall(PetscSFBcastEnd(pat->link_SF, MPIU_INT, rank_onroot_linkSF, rank_onleaves_linkSF, MPI_REPLACE));
+    PetscCall(PetscMemcpy(&rank_onleaves_linkSF[nleaves_SF2],pat->max_rank_onleaves_linkSF,nleaves_SF2*sizeof(PetscInt)));
     n = 2*nleaves_SF2;
     PetscCall(PetscSortRemoveDupsInt(&n,rank_onleaves_linkSF));
-    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,n,rank_onleaves_linkSF,PETSC_COPY_VALUES,&myneighbors));
+    PetscCall(ISCreateGeneral(PETSC_COMM_SELF,n,rank_onleaves_linkSF,PETSC_COPY_VALUES,&pat->myneighbors));
 
     PetscCall(PetscFree(rank_onleaves_linkSF));
     PetscCall(PetscFree(rank_onroot_linkSF));
   }
 
+  pat->nleaves_SF2 = nleaves_SF2;
+  pat->nleaves_SF2_unique = nleaves_SF2_unique;
+  pat->n_link = n_link;
+  pat->valid = PETSC_TRUE;
+
+  PetscCall(ISRestoreIndices(gl->i2l, &i2l_array));
+  PetscCall(ISRestoreIndices(gl->i2g, &i2g_array));
+  PetscCall(PetscFree(root_degree_onroots_SF1));
+  PetscCall(PetscFree(future_leavesSF2_onroots));
+  PetscCall(PetscFree(future_leavesSF2_onleaves));
+  PetscCall(PetscFree(leaves_SF2));
+  PetscCall(PetscFree(link_onroot));
+  PetscCall(PetscFree(max_rank_onroot_linkSF));
+  PetscCall(PetscSFDestroy(&SF2));
+  PetscCall(PetscLayoutDestroy(&links));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPFetiGetBgtSF"
+PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, QPFetiGluing gl, FetiGluingType type, Mat *Bgt_out)
+{
+  static PetscBool registered = PETSC_FALSE;
+  QPFetiGluingPattern *pat;
+  Mat         At, Bgt;
+  PetscMPIInt rank;
+  PetscInt    i, idx, idx2, nleaves_SF2, n_link;
+  PetscReal   *values;
+
+  PetscFunctionBeginI;
+  if (!registered) {
+    PetscCall(PetscLogEventRegister("QPFetiGetBgtSF",QP_CLASSID,&QP_Feti_GetBgtSF));
+    registered = PETSC_TRUE;
+  }
+  PetscCall(PetscLogEventBegin(QP_Feti_GetBgtSF,0,0,0,0)); 
+
+  PetscCallMPI(MPI_Comm_rank(comm, &rank));
+
+  /* SF graphs and preallocation are rebuilt only if the gluing type is used for the first time or the Dirichlet exclusion has changed */
+  PetscCall(QPFetiGluingPatternSetUp_Private(comm, gl, type));
+  pat = &gl->pattern[type];
+  nleaves_SF2 = pat->nleaves_SF2;
+  n_link = pat->n_link;
+  PetscCall(PetscMalloc1(nleaves_SF2, &values));
+
+  PetscBool flg_SCALE_ON=PETSC_TRUE;
+  PetscCall(PetscOptionsGetBool(NULL,NULL,"-SCALE_ON",&flg_SCALE_ON,NULL));
+  if (flg_SCALE_ON && (type==FETI_GLUING_NONRED || type==FETI_GLUING_FULL)) PetscCall(PetscPrintf(PETSC_COMM_WORLD," SCALING\n"));
+
   //get values
   PetscReal x;
   switch ( type ) {
     case FETI_GLUING_NONRED:
       for (i=0; i<nleaves_SF2; i++) {
-        if (max_rank_onleaves_linkSF[i]==rank) {
+        if (pat->max_rank_onleaves_linkSF[i]==rank) {
           values[i] = -1.0;
         } else {
           values[i] = 1.0;
         }
-        if (flg_SCALE_ON) values[i] *= (1.0 / PetscSqrtReal((PetscReal)root_degree_onleaves_fromSF1onSF2[i]));
+        if (flg_SCALE_ON) values[i] *= (1.0 / PetscSqrtReal((PetscReal)pat->root_degree_onleaves_fromSF1onSF2[i]));
       }
       break;
     case FETI_GLUING_FULL:
       for (i=0; i<nleaves_SF2; i++) {
-        if (max_rank_onleaves_linkSF[i]==rank) {
+        if (pat->max_rank_onleaves_linkSF[i]==rank) {
           values[i] = -1.0;
         } else {
           values[i] = 1.0;
         }
-        if (flg_SCALE_ON) values[i] *= (1.0 / PetscSqrtReal((PetscReal)root_degree_onleaves_fromSF1onSF2[i]));
+        if (flg_SCALE_ON) values[i] *= (1.0 / PetscSqrtReal((PetscReal)pat->root_degree_onleaves_fromSF1onSF2[i]));
       }
       break;
     case FETI_GLUING_ORTH:
       for (i=0; i<nleaves_SF2; i++) {
-        if (max_rank_onleaves_linkSF[i]==rank) {
+        if (pat->max_rank_onleaves_linkSF[i]==rank) {
           values[i] = -1.0;
         } else {
-          values[i] = 1.0/(PetscReal)division[i];
+          values[i] = 1.0/(PetscReal)pat->division[i];
         }
-        x = 1.0/(PetscReal)division[i] + 1.0;
+        x = 1.0/(PetscReal)pat->division[i] + 1.0;
         values[i]/=sqrt(x);
       }
       break;
     default: SETERRQ(comm,PETSC_ERR_PLIB,"Unknown FETI gluing type");
   }
 
-  PetscCall(ISRestoreIndices(i2l, &i2l_array));
-  PetscCall(ISRestoreIndices(i2g, &i2g_array));
   PetscBool flg_EXTENSION_ON=PETSC_TRUE;
   PetscBool flg_MATGLUING_ON=PETSC_FALSE;
 
@@ -848,44 +1128,41 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     IS cis, ris;
     PetscCall(PetscPrintf(PETSC_COMM_WORLD," MATEXTENSION type used for gluing matrix\n"));
 
-    PetscCall(MatCreateSeqAIJ(PETSC_COMM_SELF, nleaves_SF2_unique, nleaves_SF2, -1, prealloc_seqEX, &At));
+    PetscCall(MatCreateSeqAIJ(PETSC_COMM_SELF, pat->nleaves_SF2_unique, nleaves_SF2, -1, pat->prealloc_seqEX, &At));
     PetscCall(MatSetFromOptions(At));
-    for (i=0; i<nleaves_SF2; i++)  PetscCall(MatSetValue(At, condensed_local_idx[i], i, values[i], INSERT_VALUES));
+    for (i=0; i<nleaves_SF2; i++)  PetscCall(MatSetValue(At, pat->condensed_local_idx[i], i, values[i], INSERT_VALUES));
 
     PetscCall(MatAssemblyBegin(At, MAT_FINAL_ASSEMBLY));
     PetscCall(MatAssemblyEnd(At, MAT_FINAL_ASSEMBLY));
 
     PetscCall(PetscObjectSetName((PetscObject)At, "Bgt_cond"));
 
-    PetscCall(ISCreateGeneral(comm, nleaves_SF2, link_onleaves, PETSC_OWN_POINTER, &cis));
-    PetscCall(ISCreateGeneral(comm, nleaves_SF2_unique, ris_array, PETSC_OWN_POINTER, &ris));
+    PetscCall(ISCreateGeneral(comm, nleaves_SF2, pat->link_onleaves, PETSC_COPY_VALUES, &cis));
+    PetscCall(ISCreateGeneral(comm, pat->nleaves_SF2_unique, pat->ris_array, PETSC_COPY_VALUES, &ris));
 
-    PetscCall(MatCreateExtension(comm, nl, n_link, PETSC_DECIDE, PETSC_DECIDE, At, ris, PETSC_FALSE, cis, &Bgt));
+    PetscCall(MatCreateExtension(comm, gl->nl, n_link, PETSC_DECIDE, PETSC_DECIDE, At, ris, PETSC_FALSE, cis, &Bgt));
     PetscCall(MatDestroy(&At));
     PetscCall(ISDestroy(&cis));
     PetscCall(ISDestroy(&ris));
 
   } else {
-    //TODO allocate this array only if needed
-    PetscCall(PetscFree(ris_array));
-
     if (!flg_MATGLUING_ON) {
       PetscCall(PetscPrintf(PETSC_COMM_WORLD," just PetscSF (no special type) used for gluing matrix\n"));
 
       PetscCall(MatCreate(comm, &At ));
-      PetscCall(MatSetSizes(At, nleaves_SF1, n_link,  PETSC_DETERMINE, PETSC_DETERMINE ));
+      PetscCall(MatSetSizes(At, gl->nleaves_SF1, n_link,  PETSC_DETERMINE, PETSC_DETERMINE ));
       PetscCall(MatSetFromOptions(At));
-      PetscCall(MatMPIAIJSetPreallocation(At , 0, prealloc_diag, 0, prealloc_ofdiag));
-      PetscCall(MatSeqAIJSetPreallocation(At, 0, prealloc_seq));
+      PetscCall(MatMPIAIJSetPreallocation(At , 0, pat->prealloc_diag, 0, pat->prealloc_ofdiag));
+      PetscCall(MatSeqAIJSetPreallocation(At, 0, pat->prealloc_seq));
 
       PetscCall(MatGetOwnershipRange(At,  &idx, &idx2));
-      for (i=0; i<nleaves_SF2; i++)  PetscCall(MatSetValue(At, local_idx[i]+idx, link_onleaves[i], values[i], INSERT_VALUES));
+      for (i=0; i<nleaves_SF2; i++)  PetscCall(MatSetValue(At, pat->local_idx[i]+idx, pat->link_onleaves[i], values[i], INSERT_VALUES));
 
       PetscCall(MatAssemblyBegin(At, MAT_FINAL_ASSEMBLY));
       PetscCall(MatAssemblyEnd(At, MAT_FINAL_ASSEMBLY));
     } else {
       PetscCall(PetscPrintf(PETSC_COMM_WORLD," MATGLUING type used for gluing matrix\n"));
-      PetscCall(MatCreateGluing(comm, nleaves_SF1,  nleaves_SF2_unique,  n_link,  local_idx, values, link_SF, &At));
+      PetscCall(MatCreateGluing(comm, gl->nleaves_SF1,  pat->nleaves_SF2_unique,  n_link,  pat->local_idx, values, pat->link_SF, &At));
     }
 
     Mat T_loc, T;
@@ -893,11 +1170,11 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     Vec n_vec, N_vec;
     PetscInt ni;
 
-    PetscCall(ISGetLocalSize(i2l,&ni));
+    PetscCall(ISGetLocalSize(gl->i2l,&ni));
 
     PetscCall(VecCreateSeq(PETSC_COMM_SELF, ni, &n_vec));
-    PetscCall(VecCreateSeq(PETSC_COMM_SELF, nl, &N_vec));
-    PetscCall(VecScatterCreate(n_vec, NULL, N_vec, i2l, &scatter));
+    PetscCall(VecCreateSeq(PETSC_COMM_SELF, gl->nl, &N_vec));
+    PetscCall(VecScatterCreate(n_vec, NULL, N_vec, gl->i2l, &scatter));
     PetscCall(MatCreateScatter(PETSC_COMM_SELF, scatter, &T_loc));
     PetscCall(MatCreateBlockDiag(comm, T_loc, &T));
 
@@ -908,7 +1185,6 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     PetscCall(PetscObjectCompose((PetscObject)Bgt, "T_loc", (PetscObject)T_loc));
     PetscCall(PetscObjectCompose((PetscObject)Bgt, "Adt", (PetscObject)At));
 
-    PetscCall(PetscFree(link_onleaves));
     PetscCall(MatDestroy(&At));
     PetscCall(MatDestroy(&T_loc));
     PetscCall(MatDestroy(&T));
@@ -917,24 +1193,10 @@ PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscI
     PetscCall(VecDestroy(&N_vec));
   }
 
-  PetscCall(PetscObjectCompose((PetscObject)Bgt,"myneighbors",(PetscObject)myneighbors));
-  PetscCall(ISDestroy(&myneighbors));
+  PetscCall(PetscObjectCompose((PetscObject)Bgt,"myneighbors",(PetscObject)pat->myneighbors));
   *Bgt_out=Bgt;
 
-  PetscCall(PetscFree2( root_degree_onleaves_SF1, future_leavesSF2_onleaves));
-  PetscCall(PetscFree(future_leavesSF2_onroots));
-  PetscCall(PetscFree(prealloc_seqEX));
-  PetscCall(PetscFree(link_onroot));
-  PetscCall(PetscFree(division));
-  PetscCall(PetscFree4(leaves_SF2, local_idx, condensed_local_idx, root_degree_onleaves_fromSF1onSF2));
-  PetscCall(PetscFree3(prealloc_diag, prealloc_ofdiag, prealloc_seq)); 
   PetscCall(PetscFree(values));
-  PetscCall(PetscFree2(max_rank_onroot_linkSF, max_rank_onleaves_linkSF));
-  PetscCall(PetscSFDestroy(&SF1));
-  PetscCall(PetscSFDestroy(&SF2));
-  PetscCall(PetscSFDestroy(&link_SF));
-  PetscCall(PetscLayoutDestroy(&layout_SF1));
-  PetscCall(PetscLayoutDestroy(&links));
 
   PetscCall(PetscLogEventEnd(QP_Feti_GetBgtSF,0,0,0,0));
   PetscFunctionReturnI(0);
@@ -2,6 +2,7 @@
 #define	__QPFETIIMPL_H
 #include <permon/private/qpimpl.h>
 #include <permonqpfeti.h>
+#include <petscsf.h>
 
 typedef struct _n_QPFetiDirichlet *QPFetiDirichlet;
 struct _n_QPFetiDirichlet {
@@ -10,14 +11,44 @@ struct _n_QPFetiDirichlet {
   PetscBool enforce_by_B;
 };
 
+/* communication pattern of B for one gluing type, valid for the Dirichlet exclusion dirmask */
+typedef struct {
+  PetscBool   valid;
+  PetscBool   *dirmask;
+  PetscInt    nleaves_SF2, nleaves_SF2_unique, n_link;
+  PetscInt    *local_idx, *condensed_local_idx, *root_degree_onleaves_fromSF1onSF2;
+  PetscInt    *ris_array, *prealloc_seqEX, *link_onleaves, *division, *max_rank_onleaves_linkSF;
+  PetscInt    *prealloc_diag, *prealloc_ofdiag, *prealloc_seq;
+  PetscSF     link_SF;
+  IS          myneighbors;
+} QPFetiGluingPattern;
+
+/* interface analysis reused by all assemblies of B with the same l2g and i2g */
+typedef struct _n_QPFetiGluing *QPFetiGluing;
+struct _n_QPFetiGluing {
+  IS          i2g, i2l;
+  PetscInt    Nu, nl, nleaves_SF1, nroots_SF1;
+  PetscLayout layout_SF1;
+  PetscSF     SF1;
+  PetscInt    *root_degree_onroots_SF1, *root_degree_onleaves_SF1;
+  PetscBool   *dirmask;                   /* roots excluded from gluing as Dirichlet DOFs */
+  QPFetiGluingPattern pattern[3];         /* indexed by FetiGluingType */
+};
+
 typedef struct _n_QPFetiCtx *QPFetiCtx;
 struct _n_QPFetiCtx {
   /* gluing data */
   IS i2g, l2g;
   ISLocalToGlobalMapping i2g_map, l2g_map;
+  QPFetiGluing gluing;
   
   /* Dirichlet B.C. */
   QPFetiDirichlet dbc;
+  PetscBool dir_in_A;             /* Dirichlet B.C. enforced by modifying the operator, cannot be reassembled */
+
+  /* blocks placed into qp->BE by QPFetiSetUp(), replaced on reassembly */
+  Mat Bg, Bd;
+  Vec cd;
 
   PetscBool setupcalled;
 };
@@ -36,7 +67,7 @@ FLLOP_INTERN PetscErrorCode QPFetiDirichletDestroy(QPFetiDirichlet *dbc);
 FLLOP_INTERN PetscErrorCode QPFetiCreateMapMatrix(MPI_Comm comm, PetscInt Nu, PetscInt ni, PetscInt mm_size, IS i2g, Mat *MapMatrix_new);  
 FLLOP_INTERN PetscErrorCode QPFetiGetI2Lmapping(MPI_Comm comm, IS l2g, IS i2g, IS *i2l_new);   
 FLLOP_INTERN PetscErrorCode QPFetiGetNotOrthoBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscInt nl, PetscBool full_red, Mat *Bgt_out);
-FLLOP_INTERN PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscInt nl, FetiGluingType type, Mat *Bgt_out);
+FLLOP_INTERN PetscErrorCode QPFetiGetBgtSF(MPI_Comm comm, QPFetiGluing gl, FetiGluingType type, Mat *Bgt_out);
 FLLOP_INTERN PetscErrorCode QPFetiGetOrthonorBgtSF(MPI_Comm comm, IS i2g, PetscInt Nu, IS i2l, PetscInt nl, Mat *Bgt_out);
    
 FLLOP_INTERN PetscLogEvent QP_Feti_SetUp, QP_Feti_AssembleGluingFromNeighbors, QP_Feti_AssembleDirichlet;
@@ -2525,6 +2525,7 @@ PetscErrorCode QPSetFromOptions(QP qp)
   /* process any options handlers added with PetscObjectAddOptionsHandler() */
   PetscCall(PetscObjectProcessOptionsHandlers((PetscObject)qp,PetscOptionsObject));
   PetscOptionsEnd();
+  if (qp->qpc) PetscCall(QPCSetFromOptions(qp->qpc));
   qp->setfromoptionscalled++;
   PetscFunctionReturn(0);
 }
@@ -6,7 +6,25 @@
 PetscLogEvent QPT_HomogenizeEq, QPT_EnforceEqByProjector, QPT_EnforceEqByPenalty, QPT_OrthonormalizeEq, QPT_SplitBE;
 PetscLogEvent QPT_Dualize, QPT_Dualize_AssembleG, QPT_Dualize_FactorK, QPT_Dualize_PrepareBt, QPT_FetiPrepare, QPT_AllInOne, QPT_RemoveGluingOfDirichletDofs;
 
-static QPPF QPReusedCP = NULL;
+/* registry of coarse problems (QPPF objects) reusable across FETI solves, see QPTFetiPrepareReuseCPWithCtx() */
+typedef struct {
+  QPPF             pf;
+  PetscObjectId    Rid,BEid,BIid;
+  PetscObjectState Rstate,BEstate,BIstate;
+  PetscInt         M,N;
+  PetscReal        fp[2];
+  PetscInt         stamp;
+} QPTReuseCPEntry;
+
+struct _n_QPTReuseCPCtx {
+  QPTReuseCPEntry  *entries;
+  PetscInt         n,nmax;
+  PetscInt         clock;
+  PetscBool        fingerprint;
+  PetscInt         hits,misses;
+};
+
+static QPTReuseCPCtx QPTReuseCPCtxDefault = NULL;
 
 /* common tasks during a QP transform - should be called in the beginning of each transform function */
 #undef __FUNCT__
@@ -1119,6 +1137,17 @@ PetscErrorCode QPTDualize(QP qp,MatInvType invType,MatRegularizationType regType
     PetscCall(PetscObjectCompose((PetscObject)F,"Kplus",(PetscObject)Kplus));
     PetscCall(PetscObjectCompose((PetscObject)F,"Kplus_orig",(PetscObject)Kplus_orig));
     PetscCall(PetscObjectCompose((PetscObject)F,"Bt",(PetscObject)Bt));
+    {
+      Mat Bg = NULL;
+      QP  qpi = qp;
+
+      /* gluing matrix composed by QPFetiSetUp() with this QP or one of its ancestors, used by PCDUAL for the multiplicity scaling */
+      while (qpi && !Bg) {
+        PetscCall(PetscObjectQuery((PetscObject)qpi,"Bg",(PetscObject*)&Bg));
+        PetscCall(QPGetParent(qpi,&qpi));
+      }
+      if (Bg) PetscCall(PetscObjectCompose((PetscObject)F,"Bg",(PetscObject)Bg));
+    }
     
     PetscCall(MatDestroy(&B));       B     = F_arr[2];
     PetscCall(MatDestroy(&Kplus));   Kplus = F_arr[1];
@@ -1208,43 +1237,359 @@ PetscErrorCode QPTFetiPrepare(QP qp,PetscBool regularize)
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPTFetiPrepareReuseCP"
-PetscErrorCode QPTFetiPrepareReuseCP(QP qp,PetscBool regularize)
+#define __FUNCT__ "QPTReuseCPCtxCreate"
+/*@
+   QPTReuseCPCtxCreate - Create a registry of coarse problems (QPPF objects) to be reused by QPTFetiPrepareReuseCPWithCtx().
+
+   Not Collective
+
+   Output Parameter:
+.  ctx - the registry
+
+   Options Database Keys:
++  -qpt_reuse_cp_max <4> - maximum number of coarse problems held at once; the least recently used one is evicted
+-  -qpt_reuse_cp_fingerprint <false> - match coarse problems also by a numerical fingerprint of G, not only by identity of R and B
+
+   Notes:
+   Each entry is keyed by the object ids and states of the null space matrix R and the constraint matrices BE, BI
+   of the dualized QP, and by the sizes and a fingerprint (a norm and a weighted sum of G*v for a fixed vector v) of the
+   natural coarse space matrix G = R'*B'. An entry whose R, BE or BI has been changed since it was stored is dropped.
+   If the fingerprint matching is enabled, a coarse problem can be reused also for newly assembled R and B with the same G.
+   The fingerprint is only a probe of G, not a proof of equality, hence the matching is opt-in.
+   The registry must be used by the same sequence of collective calls on all ranks of the QPs passed to it.
+
+   Level: advanced
+
+.seealso QPTReuseCPCtxDestroy(), QPTReuseCPCtxReset(), QPTFetiPrepareReuseCPWithCtx()
+@*/
+PetscErrorCode QPTReuseCPCtxCreate(QPTReuseCPCtx *ctx_new)
+{
+  QPTReuseCPCtx ctx;
+
+  PetscFunctionBegin;
+  PetscValidPointer(ctx_new,1);
+  PetscCall(PetscNew(&ctx));
+  ctx->nmax = 4;
+  ctx->fingerprint = PETSC_FALSE;
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-qpt_reuse_cp_max",&ctx->nmax,NULL));
+  PetscCall(PetscOptionsGetBool(NULL,NULL,"-qpt_reuse_cp_fingerprint",&ctx->fingerprint,NULL));
+  if (ctx->nmax < 1) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_OUTOFRANGE,"-qpt_reuse_cp_max must be positive");
+  PetscCall(PetscCalloc1(ctx->nmax,&ctx->entries));
+  *ctx_new = ctx;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTReuseCPCtxReset"
+/*@
+   QPTReuseCPCtxReset - Drop all coarse problems held by the registry.
+
+   Not Collective
+
+   Input Parameter:
+.  ctx - the registry
+
+   Level: advanced
+
+.seealso QPTReuseCPCtxCreate(), QPTReuseCPCtxDestroy()
+@*/
+PetscErrorCode QPTReuseCPCtxReset(QPTReuseCPCtx ctx)
+{
+  PetscInt i;
+
+  PetscFunctionBegin;
+  if (!ctx) PetscFunctionReturn(0);
+  for (i=0; i<ctx->n; i++) PetscCall(QPPFDestroy(&ctx->entries[i].pf));
+  PetscCall(PetscArrayzero(ctx->entries,ctx->nmax));
+  ctx->n = 0;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTReuseCPCtxDestroy"
+/*@
+   QPTReuseCPCtxDestroy - Destroy the registry of coarse problems.
+
+   Not Collective
+
+   Input Parameter:
+.  ctx - the registry
+
+   Level: advanced
+
+.seealso QPTReuseCPCtxCreate(), QPTReuseCPCtxReset()
+@*/
+PetscErrorCode QPTReuseCPCtxDestroy(QPTReuseCPCtx *ctx)
+{
+  PetscFunctionBegin;
+  if (!*ctx) PetscFunctionReturn(0);
+  PetscCall(QPTReuseCPCtxReset(*ctx));
+  PetscCall(PetscFree((*ctx)->entries));
+  PetscCall(PetscFree(*ctx));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTReuseCPFingerprint_Private"
+/* fp = [ norm(G*v), w'*G*v ] with v, w fixed vectors depending only on the global indices */
+static PetscErrorCode QPTReuseCPFingerprint_Private(Mat G,PetscReal fp[2])
+{
+  Vec         v,y,w;
+  PetscScalar *arr,dot;
+  PetscInt    i,lo,hi;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateVecs(G,&v,&y));
+  PetscCall(VecDuplicate(y,&w));
+  PetscCall(VecGetOwnershipRange(v,&lo,&hi));
+  PetscCall(VecGetArray(v,&arr));
+  for (i=lo; i<hi; i++) arr[i-lo] = 1.0/(1.0 + (i%31));
+  PetscCall(VecRestoreArray(v,&arr));
+  PetscCall(VecGetOwnershipRange(w,&lo,&hi));
+  PetscCall(VecGetArray(w,&arr));
+  for (i=lo; i<hi; i++) arr[i-lo] = 1.0 + (i%13);
+  PetscCall(VecRestoreArray(w,&arr));
+  PetscCall(MatMult(G,v,y));
+  PetscCall(VecNorm(y,NORM_2,&fp[0]));
+  PetscCall(VecDot(y,w,&dot));
+  fp[1] = PetscRealPart(dot);
+  PetscCall(VecDestroy(&v));
+  PetscCall(VecDestroy(&y));
+  PetscCall(VecDestroy(&w));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTReuseCPGetKey_Private"
+static PetscErrorCode QPTReuseCPGetKey_Private(Mat R,Mat BE,Mat BI,Mat G,QPTReuseCPEntry *key)
+{
+  PetscFunctionBegin;
+  PetscCall(PetscArrayzero(key,1));
+  if (R)  {PetscCall(PetscObjectGetId((PetscObject)R,&key->Rid));   PetscCall(PetscObjectStateGet((PetscObject)R,&key->Rstate));}
+  if (BE) {PetscCall(PetscObjectGetId((PetscObject)BE,&key->BEid)); PetscCall(PetscObjectStateGet((PetscObject)BE,&key->BEstate));}
+  if (BI) {PetscCall(PetscObjectGetId((PetscObject)BI,&key->BIid)); PetscCall(PetscObjectStateGet((PetscObject)BI,&key->BIstate));}
+  PetscCall(MatGetSize(G,&key->M,&key->N));
+  key->fp[0] = key->fp[1] = -1.0;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTReuseCPCtxRemove_Private"
+static PetscErrorCode QPTReuseCPCtxRemove_Private(QPTReuseCPCtx ctx,PetscInt i)
+{
+  PetscFunctionBegin;
+  PetscCall(QPPFDestroy(&ctx->entries[i].pf));
+  ctx->entries[i] = ctx->entries[ctx->n-1];
+  PetscCall(PetscArrayzero(&ctx->entries[ctx->n-1],1));
+  ctx->n--;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTReuseCPCtxLookup_Private"
+/* find a stored coarse problem for the dual QP with the equality constraint matrix G, drop invalidated ones;
+   object ids and states are local to each rank, so all decisions are made collectively on the communicator of dualQP */
+static PetscErrorCode QPTReuseCPCtxLookup_Private(QPTReuseCPCtx ctx,QP dualQP,Mat G,QPTReuseCPEntry *key,QPPF *pf)
 {
-  QP dualQP;
+  MPI_Comm        comm;
+  PetscMPIInt     flg;
+  PetscInt        i,n,match;
+  PetscInt        *flags;
+  QPTReuseCPEntry *e;
+
+  PetscFunctionBegin;
+  *pf = NULL;
+  comm = PetscObjectComm((PetscObject)dualQP);
+  n = ctx->n;
+  match = -1;
+
+  /* identity of R, BE, BI; flags[i] = 1 if entry i matches, flags[n+i] = -1 if it is outdated, agreed by all ranks */
+  if (n) {
+    PetscCall(PetscMalloc1(2*n,&flags));
+    for (i=0; i<n; i++) {
+      PetscBool same,valid;
+
+      e = &ctx->entries[i];
+      same  = (PetscBool)(e->Rid == key->Rid && e->BEid == key->BEid && e->BIid == key->BIid);
+      valid = (PetscBool)(e->Rstate == key->Rstate && e->BEstate == key->BEstate && e->BIstate == key->BIstate && e->M == key->M && e->N == key->N);
+      flags[i]   = (same && valid) ? 1 : 0;
+      flags[n+i] = (same && !valid) ? -1 : 0;
+    }
+    PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,flags,2*n,MPIU_INT,MPI_MIN,comm));
+    for (i=0; i<n; i++) {
+      if (flags[i]) {match = i; break;}
+    }
+    if (match >= 0) {
+      key->fp[0] = ctx->entries[match].fp[0];
+      key->fp[1] = ctx->entries[match].fp[1];
+    }
+    /* R or B has been modified since the coarse problem was stored; removal moves the last entry to the freed slot */
+    for (i=n-1; i>=0; i--) {
+      if (!flags[n+i] || i == match) continue;
+      PetscCall(PetscInfo(dualQP,"R or B changed since coarse problem %" PetscInt_FMT " was stored ==> dropping it\n",i));
+      if (match == ctx->n-1) match = i;
+      PetscCall(QPTReuseCPCtxRemove_Private(ctx,i));
+    }
+    PetscCall(PetscFree(flags));
+  }
+
+  /* numerical fingerprint of G; collective and computed from global quantities, so all ranks agree */
+  if (match < 0 && ctx->fingerprint) {
+    PetscCall(QPTReuseCPFingerprint_Private(G,key->fp));
+    for (i=0; i<ctx->n; i++) {
+      e = &ctx->entries[i];
+      if (e->M != key->M || e->N != key->N) continue;
+      if (PetscAbsReal(e->fp[0]-key->fp[0]) > 1e-10*PetscMax(PetscAbsReal(key->fp[0]),1.0)) continue;
+      if (PetscAbsReal(e->fp[1]-key->fp[1]) > 1e-10*PetscMax(PetscAbsReal(key->fp[1]),1.0)) continue;
+      PetscCall(PetscInfo(dualQP,"coarse problem %" PetscInt_FMT " matched by fingerprint of G\n",i));
+      match = i;
+      break;
+    }
+  }
+
+  if (match >= 0) {
+    e = &ctx->entries[match];
+    PetscCallMPI(MPI_Comm_compare(comm,PetscObjectComm((PetscObject)e->pf),&flg));
+    if (flg == MPI_IDENT || flg == MPI_CONGRUENT) {
+      *pf = e->pf;
+      e->Rid = key->Rid;   e->Rstate  = key->Rstate;
+      e->BEid = key->BEid; e->BEstate = key->BEstate;
+      e->BIid = key->BIid; e->BIstate = key->BIstate;
+      e->stamp = ++ctx->clock;
+    }
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTReuseCPCtxInsert_Private"
+static PetscErrorCode QPTReuseCPCtxInsert_Private(QPTReuseCPCtx ctx,QPTReuseCPEntry *key,QPPF pf)
+{
+  PetscInt i,lru;
+
+  PetscFunctionBegin;
+  if (ctx->n == ctx->nmax) {
+    /* evict the least recently used coarse problem */
+    lru = 0;
+    for (i=1; i<ctx->n; i++) if (ctx->entries[i].stamp < ctx->entries[lru].stamp) lru = i;
+    PetscCall(QPTReuseCPCtxRemove_Private(ctx,lru));
+  }
+  if (ctx->fingerprint && key->fp[0] < 0.0) {
+    Mat G;
+    PetscCall(QPPFGetG(pf,&G));
+    PetscCall(QPTReuseCPFingerprint_Private(G,key->fp));
+  }
+  PetscCall(PetscObjectReference((PetscObject)pf));
+  key->pf = pf;
+  key->stamp = ++ctx->clock;
+  ctx->entries[ctx->n++] = *key;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTFetiPrepareReuseCPWithCtx"
+/*@
+   QPTFetiPrepareReuseCPWithCtx - The same as QPTFetiPrepare() but the coarse problem (QPPF) is taken
+   from the given registry if it holds one for the same natural coarse space matrix G, and stored there otherwise.
+
+   Collective on QP
+
+   Input Parameters:
++  qp - the QP
+.  regularize - regularize the stiffness matrix, see QPTDualize()
+-  ctx - the registry of coarse problems
+
+   Notes:
+   Several problems, e.g. interleaved sequences of problems with different geometries, can share one registry.
+
+   Level: advanced
+
+.seealso QPTReuseCPCtxCreate(), QPTFetiPrepare(), QPTFetiPrepareReuseCP()
+@*/
+PetscErrorCode QPTFetiPrepareReuseCPWithCtx(QP qp,PetscBool regularize,QPTReuseCPCtx ctx)
+{
+  QP              primalQP,dualQP;
+  QPPF            pf;
+  Mat             G,R;
+  Vec             e;
+  QPTReuseCPEntry key;
 
   PetscFunctionBeginI;
+  PetscValidHeaderSpecific(qp,QP_CLASSID,1);
+  PetscValidPointer(ctx,3);
+  PetscCall(PetscLogEventBegin(QPT_FetiPrepare,qp,0,0,0));
   PetscCall(QPTDualize(qp, MAT_INV_BLOCKDIAG, regularize ? MAT_REG_EXPLICIT : MAT_REG_NONE));
 
   PetscCall(QPChainGetLast(qp, &dualQP));
-  if (QPReusedCP) {
-    Mat G;
-    Vec e;
-
-    /* reuse the coarse problem from the 0th iteration */
-    PetscCall(QPSetQPPF(dualQP, QPReusedCP));
-    PetscCall(QPPFGetG(QPReusedCP, &G));
-    PetscCall(QPGetEq(dualQP, NULL, &e));
-    PetscCall(QPSetEq(dualQP, G, e));
-  } else {
-    /* store the coarse problem from the 0th iteration */
-    PetscCall(QPGetQPPF(dualQP, &QPReusedCP));
-    PetscCall(QPPFSetUp(QPReusedCP));
-    PetscCall(PetscObjectReference((PetscObject) QPReusedCP));
+  PetscCall(QPGetParent(dualQP, &primalQP));
+  PetscCall(QPGetEq(dualQP, &G, &e));
+  if (G) {
+    PetscCall(QPGetOperatorNullSpace(primalQP, &R));
+    PetscCall(QPTReuseCPGetKey_Private(R, primalQP->BE, primalQP->BI, G, &key));
+    PetscCall(QPTReuseCPCtxLookup_Private(ctx, dualQP, G, &key, &pf));
+    if (pf) {
+      /* reuse the stored coarse problem */
+      ctx->hits++;
+      PetscCall(QPSetQPPF(dualQP, pf));
+      PetscCall(QPPFGetG(pf, &G));
+      PetscCall(QPSetEq(dualQP, G, e));
+    } else {
+      /* store the new coarse problem */
+      ctx->misses++;
+      PetscCall(QPGetQPPF(dualQP, &pf));
+      PetscCall(QPPFSetUp(pf));
+      PetscCall(QPTReuseCPCtxInsert_Private(ctx, &key, pf));
+    }
+    PetscCall(PetscInfo(qp,"coarse problem registry: %" PetscInt_FMT " stored, %" PetscInt_FMT " hits, %" PetscInt_FMT " misses\n",ctx->n,ctx->hits,ctx->misses));
   }
 
   PetscCall(QPTHomogenizeEq(qp));
   PetscCall(QPTEnforceEqByProjector(qp));
+  PetscCall(PetscLogEventEnd  (QPT_FetiPrepare,qp,0,0,0));
+  PetscFunctionReturnI(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPTFetiPrepareReuseCP"
+/*@
+   QPTFetiPrepareReuseCP - QPTFetiPrepareReuseCPWithCtx() with the default registry of coarse problems.
+
+   Collective on QP
+
+   Input Parameters:
++  qp - the QP
+-  regularize - regularize the stiffness matrix, see QPTDualize()
+
+   Level: advanced
+
+.seealso QPTFetiPrepareReuseCPWithCtx(), QPTFetiPrepareReuseCPReset()
+@*/
+PetscErrorCode QPTFetiPrepareReuseCP(QP qp,PetscBool regularize)
+{
+  PetscFunctionBeginI;
+  if (!QPTReuseCPCtxDefault) {
+    PetscCall(QPTReuseCPCtxCreate(&QPTReuseCPCtxDefault));
+    PetscCall(PetscRegisterFinalize(QPTFetiPrepareReuseCPReset));
+  }
+  PetscCall(QPTFetiPrepareReuseCPWithCtx(qp,regularize,QPTReuseCPCtxDefault));
   PetscFunctionReturnI(0);
 }
 
 #undef __FUNCT__
 #define __FUNCT__ "QPTFetiPrepareReuseCPReset"
+/*@
+   QPTFetiPrepareReuseCPReset - Destroy the default registry of coarse problems used by QPTFetiPrepareReuseCP().
+
+   Not Collective
+
+   Level: advanced
+
+.seealso QPTFetiPrepareReuseCP()
+@*/
 PetscErrorCode QPTFetiPrepareReuseCPReset()
 {
   PetscFunctionBegin;
-  PetscCall(QPPFDestroy(&QPReusedCP));
-  QPReusedCP = NULL;
+  PetscCall(QPTReuseCPCtxDestroy(&QPTReuseCPCtxDefault));
   PetscFunctionReturn(0);
 }
 
@@ -1,21 +1,116 @@
 
 #include <permonqp.h>
 #include <permon/private/permonmatimpl.h>
+#include <permon/private/qppfimpl.h>
 
 typedef struct {
   Mat  A,BtB;
   PetscReal rho;
   Vec xwork;
+  QPPF pf;
+
+  /* B'*B assembled once if B is AIJ or converts to it (MATGLUING, MATEXTENSION);
+     the fused operator A + rho*B'*B is assembled on top of it if A is AIJ as well */
+  PetscBool fused,setup;
+  Mat  Afused,BtB_explicit;
+  PetscReal rho_fused;
+  Mat  G;
+  PetscObjectState Astate,Gstate;
 } Mat_Penalized;
 
+#undef __FUNCT__
+#define __FUNCT__ "MatPenalizedSetUpExplicit_Private"
+/* assembles B'*B and possibly A + rho*B'*B; repeated only if the QPPF has been reset or A or B has changed */
+static PetscErrorCode MatPenalizedSetUpExplicit_Private(Mat Arho,Mat_Penalized *ctx)
+{
+  QPPF pf = ctx->pf;
+  Mat G,Gaij;
+  PetscBool flg_A,flg_G,orth;
+  PetscObjectState Astate,Gstate;
+
+  PetscFunctionBegin;
+  if (!ctx->fused) PetscFunctionReturn(0);
+  if (ctx->setup && pf->setupcalled) {
+    PetscCall(PetscObjectStateGet((PetscObject)ctx->A,&Astate));
+    PetscCall(PetscObjectStateGet((PetscObject)ctx->G,&Gstate));
+    if (Astate == ctx->Astate && Gstate == ctx->Gstate) PetscFunctionReturn(0);
+  }
+  if (ctx->setup) {
+    PetscCall(PetscInfo(Arho,"operator A or constraint matrix B has changed, reassembling B'*B\n"));
+    PetscCall(MatDestroy(&ctx->Afused));
+    PetscCall(MatDestroy(&ctx->BtB_explicit));
+    PetscCall(MatDestroy(&ctx->G));
+  }
+
+  PetscCall(QPPFSetUp(pf));
+  PetscCall(QPPFGetG(pf,&G));
+  ctx->setup = PETSC_TRUE;
+  ctx->G = G;
+  PetscCall(PetscObjectReference((PetscObject)G));
+  PetscCall(PetscObjectStateGet((PetscObject)ctx->A,&ctx->Astate));
+  PetscCall(PetscObjectStateGet((PetscObject)G,&ctx->Gstate));
+
+  /* with implicitly orthonormalized rows, the penalized term is G'*inv(G*G')*G which is not sparse */
+  orth = (PetscBool)(pf->G_has_orthonormal_rows_implicitly && !pf->G_has_orthonormal_rows_explicitly);
+  PetscCall(PetscObjectTypeCompareAny((PetscObject)G,&flg_G,MATSEQAIJ,MATMPIAIJ,MATGLUING,MATEXTENSION,""));
+  if (orth || !flg_G) {
+    PetscCall(PetscInfo(Arho,"B'*B not assembled, applying it through QPPF\n"));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(MatConvert(G,MATAIJ,MAT_INITIAL_MATRIX,&Gaij));
+  PetscCall(MatTransposeMatMult(Gaij,Gaij,MAT_INITIAL_MATRIX,PETSC_DEFAULT,&ctx->BtB_explicit));
+  PetscCall(MatDestroy(&Gaij));
+
+  PetscCall(PetscObjectTypeCompareAny((PetscObject)ctx->A,&flg_A,MATSEQAIJ,MATMPIAIJ,""));
+  if (!flg_A) {
+    PetscCall(PetscInfo(Arho,"assembled B'*B, applying A and B'*B separately\n"));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(MatDuplicate(ctx->A,MAT_COPY_VALUES,&ctx->Afused));
+  PetscCall(MatAXPY(ctx->Afused,ctx->rho,ctx->BtB_explicit,DIFFERENT_NONZERO_PATTERN));
+  ctx->rho_fused = ctx->rho;
+  PetscCall(PetscInfo(Arho,"assembled A + rho*B'*B with rho = %.4e\n",ctx->rho));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MatPenalizedGetFused_Private"
+/* returns A + rho*B'*B as a single AIJ matrix or NULL if it is not available, and the penalized term B'*B to be applied
+   otherwise, explicit if possible; the penalty is folded in lazily so that MatPenalizedSetPenalty() only changes a scalar */
+static PetscErrorCode MatPenalizedGetFused_Private(Mat Arho,Mat *Afused,Mat *BtB)
+{
+  Mat_Penalized *ctx;
+
+  PetscFunctionBegin;
+  PetscCall(MatShellGetContext(Arho,(void*)&ctx));
+  PetscCall(MatPenalizedSetUpExplicit_Private(Arho,ctx));
+  *Afused = NULL;
+  *BtB = ctx->BtB_explicit ? ctx->BtB_explicit : ctx->BtB;
+  if (!ctx->Afused) PetscFunctionReturn(0);
+
+  if (ctx->rho_fused != ctx->rho) {
+    /* the pattern of B'*B is contained in the pattern of the fused matrix */
+    PetscCall(MatAXPY(ctx->Afused,ctx->rho-ctx->rho_fused,ctx->BtB_explicit,SUBSET_NONZERO_PATTERN));
+    ctx->rho_fused = ctx->rho;
+  }
+  *Afused = ctx->Afused;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "MatMult_Penalized"
 PetscErrorCode MatMult_Penalized(Mat Arho,Vec x,Vec y)
 {
   Mat_Penalized *ctx;
+  Mat Afused,BtB;
   PetscFunctionBegin;
+  PetscCall(MatPenalizedGetFused_Private(Arho,&Afused,&BtB));
+  if (Afused) {
+    PetscCall(MatMult(Afused,x,y));
+    PetscFunctionReturn(0);
+  }
   PetscCall(MatShellGetContext(Arho,(void*)&ctx));
-  PetscCall(MatMult(ctx->BtB,x,y));
+  PetscCall(MatMult(BtB,x,y));
   PetscCall(VecScale(y,ctx->rho));
   PetscCall(MatMultAdd(ctx->A,x,y,y));
   PetscFunctionReturn(0);
@@ -26,9 +121,15 @@ PetscErrorCode MatMult_Penalized(Mat Arho,Vec x,Vec y)
 PetscErrorCode MatMultTranspose_Penalized(Mat Arho,Vec x,Vec y)
 {
   Mat_Penalized *ctx;
+  Mat Afused,BtB;
   PetscFunctionBegin;
+  PetscCall(MatPenalizedGetFused_Private(Arho,&Afused,&BtB));
+  if (Afused) {
+    PetscCall(MatMultTranspose(Afused,x,y));
+    PetscFunctionReturn(0);
+  }
   PetscCall(MatShellGetContext(Arho,(void*)&ctx));
-  PetscCall(MatMult(ctx->BtB,x,y));
+  PetscCall(MatMult(BtB,x,y));
   PetscCall(VecScale(y,ctx->rho));
   PetscCall(MatMultTransposeAdd(ctx->A,x,y,y));
   PetscFunctionReturn(0);
@@ -39,14 +140,20 @@ PetscErrorCode MatMultTranspose_Penalized(Mat Arho,Vec x,Vec y)
 PetscErrorCode MatMultAdd_Penalized(Mat Arho,Vec x,Vec x2,Vec y)
 {
   Mat_Penalized *ctx;
+  Mat Afused,BtB;
   PetscFunctionBegin;
+  PetscCall(MatPenalizedGetFused_Private(Arho,&Afused,&BtB));
+  if (Afused) {
+    PetscCall(MatMultAdd(Afused,x,x2,y));
+    PetscFunctionReturn(0);
+  }
   PetscCall(MatShellGetContext(Arho,(void*)&ctx));
   if (x2 != y) {
-    PetscCall(MatMult(ctx->BtB,x,y));
+    PetscCall(MatMult(BtB,x,y));
     PetscCall(VecAYPX(y,ctx->rho,x2));
   } else {
     if (!ctx->xwork) PetscCall(VecDuplicate(y,&ctx->xwork));
-    PetscCall(MatMult(ctx->BtB,x,ctx->xwork));
+    PetscCall(MatMult(BtB,x,ctx->xwork));
     PetscCall(VecScale(ctx->xwork,ctx->rho));
     PetscCall(VecAXPY(y,1.0,ctx->xwork));
   }
@@ -59,14 +166,20 @@ PetscErrorCode MatMultAdd_Penalized(Mat Arho,Vec x,Vec x2,Vec y)
 PetscErrorCode MatMultTransposeAdd_Penalized(Mat Arho,Vec x,Vec x2,Vec y)
 {
   Mat_Penalized *ctx;
+  Mat Afused,BtB;
   PetscFunctionBegin;
+  PetscCall(MatPenalizedGetFused_Private(Arho,&Afused,&BtB));
+  if (Afused) {
+    PetscCall(MatMultTransposeAdd(Afused,x,x2,y));
+    PetscFunctionReturn(0);
+  }
   PetscCall(MatShellGetContext(Arho,(void*)&ctx));
   if (x2 != y) {
-    PetscCall(MatMult(ctx->BtB,x,y));
+    PetscCall(MatMult(BtB,x,y));
     PetscCall(VecAYPX(y,ctx->rho,x2));
   } else {
     if (!ctx->xwork) PetscCall(VecDuplicate(y,&ctx->xwork));
-    PetscCall(MatMult(ctx->BtB,x,ctx->xwork));
+    PetscCall(MatMult(BtB,x,ctx->xwork));
     PetscCall(VecScale(ctx->xwork,ctx->rho));
     PetscCall(VecAXPY(y,1.0,ctx->xwork));
   }
@@ -79,12 +192,18 @@ PetscErrorCode MatMultTransposeAdd_Penalized(Mat Arho,Vec x,Vec x2,Vec y)
 PetscErrorCode MatGetDiagonal_Penalized(Mat Arho,Vec d)
 {
   Mat_Penalized *ctx;
+  Mat Afused,BtB;
   PetscFunctionBegin;
+  PetscCall(MatPenalizedGetFused_Private(Arho,&Afused,&BtB));
+  if (Afused) {
+    PetscCall(MatGetDiagonal(Afused,d));
+    PetscFunctionReturn(0);
+  }
   PetscCall(MatShellGetContext(Arho,(void*)&ctx));
   PetscCall(MatGetDiagonal(ctx->A,d));
   if (!ctx->xwork) PetscCall(VecDuplicate(d,&ctx->xwork));
-  PetscCall(MatGetDiagonal(ctx->BtB,ctx->xwork));
-  PetscCall(VecAXPY(d,1.0,ctx->xwork));
+  PetscCall(MatGetDiagonal(BtB,ctx->xwork));
+  PetscCall(VecAXPY(d,ctx->rho,ctx->xwork));
   PetscFunctionReturn(0);
 }
 
@@ -96,6 +215,9 @@ PetscErrorCode MatDestroy_Penalized(Mat Arho) {
   PetscCall(MatShellGetContext(Arho,(void*)&ctx));
   PetscCall(MatDestroy(&ctx->A));
   PetscCall(MatDestroy(&ctx->BtB));
+  PetscCall(MatDestroy(&ctx->Afused));
+  PetscCall(MatDestroy(&ctx->BtB_explicit));
+  PetscCall(MatDestroy(&ctx->G));
   PetscCall(VecDestroy(&ctx->xwork));
   PetscCall(PetscFree(ctx));
   PetscCall(MatShellSetContext(Arho, NULL));
@@ -110,6 +232,7 @@ static PetscErrorCode MatPenalizedSetPenalty_Penalty(Mat Arho,PetscReal rho)
   PetscFunctionBegin;
   PetscCall(MatShellGetContext(Arho,(void*)&ctx));
   ctx->rho = rho;
+  PetscCall(PetscObjectStateIncrease((PetscObject)Arho));
   PetscFunctionReturn(0);
 }
 
@@ -125,6 +248,7 @@ static PetscErrorCode MatPenalizedUpdatePenalty_Penalty(Mat Arho,PetscReal rho_u
   rho_new = ctx->rho * rho_update;
   PetscCall(PetscInfo(fllop,"updating rho := %.4e*%.4e = %.4e\n",ctx->rho,rho_update,rho_new));
   ctx->rho = rho_new;
+  PetscCall(PetscObjectStateIncrease((PetscObject)Arho));  /* invalidates stashed data like the max eigenvalue */
   PetscFunctionReturn(0);
 }
 
@@ -211,8 +335,16 @@ PetscErrorCode MatCreatePenalized(QP qp,PetscReal rho,Mat *Arho_new)
   PetscCall(PetscMalloc(sizeof(Mat_Penalized),&ctx));
   ctx->A = A; PetscCall(PetscObjectReference((PetscObject)A));
   PetscCall(QPPFCreateGtG(pf,&ctx->BtB));
+  ctx->pf = pf;
   ctx->rho = rho;
   ctx->xwork = NULL;
+  ctx->fused = PETSC_TRUE;
+  ctx->setup = PETSC_FALSE;
+  ctx->Afused = NULL;
+  ctx->BtB_explicit = NULL;
+  ctx->G = NULL;
+  ctx->rho_fused = rho;
+  PetscCall(PetscOptionsGetBool(NULL,NULL,"-mat_penalized_fused",&ctx->fused,NULL));
   PetscCall(MatCreateShellPermon(PetscObjectComm((PetscObject)qp), A->rmap->n,A->cmap->n,A->rmap->N,A->cmap->N, ctx,&Arho));
   PetscCall(MatShellSetOperation(Arho,MATOP_DESTROY,(void(*)(void))MatDestroy_Penalized));
   PetscCall(MatShellSetOperation(Arho,MATOP_MULT,(void(*)(void))MatMult_Penalized));
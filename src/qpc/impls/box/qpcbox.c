@@ -9,8 +9,8 @@ PetscErrorCode QPCSetUp_Box(QPC qpc)
 
   PetscFunctionBegin;
 
-  /* prepare lambdawork vector based on the layout of lb */
-  lb = ctx->lb;
+  /* prepare lambdawork vector based on the layout of lb (or ub if lb is not set) */
+  lb = ctx->lb ? ctx->lb : ctx->ub;
   PetscCall(VecDuplicate(lb,&(qpc->lambdawork)));
 
   // TODO: verify layout of ub somewhere in setup or in create function
@@ -18,34 +18,353 @@ PetscErrorCode QPCSetUp_Box(QPC qpc)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPCSetFromOptions_Box"
+static PetscErrorCode QPCSetFromOptions_Box(QPC qpc,PetscOptionItems *PetscOptionsObject)
+{
+  QPC_Box         *ctx = (QPC_Box*)qpc->data;
+  PetscBool             flg,set;
+
+  PetscFunctionBegin;
+  PetscOptionsHeadBegin(PetscOptionsObject,"QPC box options");
+  PetscCall(PetscOptionsBool("-qpc_box_reference_kernels","Use scalar reference kernels instead of branch-free ones","QPCBoxSetReferenceKernels",ctx->reference,&flg,&set));
+  if (set) PetscCall(QPCBoxSetReferenceKernels(qpc,flg));
+  PetscOptionsHeadEnd();
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCBoxUpdateActiveSet_Box"
+/*
+  classify local components of x into active lower, active upper and free set;
+  the sets are rebuilt only if x, lb, ub or the active set tolerance has changed since the last call;
+  the rebuild is a full pass, the sets are not updated incrementally from the changed components of x
+*/
+static PetscErrorCode QPCBoxUpdateActiveSet_Box(QPC qpc, Vec x)
+{
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+  Vec                   lb,ub;
+  PetscObjectId         x_id;
+  PetscObjectState      x_state,lb_state=0,ub_state=0;
+
+  const PetscScalar     *x_a, *lb_a = NULL, *ub_a = NULL;
+  const PetscReal       astol = qpc->astol;
+  PetscInt              *idx_lb, *idx_ub, *idx_free;
+  PetscInt              n_local, n_lb, n_ub, n_free, al, au, i;
+
+  PetscFunctionBegin;
+  lb = ctx->lb;
+  ub = ctx->ub;
+  PetscCall(PetscObjectGetId((PetscObject)x,&x_id));
+  PetscCall(PetscObjectStateGet((PetscObject)x,&x_state));
+  if (lb) PetscCall(PetscObjectStateGet((PetscObject)lb,&lb_state));
+  if (ub) PetscCall(PetscObjectStateGet((PetscObject)ub,&ub_state));
+  if (x_id == ctx->x_id && x_state == ctx->x_state && lb_state == ctx->lb_state && ub_state == ctx->ub_state && astol == ctx->astol) PetscFunctionReturn(0);
+
+  PetscCall(VecGetLocalSize(x,&n_local));
+  if (n_local > ctx->n_alloc) {
+    PetscCall(PetscFree3(ctx->idx_lb,ctx->idx_ub,ctx->idx_free));
+    PetscCall(PetscMalloc3(n_local,&ctx->idx_lb,n_local,&ctx->idx_ub,n_local,&ctx->idx_free));
+    ctx->n_alloc = n_local;
+  }
+  idx_lb   = ctx->idx_lb;
+  idx_ub   = ctx->idx_ub;
+  idx_free = ctx->idx_free;
+
+  PetscCall(VecGetArrayRead(x, &x_a));
+  if (lb) PetscCall(VecGetArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub, &ub_a));
+  n_lb = n_ub = n_free = 0;
+  /* branch-free stream compaction: every index is written to all lists, only the counter of its set advances */
+  if (lb && ub) {
+    for (i = 0; i < n_local; i++){
+      al = (PetscInt)(PetscAbsScalar(x_a[i] - lb_a[i]) <= astol);
+      au = (PetscInt)(PetscAbsScalar(x_a[i] - ub_a[i]) <= astol) & !al;
+      idx_lb[n_lb] = i; idx_ub[n_ub] = i; idx_free[n_free] = i;
+      n_lb += al; n_ub += au; n_free += 1 - al - au;
+    }
+  } else if (lb) {
+    for (i = 0; i < n_local; i++){
+      al = (PetscInt)(PetscAbsScalar(x_a[i] - lb_a[i]) <= astol);
+      idx_lb[n_lb] = i; idx_free[n_free] = i;
+      n_lb += al; n_free += 1 - al;
+    }
+  } else {
+    for (i = 0; i < n_local; i++){
+      au = (PetscInt)(PetscAbsScalar(x_a[i] - ub_a[i]) <= astol);
+      idx_ub[n_ub] = i; idx_free[n_free] = i;
+      n_ub += au; n_free += 1 - au;
+    }
+  }
+  ctx->n_lb   = n_lb;
+  ctx->n_ub   = n_ub;
+  ctx->n_free = n_free;
+  PetscCall(VecRestoreArrayRead(x, &x_a));
+  if (lb) PetscCall(VecRestoreArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub, &ub_a));
+
+  ctx->x_id     = x_id;
+  ctx->x_state  = x_state;
+  ctx->lb_state = lb_state;
+  ctx->ub_state = ub_state;
+  ctx->astol    = astol;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCBoxResetActiveSet_Box"
+static PetscErrorCode QPCBoxResetActiveSet_Box(QPC qpc)
+{
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+
+  PetscFunctionBegin;
+  PetscCall(PetscFree3(ctx->idx_lb,ctx->idx_ub,ctx->idx_free));
+  ctx->n_lb = ctx->n_ub = ctx->n_free = ctx->n_alloc = 0;
+  ctx->x_id     = 0;
+  ctx->x_state  = 0;
+  ctx->lb_state = 0;
+  ctx->ub_state = 0;
+  ctx->astol    = 0.0;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPCGrads_Box"
 static PetscErrorCode QPCGrads_Box(QPC qpc, Vec x, Vec g, Vec gf, Vec gc)
+{
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+
+  const PetscScalar     *g_a;
+  PetscScalar           *gf_a, *gc_a;
+  PetscInt              i, j;
+
+  PetscFunctionBegin;
+  PetscCall(QPCBoxUpdateActiveSet_Box(qpc,x));
+  PetscCall(VecGetArrayRead(g, &g_a));
+  PetscCall(VecGetArray(gf, &gf_a));
+  PetscCall(VecGetArray(gc, &gc_a));
+
+  /* gf = g and gc = 0 already set by QPCGrads, so FREE SET is untouched */
+  for (j = 0; j < ctx->n_lb; j++){
+    /* active lower bound */
+    i = ctx->idx_lb[j];
+    gf_a[i] = 0.0;
+    gc_a[i] = PetscMin(g_a[i],0.0);
+  }
+  for (j = 0; j < ctx->n_ub; j++){
+    /* active upper bound */
+    i = ctx->idx_ub[j];
+    gf_a[i] = 0.0;
+    gc_a[i] = PetscMax(g_a[i],0.0);
+  }
+
+  PetscCall(VecRestoreArrayRead(g, &g_a));
+  PetscCall(VecRestoreArray(gf, &gf_a));
+  PetscCall(VecRestoreArray(gc, &gc_a));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCGradsNorms_Box"
+/*
+  fused QPCGrads_Box + gP = gf + gc + local parts of gP'*gP, gc'*gc, gf'*gf;
+  called only if all components are constrained, so all entries of gf, gc, gP are written here
+*/
+static PetscErrorCode QPCGradsNorms_Box(QPC qpc, Vec x, Vec g, Vec gf, Vec gc, Vec gP, PetscReal dots[])
+{
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+
+  const PetscScalar     *g_a;
+  PetscScalar           *gf_a, *gc_a, *gP_a;
+  PetscReal             gcTgc = 0.0, gfTgf = 0.0;
+  PetscInt              i, j;
+
+  PetscFunctionBegin;
+  PetscCall(QPCBoxUpdateActiveSet_Box(qpc,x));
+  PetscCall(VecGetArrayRead(g, &g_a));
+  PetscCall(VecGetArrayWrite(gf, &gf_a));
+  PetscCall(VecGetArrayWrite(gc, &gc_a));
+  PetscCall(VecGetArrayWrite(gP, &gP_a));
+
+  for (j = 0; j < ctx->n_free; j++){
+    /* index of this component is in FREE SET */
+    i = ctx->idx_free[j];
+    gf_a[i] = g_a[i];
+    gc_a[i] = 0.0;
+    gP_a[i] = g_a[i];
+    gfTgf  += PetscRealPart(g_a[i]*PetscConj(g_a[i]));
+  }
+  for (j = 0; j < ctx->n_lb; j++){
+    /* active lower bound */
+    i = ctx->idx_lb[j];
+    gf_a[i] = 0.0;
+    gc_a[i] = PetscMin(g_a[i],0.0);
+    gP_a[i] = gc_a[i];
+    gcTgc  += PetscRealPart(gc_a[i]*PetscConj(gc_a[i]));
+  }
+  for (j = 0; j < ctx->n_ub; j++){
+    /* active upper bound */
+    i = ctx->idx_ub[j];
+    gf_a[i] = 0.0;
+    gc_a[i] = PetscMax(g_a[i],0.0);
+    gP_a[i] = gc_a[i];
+    gcTgc  += PetscRealPart(gc_a[i]*PetscConj(gc_a[i]));
+  }
+  /* gf and gc have disjoint supports */
+  dots[0] = gfTgf + gcTgc;
+  dots[1] = gcTgc;
+  dots[2] = gfTgf;
+
+  PetscCall(VecRestoreArrayRead(g, &g_a));
+  PetscCall(VecRestoreArrayWrite(gf, &gf_a));
+  PetscCall(VecRestoreArrayWrite(gc, &gc_a));
+  PetscCall(VecRestoreArrayWrite(gP, &gP_a));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCGradReduced_Box"
+/*
+  all entries are traversed as in the reference kernel, so that gr is the same also if gf does not vanish on the active set;
+  specialized for lower-only, upper-only and two-sided box
+*/
+static PetscErrorCode QPCGradReduced_Box(QPC qpc, Vec x, Vec gf, PetscReal alpha, Vec gr)
+{
+  Vec                   lb,ub;
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+
+  const PetscScalar     *x_a, *lb_a, *ub_a, *gf_a;
+  PetscScalar           *gr_a;
+  PetscInt              n_local, i;
+
+  PetscFunctionBegin;
+  lb = ctx->lb;
+  ub = ctx->ub;
+  PetscCall(VecGetLocalSize(x,&n_local));
+  PetscCall(VecGetArrayRead(x, &x_a));
+  if (lb) PetscCall(VecGetArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub, &ub_a));
+  PetscCall(VecGetArrayRead(gf, &gf_a));
+  PetscCall(VecGetArray(gr, &gr_a));
+
+  /* gr = gf already set by QPCGradReduced */
+  if (lb && ub) {
+    for (i = 0; i < n_local; i++){
+      if (gf_a[i] > 0.0) {
+        gr_a[i] = PetscMin(gf_a[i],(x_a[i]-lb_a[i])/alpha);
+      } else if (gf_a[i] < 0.0) {
+        gr_a[i] = PetscMax(gf_a[i],(x_a[i]-ub_a[i])/alpha);
+      }
+    }
+  } else if (lb) {
+    for (i = 0; i < n_local; i++){
+      if (gf_a[i] > 0.0) gr_a[i] = PetscMin(gf_a[i],(x_a[i]-lb_a[i])/alpha);
+    }
+  } else {
+    for (i = 0; i < n_local; i++){
+      if (gf_a[i] < 0.0) gr_a[i] = PetscMax(gf_a[i],(x_a[i]-ub_a[i])/alpha);
+    }
+  }
+
+  PetscCall(VecRestoreArrayRead(x, &x_a));
+  if (lb) PetscCall(VecRestoreArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub, &ub_a));
+  PetscCall(VecRestoreArrayRead(gf, &gf_a));
+  PetscCall(VecRestoreArray(gr, &gr_a));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCFeas_Box"
+/*
+  branch-free variant specialized for lower-only, upper-only and two-sided box;
+  infinite bounds give infinite step lengths, masked components use denominator 1 to avoid FP exceptions
+*/
+static PetscErrorCode QPCFeas_Box(QPC qpc,Vec x, Vec d, PetscScalar *alpha)
 {
   Vec                   lb,ub;
   QPC_Box               *ctx = (QPC_Box*)qpc->data;
+  PetscReal             alpha_temp, alpha_l, alpha_u, dl, du;
 
-  PetscScalar           *x_a, *lb_a, *ub_a, *g_a, *gf_a, *gc_a;
+  const PetscScalar     *x_a, *d_a, *lb_a, *ub_a;
   PetscInt              n_local, i;
 
   PetscFunctionBegin;
   lb = ctx->lb;
   ub = ctx->ub;
+
+  alpha_temp = PETSC_INFINITY;
+
+  /* arrays are only read so that the state of x is kept and the cached active set stays valid */
   PetscCall(VecGetLocalSize(x,&n_local));
-  PetscCall(VecGetArray(x, &x_a));
-  if (lb) PetscCall(VecGetArray(lb, &lb_a));
-  if (ub) PetscCall(VecGetArray(ub, &ub_a));
-  PetscCall(VecGetArray(g, &g_a));
+  PetscCall(VecGetArrayRead(x,&x_a));
+  PetscCall(VecGetArrayRead(d,&d_a));
+  if (lb) PetscCall(VecGetArrayRead(lb,&lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub,&ub_a));
+
+  /* the step length is limited also by components of active set, so the whole vector is traversed;
+     infinite bounds are masked out as in the reference kernel */
+  if (lb && ub) {
+    for (i = 0; i < n_local; i++){
+      dl = d_a[i] > 0.0 ? d_a[i] : 1.0;
+      du = d_a[i] < 0.0 ? d_a[i] : -1.0;
+      alpha_l = (d_a[i] > 0.0 && lb_a[i] > PETSC_NINFINITY) ? (x_a[i] - lb_a[i])/dl : PETSC_INFINITY;
+      alpha_u = (d_a[i] < 0.0 && ub_a[i] < PETSC_INFINITY) ? (x_a[i] - ub_a[i])/du : PETSC_INFINITY;
+      alpha_temp = alpha_l < alpha_temp ? alpha_l : alpha_temp;
+      alpha_temp = alpha_u < alpha_temp ? alpha_u : alpha_temp;
+    }
+  } else if (lb) {
+    for (i = 0; i < n_local; i++){
+      dl = d_a[i] > 0.0 ? d_a[i] : 1.0;
+      alpha_l = (d_a[i] > 0.0 && lb_a[i] > PETSC_NINFINITY) ? (x_a[i] - lb_a[i])/dl : PETSC_INFINITY;
+      alpha_temp = alpha_l < alpha_temp ? alpha_l : alpha_temp;
+    }
+  } else {
+    for (i = 0; i < n_local; i++){
+      du = d_a[i] < 0.0 ? d_a[i] : -1.0;
+      alpha_u = (d_a[i] < 0.0 && ub_a[i] < PETSC_INFINITY) ? (x_a[i] - ub_a[i])/du : PETSC_INFINITY;
+      alpha_temp = alpha_u < alpha_temp ? alpha_u : alpha_temp;
+    }
+  }
+  *alpha = alpha_temp;
+
+  PetscCall(VecRestoreArrayRead(x,&x_a));
+  PetscCall(VecRestoreArrayRead(d,&d_a));
+  if (lb) PetscCall(VecRestoreArrayRead(lb,&lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub,&ub_a));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCGrads_Box_Reference"
+/*
+  scalar reference kernels; used with -qpc_box_reference_kernels (QPCSetFromOptions()) or QPCBoxSetReferenceKernels()
+*/
+static PetscErrorCode QPCGrads_Box_Reference(QPC qpc, Vec x, Vec g, Vec gf, Vec gc)
+{
+  Vec                   lb,ub;
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+
+  const PetscScalar     *x_a, *lb_a, *ub_a, *g_a;
+  PetscScalar           *gf_a, *gc_a;
+  PetscInt              n_local, i;
+
+  PetscFunctionBegin;
+  lb = ctx->lb;
+  ub = ctx->ub;
+  PetscCall(VecGetLocalSize(x,&n_local));
+  PetscCall(VecGetArrayRead(x, &x_a));
+  if (lb) PetscCall(VecGetArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub, &ub_a));
+  PetscCall(VecGetArrayRead(g, &g_a));
   PetscCall(VecGetArray(gf, &gf_a));
   PetscCall(VecGetArray(gc, &gc_a));
 
-  /* TODO create free/active IS? */
   for (i = 0; i < n_local; i++){
     if (lb && PetscAbsScalar(x_a[i] - lb_a[i]) <= qpc->astol) {
       /* active lower bound */
       gf_a[i] = 0.0;
       gc_a[i]= PetscMin(g_a[i],0.0);
-    //} else if (ub && x_a[i] >= ub_a[i]) {
     } else if (ub && PetscAbsScalar(x_a[i] -  ub_a[i]) <= qpc->astol) {
       /* active upper bound */
       gf_a[i] = 0.0;
@@ -56,33 +375,92 @@ static PetscErrorCode QPCGrads_Box(QPC qpc, Vec x, Vec g, Vec gf, Vec gc)
     }
   }
 
-  PetscCall(VecRestoreArray(x, &x_a));
-  if (lb) PetscCall(VecRestoreArray(lb, &lb_a));
-  if (ub) PetscCall(VecRestoreArray(ub, &ub_a));
-  PetscCall(VecRestoreArray(g, &g_a));
+  PetscCall(VecRestoreArrayRead(x, &x_a));
+  if (lb) PetscCall(VecRestoreArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub, &ub_a));
+  PetscCall(VecRestoreArrayRead(g, &g_a));
   PetscCall(VecRestoreArray(gf, &gf_a));
   PetscCall(VecRestoreArray(gc, &gc_a));
   PetscFunctionReturn(0);
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPCGradReduced_Box"
-static PetscErrorCode QPCGradReduced_Box(QPC qpc, Vec x, Vec gf, PetscReal alpha, Vec gr)
+#define __FUNCT__ "QPCGradsNorms_Box_Reference"
+static PetscErrorCode QPCGradsNorms_Box_Reference(QPC qpc, Vec x, Vec g, Vec gf, Vec gc, Vec gP, PetscReal dots[])
 {
   Vec                   lb,ub;
   QPC_Box               *ctx = (QPC_Box*)qpc->data;
 
-  PetscScalar           *x_a, *lb_a, *ub_a, *gf_a, *gr_a;
+  const PetscScalar     *x_a, *lb_a = NULL, *ub_a = NULL, *g_a;
+  PetscScalar           *gf_a, *gc_a, *gP_a;
+  PetscReal             gPTgP = 0.0, gcTgc = 0.0, gfTgf = 0.0;
   PetscInt              n_local, i;
 
   PetscFunctionBegin;
   lb = ctx->lb;
   ub = ctx->ub;
   PetscCall(VecGetLocalSize(x,&n_local));
-  PetscCall(VecGetArray(x, &x_a));
-  if (lb) PetscCall(VecGetArray(lb, &lb_a));
-  if (ub) PetscCall(VecGetArray(ub, &ub_a));
-  PetscCall(VecGetArray(gf, &gf_a));
+  PetscCall(VecGetArrayRead(x, &x_a));
+  if (lb) PetscCall(VecGetArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub, &ub_a));
+  PetscCall(VecGetArrayRead(g, &g_a));
+  PetscCall(VecGetArrayWrite(gf, &gf_a));
+  PetscCall(VecGetArrayWrite(gc, &gc_a));
+  PetscCall(VecGetArrayWrite(gP, &gP_a));
+
+  for (i = 0; i < n_local; i++){
+    if (lb && PetscAbsScalar(x_a[i] - lb_a[i]) <= qpc->astol) {
+      /* active lower bound */
+      gf_a[i] = 0.0;
+      gc_a[i] = PetscMin(g_a[i],0.0);
+      gcTgc  += PetscRealPart(gc_a[i]*PetscConj(gc_a[i]));
+    } else if (ub && PetscAbsScalar(x_a[i] -  ub_a[i]) <= qpc->astol) {
+      /* active upper bound */
+      gf_a[i] = 0.0;
+      gc_a[i] = PetscMax(g_a[i],0.0);
+      gcTgc  += PetscRealPart(gc_a[i]*PetscConj(gc_a[i]));
+    } else {
+      /* index of this component is in FREE SET */
+      gf_a[i] = g_a[i];
+      gc_a[i] = 0.0;
+      gfTgf  += PetscRealPart(gf_a[i]*PetscConj(gf_a[i]));
+    }
+    gP_a[i] = gf_a[i] + gc_a[i];
+    gPTgP  += PetscRealPart(gP_a[i]*PetscConj(gP_a[i]));
+  }
+  dots[0] = gPTgP;
+  dots[1] = gcTgc;
+  dots[2] = gfTgf;
+
+  PetscCall(VecRestoreArrayRead(x, &x_a));
+  if (lb) PetscCall(VecRestoreArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub, &ub_a));
+  PetscCall(VecRestoreArrayRead(g, &g_a));
+  PetscCall(VecRestoreArrayWrite(gf, &gf_a));
+  PetscCall(VecRestoreArrayWrite(gc, &gc_a));
+  PetscCall(VecRestoreArrayWrite(gP, &gP_a));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCGradReduced_Box_Reference"
+static PetscErrorCode QPCGradReduced_Box_Reference(QPC qpc, Vec x, Vec gf, PetscReal alpha, Vec gr)
+{
+  Vec                   lb,ub;
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+
+  const PetscScalar     *x_a, *lb_a, *ub_a, *gf_a;
+  PetscScalar           *gr_a;
+  PetscInt              n_local, i;
+
+  PetscFunctionBegin;
+  lb = ctx->lb;
+  ub = ctx->ub;
+  PetscCall(VecGetLocalSize(x,&n_local));
+  PetscCall(VecGetArrayRead(x, &x_a));
+  if (lb) PetscCall(VecGetArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub, &ub_a));
+  PetscCall(VecGetArrayRead(gf, &gf_a));
   PetscCall(VecGetArray(gr, &gr_a));
 
   for (i = 0; i < n_local; i++){
@@ -93,23 +471,23 @@ static PetscErrorCode QPCGradReduced_Box(QPC qpc, Vec x, Vec gf, PetscReal alpha
     }
   }
 
-  PetscCall(VecRestoreArray(x, &x_a));
-  if (lb) PetscCall(VecRestoreArray(lb, &lb_a));
-  if (ub) PetscCall(VecRestoreArray(ub, &ub_a));
-  PetscCall(VecRestoreArray(gf, &gf_a));
+  PetscCall(VecRestoreArrayRead(x, &x_a));
+  if (lb) PetscCall(VecRestoreArrayRead(lb, &lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub, &ub_a));
+  PetscCall(VecRestoreArrayRead(gf, &gf_a));
   PetscCall(VecRestoreArray(gr, &gr_a));
   PetscFunctionReturn(0);
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPCFeas_Box"
-static PetscErrorCode QPCFeas_Box(QPC qpc,Vec x, Vec d, PetscScalar *alpha)
+#define __FUNCT__ "QPCFeas_Box_Reference"
+static PetscErrorCode QPCFeas_Box_Reference(QPC qpc,Vec x, Vec d, PetscScalar *alpha)
 {
   Vec                   lb,ub;
   QPC_Box               *ctx = (QPC_Box*)qpc->data;
   PetscScalar           alpha_temp, alpha_i;
 
-  PetscScalar           *x_a, *d_a, *lb_a, *ub_a;
+  const PetscScalar     *x_a, *d_a, *lb_a, *ub_a;
   PetscInt              n_local, i;
 
   PetscFunctionBegin;
@@ -119,10 +497,10 @@ static PetscErrorCode QPCFeas_Box(QPC qpc,Vec x, Vec d, PetscScalar *alpha)
   alpha_temp = PETSC_INFINITY;
 
   PetscCall(VecGetLocalSize(x,&n_local));
-  PetscCall(VecGetArray(x,&x_a));
-  PetscCall(VecGetArray(d,&d_a));
-  if (lb) PetscCall(VecGetArray(lb,&lb_a));
-  if (ub) PetscCall(VecGetArray(ub,&ub_a));
+  PetscCall(VecGetArrayRead(x,&x_a));
+  PetscCall(VecGetArrayRead(d,&d_a));
+  if (lb) PetscCall(VecGetArrayRead(lb,&lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub,&ub_a));
 
   for(i=0;i < n_local;i++){
     if(d_a[i] > 0 && lb && lb_a[i] > PETSC_NINFINITY) {
@@ -144,10 +522,10 @@ static PetscErrorCode QPCFeas_Box(QPC qpc,Vec x, Vec d, PetscScalar *alpha)
   }
   *alpha = alpha_temp;
 
-  PetscCall(VecRestoreArray(x,&x_a));
-  PetscCall(VecRestoreArray(d,&d_a));
-  if (lb) PetscCall(VecRestoreArray(lb,&lb_a));
-  if (ub) PetscCall(VecRestoreArray(ub,&ub_a));
+  PetscCall(VecRestoreArrayRead(x,&x_a));
+  PetscCall(VecRestoreArrayRead(d,&d_a));
+  if (lb) PetscCall(VecRestoreArrayRead(lb,&lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub,&ub_a));
   PetscFunctionReturn(0);
 }
 
@@ -162,6 +540,7 @@ static PetscErrorCode QPCBoxSet_Box(QPC qpc,Vec lb, Vec ub)
   PetscCall(VecDestroy(&ctx->ub));
   PetscCall(VecDestroy(&ctx->llb));
   PetscCall(VecDestroy(&ctx->lub));
+  PetscCall(QPCBoxResetActiveSet_Box(qpc));
   ctx->lb = lb;
   ctx->ub = ub;
   if (lb) {
@@ -294,8 +673,8 @@ PetscErrorCode QPCGetConstraintFunction_Box(QPC qpc, Vec x_sub, Vec *hx_out)
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPCProject_Box"
-PetscErrorCode QPCProject_Box(QPC qpc, Vec x, Vec Px)
+#define __FUNCT__ "QPCProject_Box_Reference"
+static PetscErrorCode QPCProject_Box_Reference(QPC qpc, Vec x, Vec Px)
 {
   QPC_Box         *ctx = (QPC_Box*)qpc->data;
   Vec             lb,ub;
@@ -312,6 +691,86 @@ PetscErrorCode QPCProject_Box(QPC qpc, Vec x, Vec Px)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPCProject_Box"
+/*
+  single pass min/max projection specialized for lower-only, upper-only and two-sided box
+*/
+PetscErrorCode QPCProject_Box(QPC qpc, Vec x, Vec Px)
+{
+  QPC_Box               *ctx = (QPC_Box*)qpc->data;
+  Vec                   lb,ub;
+
+  const PetscScalar     *x_a, *lb_a, *ub_a;
+  PetscScalar           *Px_a, xi;
+  PetscInt              n_local, i;
+
+  PetscFunctionBegin;
+  lb = ctx->lb;
+  ub = ctx->ub;
+  PetscCall(VecGetLocalSize(x,&n_local));
+  PetscCall(VecGetArray(Px,&Px_a));
+  if (x == Px) {
+    x_a = Px_a;
+  } else {
+    PetscCall(VecGetArrayRead(x,&x_a));
+  }
+  if (lb) PetscCall(VecGetArrayRead(lb,&lb_a));
+  if (ub) PetscCall(VecGetArrayRead(ub,&ub_a));
+
+  if (lb && ub) {
+    for (i = 0; i < n_local; i++){
+      xi      = x_a[i] > lb_a[i] ? x_a[i] : lb_a[i];
+      Px_a[i] = xi < ub_a[i] ? xi : ub_a[i];
+    }
+  } else if (lb) {
+    for (i = 0; i < n_local; i++) Px_a[i] = x_a[i] > lb_a[i] ? x_a[i] : lb_a[i];
+  } else {
+    for (i = 0; i < n_local; i++) Px_a[i] = x_a[i] < ub_a[i] ? x_a[i] : ub_a[i];
+  }
+
+  if (lb) PetscCall(VecRestoreArrayRead(lb,&lb_a));
+  if (ub) PetscCall(VecRestoreArrayRead(ub,&ub_a));
+  if (x != Px) PetscCall(VecRestoreArrayRead(x,&x_a));
+  PetscCall(VecRestoreArray(Px,&Px_a));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCBoxSetKernels_Private"
+static PetscErrorCode QPCBoxSetKernels_Private(QPC qpc)
+{
+  QPC_Box         *ctx = (QPC_Box*)qpc->data;
+
+  PetscFunctionBegin;
+  if (ctx->reference) {
+    qpc->ops->project                   = QPCProject_Box_Reference;
+    qpc->ops->feas                      = QPCFeas_Box_Reference;
+    qpc->ops->grads                     = QPCGrads_Box_Reference;
+    qpc->ops->gradsnorms                = QPCGradsNorms_Box_Reference;
+    qpc->ops->gradreduced               = QPCGradReduced_Box_Reference;
+  } else {
+    qpc->ops->project                   = QPCProject_Box;
+    qpc->ops->feas                      = QPCFeas_Box;
+    qpc->ops->grads                     = QPCGrads_Box;
+    qpc->ops->gradsnorms                = QPCGradsNorms_Box;
+    qpc->ops->gradreduced               = QPCGradReduced_Box;
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCBoxSetReferenceKernels_Box"
+static PetscErrorCode QPCBoxSetReferenceKernels_Box(QPC qpc,PetscBool flg)
+{
+  QPC_Box         *ctx = (QPC_Box*)qpc->data;
+
+  PetscFunctionBegin;
+  ctx->reference = flg;
+  PetscCall(QPCBoxSetKernels_Private(qpc));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPCView_Box"
 PetscErrorCode QPCView_Box(QPC qpc, PetscViewer viewer)
@@ -333,6 +792,16 @@ PetscErrorCode QPCView_Box(QPC qpc, PetscViewer viewer)
     PetscCall(VecView(ctx->ub,viewer));
     PetscCall(PetscViewerASCIIPopTab(viewer));
   }
+  /* print sizes of cached active and free sets */
+  if (ctx->x_id) {
+    PetscInt sizes[3];
+
+    sizes[0] = ctx->n_lb;
+    sizes[1] = ctx->n_ub;
+    sizes[2] = ctx->n_free;
+    PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,sizes,3,MPIU_INT,MPI_SUM,PetscObjectComm((PetscObject)qpc)));
+    PetscCall(PetscViewerASCIIPrintf(viewer, "active set at last x: lower %" PetscInt_FMT ", upper %" PetscInt_FMT ", free %" PetscInt_FMT "\n",sizes[0],sizes[1],sizes[2]));
+  }
   PetscFunctionReturn(0);
 }
 
@@ -446,6 +915,7 @@ PetscErrorCode QPCDestroy_Box(QPC qpc)
     PetscCall(VecDestroy(&ctx->ub));
     PetscCall(VecDestroy(&ctx->lub));
   }
+  PetscCall(QPCBoxResetActiveSet_Box(qpc));
   PetscFunctionReturn(0);
 }
 
@@ -462,28 +932,38 @@ FLLOP_EXTERN PetscErrorCode QPCCreate_Box(QPC qpc)
   /* set general QPC functions already implemented for this QPC type */
   qpc->ops->destroy                     = QPCDestroy_Box;
   qpc->ops->setup                       = QPCSetUp_Box;
+  qpc->ops->setfromoptions              = QPCSetFromOptions_Box;
   qpc->ops->view                        = QPCView_Box;
   qpc->ops->viewkkt                     = QPCViewKKT_Box;
   qpc->ops->getblocksize                = QPCGetBlockSize_Box;
   qpc->ops->getconstraintfunction       = QPCGetConstraintFunction_Box;
   qpc->ops->getnumberofconstraints      = QPCGetNumberOfConstraints_Box;
-  qpc->ops->project                     = QPCProject_Box;
   qpc->ops->islinear                    = QPCIsLinear_Box;
   qpc->ops->issubsymmetric              = QPCIsSubsymmetric_Box;
-  qpc->ops->feas                        = QPCFeas_Box;
-  qpc->ops->grads                       = QPCGrads_Box;
-  qpc->ops->gradreduced                 = QPCGradReduced_Box;
 
   /* set type-specific functions */
   PetscCall(PetscObjectComposeFunction((PetscObject)qpc,"QPCBoxSet_Box_C",QPCBoxSet_Box));
   PetscCall(PetscObjectComposeFunction((PetscObject)qpc,"QPCBoxGet_Box_C",QPCBoxGet_Box));
   PetscCall(PetscObjectComposeFunction((PetscObject)qpc,"QPCBoxGetMultipliers_Box_C",QPCBoxGetMultipliers_Box));
+  PetscCall(PetscObjectComposeFunction((PetscObject)qpc,"QPCBoxSetReferenceKernels_Box_C",QPCBoxSetReferenceKernels_Box));
 
   /* initialize type-specific inner data */
   ctx->lb                         = NULL;
   ctx->ub                         = NULL;
   ctx->llb                        = NULL;
   ctx->lub                        = NULL;
+  ctx->idx_lb                     = NULL;
+  ctx->idx_ub                     = NULL;
+  ctx->idx_free                   = NULL;
+  ctx->n_lb                       = 0;
+  ctx->n_ub                       = 0;
+  ctx->n_free                     = 0;
+  ctx->n_alloc                    = 0;
+  ctx->x_id                       = 0;
+  ctx->reference                  = PETSC_FALSE;
+
+  /* set projection, feasibility and gradient splitting kernels */
+  PetscCall(QPCBoxSetKernels_Private(qpc));
   PetscFunctionReturn(0);
 }
 
@@ -541,6 +1021,30 @@ PetscErrorCode QPCBoxGetMultipliers(QPC qpc,Vec *llb,Vec *lub)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPCBoxSetReferenceKernels"
+/*@
+QPCBoxSetReferenceKernels - use scalar reference implementation of projection, feasible step length and gradient splitting
+  instead of the default branch-free kernels specialized for lower-only, upper-only and two-sided box
+
+Parameters:
++ qpc - QPC instance
+- flg - PETSC_TRUE to use the reference kernels
+
+Options Database Key:
+. -qpc_box_reference_kernels - use the reference kernels
+
+Level: developer
+@*/
+PetscErrorCode QPCBoxSetReferenceKernels(QPC qpc,PetscBool flg)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qpc,QPC_CLASSID,1);
+  PetscValidLogicalCollectiveBool(qpc,flg,2);
+  PetscTryMethod(qpc,"QPCBoxSetReferenceKernels_Box_C",(QPC,PetscBool),(qpc,flg));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPCCreateBox"
 /*@
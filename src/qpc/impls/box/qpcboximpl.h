@@ -7,6 +7,18 @@ typedef struct {
   Vec ub;
   Vec llb;
   Vec lub;
+
+  /* cached active/free index sets, valid for x with id x_id and state x_state, bounds of states lb_state/ub_state
+     and active set tolerance astol; they are rebuilt from scratch whenever any of these changes */
+  PetscInt         *idx_lb;   /* local indices of active lower bound */
+  PetscInt         *idx_ub;   /* local indices of active upper bound */
+  PetscInt         *idx_free; /* local indices of free set */
+  PetscInt         n_lb,n_ub,n_free,n_alloc;
+  PetscObjectId    x_id;
+  PetscObjectState x_state,lb_state,ub_state;
+  PetscReal        astol;
+
+  PetscBool        reference; /* use scalar reference kernels */
 } QPC_Box;
 
 #endif
@@ -25,9 +25,9 @@ PetscErrorCode QPCCreate(MPI_Comm comm,QPC *qpc_new)
 
   qpc->lambdawork   = NULL;
   qpc->is           = NULL;
-  /* TODO QPCSetFromOptions */
   qpc->astol        = 10*PETSC_MACHINE_EPSILON;
   qpc->setupcalled  = PETSC_FALSE; /* the setup was not called yet */
+  qpc->feas_request = MPI_REQUEST_NULL;
 
   *qpc_new = qpc;
   PetscFunctionReturn(0);
@@ -75,6 +75,24 @@ PetscErrorCode QPCReset(QPC qpc)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPCSetFromOptions"
+/*@
+QPCSetFromOptions - set type-specific QPC options from the options database
+
+Parameters:
+. qpc - instance of QPC
+@*/
+PetscErrorCode QPCSetFromOptions(QPC qpc)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qpc,QPC_CLASSID,1);
+  PetscObjectOptionsBegin((PetscObject)qpc);
+  PetscTryTypeMethod(qpc,setfromoptions,PetscOptionsObject);
+  PetscOptionsEnd();
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPCView"
 PetscErrorCode QPCView(QPC qpc,PetscViewer v)
@@ -493,6 +511,28 @@ PetscErrorCode QPCProject(QPC qpc,Vec x, Vec Px)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPCFeas_Local_Private"
+static PetscErrorCode QPCFeas_Local_Private(QPC qpc, Vec x, Vec d, PetscScalar *alpha)
+{
+  Vec x_sub, d_sub;
+
+  PetscFunctionBegin;
+  if (!qpc->ops->feas) SETERRQ(PetscObjectComm((PetscObject)qpc),PETSC_ERR_SUP,"QPC type %s",((PetscObject)qpc)->type_name);
+
+  /* scatter the gradients */
+  PetscCall(QPCGetSubvector( qpc, x, &x_sub));
+  PetscCall(QPCGetSubvector( qpc, d, &d_sub));
+
+  /* compute largest step-size for the given QPC type */
+  PetscUseTypeMethod(qpc, feas, x_sub, d_sub, alpha);
+
+  /* restore the gradients */
+  PetscCall(QPCRestoreSubvector( qpc, x, &x_sub));
+  PetscCall(QPCRestoreSubvector( qpc, d, &d_sub));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPCFeas"
 /*@
@@ -505,7 +545,6 @@ Parameters:
 @*/
 PetscErrorCode QPCFeas(QPC qpc, Vec x, Vec d, PetscScalar *alpha)
 {
-  Vec x_sub, d_sub;
   PetscScalar alpha_temp;
 
   PetscFunctionBegin;
@@ -513,19 +552,65 @@ PetscErrorCode QPCFeas(QPC qpc, Vec x, Vec d, PetscScalar *alpha)
   PetscValidHeaderSpecific(x,VEC_CLASSID,2);
   PetscValidHeaderSpecific(d,VEC_CLASSID,3);
   PetscValidScalarPointer(alpha,4);
-  if (!qpc->ops->feas) SETERRQ(PetscObjectComm((PetscObject)qpc),PETSC_ERR_SUP,"QPC type %s",((PetscObject)qpc)->type_name);
 
-  /* scatter the gradients */
-  PetscCall(QPCGetSubvector( qpc, x, &x_sub));
-  PetscCall(QPCGetSubvector( qpc, d, &d_sub));
-
-  /* compute largest step-size for the given QPC type */
-  PetscUseTypeMethod(qpc, feas, x_sub, d_sub, &alpha_temp);
+  PetscCall(QPCFeas_Local_Private(qpc, x, d, &alpha_temp));
   PetscCallMPI(MPI_Allreduce(&alpha_temp, alpha, 1, MPIU_SCALAR, MPIU_MIN, PetscObjectComm((PetscObject)qpc)));
+  PetscFunctionReturn(0);
+}
 
-  /* restore the gradients */
-  PetscCall(QPCRestoreSubvector( qpc, x, &x_sub));
-  PetscCall(QPCRestoreSubvector( qpc, d, &d_sub));
+#undef __FUNCT__
+#define __FUNCT__ "QPCFeasBegin"
+/*@
+QPCFeasBegin - start computation of maximum step-size; the global minimum is reduced
+  with a nonblocking collective so that it can be overlapped with other work
+
+Parameters:
++ qpc - QPC instance
+. x - vector of variables
+- d - minus value of direction
+
+Notes:
+x and d can be modified after this call; the result is obtained with QPCFeasEnd().
+
+Level: developer
+
+.seealso: QPCFeas(), QPCFeasEnd()
+@*/
+PetscErrorCode QPCFeasBegin(QPC qpc, Vec x, Vec d)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qpc,QPC_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(d,VEC_CLASSID,3);
+  if (qpc->feas_request != MPI_REQUEST_NULL) SETERRQ(PetscObjectComm((PetscObject)qpc),PETSC_ERR_ORDER,"QPCFeasEnd() must be called before the next QPCFeasBegin()");
+
+  PetscCall(QPCFeas_Local_Private(qpc, x, d, &qpc->feas_local));
+  PetscCallMPI(MPI_Iallreduce(&qpc->feas_local, &qpc->feas_global, 1, MPIU_SCALAR, MPIU_MIN, PetscObjectComm((PetscObject)qpc), &qpc->feas_request));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPCFeasEnd"
+/*@
+QPCFeasEnd - finish computation of maximum step-size started by QPCFeasBegin()
+
+Parameters:
++ qpc - QPC instance
+- alpha - pointer to return value
+
+Level: developer
+
+.seealso: QPCFeas(), QPCFeasBegin()
+@*/
+PetscErrorCode QPCFeasEnd(QPC qpc, PetscScalar *alpha)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qpc,QPC_CLASSID,1);
+  PetscValidScalarPointer(alpha,2);
+  if (qpc->feas_request == MPI_REQUEST_NULL) SETERRQ(PetscObjectComm((PetscObject)qpc),PETSC_ERR_ORDER,"QPCFeasBegin() must be called first");
+
+  PetscCallMPI(MPI_Wait(&qpc->feas_request, MPI_STATUS_IGNORE));
+  *alpha = qpc->feas_global;
   PetscFunctionReturn(0);
 }
 
@@ -571,6 +656,68 @@ PetscErrorCode QPCGrads(QPC qpc, Vec x, Vec g, Vec gf, Vec gc)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPCGradsNorms"
+/*@
+QPCGradsNorms - compute free, chopped and projected gradient together with local parts of their squared norms
+
+The local partial sums are not reduced over the communicator so that the caller can merge
+them into a single reduction, e.g. MPI_Allreduce(MPI_IN_PLACE,dots,3,MPIU_REAL,MPIU_SUM,comm).
+
+Parameters:
++ qpc - QPC instance
+. x  - vector of variables
+. g  - gradient
+. gf - free gradient
+. gc - chopped gradient
+. gP - projected gradient gP = gf + gc
+- dots - array of length 3 filled with local parts of gP'*gP, gc'*gc and gf'*gf
+
+Level: developer
+
+.seealso: QPCGrads()
+@*/
+PetscErrorCode QPCGradsNorms(QPC qpc, Vec x, Vec g, Vec gf, Vec gc, Vec gP, PetscReal dots[])
+{
+  const PetscScalar *gf_a, *gc_a, *gP_a;
+  PetscInt          n_local, i;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qpc,QPC_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(g,VEC_CLASSID,3);
+  PetscValidHeaderSpecific(gf,VEC_CLASSID,4);
+  PetscValidHeaderSpecific(gc,VEC_CLASSID,5);
+  PetscValidHeaderSpecific(gP,VEC_CLASSID,6);
+  PetscValidRealPointer(dots,7);
+  PetscCall(QPCSetUp(qpc));
+
+  if (!qpc->is && qpc->ops->gradsnorms) {
+    /* all components are constrained, use fused single-pass kernel */
+    PetscUseTypeMethod(qpc,gradsnorms,x,g,gf,gc,gP,dots);
+    PetscFunctionReturn(0);
+  }
+
+  /* unconstrained components are not touched by the type kernel, fall back to separate passes */
+  PetscCall(QPCGrads(qpc,x,g,gf,gc));
+  PetscCall(VecWAXPY(gP,1.0,gf,gc));
+
+  dots[0] = dots[1] = dots[2] = 0.0;
+  PetscCall(VecGetLocalSize(gP,&n_local));
+  PetscCall(VecGetArrayRead(gP,&gP_a));
+  PetscCall(VecGetArrayRead(gc,&gc_a));
+  PetscCall(VecGetArrayRead(gf,&gf_a));
+  for (i = 0; i < n_local; i++) {
+    dots[0] += PetscRealPart(gP_a[i]*PetscConj(gP_a[i]));
+    dots[1] += PetscRealPart(gc_a[i]*PetscConj(gc_a[i]));
+    dots[2] += PetscRealPart(gf_a[i]*PetscConj(gf_a[i]));
+  }
+  PetscCall(VecRestoreArrayRead(gP,&gP_a));
+  PetscCall(VecRestoreArrayRead(gc,&gc_a));
+  PetscCall(VecRestoreArrayRead(gf,&gf_a));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPCGradReduced"
 /*@
@@ -7,9 +7,11 @@ PetscLogEvent QPPF_ApplyCP, QPPF_ApplyCP_gt, QPPF_ApplyCP_sc;
 PetscLogEvent QPPF_ApplyP, QPPF_ApplyQ, QPPF_ApplyHalfQ, QPPF_ApplyG, QPPF_ApplyGt;
 
 const char *QPPFVariants[] = {"zero","all","dist", "QPPFVariant","QPPF_",0};
+const char *QPPFGGtStorages[] = {"auto","sparse","dense","implicit","QPPFGGtStorage","QPPF_GGT_STORAGE_",0};
 
 #define RANK0 0
 #define G_RELATIVE_FILL 1.0
+#define GGT_DENSE_FILL 0.3
 
 
 #undef __FUNCT__
@@ -72,6 +74,101 @@ static PetscErrorCode QPPFMatMult_GtG(Mat matGtG, Vec v, Vec GtGv)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFCacheReset_Private"
+static PetscErrorCode QPPFCacheReset_Private(QPPF cp)
+{
+  PetscInt i;
+
+  PetscFunctionBegin;
+  cp->cache_pending_id = 0;
+  if (!cp->cache) PetscFunctionReturn(0);
+  for (i=0; i<cp->cache_size; i++) {
+    PetscCall(VecDestroy(&cp->cache[i].result));
+    PetscCall(VecDestroy(&cp->cache[i].alpha_tilde));
+  }
+  PetscCall(PetscFree(cp->cache));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFCacheFind_Private"
+/* look up the result of op applied to v; the key of v is returned to be passed to QPPFCacheStore_Private later, as v may be overwritten by the result;
+   count is false for the repeated lookup in the End phase of a split application */
+static PetscErrorCode QPPFCacheFind_Private(QPPF cp, QPPFCacheOp op, Vec v, PetscBool count, PetscObjectId *id, PetscObjectState *state, PetscInt *idx)
+{
+  PetscInt i;
+  QPPFCacheEntry *e;
+
+  PetscFunctionBegin;
+  *idx = -1;
+  PetscCall(PetscObjectGetId((PetscObject)v, id));
+  PetscCall(PetscObjectStateGet((PetscObject)v, state));
+  if (!cp->cache_size) PetscFunctionReturn(0);
+  for (i=0; cp->cache && i<cp->cache_size; i++) {
+    e = &cp->cache[i];
+    if (e->stamp && e->op == op && e->id == *id && e->state == *state) {
+      e->stamp = ++cp->cache_clock;
+      if (count) cp->cache_hits++;
+      *idx = i;
+      PetscFunctionReturn(0);
+    }
+  }
+  if (count) cp->cache_misses++;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFCacheGet_Private"
+static PetscErrorCode QPPFCacheGet_Private(QPPF cp, PetscInt idx, Vec y)
+{
+  QPPFCacheEntry *e = &cp->cache[idx];
+
+  PetscFunctionBegin;
+  PetscCall(VecCopy(e->result, y));
+  /* a hit of Q or P must leave alpha_tilde as the computation would */
+  if (e->op == QPPF_CACHE_OP_Q || e->op == QPPF_CACHE_OP_P) {
+    PERMON_ASSERT(e->alpha_tilde,"cached Q/P application has alpha_tilde");
+    PetscCall(VecCopy(e->alpha_tilde, cp->alpha_tilde));
+    PetscCall(PetscObjectStateIncrease((PetscObject)cp->alpha_tilde));
+  }
+  PetscCall(PetscObjectStateIncrease((PetscObject)y));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFCacheStore_Private"
+static PetscErrorCode QPPFCacheStore_Private(QPPF cp, QPPFCacheOp op, PetscObjectId id, PetscObjectState state, Vec y)
+{
+  PetscInt i, j;
+  QPPFCacheEntry *e;
+
+  PetscFunctionBegin;
+  if (!cp->cache_size) PetscFunctionReturn(0);
+  if (!cp->cache) PetscCall(PetscCalloc1(cp->cache_size, &cp->cache));
+
+  /* take an empty or the least recently used entry */
+  for (i=1, j=0; i<cp->cache_size; i++) {
+    if (cp->cache[i].stamp < cp->cache[j].stamp) j = i;
+  }
+  e = &cp->cache[j];
+  if (e->result && e->op != op) {
+    PetscCall(VecDestroy(&e->result));
+    PetscCall(VecDestroy(&e->alpha_tilde));
+  }
+  if (!e->result) PetscCall(VecDuplicate(y, &e->result));
+  PetscCall(VecCopy(y, e->result));
+  if (op == QPPF_CACHE_OP_Q || op == QPPF_CACHE_OP_P) {
+    if (!e->alpha_tilde) PetscCall(VecDuplicate(cp->alpha_tilde, &e->alpha_tilde));
+    PetscCall(VecCopy(cp->alpha_tilde, e->alpha_tilde));
+  }
+  e->op    = op;
+  e->id    = id;
+  e->state = state;
+  e->stamp = ++cp->cache_clock;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPPFCreate"
 PetscErrorCode QPPFCreate(MPI_Comm comm, QPPF* qppf_new)
@@ -90,10 +187,31 @@ PetscErrorCode QPPFCreate(MPI_Comm comm, QPPF* qppf_new)
   cp->GGtinv              = NULL;
   cp->G_left              = NULL;
   cp->Gt_right            = NULL;
-  cp->QPPFApplyQ_last_v   = NULL;
-  cp->QPPFApplyQ_last_Qv  = NULL;
+  cp->cache               = NULL;
+  cp->cache_size          = 4;
+  cp->cache_clock         = 0;
+  cp->cache_hits          = 0;
+  cp->cache_misses        = 0;
+  cp->cache_pending_id    = 0;
+  cp->cache_pending_started = PETSC_FALSE;
+  cp->fusedP              = PETSC_TRUE;
+  cp->fusedP_active       = PETSC_FALSE;
   
   cp->GGt_relative_fill   = 1.0;
+  cp->GGt_storage         = QPPF_GGT_STORAGE_AUTO;
+  cp->GGt_dense_fill      = GGT_DENSE_FILL;
+  cp->GGt_fill            = -1.0;
+  cp->GGt_dense           = PETSC_FALSE;
+
+  cp->multilevel          = PETSC_FALSE;
+  cp->ml_cluster_size     = PETSC_DECIDE;
+  cp->ml_Z                = NULL;
+  cp->ml_Gcinv            = NULL;
+  cp->ml_ksp_local        = NULL;
+  cp->ml_xloc             = NULL;
+  cp->ml_yloc             = NULL;
+  cp->ml_xc               = NULL;
+  cp->ml_yc               = NULL;
 
   cp->setupcalled         = PETSC_FALSE;
   cp->setfromoptionscalled= 0;
@@ -135,6 +253,7 @@ PetscErrorCode QPPFSetG(QPPF cp, Mat G)
   PetscCall(MatGetLocalSize(G, &cp->Gm, &cp->Gn));
   PetscCall(PetscObjectReference((PetscObject) G));
   PetscCall(PetscObjectIncrementTabLevel((PetscObject) G, (PetscObject) cp, 1));
+  PetscCall(QPPFCacheReset_Private(cp));
   cp->dataChange = PETSC_TRUE;
   cp->setupcalled = PETSC_FALSE;
   PetscFunctionReturn(0);
@@ -152,6 +271,7 @@ PetscErrorCode QPPFSetExplicitInv(QPPF cp, PetscBool explicitInv)
     cp->explicitInv = explicitInv;
     cp->explicitInvChange = PETSC_TRUE;
     cp->setupcalled = PETSC_FALSE;
+    PetscCall(QPPFCacheReset_Private(cp));
   }
   PetscFunctionReturn(0);
 }
@@ -168,12 +288,198 @@ PetscErrorCode QPPFSetRedundancy(QPPF cp, PetscInt nred)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFSetCacheSize"
+/*@
+   QPPFSetCacheSize - Set the number of remembered results of QPPF applications.
+
+   Logically Collective on QPPF
+
+   Input Parameters:
++  cp - the projector factory
+-  size - number of cache entries, 0 disables the cache
+
+   Options Database Keys:
+.  -qppf_cache_size <4> - number of cache entries
+
+   Notes:
+   Results of QPPFApplyQ(), QPPFApplyP(), QPPFApplyHalfQ(), QPPFApplyHalfQTranspose(), QPPFApplyGtG() and QPPFApplyCP()
+   are cached with the id and state of the input vector and reused if the same unchanged vector is passed again.
+   The least recently used entry is replaced. QPPFApplyP() reuses the cached results of QPPFApplyQ()
+   unless the fused P apply (-qppf_fused_P) is active.
+   The cache is dropped whenever G or the coarse problem settings change and in QPPFSetUp().
+   Split applications (QPPFApplyQBegin()/QPPFApplyQEnd(), QPPFApplyPBegin()/QPPFApplyPEnd()) look the input up
+   in the Begin phase. Only one split application can be pending; no other QPPF application may be started before its End.
+
+   Level: advanced
+
+.seealso: QPPFApplyQ(), QPPFView()
+@*/
+PetscErrorCode QPPFSetCacheSize(QPPF cp, PetscInt size)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp, QPPF_CLASSID, 1);
+  PetscValidLogicalCollectiveInt(cp, size, 2);
+  if (size < 0) SETERRQ(PetscObjectComm((PetscObject)cp),PETSC_ERR_ARG_OUTOFRANGE,"cache size must be nonnegative");
+  if (cp->cache_size == size) PetscFunctionReturn(0);
+  PetscCall(QPPFCacheReset_Private(cp));
+  cp->cache_size = size;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFSetGGtStorage"
+/*@
+   QPPFSetGGtStorage - Set storage of the coarse problem matrix GG'.
+
+   Logically Collective on QPPF
+
+   Input Parameters:
++  cp - the projector factory
+.  storage - QPPF_GGT_STORAGE_SPARSE, QPPF_GGT_STORAGE_DENSE, QPPF_GGT_STORAGE_AUTO to decide by the fill of GG',
+              or QPPF_GGT_STORAGE_IMPLICIT not to assemble GG' at all
+-  dense_fill - in the auto mode, GG' is stored as dense if its relative fill exceeds this value (PETSC_DEFAULT for 0.3)
+
+   Options Database Keys:
++  -qppf_GGt_storage <auto,sparse,dense,implicit> - GG' storage
+.  -qppf_GGt_dense_fill <0.3> - fill threshold for the auto mode
+-  -qppf_explicit_GGt <true> - false is the same as -qppf_GGt_storage implicit
+
+   Notes:
+   The factorization used for GG' follows from its storage, see MatCreateInv().
+   Implicit GG' is applied as the product of G and G' and can be solved only iteratively.
+   The auto mode chooses dense storage only if GG' is factored sequentially, i.e. on one rank or with full redundancy,
+   since a parallel dense Cholesky factorization is not available by default.
+   Changing the storage resets the projector factory, see QPPFReset().
+
+   Level: advanced
+
+.seealso: QPPFGetGGtStorage(), QPPFSetExplicitInv(), QPPFView()
+@*/
+PetscErrorCode QPPFSetGGtStorage(QPPF cp, QPPFGGtStorage storage, PetscReal dense_fill)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp, QPPF_CLASSID, 1);
+  PetscValidLogicalCollectiveEnum(cp, storage, 2);
+  PetscValidLogicalCollectiveReal(cp, dense_fill, 3);
+  if (dense_fill == PETSC_DEFAULT) dense_fill = GGT_DENSE_FILL;
+  if (dense_fill < 0.0 || dense_fill > 1.0) SETERRQ(PetscObjectComm((PetscObject)cp),PETSC_ERR_ARG_OUTOFRANGE,"dense_fill must be in [0,1]");
+  if (cp->GGt_storage != storage || cp->GGt_dense_fill != dense_fill) {
+    cp->GGt_storage = storage;
+    cp->GGt_dense_fill = dense_fill;
+    PetscCall(QPPFReset(cp));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFGetGGtStorage"
+/*@
+   QPPFGetGGtStorage - Get storage settings of the coarse problem matrix GG'.
+
+   Not Collective
+
+   Input Parameter:
+.  cp - the projector factory
+
+   Output Parameters:
++  storage - the requested storage
+-  dense_fill - fill threshold for the auto mode
+
+   Level: advanced
+
+.seealso: QPPFSetGGtStorage()
+@*/
+PetscErrorCode QPPFGetGGtStorage(QPPF cp, QPPFGGtStorage *storage, PetscReal *dense_fill)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp, QPPF_CLASSID, 1);
+  if (storage) *storage = cp->GGt_storage;
+  if (dense_fill) *dense_fill = cp->GGt_dense_fill;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFSetMultilevel"
+/*@
+   QPPFSetMultilevel - Solve the coarse problem GG' iteratively, preconditioned with a cluster-level coarse problem.
+
+   Logically Collective on QPPF
+
+   Input Parameters:
++  cp - the projector factory
+.  multilevel - use the multilevel mode
+-  cluster_size - number of consecutive ranks aggregated into one cluster (PETSC_DECIDE for about the square root of the communicator size)
+
+   Options Database Keys:
++  -qppf_multilevel - use the multilevel mode
+-  -qppf_multilevel_cluster_size <n> - cluster size
+
+   Notes:
+   This is the hierarchical (three-level) TFETI approach for problems where GG' is too large to be factored directly.
+   The i-th coarse DOF (row of G) owned by each rank of a cluster is aggregated into the i-th coarse DOF of the cluster,
+   giving the aggregation matrix Z. GG' is then solved by CG with the additive preconditioner
+   Z*inv(Z'*GG'*Z)*Z' + inv(D), where D is the rank-local diagonal block of GG'.
+   The cluster coarse problem Z'*GG'*Z is factored as GG' normally is, so the QPPF redundancy applies to it.
+   The solvers can be configured with the prefixes qppf_mat_inv_ (outer CG), qppf_ml_mat_inv_ (cluster coarse problem)
+   and qppf_ml_local_ (local blocks). GG' must be assembled explicitly and is stored as sparse.
+   QPPFApplyCP() and the projector applications use this mode transparently.
+
+   Level: advanced
+
+.seealso: QPPFGetMultilevel(), QPPFSetRedundancy(), QPPFApplyCP()
+@*/
+PetscErrorCode QPPFSetMultilevel(QPPF cp, PetscBool multilevel, PetscInt cluster_size)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp, QPPF_CLASSID, 1);
+  PetscValidLogicalCollectiveBool(cp, multilevel, 2);
+  PetscValidLogicalCollectiveInt(cp, cluster_size, 3);
+  if (cluster_size == PETSC_DEFAULT) cluster_size = PETSC_DECIDE;
+  if (cluster_size != PETSC_DECIDE && cluster_size < 1) SETERRQ(PetscObjectComm((PetscObject)cp),PETSC_ERR_ARG_OUTOFRANGE,"cluster size must be positive");
+  if (cp->multilevel != multilevel || cp->ml_cluster_size != cluster_size) {
+    cp->multilevel = multilevel;
+    cp->ml_cluster_size = cluster_size;
+    PetscCall(QPPFReset(cp));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFGetMultilevel"
+/*@
+   QPPFGetMultilevel - Get settings of the multilevel mode.
+
+   Not Collective
+
+   Input Parameter:
+.  cp - the projector factory
+
+   Output Parameters:
++  multilevel - whether the multilevel mode is used
+-  cluster_size - number of ranks per cluster (PETSC_DECIDE if not set and QPPFSetUp() has not been called yet)
+
+   Level: advanced
+
+.seealso: QPPFSetMultilevel()
+@*/
+PetscErrorCode QPPFGetMultilevel(QPPF cp, PetscBool *multilevel, PetscInt *cluster_size)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp, QPPF_CLASSID, 1);
+  if (multilevel) *multilevel = cp->multilevel;
+  if (cluster_size) *cluster_size = cp->ml_cluster_size;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPPFSetFromOptions"
 PetscErrorCode QPPFSetFromOptions(QPPF cp)
 {
-  PetscBool set, flg;
+  PetscBool set, flg, set1;
   PetscInt nred;
+  QPPFGGtStorage storage;
+  PetscReal dense_fill;
 
   PetscFunctionBegin;
   PetscValidHeaderSpecific(cp, QPPF_CLASSID, 1);
@@ -184,6 +490,27 @@ PetscErrorCode QPPFSetFromOptions(QPPF cp)
 
   PetscCall(PetscOptionsInt("-qppf_redundancy", "number of parallel redundant solves of CP, each with (size of CP's comm)/qppf_redundancy processes", "QPPFSetRedundancy", cp->redundancy, &nred, &set));
   if (set) PetscCall(QPPFSetRedundancy(cp, nred));
+
+  PetscCall(PetscOptionsInt("-qppf_cache_size", "number of cached results of QPPF applications", "QPPFSetCacheSize", cp->cache_size, &nred, &set));
+  if (set) PetscCall(QPPFSetCacheSize(cp, nred));
+
+  PetscCall(PetscOptionsBool("-qppf_fused_P", "apply P = I - G'*inv(GG')*G in one pass over G when G is AIJ", "QPPFApplyP", cp->fusedP, &cp->fusedP, NULL));
+
+  storage = cp->GGt_storage;
+  dense_fill = cp->GGt_dense_fill;
+  flg = (PetscBool)(storage != QPPF_GGT_STORAGE_IMPLICIT);
+  PetscCall(PetscOptionsBool("-qppf_explicit_GGt", "assemble GGt explicitly, false is the same as -qppf_GGt_storage implicit", "QPPFSetGGtStorage", flg, &flg, &set));
+  if (set && !flg) storage = QPPF_GGT_STORAGE_IMPLICIT;
+  else if (set && storage == QPPF_GGT_STORAGE_IMPLICIT) storage = QPPF_GGT_STORAGE_AUTO;
+  PetscCall(PetscOptionsEnum("-qppf_GGt_storage", "storage of GGt", "QPPFSetGGtStorage", QPPFGGtStorages, (PetscEnum)storage, (PetscEnum*)&storage, &set));
+  PetscCall(PetscOptionsReal("-qppf_GGt_dense_fill", "GGt is stored as dense above this relative fill (auto storage)", "QPPFSetGGtStorage", dense_fill, &dense_fill, &set1));
+  if (storage != cp->GGt_storage || set1) PetscCall(QPPFSetGGtStorage(cp, storage, dense_fill));
+
+  flg = cp->multilevel;
+  nred = cp->ml_cluster_size;
+  PetscCall(PetscOptionsBool("-qppf_multilevel", "solve GGt by CG preconditioned with a cluster coarse problem", "QPPFSetMultilevel", flg, &flg, &set));
+  PetscCall(PetscOptionsInt("-qppf_multilevel_cluster_size", "number of ranks aggregated into one cluster", "QPPFSetMultilevel", nred, &nred, &set1));
+  if (set || set1) PetscCall(QPPFSetMultilevel(cp, flg, nred));
   
   cp->setfromoptionscalled++;
   PetscOptionsEnd();
@@ -213,13 +540,65 @@ static PetscErrorCode QPPFSetUpGt_Private(QPPF cp, Mat *newGt)
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFSetUpGGtStorage_Private"
+/* measure the fill of assembled GGt and convert it to the requested (sparse or dense) storage */
+static PetscErrorCode QPPFSetUpGGtStorage_Private(QPPF cp, Mat *GGt)
+{
+  MatInfo info;
+  PetscInt M;
+  PetscBool dense;
+
+  PetscFunctionBeginI;
+  PetscCall(MatGetSize(*GGt, &M, NULL));
+  PetscCall(PetscObjectBaseTypeCompareAny((PetscObject)*GGt, &dense, MATSEQDENSE, MATMPIDENSE, ""));
+  cp->GGt_fill = -1.0;
+  if ((*GGt)->ops->getinfo && M) {
+    PetscCall(MatGetInfo(*GGt, MAT_GLOBAL_SUM, &info));
+    cp->GGt_fill = info.nz_used / ((PetscReal)M * (PetscReal)M);
+  }
+
+  /* the multilevel mode needs sparse GGt */
+  switch (cp->multilevel ? QPPF_GGT_STORAGE_SPARSE : cp->GGt_storage) {
+    case QPPF_GGT_STORAGE_SPARSE:
+      if (dense) {
+        PetscCall(MatConvert(*GGt, MATAIJ, MAT_INPLACE_MATRIX, GGt));
+        dense = PETSC_FALSE;
+      }
+      break;
+    case QPPF_GGT_STORAGE_DENSE:
+      if (!dense) {
+        PetscCall(MatConvert(*GGt, MATDENSE, MAT_INPLACE_MATRIX, GGt));
+        dense = PETSC_TRUE;
+      }
+      break;
+    default:
+      /* MatInv factors GGt by PETSc Cholesky unless a parallel sparse direct solver takes it, which is not available
+         for MPIDENSE; so dense storage is chosen only if each factorization is sequential, i.e. on one rank or with full
+         redundancy (the default redundancy resolves to full for non-parallel factorizations) */
+      if (!dense && cp->GGt_fill > cp->GGt_dense_fill) {
+        PetscMPIInt size;
+
+        PetscCallMPI(MPI_Comm_size(PetscObjectComm((PetscObject)cp), &size));
+        if (size == 1 || cp->redundancy < 0 || cp->redundancy == size) {
+          PetscCall(MatConvert(*GGt, MATDENSE, MAT_INPLACE_MATRIX, GGt));
+          dense = PETSC_TRUE;
+        } else {
+          PetscCall(PetscInfo(cp, "GGt fill %.3g exceeds the dense threshold but redundancy %" PetscInt_FMT " < %d gives a parallel factorization ==> keeping sparse GGt\n", (double)cp->GGt_fill, cp->redundancy, size));
+        }
+      }
+  }
+  cp->GGt_dense = dense;
+  PetscCall(PetscInfo(cp, "GGt fill %.3g (dense threshold %.3g, storage %s), using %s GGt\n", (double)cp->GGt_fill, (double)cp->GGt_dense_fill, QPPFGGtStorages[cp->GGt_storage], dense ? "dense" : "sparse"));
+  PetscFunctionReturnI(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPPFSetUpGGt_Private"
 static PetscErrorCode QPPFSetUpGGt_Private(QPPF cp, Mat *newGGt)
 {
   MPI_Comm comm;
   Mat GGt=NULL;
-  PetscBool GGt_explicit = PETSC_TRUE;
   PetscErrorCode ierr;
 
   PetscFunctionBeginI;
@@ -235,17 +614,11 @@ static PetscErrorCode QPPFSetUpGGt_Private(QPPF cp, Mat *newGGt)
 
   PetscCall(PetscLogEventBegin(QPPF_SetUp_GGt,cp,0,0,0));
   
-  PetscObjectOptionsBegin((PetscObject)cp);
-  //TODO DIRTY
-  PetscCall(PetscOptionsGetBool(NULL,NULL,"-qpt_dualize_explicit_G",&GGt_explicit,NULL));
-  if (GGt_explicit) {//implicit G -> implicit GGt
-    PetscCall(PetscOptionsGetBool(((PetscObject)cp)->options,NULL,"-qppf_explicit_GGt",&GGt_explicit,NULL));
-  }
-  PetscOptionsEnd();
-
-  if (GGt_explicit) {
-    //TODO if GGt fill > 0.3, use PETSC_FALSE (dense result)
+  cp->GGt_dense = PETSC_FALSE;
+  cp->GGt_fill = -1.0;
+  if (cp->GGt_storage != QPPF_GGT_STORAGE_IMPLICIT) {
     PetscCall(PermonMatMatMult(cp->G,cp->Gt,MAT_INITIAL_MATRIX,cp->GGt_relative_fill,&GGt));
+    PetscCall(QPPFSetUpGGtStorage_Private(cp,&GGt));
   } else {
     Mat GGt_arr[3];
 
@@ -284,6 +657,124 @@ static PetscErrorCode QPPFSetUpGGt_Private(QPPF cp, Mat *newGGt)
   PetscFunctionReturnI(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFMultilevelPCApply_Private"
+/* y = inv(D)*x + Z*inv(Z'*GG'*Z)*Z'*x */
+static PetscErrorCode QPPFMultilevelPCApply_Private(PC pc, Vec x, Vec y)
+{
+  QPPF cp;
+  const PetscScalar *xarr;
+  PetscScalar *yarr;
+
+  PetscFunctionBegin;
+  PetscCall(PCShellGetContext(pc, &cp));
+
+  /* rank-local blocks */
+  PetscCall(VecGetArrayRead(x, &xarr));
+  PetscCall(VecGetArray(y, &yarr));
+  PetscCall(VecPlaceArray(cp->ml_xloc, xarr));
+  PetscCall(VecPlaceArray(cp->ml_yloc, yarr));
+  PetscCall(KSPSolve(cp->ml_ksp_local, cp->ml_xloc, cp->ml_yloc));
+  PetscCall(VecResetArray(cp->ml_xloc));
+  PetscCall(VecResetArray(cp->ml_yloc));
+  PetscCall(VecRestoreArrayRead(x, &xarr));
+  PetscCall(VecRestoreArray(y, &yarr));
+
+  /* cluster coarse problem */
+  PetscCall(MatMultTranspose(cp->ml_Z, x, cp->ml_xc));
+  PetscCall(MatMult(cp->ml_Gcinv, cp->ml_xc, cp->ml_yc));
+  PetscCall(MatMultAdd(cp->ml_Z, cp->ml_yc, y, y));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFSetUpMultilevel_Private"
+/* replace the direct solver of GGt held by GGtinv with CG preconditioned by the cluster coarse problem */
+static PetscErrorCode QPPFSetUpMultilevel_Private(QPPF cp, Mat GGt, Mat GGtinv)
+{
+  MPI_Comm comm, ccomm;
+  PetscMPIInt rank, size, crank;
+  PetscInt i, nc, rstart, cstart;
+  PetscBool flg;
+  Mat Gc, Dloc;
+  KSP ksp;
+  PC pc;
+  const char *prefix;
+
+  PetscFunctionBeginI;
+  PetscCall(PetscObjectGetComm((PetscObject)cp, &comm));
+  PetscCallMPI(MPI_Comm_rank(comm, &rank));
+  PetscCallMPI(MPI_Comm_size(comm, &size));
+  PetscCall(PetscObjectBaseTypeCompareAny((PetscObject)GGt, &flg, MATSEQAIJ, MATMPIAIJ, ""));
+  if (!flg) SETERRQ(comm,PETSC_ERR_SUP,"multilevel QPPF needs explicitly assembled AIJ GGt, got %s",((PetscObject)GGt)->type_name);
+  if (cp->explicitInv) SETERRQ(comm,PETSC_ERR_SUP,"multilevel QPPF cannot be combined with explicit inverse of GGt");
+  if (cp->ml_cluster_size == PETSC_DECIDE) cp->ml_cluster_size = PetscMax(1, (PetscInt)PetscSqrtReal((PetscReal)size));
+  PetscCall(PetscObjectGetOptionsPrefix((PetscObject)cp, &prefix));
+
+  /* aggregation Z - the i-th local row of each rank of a cluster goes to the i-th column of the cluster, columns owned by the first rank of the cluster */
+  PetscCallMPI(MPI_Comm_split(comm, (PetscMPIInt)(rank/cp->ml_cluster_size), rank, &ccomm));
+  PetscCallMPI(MPI_Comm_rank(ccomm, &crank));
+  PetscCallMPI(MPI_Allreduce(&cp->Gm, &nc, 1, MPIU_INT, MPI_MAX, ccomm));
+  PetscCall(MatCreateAIJ(comm, cp->Gm, crank ? 0 : nc, PETSC_DETERMINE, PETSC_DETERMINE, 1, NULL, 1, NULL, &cp->ml_Z));
+  PetscCall(MatGetOwnershipRange(cp->ml_Z, &rstart, NULL));
+  PetscCall(MatGetOwnershipRangeColumn(cp->ml_Z, &cstart, NULL));
+  PetscCallMPI(MPI_Bcast(&cstart, 1, MPIU_INT, 0, ccomm));
+  PetscCallMPI(MPI_Comm_free(&ccomm));
+  for (i=0; i<cp->Gm; i++) PetscCall(MatSetValue(cp->ml_Z, rstart+i, cstart+i, 1.0, INSERT_VALUES));
+  PetscCall(MatAssemblyBegin(cp->ml_Z, MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(  cp->ml_Z, MAT_FINAL_ASSEMBLY));
+  PetscCall(PetscObjectSetName((PetscObject)cp->ml_Z, "Z"));
+  PetscCall(MatCreateVecs(cp->ml_Z, &cp->ml_xc, &cp->ml_yc));
+
+  /* cluster coarse problem Gc = Z'*GG'*Z, SPD as Z has full column rank */
+  PetscCall(MatPtAP(GGt, cp->ml_Z, MAT_INITIAL_MATRIX, PETSC_DEFAULT, &Gc));
+  PetscCall(PetscObjectSetName((PetscObject)Gc, "GGt_cluster"));
+  PetscCall(MatSetOption(Gc, MAT_SYMMETRIC, PETSC_TRUE));
+  PetscCall(MatSetOption(Gc, MAT_SPD, PETSC_TRUE));
+  PetscCall(MatCreateInv(Gc, MAT_INV_MONOLITHIC, &cp->ml_Gcinv));
+  PetscCall(PetscObjectSetName((PetscObject)cp->ml_Gcinv, "GGt_cluster_inv"));
+  PetscCall(PetscObjectIncrementTabLevel((PetscObject)cp->ml_Gcinv, (PetscObject)cp, 1));
+  PetscCall(MatSetOptionsPrefix(cp->ml_Gcinv, prefix));
+  PetscCall(MatAppendOptionsPrefix(cp->ml_Gcinv, "qppf_ml_"));
+  PetscCall(MatInvSetRedundancy(cp->ml_Gcinv, cp->redundancy));
+  if (cp->setfromoptionscalled) PetscCall(PermonMatSetFromOptions(cp->ml_Gcinv));
+  PetscCall(MatAssemblyBegin(cp->ml_Gcinv, MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(  cp->ml_Gcinv, MAT_FINAL_ASSEMBLY));
+  PetscCall(MatInvGetRedundancy(cp->ml_Gcinv, &cp->redundancy));
+  PetscCall(MatInvSetUp(cp->ml_Gcinv));
+  PetscCall(MatDestroy(&Gc));
+
+  /* rank-local diagonal block of GGt */
+  PetscCall(MatGetDiagonalBlock(GGt, &Dloc));
+  PetscCall(KSPCreate(PETSC_COMM_SELF, &cp->ml_ksp_local));
+  PetscCall(PetscObjectIncrementTabLevel((PetscObject)cp->ml_ksp_local, (PetscObject)cp, 1));
+  PetscCall(KSPSetOperators(cp->ml_ksp_local, Dloc, Dloc));
+  PetscCall(KSPSetType(cp->ml_ksp_local, KSPPREONLY));
+  PetscCall(KSPGetPC(cp->ml_ksp_local, &pc));
+  PetscCall(PCSetType(pc, PCCHOLESKY));
+  PetscCall(KSPSetOptionsPrefix(cp->ml_ksp_local, prefix));
+  PetscCall(KSPAppendOptionsPrefix(cp->ml_ksp_local, "qppf_ml_local_"));
+  if (cp->setfromoptionscalled) PetscCall(KSPSetFromOptions(cp->ml_ksp_local));
+  PetscCall(KSPSetUp(cp->ml_ksp_local));
+  PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF, 1, cp->Gm, NULL, &cp->ml_xloc));
+  PetscCall(VecCreateSeqWithArray(PETSC_COMM_SELF, 1, cp->Gm, NULL, &cp->ml_yloc));
+
+  /* outer CG on GGt, no redundant solve */
+  PetscCall(MatInvSetRedundancy(GGtinv, 0));
+  PetscCall(MatInvCreateInnerObjects(GGtinv));
+  PetscCall(MatInvGetKSP(GGtinv, &ksp));
+  PetscCall(KSPSetType(ksp, KSPCG));
+  PetscCall(KSPGetPC(ksp, &pc));
+  PetscCall(PCSetType(pc, PCSHELL));
+  PetscCall(PCShellSetContext(pc, cp));
+  PetscCall(PCShellSetApply(pc, QPPFMultilevelPCApply_Private));
+  PetscCall(PCShellSetName(pc, "QPPF multilevel (cluster coarse problem + local blocks)"));
+  if (cp->setfromoptionscalled) PetscCall(KSPSetFromOptions(ksp));
+
+  PetscCall(PetscInfo(cp, "multilevel coarse problem: %" PetscInt_FMT " coarse DOFs aggregated into %" PetscInt_FMT " cluster DOFs, cluster size %" PetscInt_FMT "\n", cp->GM, cp->ml_Z->cmap->N, cp->ml_cluster_size));
+  PetscFunctionReturnI(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPPFSetUpGGtinv_Private"
 static PetscErrorCode QPPFSetUpGGtinv_Private(QPPF cp, Mat *GGtinv_new)
@@ -307,9 +798,8 @@ static PetscErrorCode QPPFSetUpGGtinv_Private(QPPF cp, Mat *GGtinv_new)
   PetscCall(PetscObjectSetName((PetscObject) GGtinv, "GGtinv"));
   PetscCall(MatSetOptionsPrefix(GGtinv, ((PetscObject)cp)->prefix));
   PetscCall(MatAppendOptionsPrefix(GGtinv, "qppf_"));
-  PetscCall(MatDestroy(&GGt));
   
-  PetscCall(MatInvSetRedundancy(GGtinv, cp->redundancy));
+  if (!cp->multilevel) PetscCall(MatInvSetRedundancy(GGtinv, cp->redundancy));
 
   if (cp->setfromoptionscalled) {
     PetscCall(PermonMatSetFromOptions(GGtinv));
@@ -318,7 +808,12 @@ static PetscErrorCode QPPFSetUpGGtinv_Private(QPPF cp, Mat *GGtinv_new)
   PetscCall(MatAssemblyBegin(GGtinv, MAT_FINAL_ASSEMBLY));
   PetscCall(MatAssemblyEnd(  GGtinv, MAT_FINAL_ASSEMBLY));
 
-  PetscCall(MatInvGetRedundancy(GGtinv, &cp->redundancy));
+  if (cp->multilevel) {
+    PetscCall(QPPFSetUpMultilevel_Private(cp, GGt, GGtinv));
+  } else {
+    PetscCall(MatInvGetRedundancy(GGtinv, &cp->redundancy));
+  }
+  PetscCall(MatDestroy(&GGt));
   
   if (cp->explicitInv) {
     Mat GGtinv_explicit;
@@ -370,8 +865,15 @@ PetscErrorCode QPPFReset(QPPF cp)
   PetscCall(VecDestroy(&cp->Gt_right));
   PetscCall(VecDestroy(&cp->G_left));
   PetscCall(VecDestroy(&cp->alpha_tilde));
-  PetscCall(VecDestroy(&cp->QPPFApplyQ_last_Qv));
+  PetscCall(QPPFCacheReset_Private(cp));
   PetscCall(MatDestroy(&cp->Gt));
+  PetscCall(MatDestroy(&cp->ml_Z));
+  PetscCall(MatDestroy(&cp->ml_Gcinv));
+  PetscCall(KSPDestroy(&cp->ml_ksp_local));
+  PetscCall(VecDestroy(&cp->ml_xloc));
+  PetscCall(VecDestroy(&cp->ml_yloc));
+  PetscCall(VecDestroy(&cp->ml_xc));
+  PetscCall(VecDestroy(&cp->ml_yc));
   PetscFunctionReturn(0);
 }
 
@@ -391,6 +893,7 @@ PetscErrorCode QPPFSetUp(QPPF cp)
 
   FllopTraceBegin;
   PetscCall(PetscLogEventBegin(QPPF_SetUp, cp, cp->GGtinv, cp->G, cp->Gt));
+  PetscCall(QPPFCacheReset_Private(cp));
 
   PetscCall(PetscObjectGetComm((PetscObject) cp, &comm));
   PetscCallMPI(MPI_Comm_rank(comm, &rank));
@@ -420,6 +923,12 @@ PetscErrorCode QPPFSetUp(QPPF cp)
   PetscCall(VecDuplicate(cp->G_left, &(cp->alpha_tilde)));
   PetscCall(VecZeroEntries(cp->alpha_tilde));
 
+  /* fused P apply needs the transpose multiply-add of assembled G */
+  cp->fusedP_active = PETSC_FALSE;
+  if (cp->fusedP) {
+    PetscCall(PetscObjectBaseTypeCompareAny((PetscObject)cp->G, &cp->fusedP_active, MATSEQAIJ, MATMPIAIJ, ""));
+  }
+
   if (cp->GGtinv && !cp->explicitInv) PetscCall(MatInvSetUp(cp->GGtinv));
 
   cp->it_GGtinvv       = 0;
@@ -460,69 +969,165 @@ PetscErrorCode QPPFGetAlphaTilde(QPPF cp, Vec *alpha_tilde)
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPPFApplyQ"
-/* Applies the orthogonal projector Q = G'*inv(G*G')*G to vector v */
-PetscErrorCode QPPFApplyQ(QPPF cp, Vec v, Vec Qv)
+#define __FUNCT__ "QPPFCheckNotPending_Private"
+/* the work vectors and the coarse solver are shared, so nothing may run between QPPFApply[QP]Begin() and QPPFApply[QP]End() */
+static PetscErrorCode QPPFCheckNotPending_Private(QPPF cp)
 {
-  Vec Gt_right;
+  PetscFunctionBegin;
+  if (cp->cache_pending_id) SETERRQ(PetscObjectComm((PetscObject)cp),PETSC_ERR_ORDER,"a split QPPF application is pending, call QPPFApplyQEnd() or QPPFApplyPEnd() first");
+  PetscFunctionReturn(0);
+}
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyGStart_Private"
+/* G_left = G*v and start of the coarse solve */
+static PetscErrorCode QPPFApplyGStart_Private(QPPF cp, Vec v)
+{
   PetscFunctionBegin;
-  PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
-  PetscValidHeaderSpecific(v,VEC_CLASSID,2);
-  PetscValidHeaderSpecific(Qv,VEC_CLASSID,3);
+  PetscCall(PetscLogEventBegin(QPPF_ApplyG,cp,v,0,0));
+  PetscCall(MatMult(cp->G, v, cp->G_left));
+  PetscCall(PetscLogEventEnd(QPPF_ApplyG,cp,v,0,0));
 
-  /* if v is the same as the last time, reuse the last computed product Q*v */
-  if (v == cp->QPPFApplyQ_last_v && ((PetscObject)v)->state == cp->QPPFApplyQ_last_v_state && cp->QPPFApplyQ_last_Qv) {
-    PetscCall(VecCopy(cp->QPPFApplyQ_last_Qv, Qv));
-    PetscFunctionReturn(0);
+  if (!cp->G_has_orthonormal_rows_explicitly) {
+    PetscCall(QPPFApplyCPBegin(cp, cp->G_left));
   }
-  
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyGBegin_Private"
+/* common first phase of Q and P: cache lookup, G_left = G*v and start of the coarse solve; v is remembered as the pending input */
+static PetscErrorCode QPPFApplyGBegin_Private(QPPF cp, QPPFCacheOp op, Vec v)
+{
+  PetscObjectId id;
+  PetscObjectState state;
+  PetscInt idx;
+
+  PetscFunctionBegin;
+  /* set up first, it drops the results cached for outdated data */
   PetscCall(QPPFSetUp(cp));
+  PetscCall(QPPFCheckNotPending_Private(cp));
+
+  /* if the result has been computed for unchanged v, it is taken in the End phase */
+  PetscCall(QPPFCacheFind_Private(cp, op, v, PETSC_TRUE, &id, &state, &idx));
+  if (idx < 0) PetscCall(QPPFApplyGStart_Private(cp, v));
+  cp->cache_pending_id      = id;
+  cp->cache_pending_state   = state;
+  cp->cache_pending_started = (PetscBool)(idx < 0);
+  PetscFunctionReturn(0);
+}
 
-  PetscCall(PetscLogEventBegin(QPPF_ApplyQ,cp,v,Qv,0));
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyGEnd_Private"
+/* common second phase of Q and P: y is the cached result if found in Begin (*hit true), otherwise Gt_right = (GG^T)^{-1} * G*v is finished */
+static PetscErrorCode QPPFApplyGEnd_Private(QPPF cp, QPPFCacheOp op, Vec v, Vec y, PetscBool *hit, PetscObjectId *id, PetscObjectState *state, Vec *Gt_right)
+{
+  PetscInt idx;
 
-  /* G_left = G*v */
-  PetscCall(PetscLogEventBegin(QPPF_ApplyG,cp,v,0,0));
-  PetscCall(MatMult(cp->G, v, cp->G_left));
-  PetscCall(PetscLogEventEnd(QPPF_ApplyG,cp,v,0,0));
+  PetscFunctionBegin;
+  PetscCall(PetscObjectGetId((PetscObject)v, id));
+  PetscCall(PetscObjectStateGet((PetscObject)v, state));
+  if (cp->cache_pending_id != *id || cp->cache_pending_state != *state) SETERRQ(PetscObjectComm((PetscObject)cp),PETSC_ERR_ORDER,"no pending split QPPF application of this vector; v must not change and the projector must not be reset between Begin and End");
+  cp->cache_pending_id = 0;
+
+  if (!cp->cache_pending_started) {
+    PetscCall(QPPFCacheFind_Private(cp, op, v, PETSC_FALSE, id, state, &idx));
+    if (idx < 0) SETERRQ(PetscObjectComm((PetscObject)cp),PETSC_ERR_PLIB,"result found in the Begin phase has been dropped from the cache");
+    PetscCall(QPPFCacheGet_Private(cp, idx, y));
+    *hit = PETSC_TRUE;
+    PetscFunctionReturn(0);
+  }
+  *hit = PETSC_FALSE;
 
   if (!cp->G_has_orthonormal_rows_explicitly) {
-    /* Gt_right = (GG^T)^{-1} * G_left */
-    PetscCall(QPPFApplyCP(cp, cp->G_left, cp->Gt_right));
-    Gt_right = cp->Gt_right;
+    PetscCall(QPPFApplyCPEnd(cp, cp->G_left, cp->Gt_right));
+    *Gt_right = cp->Gt_right;
   } else {
-    Gt_right = cp->G_left;
+    *Gt_right = cp->G_left;
   }
 
   /* alpha_tilde = (GG^T)^{-1} * G_left */
-  PetscCall(VecCopy(cp->Gt_right, cp->alpha_tilde));
+  PetscCall(VecCopy(*Gt_right, cp->alpha_tilde));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyQBegin"
+/* Begins applying Q; G*v is computed and the coarse solve is started, see QPPFApplyCPBegin().
+   Until QPPFApplyQEnd(), v must not be changed and no other application of cp may be started. */
+PetscErrorCode QPPFApplyQBegin(QPPF cp, Vec v)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
+  PetscValidHeaderSpecific(v,VEC_CLASSID,2);
+  PetscCall(QPPFApplyGBegin_Private(cp, QPPF_CACHE_OP_Q, v));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyQEnd"
+PetscErrorCode QPPFApplyQEnd(QPPF cp, Vec v, Vec Qv)
+{
+  Vec Gt_right;
+  PetscObjectId id;
+  PetscObjectState state;
+  PetscBool hit;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
+  PetscValidHeaderSpecific(v,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(Qv,VEC_CLASSID,3);
+
+  PetscCall(PetscLogEventBegin(QPPF_ApplyQ,cp,v,Qv,0));
+  PetscCall(QPPFApplyGEnd_Private(cp, QPPF_CACHE_OP_Q, v, Qv, &hit, &id, &state, &Gt_right));
+  if (hit) {
+    PetscCall(PetscLogEventEnd(QPPF_ApplyQ,cp,v,Qv,0));
+    PetscFunctionReturn(0);
+  }
   
   /* Qv = Gt*Gt_right */
   PetscCall(PetscLogEventBegin(QPPF_ApplyGt,cp,Qv,0,0));
   PetscCall(MatMult(cp->Gt, Gt_right, Qv));
   PetscCall(PetscLogEventEnd(QPPF_ApplyGt,cp,Qv,0,0));
 
-  /* remember current v and Qv */
-  cp->QPPFApplyQ_last_v  = v;
-  if (!cp->QPPFApplyQ_last_Qv) PetscCall(VecDuplicate(Qv,&cp->QPPFApplyQ_last_Qv));
-  PetscCall(VecCopy(Qv, cp->QPPFApplyQ_last_Qv));
-  PetscCall(PetscObjectStateGet((PetscObject)v,&cp->QPPFApplyQ_last_v_state));
+  /* remember Qv for the key of v taken before Qv was written */
+  PetscCall(QPPFCacheStore_Private(cp, QPPF_CACHE_OP_Q, id, state, Qv));
 
   PetscCall(PetscLogEventEnd(QPPF_ApplyQ,cp,v,Qv,0));
   PetscCall(PetscObjectStateIncrease((PetscObject)Qv));
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyQ"
+/* Applies the orthogonal projector Q = G'*inv(G*G')*G to vector v */
+PetscErrorCode QPPFApplyQ(QPPF cp, Vec v, Vec Qv)
+{
+  PetscFunctionBegin;
+  PetscCall(QPPFApplyQBegin(cp, v));
+  PetscCall(QPPFApplyQEnd(cp, v, Qv));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPPFApplyHalfQ"
 PetscErrorCode QPPFApplyHalfQ(QPPF cp, Vec x, Vec y)
 {
+  PetscObjectId id;
+  PetscObjectState state;
+  PetscInt idx;
 
   PetscFunctionBeginI;
   PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
   PetscValidHeaderSpecific(x,VEC_CLASSID,2);
   PetscValidHeaderSpecific(y,VEC_CLASSID,3);
   PetscCall(QPPFSetUp(cp));
+  PetscCall(QPPFCheckNotPending_Private(cp));
+  PetscCall(QPPFCacheFind_Private(cp, QPPF_CACHE_OP_HALFQ, x, PETSC_TRUE, &id, &state, &idx));
+  if (idx >= 0) {
+    PetscCall(QPPFCacheGet_Private(cp, idx, y));
+    PetscFunctionReturnI(0);
+  }
 
   PetscCall(PetscLogEventBegin(QPPF_ApplyHalfQ,cp,x,y,0));
 
@@ -532,9 +1137,11 @@ PetscErrorCode QPPFApplyHalfQ(QPPF cp, Vec x, Vec y)
   PetscCall(PetscLogEventEnd(QPPF_ApplyG,cp,x,0,0));
 
   /* y = (GG^T)^{-1} * G_left */
-  PetscCall(QPPFApplyCP(cp, cp->G_left, y));
+  PetscCall(QPPFApplyCPBegin(cp, cp->G_left));
+  PetscCall(QPPFApplyCPEnd(cp, cp->G_left, y));
 
   PetscCall(PetscLogEventEnd(QPPF_ApplyHalfQ,cp,x,y,0));
+  PetscCall(QPPFCacheStore_Private(cp, QPPF_CACHE_OP_HALFQ, id, state, y));
   PetscCall(PetscObjectStateIncrease((PetscObject)y));
   PetscFunctionReturnI(0);
 }
@@ -544,17 +1151,27 @@ PetscErrorCode QPPFApplyHalfQ(QPPF cp, Vec x, Vec y)
 PetscErrorCode QPPFApplyHalfQTranspose(QPPF cp, Vec x, Vec y)
 {
   Vec Gt_right;
+  PetscObjectId id;
+  PetscObjectState state;
+  PetscInt idx;
 
   PetscFunctionBeginI;
   PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
   PetscValidHeaderSpecific(x,VEC_CLASSID,2);
   PetscValidHeaderSpecific(y,VEC_CLASSID,3);
   PetscCall(QPPFSetUp(cp));
+  PetscCall(QPPFCheckNotPending_Private(cp));
+  PetscCall(QPPFCacheFind_Private(cp, QPPF_CACHE_OP_HALFQT, x, PETSC_TRUE, &id, &state, &idx));
+  if (idx >= 0) {
+    PetscCall(QPPFCacheGet_Private(cp, idx, y));
+    PetscFunctionReturnI(0);
+  }
 
   PetscCall(PetscLogEventBegin(QPPF_ApplyHalfQ,cp,x,y,0));
   if (!cp->G_has_orthonormal_rows_explicitly) {
     /* Gt_right = (GG^T)^{-1} * G_left */
-    PetscCall(QPPFApplyCP(cp, x, cp->Gt_right));
+    PetscCall(QPPFApplyCPBegin(cp, x));
+    PetscCall(QPPFApplyCPEnd(cp, x, cp->Gt_right));
     Gt_right = cp->Gt_right;
   } else {
     Gt_right = x;
@@ -567,30 +1184,83 @@ PetscErrorCode QPPFApplyHalfQTranspose(QPPF cp, Vec x, Vec y)
 
   PetscCall(PetscLogEventEnd(QPPF_ApplyHalfQ,cp,x,y,0));
   PetscCall(PetscObjectStateIncrease((PetscObject)y));
+  PetscCall(QPPFCacheStore_Private(cp, QPPF_CACHE_OP_HALFQT, id, state, y));
   PetscFunctionReturnI(0);
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPPFApplyP"
-PetscErrorCode QPPFApplyP(QPPF cp, Vec v, Vec Pv)
+#define __FUNCT__ "QPPFApplyPBegin"
+/* Begins applying P = I - Q; local work not touching v can be done before QPPFApplyPEnd() while the coarse problem data are communicated;
+   no other application of cp may be started before QPPFApplyPEnd() */
+PetscErrorCode QPPFApplyPBegin(QPPF cp, Vec v)
 {
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
+  PetscValidHeaderSpecific(v,VEC_CLASSID,2);
+  PetscCall(QPPFSetUp(cp));
+  if (cp->fusedP_active) {
+    PetscCall(QPPFApplyGBegin_Private(cp, QPPF_CACHE_OP_P, v));
+  } else {
+    PetscCall(QPPFApplyQBegin(cp, v));
+  }
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyPEnd"
+PetscErrorCode QPPFApplyPEnd(QPPF cp, Vec v, Vec Pv)
+{
+  Vec Gt_right;
+  PetscObjectId id;
+  PetscObjectState state;
+  PetscBool hit;
+
   PetscFunctionBegin;
   PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
   PetscValidHeaderSpecific(v,VEC_CLASSID,2);
   PetscValidHeaderSpecific(Pv,VEC_CLASSID,3);
   PetscCall(PetscLogEventBegin(QPPF_ApplyP,cp,v,Pv,0));
-  PetscCall(QPPFApplyQ(cp, v, Pv));
-  PetscCall(VecAYPX(Pv, -1.0, v));  //Pv = v - Pv
+  if (!cp->fusedP_active) {
+    PetscCall(QPPFApplyQEnd(cp, v, Pv));
+    PetscCall(VecAYPX(Pv, -1.0, v));  //Pv = v - Pv
+  } else {
+    PetscCall(QPPFApplyGEnd_Private(cp, QPPF_CACHE_OP_P, v, Pv, &hit, &id, &state, &Gt_right));
+    if (hit) {
+      PetscCall(PetscLogEventEnd(QPPF_ApplyP,cp,v,Pv,0));
+      PetscFunctionReturn(0);
+    }
+
+    /* Pv = v - G'*Gt_right in a single pass over G, using the scatter of G reversed instead of a separate Gt */
+    PetscCall(VecScale(Gt_right, -1.0));
+    PetscCall(PetscLogEventBegin(QPPF_ApplyGt,cp,Pv,0,0));
+    PetscCall(MatMultTransposeAdd(cp->G, Gt_right, v, Pv));
+    PetscCall(PetscLogEventEnd(QPPF_ApplyGt,cp,Pv,0,0));
+    PetscCall(QPPFCacheStore_Private(cp, QPPF_CACHE_OP_P, id, state, Pv));
+  }
   PetscCall(PetscLogEventEnd(QPPF_ApplyP,cp,v,Pv,0));
   PetscCall(PetscObjectStateIncrease((PetscObject)Pv));
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyP"
+PetscErrorCode QPPFApplyP(QPPF cp, Vec v, Vec Pv)
+{
+  PetscFunctionBegin;
+  PetscCall(QPPFApplyPBegin(cp, v));
+  PetscCall(QPPFApplyPEnd(cp, v, Pv));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPPFApplyGtG"
 /* Applies GtG = G'*G to vector v */
 PetscErrorCode QPPFApplyGtG(QPPF cp, Vec v, Vec GtGv)
 {
+  PetscObjectId id;
+  PetscObjectState state;
+  PetscInt idx;
+
   PetscFunctionBegin;
   PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
   PetscValidHeaderSpecific(v,VEC_CLASSID,2);
@@ -599,8 +1269,13 @@ PetscErrorCode QPPFApplyGtG(QPPF cp, Vec v, Vec GtGv)
     PetscCall(QPPFApplyQ(cp,v,GtGv));
     PetscFunctionReturn(0);
   }
-
   PetscCall(QPPFSetUp(cp));
+  PetscCall(QPPFCheckNotPending_Private(cp));
+  PetscCall(QPPFCacheFind_Private(cp, QPPF_CACHE_OP_GTG, v, PETSC_TRUE, &id, &state, &idx));
+  if (idx >= 0) {
+    PetscCall(QPPFCacheGet_Private(cp, idx, GtGv));
+    PetscFunctionReturn(0);
+  }
   
   /* G_left = G*v */
   PetscCall(PetscLogEventBegin(QPPF_ApplyG,cp,v,GtGv,0));
@@ -613,24 +1288,34 @@ PetscErrorCode QPPFApplyGtG(QPPF cp, Vec v, Vec GtGv)
   PetscCall(PetscLogEventEnd(QPPF_ApplyGt,cp,v,GtGv,0));
 
   PetscCall(PetscObjectStateIncrease((PetscObject)GtGv));
+  PetscCall(QPPFCacheStore_Private(cp, QPPF_CACHE_OP_GTG, id, state, GtGv));
   PetscFunctionReturn(0);
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "QPPFApplyCP"
-/* Applies inv(G*G') to vector x; in other words y solves the coarse problem G*G'*y = x */
-PetscErrorCode QPPFApplyCP(QPPF cp, Vec x, Vec y)
+#define __FUNCT__ "QPPFApplyCPBegin"
+/* Begins solving the coarse problem G*G'*y = x; with a redundant coarse solver, x is being gathered to the subcommunicators until QPPFApplyCPEnd() */
+PetscErrorCode QPPFApplyCPBegin(QPPF cp, Vec x)
 {
-  MPI_Comm comm = ((PetscObject) cp)->comm;
-  PetscMPIInt rank;
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscCall(QPPFSetUp(cp));
+  PetscCall(QPPFCheckNotPending_Private(cp));
+  if (cp->GGtinv && !cp->explicitInv) {
+    PetscCall(MatInvMultBegin(cp->GGtinv, x));
+  }
+  PetscFunctionReturn(0);
+}
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyCPEnd"
+PetscErrorCode QPPFApplyCPEnd(QPPF cp, Vec x, Vec y)
+{
   PetscFunctionBegin;
   PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
   PetscValidHeaderSpecific(x,VEC_CLASSID,2);
   PetscValidHeaderSpecific(y,VEC_CLASSID,3);
-  
-  PetscCallMPI(MPI_Comm_rank(comm, &rank));
-  PetscCall(QPPFSetUp(cp));
 
   PetscCall(PetscLogEventBegin(QPPF_ApplyCP, cp, cp->GGtinv, x, y));
   
@@ -639,13 +1324,14 @@ PetscErrorCode QPPFApplyCP(QPPF cp, Vec x, Vec y)
     PetscInt iter;
     KSP GGtinv_ksp;
 
-    PetscCall(MatMult(cp->GGtinv, x, y));
-
     if (!cp->explicitInv) {
+      PetscCall(MatInvMultEnd(cp->GGtinv, x, y));
       PetscCall(MatInvGetKSP(cp->GGtinv, &GGtinv_ksp));
       PetscCall(KSPGetIterationNumber(GGtinv_ksp, &iter));
       cp->it_GGtinvv += iter;
       PetscCall(KSPGetConvergedReason(GGtinv_ksp, &cp->conv_GGtinvv));
+    } else {
+      PetscCall(MatMult(cp->GGtinv, x, y));
     }
   } else {
     PetscCall(VecCopy(x, y));
@@ -656,6 +1342,32 @@ PetscErrorCode QPPFApplyCP(QPPF cp, Vec x, Vec y)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPPFApplyCP"
+/* Applies inv(G*G') to vector x; in other words y solves the coarse problem G*G'*y = x */
+PetscErrorCode QPPFApplyCP(QPPF cp, Vec x, Vec y)
+{
+  PetscObjectId id;
+  PetscObjectState state;
+  PetscInt idx;
+
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(cp,QPPF_CLASSID,1);
+  PetscValidHeaderSpecific(x,VEC_CLASSID,2);
+  PetscValidHeaderSpecific(y,VEC_CLASSID,3);
+  PetscCall(QPPFSetUp(cp));
+  PetscCall(QPPFCheckNotPending_Private(cp));
+  PetscCall(QPPFCacheFind_Private(cp, QPPF_CACHE_OP_CP, x, PETSC_TRUE, &id, &state, &idx));
+  if (idx >= 0) {
+    PetscCall(QPPFCacheGet_Private(cp, idx, y));
+    PetscFunctionReturn(0);
+  }
+  PetscCall(QPPFApplyCPBegin(cp, x));
+  PetscCall(QPPFApplyCPEnd(cp, x, y));
+  PetscCall(QPPFCacheStore_Private(cp, QPPF_CACHE_OP_CP, id, state, y));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPPFCreateQ"
 /* Get operator Q = G'*inv(G*G')*G in implicit form */
@@ -822,8 +1534,14 @@ PetscErrorCode QPPFView(QPPF cp, PetscViewer viewer)
   PetscCall(PetscViewerASCIIPrintf(viewer, "G has orth. rows i.:%c\n", cp->G_has_orthonormal_rows_implicitly ? 'y' : 'n'));
   PetscCall(PetscViewerASCIIPrintf(viewer, "explicit:           %c\n", cp->explicitInv ? 'y' : 'n'));
   PetscCall(PetscViewerASCIIPrintf(viewer, "redundancy:         %d\n", cp->redundancy));
+  PetscCall(PetscViewerASCIIPrintf(viewer, "GGt storage:        %s (requested %s, dense fill threshold %.3g)\n", cp->GGt_storage == QPPF_GGT_STORAGE_IMPLICIT ? "implicit" : (cp->GGt_dense ? "dense" : "sparse"), QPPFGGtStorages[cp->GGt_storage], (double)cp->GGt_dense_fill));
+  if (cp->GGt_fill >= 0.0) PetscCall(PetscViewerASCIIPrintf(viewer, "GGt fill:           %.3g\n", (double)cp->GGt_fill));
   PetscCall(PetscViewerASCIIPrintf(viewer, "last conv. reason:  %d\n", cp->conv_GGtinvv));
   PetscCall(PetscViewerASCIIPrintf(viewer, "cumulative #iter.:  %d\n", cp->it_GGtinvv));
+  PetscCall(PetscViewerASCIIPrintf(viewer, "fused P apply:      %c\n", cp->fusedP_active ? 'y' : 'n'));
+  PetscCall(PetscViewerASCIIPrintf(viewer, "multilevel:         %c\n", cp->multilevel ? 'y' : 'n'));
+  if (cp->ml_Z) PetscCall(PetscViewerASCIIPrintf(viewer, "  cluster size %" PetscInt_FMT ", %" PetscInt_FMT " cluster coarse DOFs\n", cp->ml_cluster_size, cp->ml_Z->cmap->N));
+  PetscCall(PetscViewerASCIIPrintf(viewer, "cache size:         %" PetscInt_FMT " (hits %" PetscInt_FMT ", misses %" PetscInt_FMT ")\n", cp->cache_size, cp->cache_hits, cp->cache_misses));
 
   PetscCall(PetscViewerPushFormat(viewer, PETSC_VIEWER_ASCII_INFO));
   if (cp->explicitInv) {
@@ -836,6 +1554,7 @@ PetscErrorCode QPPFView(QPPF cp, PetscViewer viewer)
     PetscCall(PetscViewerRestoreSubViewer(viewer, comm, &scv));
   } else {
     if (cp->GGtinv) PetscCall(MatView(cp->GGtinv, viewer));
+    if (cp->ml_Gcinv) PetscCall(MatView(cp->ml_Gcinv, viewer));
   }
   if (cp->G)    PetscCall(MatPrintInfo(cp->G));
   if (cp->Gt)   PetscCall(MatPrintInfo(cp->Gt));
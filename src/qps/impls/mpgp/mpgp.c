@@ -47,6 +47,28 @@ PetscErrorCode QPSMPGPGetCurrentStepType_MPGP(QPS qps,char *stepType)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPSMPGPGetGradient_MPGP"
+static PetscErrorCode QPSMPGPGetGradient_MPGP(QPS qps,Vec *g)
+{
+  QPS_MPGP *mpgp = (QPS_MPGP*)qps->data;
+
+  PetscFunctionBegin;
+  *g = mpgp->gvalid ? qps->work[3] : NULL;
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPSMPGPSetReuseGradient_MPGP"
+static PetscErrorCode QPSMPGPSetReuseGradient_MPGP(QPS qps,PetscBool flg)
+{
+  QPS_MPGP *mpgp = (QPS_MPGP*)qps->data;
+
+  PetscFunctionBegin;
+  mpgp->reuse_gradient = flg;
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPSMPGPGetAlpha_MPGP"
 static PetscErrorCode QPSMPGPGetAlpha_MPGP(QPS qps,PetscReal *alpha,QPSScalarArgType *argtype)
@@ -190,15 +212,19 @@ static PetscErrorCode QPSMPGPSetOperatorMaxEigenvalueIterations_MPGP(QPS qps,Pet
 }
 
 #undef __FUNCT__
-#define __FUNCT__ "MPGPGrads"
+#define __FUNCT__ "MPGPGrads_Private"
 /*
-MPGPGrads - compute projected, chopped, and free gradient
+MPGPGrads_Private - compute projected, chopped, and free gradient;
+            squared norms of gP, gc and gf are stored in mpgp->gdots using a single reduction
 
 Parameters:
 + qps - QP solver
-- g - gradient
+. x - solution vector
+. g - gradient
+. Ap - if not NULL, Ap'*gf is reduced together with the norms
+- ApTgf - pointer to store Ap'*gf
 */
-static PetscErrorCode MPGPGrads(QPS qps, Vec x, Vec g)
+static PetscErrorCode MPGPGrads_Private(QPS qps, Vec x, Vec g, Vec Ap, PetscReal *ApTgf)
 {
   QP                qp;
   QPC               qpc;
@@ -208,6 +234,8 @@ static PetscErrorCode MPGPGrads(QPS qps, Vec x, Vec g)
   Vec               gc;                 /* ... chopped gradient                 */
   Vec               gf;                 /* ... free gradient                    */
 
+  PetscReal         dots[4];
+  PetscInt          ndots = 3;
   QPS_MPGP          *mpgp = (QPS_MPGP*)qps->data;
 
   PetscFunctionBegin;
@@ -219,9 +247,41 @@ static PetscErrorCode MPGPGrads(QPS qps, Vec x, Vec g)
   gf                = qps->work[1];
   gc                = qps->work[2];
 
-  PetscCall(QPCGrads(qpc,x,g,gf,gc));
+  PetscCall(QPCGradsNorms(qpc,x,g,gf,gc,gP,dots));
+  if (Ap) {
+    const PetscScalar *Ap_a,*gf_a;
+    PetscInt          i,n;
+
+    dots[ndots] = 0.0;
+    PetscCall(VecGetLocalSize(gf,&n));
+    PetscCall(VecGetArrayRead(Ap,&Ap_a));
+    PetscCall(VecGetArrayRead(gf,&gf_a));
+    for (i=0; i<n; i++) dots[ndots] += PetscRealPart(Ap_a[i]*PetscConj(gf_a[i]));
+    PetscCall(VecRestoreArrayRead(Ap,&Ap_a));
+    PetscCall(VecRestoreArrayRead(gf,&gf_a));
+    ndots++;
+  }
+  PetscCallMPI(MPI_Allreduce(MPI_IN_PLACE,dots,ndots,MPIU_REAL,MPIU_SUM,PetscObjectComm((PetscObject)qps)));
+  PetscCall(PetscArraycpy(mpgp->gdots,dots,3));
+  if (Ap) *ApTgf = dots[3];
   PetscCall(QPCGradReduced(qpc,x,gf,mpgp->alpha,gr));
-  PetscCall(VecWAXPY(gP,1.0,gf,gc));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "MPGPGrads"
+/*
+MPGPGrads - compute projected, chopped, and free gradient
+
+Parameters:
++ qps - QP solver
+. x - solution vector
+- g - gradient
+*/
+static PetscErrorCode MPGPGrads(QPS qps, Vec x, Vec g)
+{
+  PetscFunctionBegin;
+  PetscCall(MPGPGrads_Private(qps,x,g,NULL,NULL));
   PetscFunctionReturn(0);
 }
 
@@ -427,6 +487,7 @@ PetscErrorCode QPSSetup_MPGP(QPS qps)
     mpgp->alpha = mpgp->alpha_user;
   }
   PetscCall(PetscInfo(qps,  "alpha      = %.8e\n", mpgp->alpha));
+  mpgp->gvalid = PETSC_FALSE;  /* work vectors might have been recreated */
   PetscFunctionReturn(0);
 }
 
@@ -446,7 +507,6 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
   Mat               A;                  /* ... hessian matrix                   */
   Vec               b;                  /* ... right-hand side vector           */
   Vec               x;                  /* ... vector of variables              */
-  Vec               gP;                 /* ... projected gradient               */
   Vec               gc;                 /* ... chopped gradient                 */
   Vec               gf;                 /* ... free gradient                    */
   Vec               g;                  /* ... gradient                         */
@@ -469,9 +529,11 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
   PetscInt          nfinc=0;            /* ... functional increase counter      */
   PetscInt          nfall=0;            /* ... fallback step counter            */
 
+  PetscBool         reuse;              /* ... reuse g from the caller          */
+  PetscObjectState  xstate;
+
   PetscFunctionBegin;
   /* set working vectors */
-  gP                = qps->work[0];
   gf                = qps->work[1];
   gc                = qps->work[2];
 
@@ -499,12 +561,25 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
   PetscCall(QPGetOperator(qp, &A));                   /* get hessian matrix */
   PetscCall(QPGetRhs(qp, &b));                        /* get right-hand side vector */
 
-  PetscCall(QPCProject(qpc,x,x));                     /* project x initial guess to feasible set */
+  /* the caller can provide g = A*x - b, e.g. updated from the previous solve; x is then feasible and unchanged since */
+  reuse = PETSC_FALSE;
+  if (mpgp->reuse_gradient && mpgp->gvalid) {
+    PetscCall(PetscObjectStateGet((PetscObject)x,&xstate));
+    reuse = (PetscBool)(xstate == mpgp->xstate);
+  }
+  mpgp->reuse_gradient = PETSC_FALSE;
+  mpgp->gvalid = PETSC_FALSE;
+
+  if (reuse) {
+    PetscCall(PetscInfo(qps,"reusing the gradient provided by the caller\n"));
+  } else {
+    PetscCall(QPCProject(qpc,x,x));                   /* project x initial guess to feasible set */
 
-  /* compute gradient */
-  PetscCall(MatMult(A, x, g));                        /* g=A*x */
-  nmv++;                                          /* matrix multiplication counter */
-  PetscCall(VecAXPY(g, -1.0, b));                     /* g=g-b */
+    /* compute gradient */
+    PetscCall(MatMult(A, x, g));                      /* g=A*x */
+    nmv++;                                        /* matrix multiplication counter */
+    PetscCall(VecAXPY(g, -1.0, b));                   /* g=g-b */
+  }
 
   PetscCall(MPGPGrads(qps, x, g));                    /* grad. splitting  gP,gf,gc */
 
@@ -516,14 +591,14 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
   while (1)                                       /* main cycle */
   {
     /* compute the norm of projected gradient - stopping criterion */
-    PetscCall(VecNorm(gP, NORM_2, &qps->rnorm));      /* qps->rnorm=norm(gP)*/
+    qps->rnorm = PetscSqrtReal(mpgp->gdots[0]);     /* qps->rnorm=norm(gP)*/
 
-    /* compute dot products to control the proportionality */
-    PetscCall(VecDot(gc, gc, &gcTgc));               /* gcTgc=gc'*gc   */
+    /* dot products to control the proportionality (reduced together in MPGPGrads) */
+    gcTgc = mpgp->gdots[1];                         /* gcTgc=gc'*gc   */
     /* NOTE: using gf'*gf for proportiong rule instead of gr'*gf
     *  which can lead to more agressive proportioning as
     *  sqrt(g_reduced^T * g_free) <= ||g_free||                    */
-    PetscCall(VecDot(gf, gf, &gfTgf));               /* gfTgf=gr'*gf   */
+    gfTgf = mpgp->gdots[2];                         /* gfTgf=gf'*gf   */
 
     /* compute norm of gf, gc from computed dot products */
     if (qps->numbermonitors) {
@@ -539,14 +614,28 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
     /* proportional condition */
     if (gcTgc <= gamma2*gfTgf)                    /* u is proportional */
     {
-      PetscCall(MatMult(A, p, Ap));                   /* Ap=A*p */
-      nmv++;                                      /* matrix multiplication counter */
+      if (mpgp->pipelined) {
+        /* start A*p and the reductions independent of Ap, finish them after all are in flight */
+        PetscCall(PermonMatMultBegin(A, p, Ap));      /* Ap=A*p */
+        PetscCall(VecDotBegin(g, p, &acg));           /* acg=g'*p       */
+        PetscCall(PetscCommSplitReductionBegin(PetscObjectComm((PetscObject)g)));
+        PetscCall(QPCFeasBegin(qpc, x, p));           /* finds max.feas.steplength */
+        PetscCall(PermonMatMultEnd(A, p, Ap));
+        nmv++;                                    /* matrix multiplication counter */
+        PetscCall(VecDotEnd(g, p, &acg));
+        PetscCall(QPCFeasEnd(qpc, &afeas));
+        PetscCall(VecDot(p, Ap, &pAp));               /* pAp=p'*Ap      */
+        acg  = acg/pAp;                           /* acg=acg/pAp    */
+      } else {
+        PetscCall(MatMult(A, p, Ap));                 /* Ap=A*p */
+        nmv++;                                    /* matrix multiplication counter */
 
-      /* compute step-sizes */
-      PetscCall(VecDot(p, Ap, &pAp));                 /* pAp=p'*Ap      */
-      PetscCall(VecDot(g,  p, &acg));                 /* acg=g'*p       */
-      acg  = acg/pAp;                             /* acg=acg/pAp    */
-      PetscCall(QPCFeas(qpc, x, p, &afeas));          /* finds max.feas.steplength */
+        /* compute step-sizes */
+        PetscCall(VecDot(p, Ap, &pAp));               /* pAp=p'*Ap      */
+        PetscCall(VecDot(g,  p, &acg));               /* acg=g'*p       */
+        acg  = acg/pAp;                           /* acg=acg/pAp    */
+        PetscCall(QPCFeas(qpc, x, p, &afeas));        /* finds max.feas.steplength */
+      }
 
       /* decide if it is able to do full CG step */
       if (acg <= afeas)
@@ -558,10 +647,15 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
         /* make CG step */
         PetscCall(VecAXPY(x, -acg, p));               /* x=x-acg*p      */
         PetscCall(VecAXPY(g, -acg, Ap));              /* g=g-acg*Ap      */
-        PetscCall(MPGPGrads(qps, x, g));              /* grad. splitting  gP,gf,gc */
+        if (mpgp->pipelined) {
+          /* grad. splitting  gP,gf,gc with bcg=Ap'*gf in the same reduction */
+          PetscCall(MPGPGrads_Private(qps, x, g, Ap, &bcg));
+        } else {
+          PetscCall(MPGPGrads(qps, x, g));            /* grad. splitting  gP,gf,gc */
+          PetscCall(VecDot(Ap, gf, &bcg));            /* bcg=Ap'*gf     */
+        }
 
         /* compute orthogonalization parameter and next orthogonal vector */
-        PetscCall(VecDot(Ap, gf, &bcg));              /* bcg=Ap'*gf     */
         bcg  = bcg/pAp;                           /* bcg=bcg/pAp     */
         PetscCall(VecAYPX(p, -bcg, gf));              /* p=gf-bcg*p     */
       }
@@ -599,8 +693,8 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
             nfinc++;
             if (mpgp->fallback2) {
               PetscCall(MPGPGrads(qps, x, g));              /* grad. splitting  gP,gf,gc */
-              PetscCall(VecDot(gc, gc, &gcTgc));               /* gcTgc=gc'*gc   */
-              PetscCall(VecDot(gf, gf, &gfTgf));               /* gfTgf=gr'*gf   */
+              gcTgc = mpgp->gdots[1];                       /* gcTgc=gc'*gc   */
+              gfTgf = mpgp->gdots[2];                       /* gfTgf=gf'*gf   */
               if (gcTgc <= gamma2*gfTgf) {                   /* u is proportional */
                 mpgp->fallback = PETSC_FALSE;
               } else {
@@ -656,6 +750,10 @@ PetscErrorCode QPSSolve_MPGP(QPS qps)
     qps->iteration++;
   };
 
+  /* g is the gradient at x on exit, keep it for a possible warm start of the next solve */
+  PetscCall(PetscObjectStateGet((PetscObject)x,&mpgp->xstate));
+  mpgp->gvalid = PETSC_TRUE;
+
   mpgp->ncg     += ncg;
   mpgp->nexp    += nexp;
   mpgp->nmv     += nmv;
@@ -699,6 +797,8 @@ PetscErrorCode QPSDestroy_MPGP(QPS qps)
   PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPGetOperatorMaxEigenvalueTolerance_MPGP_C",NULL));
   PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPGetOperatorMaxEigenvalueIterations_MPGP_C",NULL));
   PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPSetOperatorMaxEigenvalueIterations_MPGP_C",NULL));
+  PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPGetGradient_MPGP_C",NULL));
+  PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPSetReuseGradient_MPGP_C",NULL));
   PetscCall(QPSDestroyDefault(qps));
   PetscFunctionReturn(0);
 }
@@ -755,6 +855,7 @@ PetscErrorCode QPSSetFromOptions_MPGP(QPS qps,PetscOptionItems *PetscOptionsObje
   PetscCall(PetscOptionsBool("-qps_mpgp_fallback","Throw away expansion step if cost function increased and do a std expansion step.","",(PetscBool) mpgp->fallback,&mpgp->fallback,NULL));
   PetscCall(PetscOptionsBool("-qps_mpgp_fallback2","Same as fallback which is done only if the next step is proportioning","",(PetscBool) mpgp->fallback2,&mpgp->fallback2,NULL));
   if (mpgp->fallback2) mpgp->fallback = PETSC_FALSE;
+  PetscCall(PetscOptionsBool("-qps_mpgp_pipelined","Overlap reductions of CG step with Hessian multiplication and merge them where possible","",mpgp->pipelined,&mpgp->pipelined,NULL));
   PetscOptionsHeadEnd();
   PetscFunctionReturn(0);
 }
@@ -800,7 +901,8 @@ PetscErrorCode QPSViewConvergence_MPGP(QPS qps, PetscViewer v)
 .  -qps_mpgp_expansion_length_type - set expansion step length type, default: "fixed"
 .  -qps_mpgp_alpha_reset - if alpha=Nan reset to initial value, otherwise keep last alpaha, default: true
 .  -qps_mpgp_fallback - throw away expansion step if cost function increased and do a std expansion step, default false
--  -qps_mpgp_fallback2 - same as fallback which is done only if the next step is proportioning
+.  -qps_mpgp_fallback2 - same as fallback which is done only if the next step is proportioning
+-  -qps_mpgp_pipelined - overlap g'*p and feasible step length reductions with the split-phase Hessian multiplication (see PermonMatMultBegin()) and merge Ap'*gf into gradient norms reduction; iterates are the same, default false
 
    Available expansion types:
 +  "std" - standard expansion
@@ -854,6 +956,9 @@ FLLOP_EXTERN PetscErrorCode QPSCreate_MPGP(QPS qps)
 
   mpgp->fallback              = PETSC_FALSE;
   mpgp->fallback2              = PETSC_FALSE;
+  mpgp->pipelined             = PETSC_FALSE;
+  mpgp->reuse_gradient        = PETSC_FALSE;
+  mpgp->gvalid                = PETSC_FALSE;
 
   /*
        Sets the functions that are associated with this data structure
@@ -880,6 +985,8 @@ FLLOP_EXTERN PetscErrorCode QPSCreate_MPGP(QPS qps)
   PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPGetOperatorMaxEigenvalueIterations_MPGP_C",QPSMPGPGetOperatorMaxEigenvalueIterations_MPGP));
   PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPSetOperatorMaxEigenvalueIterations_MPGP_C",QPSMPGPSetOperatorMaxEigenvalueIterations_MPGP));
   PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPUpdateMaxEigenvalue_MPGP_C",QPSMPGPUpdateMaxEigenvalue_MPGP));
+  PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPGetGradient_MPGP_C",QPSMPGPGetGradient_MPGP));
+  PetscCall(PetscObjectComposeFunction((PetscObject)qps,"QPSMPGPSetReuseGradient_MPGP_C",QPSMPGPSetReuseGradient_MPGP));
   PetscFunctionReturn(0);
 }
 
@@ -1023,6 +1130,60 @@ PetscErrorCode  QPSMPGPUpdateMaxEigenvalue(QPS qps, PetscReal maxeig_update)
   PetscFunctionReturn(0);
 }
 
+#undef __FUNCT__
+#define __FUNCT__ "QPSMPGPGetGradient"
+/*@
+QPSMPGPGetGradient - get the gradient g = A*x - b at the solution of the last solve
+
+Parameters:
++ qps - QP solver
+- g - the gradient work vector, NULL if it is not valid (no solve since the last setup, or qps is not MPGP)
+
+Notes:
+The vector is owned by the solver. It can be updated by the caller, e.g. if only the right-hand side
+has changed, and passed to the next solve with QPSMPGPSetReuseGradient().
+
+Level: advanced
+
+.seealso: QPSMPGPSetReuseGradient()
+@*/
+PetscErrorCode QPSMPGPGetGradient(QPS qps,Vec *g)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qps,QPS_CLASSID,1);
+  PetscValidPointer(g,2);
+  *g = NULL;
+  PetscTryMethod(qps,"QPSMPGPGetGradient_MPGP_C",(QPS,Vec*),(qps,g));
+  PetscFunctionReturn(0);
+}
+
+#undef __FUNCT__
+#define __FUNCT__ "QPSMPGPSetReuseGradient"
+/*@
+QPSMPGPSetReuseGradient - let the next solve start from the gradient obtained with QPSMPGPGetGradient(),
+skipping the projection of the initial guess and the computation of A*x - b
+
+Parameters:
++ qps - QP solver
+- flg - reuse the gradient in the next solve
+
+Notes:
+The flag holds for one solve only. It is ignored if the solution vector has been changed since the last solve.
+The caller is responsible for the gradient being consistent with the current operator and right-hand side.
+
+Level: advanced
+
+.seealso: QPSMPGPGetGradient()
+@*/
+PetscErrorCode QPSMPGPSetReuseGradient(QPS qps,PetscBool flg)
+{
+  PetscFunctionBegin;
+  PetscValidHeaderSpecific(qps,QPS_CLASSID,1);
+  PetscValidLogicalCollectiveBool(qps,flg,2);
+  PetscTryMethod(qps,"QPSMPGPSetReuseGradient_MPGP_C",(QPS,PetscBool),(qps,flg));
+  PetscFunctionReturn(0);
+}
+
 #undef __FUNCT__
 #define __FUNCT__ "QPSMPGPSetOperatorMaxEigenvalueTolerance"
 /*@
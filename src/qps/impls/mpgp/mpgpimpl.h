@@ -15,6 +15,7 @@ typedef struct {
 
   PetscReal gfnorm;
   PetscReal gcnorm;
+  PetscReal gdots[3];         /* ... gP'*gP, gc'*gc, gf'*gf from last grad. splitting */
 
   PetscInt  nmv;              /* ... matrix-vector mult. counter      */
   PetscInt  ncg;              /* ... cg step counter                  */
@@ -35,6 +36,11 @@ typedef struct {
   PetscBool                  resetalpha;
   PetscBool                  fallback;
   PetscBool                  fallback2;
+  PetscBool                  pipelined;
+
+  PetscBool                  reuse_gradient;  /* next solve starts from the gradient left in g by the caller */
+  PetscBool                  gvalid;          /* g corresponds to x with state xstate */
+  PetscObjectState           xstate;
 } QPS_MPGP;
 
 #endif
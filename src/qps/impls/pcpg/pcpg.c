@@ -99,8 +99,9 @@ PetscErrorCode QPSSolve_PCPG(QPS qps){
   PetscCall(VecAYPX(r, -1.0, rhs));
   
   qps->iteration = 0;
+  PetscCall(QPPFApplyPBegin(cp, r));
   do {
-    PetscCall(QPPFApplyP(cp, r, w));
+    PetscCall(QPPFApplyPEnd(cp, r, w));
     
     //convergence test
     PetscCall(VecNorm(w, NORM_2, &qps->rnorm));
@@ -125,10 +126,12 @@ PetscErrorCode QPSSolve_PCPG(QPS qps){
     PetscCall(MatMult(Amat,p, Ap));
     PetscCall(VecDot(p, Ap, &alpha1));
     alpha = beta1/alpha1;
-    PetscCall(VecAXPY(lm, alpha, p));
     PetscCall(VecAXPY(r, -alpha, Ap ));
     
     qps->iteration++;
+    /* overlap the coarse problem communication of the next projection with the update of lm */
+    if (qps->iteration < qps->max_it) PetscCall(QPPFApplyPBegin(cp, r));
+    PetscCall(VecAXPY(lm, alpha, p));
   } while (qps->iteration < qps->max_it);
   PetscFunctionReturn(0);
 }
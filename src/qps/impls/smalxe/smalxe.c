@@ -775,6 +775,7 @@ PetscErrorCode QPSSetFromOptions_SMALXE(QPS qps,PetscOptionItems *PetscOptionsOb
   PetscCall(PetscOptionsReal("-qps_smalxe_norm_update_lag_upper","","",smalxe->upper,&smalxe->upper,NULL));
 
   PetscCall(PetscOptionsBool("-qps_smalxe_knoll","","",smalxe->knoll,&smalxe->knoll,NULL));
+  PetscCall(PetscOptionsBool("-qps_smalxe_warm_start","reuse the inner solver gradient between outer iterations","",smalxe->warm_start,&smalxe->warm_start,NULL));
   smalxe->setfromoptionscalled = PETSC_TRUE;
   PetscOptionsHeadEnd();
   PetscFunctionReturn(0);
@@ -919,7 +920,7 @@ PetscErrorCode QPSSolve_SMALXE(QPS qps)
   QP            qp, qp_inner;
   Mat           A_inner;
   Vec           b,b_inner,u,Btmu;
-  PetscReal     Lag, Lag_old, rho;
+  PetscReal     Lag, Lag_old, rho, rho_inner;
   PetscInt      i,it_inner,maxits;
 
   PetscFunctionBegin;
@@ -986,6 +987,20 @@ PetscErrorCode QPSSolve_SMALXE(QPS qps)
     /* update the inner RHS b_inner=b-Btmu */
     PetscCall(VecWAXPY(b_inner, -1.0, Btmu, b));
 
+    /* warm start: the inner gradient g = A_inner*u - b_inner from the previous inner solve changes
+       by rho_old*BtBu due to the Btmu update and by (rho-rho_old)*BtBu due to the penalty update,
+       so g += rho*BtBu saves the projection and A_inner*u in the next inner solve */
+    if (i && smalxe->warm_start && qps_inner->solQP == qp_inner) {
+      Vec g;
+
+      PetscCall(QPSMPGPGetGradient(qps_inner,&g));
+      if (g) {
+        PetscCall(MatPenalizedGetPenalty(A_inner,&rho_inner));
+        PetscCall(VecAXPY(g,rho_inner,qps->work[0]));         /* g = g + rho*BtBu */
+        PetscCall(QPSMPGPSetReuseGradient(qps_inner,PETSC_TRUE));
+      }
+    }
+
     /* call inner solver with custom stopping criterion */
     qps_inner->divtol = qps->divtol;
     PetscCall(QPSConvergedSetUp_Inner_SMALXE(qps_inner));
@@ -1229,6 +1244,7 @@ FLLOP_EXTERN PetscErrorCode QPSCreate_SMALXE(QPS qps)
   smalxe->upper       = 1.1;
 
   smalxe->knoll       = PETSC_FALSE;
+  smalxe->warm_start  = PETSC_TRUE;
   /* set SMALXE-specific default maximum number of outer iterations */
   qps->max_it = 100;
 
@@ -0,0 +1,151 @@
+/* Test QPFetiReassemble() with another gluing type and Dirichlet set against a fresh FETI assembly */
+#include <permonqpfeti.h>
+
+/* 1D Laplacian as MATIS, one subdomain of ne_l elements per rank */
+static PetscErrorCode CreateProblem(PetscInt ne_l,Mat *A_new,Vec *b_new,Vec *x_new)
+{
+  MPI_Comm               comm = PETSC_COMM_WORLD;
+  PetscMPIInt            rank,size;
+  PetscScalar            Aloc[4] = {1,-1,-1,1},bloc[2] = {0.5,0.5};
+  PetscInt               i,idx[2],*global_indices;
+  ISLocalToGlobalMapping l2g;
+  Mat                    A;
+  Vec                    b,x;
+
+  PetscFunctionBegin;
+  PetscCallMPI(MPI_Comm_rank(comm,&rank));
+  PetscCallMPI(MPI_Comm_size(comm,&size));
+  PetscCall(PetscMalloc1(ne_l+1,&global_indices));
+  for (i=0; i<ne_l+1; i++) global_indices[i] = rank*ne_l+i;
+  PetscCall(ISLocalToGlobalMappingCreate(comm,1,ne_l+1,global_indices,PETSC_OWN_POINTER,&l2g));
+  PetscCall(MatCreateIS(comm,1,PETSC_DECIDE,PETSC_DECIDE,size*ne_l+1,size*ne_l+1,l2g,l2g,&A));
+  PetscCall(MatISSetPreallocation(A,3,NULL,3,NULL));
+  PetscCall(MatCreateVecs(A,&x,&b));
+  for (i=0; i<ne_l; i++) {
+    idx[0] = i;
+    idx[1] = i+1;
+    PetscCall(MatSetValuesLocal(A,2,idx,2,idx,Aloc,ADD_VALUES));
+    PetscCall(VecSetValuesLocal(b,2,idx,bloc,ADD_VALUES));
+  }
+  PetscCall(VecAssemblyBegin(b));
+  PetscCall(VecAssemblyEnd(b));
+  PetscCall(MatAssemblyBegin(A,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(A,MAT_FINAL_ASSEMBLY));
+  /* nonzero Dirichlet values give nonzero cE */
+  PetscCall(VecSet(x,1.0));
+  PetscCall(ISLocalToGlobalMappingDestroy(&l2g));
+  *A_new = A;
+  *b_new = b;
+  *x_new = x;
+  PetscFunctionReturn(0);
+}
+
+/* Dirichlet DOFs in global undecomposed numbering: the left end, and the right end if both */
+static PetscErrorCode CreateDirichlet(PetscInt ne_l,PetscBool both,IS *dir)
+{
+  PetscMPIInt rank,size;
+  PetscInt    idx[2],n=0;
+
+  PetscFunctionBegin;
+  PetscCallMPI(MPI_Comm_rank(PETSC_COMM_WORLD,&rank));
+  PetscCallMPI(MPI_Comm_size(PETSC_COMM_WORLD,&size));
+  if (!rank) idx[n++] = 0;
+  if (both && rank == size-1) idx[n++] = size*ne_l;
+  PetscCall(ISCreateGeneral(PETSC_COMM_WORLD,n,idx,PETSC_COPY_VALUES,dir));
+  PetscFunctionReturn(0);
+}
+
+/* QP with the block diagonal operator and FETI constraints assembled with the given gluing type and Dirichlet set */
+static PetscErrorCode CreateFetiQP(Mat A,Vec b,Vec x,const char type[],IS dir,QP *qp_new,QP *child)
+{
+  QP qp;
+
+  PetscFunctionBegin;
+  PetscCall(QPCreate(PETSC_COMM_WORLD,&qp));
+  PetscCall(QPSetOperator(qp,A));
+  PetscCall(QPSetRhs(qp,b));
+  PetscCall(QPSetInitialVector(qp,x));
+  PetscCall(QPTMatISToBlockDiag(qp));
+  PetscCall(QPGetChild(qp,child));
+  PetscCall(QPFetiSetDirichlet(*child,dir,FETI_GLOBAL_UNDECOMPOSED,PETSC_TRUE));
+  PetscCall(PetscOptionsSetValue(NULL,"-feti_gluing_type",type));
+  PetscCall(QPFetiSetUp(*child));
+  *qp_new = qp;
+  PetscFunctionReturn(0);
+}
+
+/* BE of qp must consist of the blocks Bg and Bd of BE of qpref */
+static PetscErrorCode CheckEq(QP qp,QP qpref)
+{
+  Mat       BE,BEref,B,Bref;
+  Vec       cE,cEref,diff;
+  PetscInt  i,M,Mref;
+  PetscReal norm;
+  PetscBool flg;
+
+  PetscFunctionBegin;
+  PetscCall(QPGetEq(qp,&BE,&cE));
+  PetscCall(QPGetEq(qpref,&BEref,&cEref));
+  PetscCall(MatNestGetSize(BE,&M,NULL));
+  PetscCall(MatNestGetSize(BEref,&Mref,NULL));
+  if (M != 2 || Mref != 2) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"BE has %" PetscInt_FMT " blocks, fresh BE %" PetscInt_FMT ", expected Bg and Bd",M,Mref);
+  for (i=0; i<M; i++) {
+    PetscCall(MatNestGetSubMat(BE,i,0,&B));
+    PetscCall(MatNestGetSubMat(BEref,i,0,&Bref));
+    PetscCall(MatMultEqual(B,Bref,3,&flg));
+    if (!flg) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"block %" PetscInt_FMT " of the reassembled BE differs from the fresh assembly",i);
+  }
+  if (!cE != !cEref) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"cE is set in only one of the assemblies");
+  if (cE) {
+    PetscCall(VecDuplicate(cE,&diff));
+    PetscCall(VecWAXPY(diff,-1.0,cE,cEref));
+    PetscCall(VecNorm(diff,NORM_2,&norm));
+    if (norm > PETSC_SMALL) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"reassembled cE differs from the fresh assembly: %g",(double)norm);
+    PetscCall(VecDestroy(&diff));
+  }
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  Mat      A;
+  Vec      b,x;
+  IS       dir1,dir2;
+  QP       qp,child,qpref,childref;
+  PetscInt ne_l=4;
+
+  PetscCall(PermonInitialize(&argc,&args,(char*)0,(char*)0));
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-ne",&ne_l,NULL));
+  PetscCall(CreateProblem(ne_l,&A,&b,&x));
+  PetscCall(CreateDirichlet(ne_l,PETSC_FALSE,&dir1));
+  PetscCall(CreateDirichlet(ne_l,PETSC_TRUE,&dir2));
+
+  /* full gluing with one Dirichlet DOF, reassembled with orthonormal gluing and two */
+  PetscCall(CreateFetiQP(A,b,x,"full",dir1,&qp,&child));
+  PetscCall(QPFetiSetDirichlet(child,dir2,FETI_GLOBAL_UNDECOMPOSED,PETSC_TRUE));
+  PetscCall(PetscOptionsSetValue(NULL,"-feti_gluing_type","orth"));
+  PetscCall(QPFetiReassemble(child));
+
+  PetscCall(CreateFetiQP(A,b,x,"orth",dir2,&qpref,&childref));
+  PetscCall(CheckEq(child,childref));
+
+  /* reassembly with the same data from the cached patterns */
+  PetscCall(QPFetiReassemble(child));
+  PetscCall(CheckEq(child,childref));
+
+  PetscCall(QPDestroy(&qp));
+  PetscCall(QPDestroy(&qpref));
+  PetscCall(ISDestroy(&dir1));
+  PetscCall(ISDestroy(&dir2));
+  PetscCall(VecDestroy(&b));
+  PetscCall(VecDestroy(&x));
+  PetscCall(MatDestroy(&A));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+/*TEST
+  test:
+    nsize: {{1 3}}
+    filter: grep "FETI gluing type"
+TEST*/
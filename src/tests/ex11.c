@@ -0,0 +1,82 @@
+/* Test the multilevel mode of QPPF - the projector onto Ker G with GG' solved by CG preconditioned with the cluster coarse problem */
+#include <permonqppf.h>
+
+/* Gm rows per rank, each with two own columns and a coupling to the first column of the next rank, so that GG' is not block diagonal */
+static PetscErrorCode CreateG(MPI_Comm comm,PetscInt Gm,Mat *G)
+{
+  PetscInt i,N,rstart,cstart;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateAIJ(comm,Gm,2*Gm,PETSC_DETERMINE,PETSC_DETERMINE,2,NULL,1,NULL,G));
+  PetscCall(MatGetSize(*G,NULL,&N));
+  PetscCall(MatGetOwnershipRange(*G,&rstart,NULL));
+  PetscCall(MatGetOwnershipRangeColumn(*G,&cstart,NULL));
+  for (i=0; i<Gm; i++) {
+    PetscCall(MatSetValue(*G,rstart+i,cstart+2*i,1.0,INSERT_VALUES));
+    PetscCall(MatSetValue(*G,rstart+i,cstart+2*i+1,-1.0+0.1*i,INSERT_VALUES));
+    PetscCall(MatSetValue(*G,rstart+i,(cstart+2*Gm)%N,0.5,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(*G,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(*G,MAT_FINAL_ASSEMBLY));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  MPI_Comm           comm;
+  Mat                G,GGtinv;
+  Vec                v,Pv,Gv;
+  QPPF               pf;
+  KSP                ksp;
+  KSPConvergedReason reason;
+  PetscRandom        rand;
+  PetscBool          multilevel;
+  PetscInt           Gm=3;
+  PetscReal          nrm,nrmGv;
+
+  PetscCall(PermonInitialize(&argc,&args,(char*)0,(char*)0));
+  comm = PETSC_COMM_WORLD;
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-Gm",&Gm,NULL));
+  PetscCall(CreateG(comm,Gm,&G));
+
+  PetscCall(QPPFCreate(comm,&pf));
+  PetscCall(QPPFSetG(pf,G));
+  PetscCall(QPPFSetFromOptions(pf));
+  PetscCall(QPPFSetUp(pf));
+  PetscCall(QPPFGetMultilevel(pf,&multilevel,NULL));
+  if (!multilevel) SETERRQ(comm,PETSC_ERR_PLIB,"multilevel mode expected");
+  PetscCall(QPPFGetGGtinv(pf,&GGtinv));
+  PetscCall(MatInvGetKSP(GGtinv,&ksp));
+  PetscCall(KSPSetTolerances(ksp,1e-10,PETSC_DEFAULT,PETSC_DEFAULT,PETSC_DEFAULT));
+
+  PetscCall(MatCreateVecs(G,&v,&Gv));
+  PetscCall(VecDuplicate(v,&Pv));
+  PetscCall(PetscRandomCreate(comm,&rand));
+  PetscCall(VecSetRandom(v,rand));
+  PetscCall(PetscRandomDestroy(&rand));
+
+  /* G*P*v = 0 up to the tolerance of the outer CG */
+  PetscCall(MatMult(G,v,Gv));
+  PetscCall(VecNorm(Gv,NORM_2,&nrmGv));
+  PetscCall(QPPFApplyP(pf,v,Pv));
+  PetscCall(KSPGetConvergedReason(ksp,&reason));
+  if (reason <= 0) SETERRQ(comm,PETSC_ERR_NOT_CONVERGED,"outer CG on GG' did not converge: %s",KSPConvergedReasons[reason]);
+  PetscCall(MatMult(G,Pv,Gv));
+  PetscCall(VecNorm(Gv,NORM_2,&nrm));
+  if (nrm > 1e-8*nrmGv) SETERRQ(comm,PETSC_ERR_PLIB,"||G*P*v|| = %g is not small compared to ||G*v|| = %g",(double)nrm,(double)nrmGv);
+
+  PetscCall(VecDestroy(&v));
+  PetscCall(VecDestroy(&Pv));
+  PetscCall(VecDestroy(&Gv));
+  PetscCall(QPPFDestroy(&pf));
+  PetscCall(MatDestroy(&G));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+/*TEST
+  test:
+    nsize: {{6 7}}
+    requires: mumps
+    args: -qppf_multilevel -qppf_multilevel_cluster_size 2
+TEST*/
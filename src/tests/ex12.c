@@ -0,0 +1,134 @@
+/* Test the split QPPF applications QPPFApplyQBegin()/QPPFApplyQEnd() and QPPFApplyPBegin()/QPPFApplyPEnd() against the plain ones,
+   with and without the cache, and that starting another application of the same QPPF before End is an error */
+#include <permonqppf.h>
+
+/* Gm rows per rank, each with two own columns and a coupling to the first column of the next rank */
+static PetscErrorCode CreateG(MPI_Comm comm,PetscInt Gm,Mat *G)
+{
+  PetscInt i,N,rstart,cstart;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateAIJ(comm,Gm,2*Gm,PETSC_DETERMINE,PETSC_DETERMINE,2,NULL,1,NULL,G));
+  PetscCall(MatGetSize(*G,NULL,&N));
+  PetscCall(MatGetOwnershipRange(*G,&rstart,NULL));
+  PetscCall(MatGetOwnershipRangeColumn(*G,&cstart,NULL));
+  for (i=0; i<Gm; i++) {
+    PetscCall(MatSetValue(*G,rstart+i,cstart+2*i,1.0,INSERT_VALUES));
+    PetscCall(MatSetValue(*G,rstart+i,cstart+2*i+1,-1.0+0.1*i,INSERT_VALUES));
+    PetscCall(MatSetValue(*G,rstart+i,(cstart+2*Gm)%N,0.5,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(*G,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(*G,MAT_FINAL_ASSEMBLY));
+  PetscFunctionReturn(0);
+}
+
+static PetscErrorCode CheckEqual(Vec x,Vec y,const char name[])
+{
+  Vec       d;
+  PetscReal norm;
+
+  PetscFunctionBegin;
+  PetscCall(VecDuplicate(x,&d));
+  PetscCall(VecWAXPY(d,-1.0,x,y));
+  PetscCall(VecNorm(d,NORM_2,&norm));
+  PetscCall(VecDestroy(&d));
+  if (norm > PETSC_SMALL) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"split %s differs from the plain one: %g",name,(double)norm);
+  PetscFunctionReturn(0);
+}
+
+/* split applications of v compared with the plain ones computed for a copy of v */
+static PetscErrorCode CheckSplit(QPPF pf,Vec v)
+{
+  Vec vc,y,yref;
+
+  PetscFunctionBegin;
+  PetscCall(VecDuplicate(v,&vc));
+  PetscCall(VecDuplicate(v,&y));
+  PetscCall(VecDuplicate(v,&yref));
+  PetscCall(VecCopy(v,vc));
+
+  PetscCall(QPPFApplyQ(pf,vc,yref));
+  PetscCall(QPPFApplyQBegin(pf,v));
+  PetscCall(QPPFApplyQEnd(pf,v,y));
+  PetscCall(CheckEqual(y,yref,"Q"));
+  /* the second pair may be served from the cache */
+  PetscCall(QPPFApplyQBegin(pf,v));
+  PetscCall(QPPFApplyQEnd(pf,v,y));
+  PetscCall(CheckEqual(y,yref,"Q"));
+
+  PetscCall(QPPFApplyP(pf,vc,yref));
+  PetscCall(QPPFApplyPBegin(pf,v));
+  PetscCall(QPPFApplyPEnd(pf,v,y));
+  PetscCall(CheckEqual(y,yref,"P"));
+  PetscCall(QPPFApplyPBegin(pf,v));
+  PetscCall(QPPFApplyPEnd(pf,v,y));
+  PetscCall(CheckEqual(y,yref,"P"));
+
+  PetscCall(VecDestroy(&vc));
+  PetscCall(VecDestroy(&y));
+  PetscCall(VecDestroy(&yref));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  MPI_Comm       comm;
+  Mat            G;
+  Vec            v,w,y;
+  QPPF           pf;
+  PetscRandom    rand;
+  PetscInt       Gm=3;
+  PetscErrorCode ierr;
+
+  PetscCall(PermonInitialize(&argc,&args,(char*)0,(char*)0));
+  comm = PETSC_COMM_WORLD;
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-Gm",&Gm,NULL));
+  PetscCall(CreateG(comm,Gm,&G));
+
+  PetscCall(QPPFCreate(comm,&pf));
+  PetscCall(QPPFSetG(pf,G));
+  PetscCall(QPPFSetFromOptions(pf));
+  PetscCall(QPPFSetUp(pf));
+
+  PetscCall(MatCreateVecs(G,&v,NULL));
+  PetscCall(VecDuplicate(v,&w));
+  PetscCall(VecDuplicate(v,&y));
+  PetscCall(PetscRandomCreate(comm,&rand));
+  PetscCall(VecSetRandom(v,rand));
+  PetscCall(VecSetRandom(w,rand));
+  PetscCall(PetscRandomDestroy(&rand));
+
+  PetscCall(CheckSplit(pf,v));
+  PetscCall(QPPFSetCacheSize(pf,0));
+  PetscCall(CheckSplit(pf,w));
+
+  /* nothing else may run on pf between Begin and End */
+  PetscCall(QPPFApplyPBegin(pf,v));
+  PetscCall(PetscPushErrorHandler(PetscReturnErrorHandler,NULL));
+  ierr = QPPFApplyQBegin(pf,w);
+  PetscCall(PetscPopErrorHandler());
+  if (ierr != PETSC_ERR_ORDER) SETERRQ(comm,PETSC_ERR_PLIB,"second QPPFApplyQBegin() before End did not fail with PETSC_ERR_ORDER");
+  PetscCall(PetscPushErrorHandler(PetscReturnErrorHandler,NULL));
+  ierr = QPPFApplyHalfQ(pf,w,y);
+  PetscCall(PetscPopErrorHandler());
+  if (ierr != PETSC_ERR_ORDER) SETERRQ(comm,PETSC_ERR_PLIB,"QPPFApplyHalfQ() before End did not fail with PETSC_ERR_ORDER");
+  PetscCall(PetscPushErrorHandler(PetscReturnErrorHandler,NULL));
+  ierr = QPPFApplyPEnd(pf,w,y);
+  PetscCall(PetscPopErrorHandler());
+  if (ierr != PETSC_ERR_ORDER) SETERRQ(comm,PETSC_ERR_PLIB,"QPPFApplyPEnd() with another vector did not fail with PETSC_ERR_ORDER");
+  PetscCall(QPPFApplyPEnd(pf,v,y));
+
+  PetscCall(VecDestroy(&v));
+  PetscCall(VecDestroy(&w));
+  PetscCall(VecDestroy(&y));
+  PetscCall(QPPFDestroy(&pf));
+  PetscCall(MatDestroy(&G));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+/*TEST
+  test:
+    nsize: {{1 3}}
+    args: -qppf_fused_P {{0 1}}
+TEST*/
@@ -0,0 +1,152 @@
+/* Test the penalized operator A + rho*B'*B - the fused AIJ operator, the split one with assembled B'*B for AIJ and
+   MATEXTENSION B and implicit A, and the split one through QPPF, all against A*x + rho*B'*(B*x) */
+#include <permonqp.h>
+
+/* Bm rows per rank, each with two own columns and a coupling to the first column of the next rank */
+static PetscErrorCode CreateB(MPI_Comm comm,PetscInt Bm,Mat *B)
+{
+  PetscInt i,N,rstart,cstart;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateAIJ(comm,Bm,2*Bm,PETSC_DETERMINE,PETSC_DETERMINE,2,NULL,1,NULL,B));
+  PetscCall(MatGetSize(*B,NULL,&N));
+  PetscCall(MatGetOwnershipRange(*B,&rstart,NULL));
+  PetscCall(MatGetOwnershipRangeColumn(*B,&cstart,NULL));
+  for (i=0; i<Bm; i++) {
+    PetscCall(MatSetValue(*B,rstart+i,cstart+2*i,1.0,INSERT_VALUES));
+    PetscCall(MatSetValue(*B,rstart+i,cstart+2*i+1,-1.0+0.1*i,INSERT_VALUES));
+    PetscCall(MatSetValue(*B,rstart+i,(cstart+2*Bm)%N,0.5,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(*B,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(*B,MAT_FINAL_ASSEMBLY));
+  PetscFunctionReturn(0);
+}
+
+/* 1D Laplacian with n rows per rank */
+static PetscErrorCode CreateA(MPI_Comm comm,PetscInt n,Mat *A)
+{
+  PetscInt i,N,rstart,rend;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateAIJ(comm,n,n,PETSC_DETERMINE,PETSC_DETERMINE,3,NULL,1,NULL,A));
+  PetscCall(MatGetSize(*A,&N,NULL));
+  PetscCall(MatGetOwnershipRange(*A,&rstart,&rend));
+  for (i=rstart; i<rend; i++) {
+    if (i>0)   PetscCall(MatSetValue(*A,i,i-1,-1.0,INSERT_VALUES));
+    if (i<N-1) PetscCall(MatSetValue(*A,i,i+1,-1.0,INSERT_VALUES));
+    PetscCall(MatSetValue(*A,i,i,2.0,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(*A,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(*A,MAT_FINAL_ASSEMBLY));
+  PetscFunctionReturn(0);
+}
+
+/* compares Arho*x and x + Arho*x with A*x + rho*B'*(B*x), also after changing rho */
+static PetscErrorCode CheckPenalized(QP qp,PetscBool fused,PetscReal rho,Mat A,Mat B,Vec x,const char name[])
+{
+  Mat       Arho;
+  Vec       y,yref,Bx;
+  PetscReal norm,r;
+  PetscInt  k;
+
+  PetscFunctionBegin;
+  PetscCall(PetscOptionsSetValue(NULL,"-mat_penalized_fused",fused ? "1" : "0"));
+  PetscCall(MatCreatePenalized(qp,rho,&Arho));
+  PetscCall(PetscOptionsClearValue(NULL,"-mat_penalized_fused"));
+  PetscCall(MatCreateVecs(B,NULL,&Bx));
+  PetscCall(VecDuplicate(x,&y));
+  PetscCall(VecDuplicate(x,&yref));
+
+  for (k=0; k<2; k++) {
+    r = k ? 2.0*rho : rho;
+    if (k) PetscCall(MatPenalizedSetPenalty(Arho,r));
+    PetscCall(MatMult(B,x,Bx));
+    PetscCall(MatMultTranspose(B,Bx,yref));
+    PetscCall(VecScale(yref,r));
+    PetscCall(MatMultAdd(A,x,yref,yref));
+
+    PetscCall(MatMult(Arho,x,y));
+    PetscCall(VecAXPY(y,-1.0,yref));
+    PetscCall(VecNorm(y,NORM_2,&norm));
+    if (norm > PETSC_SMALL) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"%s penalized MatMult with rho = %g differs from the reference: %g",name,(double)r,(double)norm);
+
+    PetscCall(VecAXPY(yref,1.0,x));
+    PetscCall(MatMultAdd(Arho,x,x,y));
+    PetscCall(VecAXPY(y,-1.0,yref));
+    PetscCall(VecNorm(y,NORM_2,&norm));
+    if (norm > PETSC_SMALL) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"%s penalized MatMultAdd with rho = %g differs from the reference: %g",name,(double)r,(double)norm);
+  }
+
+  PetscCall(VecDestroy(&y));
+  PetscCall(VecDestroy(&yref));
+  PetscCall(VecDestroy(&Bx));
+  PetscCall(MatDestroy(&Arho));
+  PetscFunctionReturn(0);
+}
+
+/* QP with operator A and equality constraint B */
+static PetscErrorCode CreateQP(Mat A,Mat B,QP *qp)
+{
+  PetscFunctionBegin;
+  PetscCall(QPCreate(PetscObjectComm((PetscObject)A),qp));
+  PetscCall(QPSetOperator(*qp,A));
+  PetscCall(QPSetEq(*qp,B,NULL));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  MPI_Comm    comm;
+  Mat         A,Atimer,B,Bext;
+  Vec         x;
+  QP          qp;
+  PetscRandom rand;
+  PetscInt    Bm=3;
+  PetscReal   rho=10.0;
+
+  PetscCall(PermonInitialize(&argc,&args,(char*)0,(char*)0));
+  comm = PETSC_COMM_WORLD;
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-Bm",&Bm,NULL));
+  PetscCall(PetscOptionsGetReal(NULL,NULL,"-rho",&rho,NULL));
+  PetscCall(CreateB(comm,Bm,&B));
+  PetscCall(CreateA(comm,2*Bm,&A));
+  /* MATTIMER is not AIJ, so A + rho*B'*B is not fused */
+  PetscCall(MatCreateTimer(A,&Atimer));
+  PetscCall(MatConvert(B,MATEXTENSION,MAT_INITIAL_MATRIX,&Bext));
+
+  PetscCall(MatCreateVecs(B,&x,NULL));
+  PetscCall(PetscRandomCreate(comm,&rand));
+  PetscCall(VecSetRandom(x,rand));
+  PetscCall(PetscRandomDestroy(&rand));
+
+  PetscCall(CreateQP(A,B,&qp));
+  PetscCall(CheckPenalized(qp,PETSC_TRUE,rho,A,B,x,"fused"));
+  PetscCall(CheckPenalized(qp,PETSC_FALSE,rho,A,B,x,"split through QPPF"));
+  PetscCall(QPDestroy(&qp));
+
+  PetscCall(CreateQP(Atimer,B,&qp));
+  PetscCall(CheckPenalized(qp,PETSC_TRUE,rho,A,B,x,"split with assembled B'*B"));
+  PetscCall(CheckPenalized(qp,PETSC_FALSE,rho,A,B,x,"split through QPPF"));
+  PetscCall(QPDestroy(&qp));
+
+  PetscCall(CreateQP(A,Bext,&qp));
+  PetscCall(CheckPenalized(qp,PETSC_TRUE,rho,A,B,x,"fused with MATEXTENSION B"));
+  PetscCall(QPDestroy(&qp));
+
+  PetscCall(CreateQP(Atimer,Bext,&qp));
+  PetscCall(CheckPenalized(qp,PETSC_TRUE,rho,A,B,x,"split with assembled MATEXTENSION B'*B"));
+  PetscCall(QPDestroy(&qp));
+
+  PetscCall(VecDestroy(&x));
+  PetscCall(MatDestroy(&Bext));
+  PetscCall(MatDestroy(&Atimer));
+  PetscCall(MatDestroy(&A));
+  PetscCall(MatDestroy(&B));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+/*TEST
+  test:
+    nsize: {{1 3}}
+TEST*/
@@ -0,0 +1,111 @@
+
+/* Test MatGetMaxEigenvalue (Lanczos with a capped basis, or the power method) against a plain power iteration,
+   including the stashed estimate and the stashed Ritz vector */
+#include <permonmat.h>
+
+/* 1D Laplacian with n rows per rank and the first diagonal entry increased by delta, so that the largest
+   eigenvalue (about 2+delta+1/delta) is separated from the rest of the spectrum */
+static PetscErrorCode CreateA(MPI_Comm comm,PetscInt n,PetscReal delta,Mat *A)
+{
+  PetscInt i,N,rstart,rend;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateAIJ(comm,n,n,PETSC_DETERMINE,PETSC_DETERMINE,3,NULL,1,NULL,A));
+  PetscCall(MatGetSize(*A,&N,NULL));
+  PetscCall(MatGetOwnershipRange(*A,&rstart,&rend));
+  for (i=rstart; i<rend; i++) {
+    if (i>0)   PetscCall(MatSetValue(*A,i,i-1,-1.0,INSERT_VALUES));
+    if (i<N-1) PetscCall(MatSetValue(*A,i,i+1,-1.0,INSERT_VALUES));
+    PetscCall(MatSetValue(*A,i,i,i ? 2.0 : 2.0+delta,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(*A,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(*A,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatSetOption(*A,MAT_SYMMETRIC,PETSC_TRUE));
+  PetscFunctionReturn(0);
+}
+
+/* reference: plain power iteration with a fixed number of iterations, v is the normalized eigenvector estimate */
+static PetscErrorCode PowerReference(Mat A,PetscInt its,PetscReal *lambda,Vec v)
+{
+  Vec         w;
+  PetscScalar dot;
+  PetscInt    k;
+
+  PetscFunctionBegin;
+  PetscCall(VecDuplicate(v,&w));
+  PetscCall(VecSet(v,1.0));
+  PetscCall(VecNormalize(v,NULL));
+  for (k=0; k<its; k++) {
+    PetscCall(MatMult(A,v,w));
+    PetscCall(VecDot(w,v,&dot));
+    PetscCall(VecNormalize(w,NULL));
+    PetscCall(VecCopy(w,v));
+  }
+  *lambda = PetscRealPart(dot);
+  PetscCall(VecDestroy(&w));
+  PetscFunctionReturn(0);
+}
+
+/* the stashed Ritz vector must be a unit eigenvector estimate parallel to the reference one */
+static PetscErrorCode CheckRitzVec(Mat A,PetscReal lambda,Vec vref)
+{
+  Vec         ritz,r;
+  PetscScalar dot;
+  PetscReal   norm;
+
+  PetscFunctionBegin;
+  PetscCall(PetscObjectQuery((PetscObject)A,"MatGetMaxEigenvalue_RitzVec",(PetscObject*)&ritz));
+  if (!ritz) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"eigenvector estimate is not stashed in A");
+  PetscCall(VecDuplicate(ritz,&r));
+  PetscCall(MatMult(A,ritz,r));
+  PetscCall(VecAXPY(r,-lambda,ritz));
+  PetscCall(VecNorm(r,NORM_2,&norm));
+  if (norm > 1e-3*lambda) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"stashed eigenvector estimate has relative residual %g",(double)(norm/lambda));
+  PetscCall(VecDot(ritz,vref,&dot));
+  if (PetscAbsReal(PetscAbsScalar(dot)-1.0) > 1e-4) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"stashed eigenvector estimate is not parallel to the power method one, |(v,vref)| = %g",(double)PetscAbsScalar(dot));
+  PetscCall(VecDestroy(&r));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  MPI_Comm    comm;
+  Mat         A;
+  Vec         vref;
+  PetscScalar lambda,lambda1;
+  PetscReal   lref,delta=2.0,tol=1e-10;
+  PetscInt    n=10,maxits=1000;
+
+  PetscCall(PermonInitialize(&argc,&args,(char*)0,(char*)0));
+  comm = PETSC_COMM_WORLD;
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-n",&n,NULL));
+  PetscCall(PetscOptionsGetReal(NULL,NULL,"-delta",&delta,NULL));
+  PetscCall(CreateA(comm,n,delta,&A));
+  PetscCall(MatCreateVecs(A,&vref,NULL));
+  PetscCall(PowerReference(A,2000,&lref,vref));
+
+  PetscCall(MatGetMaxEigenvalue(A,NULL,&lambda,tol,maxits));
+  if (PetscAbsScalar(lambda-lref) > 1e-6*lref) SETERRQ(comm,PETSC_ERR_PLIB,"max eigenvalue estimate %.12e differs from the power method one %.12e",(double)PetscRealPart(lambda),(double)lref);
+  PetscCall(CheckRitzVec(A,lref,vref));
+
+  /* unchanged A and a looser tolerance give the stashed estimate */
+  PetscCall(MatGetMaxEigenvalue(A,NULL,&lambda1,1e-6,maxits));
+  if (lambda1 != lambda) SETERRQ(comm,PETSC_ERR_PLIB,"stashed estimate %.12e was not returned, got %.12e",(double)PetscRealPart(lambda),(double)PetscRealPart(lambda1));
+
+  /* changed A is estimated again, starting from the stashed Ritz vector */
+  PetscCall(MatScale(A,2.0));
+  PetscCall(MatGetMaxEigenvalue(A,NULL,&lambda,tol,maxits));
+  if (PetscAbsScalar(lambda-2.0*lref) > 2e-6*lref) SETERRQ(comm,PETSC_ERR_PLIB,"max eigenvalue estimate of the scaled matrix %.12e differs from the power method one %.12e",(double)PetscRealPart(lambda),(double)(2.0*lref));
+  PetscCall(CheckRitzVec(A,2.0*lref,vref));
+
+  PetscCall(VecDestroy(&vref));
+  PetscCall(MatDestroy(&A));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+/*TEST
+  test:
+    nsize: {{1 3}}
+    args: -mat_get_max_eigenvalue_lanczos {{0 1}} -mat_get_max_eigenvalue_lanczos_max_basis 4
+TEST*/
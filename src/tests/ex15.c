@@ -0,0 +1,147 @@
+
+/* Test MATEXTENSION MatMult, MatMultTranspose and their Add variants with ranks whose row and column index sets
+   cover the whole owned range (in-place), a contiguous part of it (in-place with zeroing), or are not contiguous
+   and not owned (scattered), against the same matrix assembled as AIJ */
+#include <permonmat.h>
+
+/* index sets of this rank: rank%3 == 0 full owned ranges, rank%3 == 1 contiguous parts, rank%3 == 2 strided rows
+   and columns owned by other ranks; the ranks with rank%3 == 2 need at least 3 ranks */
+static PetscErrorCode CreateIS(Mat B,IS *ris,IS *cis)
+{
+  PetscMPIInt rank;
+  PetscInt    m,n,N,rstart,cstart,cend,idx[4];
+
+  PetscFunctionBegin;
+  PetscCallMPI(MPI_Comm_rank(PetscObjectComm((PetscObject)B),&rank));
+  PetscCall(MatGetLocalSize(B,&m,&n));
+  PetscCall(MatGetSize(B,NULL,&N));
+  PetscCall(MatGetOwnershipRange(B,&rstart,NULL));
+  PetscCall(MatGetOwnershipRangeColumn(B,&cstart,&cend));
+  switch (rank%3) {
+    case 0:
+      PetscCall(ISCreateStride(PETSC_COMM_SELF,m,rstart,1,ris));
+      PetscCall(ISCreateStride(PETSC_COMM_SELF,n,cstart,1,cis));
+      break;
+    case 1:
+      PetscCall(ISCreateStride(PETSC_COMM_SELF,m/2,rstart+2,1,ris));
+      PetscCall(ISCreateStride(PETSC_COMM_SELF,n-2,cstart+1,1,cis));
+      break;
+    default:
+      PetscCall(ISCreateStride(PETSC_COMM_SELF,m/2,rstart,2,ris));
+      idx[0] = cstart; idx[1] = cstart+3; idx[2] = cend%N; idx[3] = (cend+2)%N;
+      PetscCall(ISCreateGeneral(PETSC_COMM_SELF,4,idx,PETSC_COPY_VALUES,cis));
+  }
+  PetscFunctionReturn(0);
+}
+
+static PetscErrorCode CheckEqual(Vec x,Vec y,const char name[])
+{
+  Vec       d;
+  PetscReal norm;
+
+  PetscFunctionBegin;
+  PetscCall(VecDuplicate(x,&d));
+  PetscCall(VecWAXPY(d,-1.0,x,y));
+  PetscCall(VecNorm(d,NORM_2,&norm));
+  PetscCall(VecDestroy(&d));
+  if (norm > PETSC_SMALL) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"MATEXTENSION %s differs from the AIJ one: %g",name,(double)norm);
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  MPI_Comm       comm;
+  PetscMPIInt    rank;
+  Mat            Aloc,TA,B;
+  IS             ris,cis;
+  Vec            x,y,yref,r,c,cref;
+  PetscRandom    rand;
+  PetscInt       i,j,n=6,nr,nc;
+  const PetscInt *rows,*cols;
+  PetscScalar    v;
+
+  PetscCall(PermonInitialize(&argc,&args,(char*)0,(char*)0));
+  comm = PETSC_COMM_WORLD;
+  PetscCallMPI(MPI_Comm_rank(comm,&rank));
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-n",&n,NULL));
+  if (n < 6) SETERRQ(comm,PETSC_ERR_ARG_OUTOFRANGE,"-n must be at least 6");
+
+  /* reference AIJ matrix, used for the layouts first */
+  PetscCall(MatCreateAIJ(comm,n,n,PETSC_DETERMINE,PETSC_DETERMINE,n,NULL,n,NULL,&B));
+  PetscCall(CreateIS(B,&ris,&cis));
+  PetscCall(ISGetLocalSize(ris,&nr));
+  PetscCall(ISGetLocalSize(cis,&nc));
+  PetscCall(ISGetIndices(ris,&rows));
+  PetscCall(ISGetIndices(cis,&cols));
+
+  /* condensed matrix and the same values at the global positions */
+  PetscCall(MatCreateSeqAIJ(PETSC_COMM_SELF,nr,nc,nc,NULL,&Aloc));
+  for (i=0; i<nr; i++) {
+    for (j=0; j<nc; j++) {
+      v = 1.0 + i + 0.1*j + rank;
+      PetscCall(MatSetValue(Aloc,i,j,v,INSERT_VALUES));
+      PetscCall(MatSetValue(B,rows[i],cols[j],v,ADD_VALUES));
+    }
+  }
+  PetscCall(ISRestoreIndices(ris,&rows));
+  PetscCall(ISRestoreIndices(cis,&cols));
+  PetscCall(MatAssemblyBegin(Aloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(Aloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyBegin(B,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(B,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatCreateExtension(comm,n,n,PETSC_DETERMINE,PETSC_DETERMINE,Aloc,ris,PETSC_TRUE,cis,&TA));
+
+  PetscCall(MatCreateVecs(B,&x,&y));
+  PetscCall(VecDuplicate(y,&yref));
+  PetscCall(VecDuplicate(y,&r));
+  PetscCall(VecDuplicate(x,&c));
+  PetscCall(VecDuplicate(x,&cref));
+  PetscCall(PetscRandomCreate(comm,&rand));
+  PetscCall(VecSetRandom(x,rand));
+  PetscCall(VecSetRandom(r,rand));
+
+  /* output vectors hold garbage first, rows and columns not covered by this rank must be zeroed */
+  PetscCall(VecSetRandom(y,rand));
+  PetscCall(MatMult(TA,x,y));
+  PetscCall(MatMult(B,x,yref));
+  PetscCall(CheckEqual(y,yref,"MatMult"));
+
+  PetscCall(VecSetRandom(c,rand));
+  PetscCall(MatMultTranspose(TA,r,c));
+  PetscCall(MatMultTranspose(B,r,cref));
+  PetscCall(CheckEqual(c,cref,"MatMultTranspose"));
+
+  PetscCall(MatMultAdd(TA,x,r,y));
+  PetscCall(MatMultAdd(B,x,r,yref));
+  PetscCall(CheckEqual(y,yref,"MatMultAdd"));
+
+  PetscCall(MatMultTransposeAdd(TA,r,x,c));
+  PetscCall(MatMultTransposeAdd(B,r,x,cref));
+  PetscCall(CheckEqual(c,cref,"MatMultTransposeAdd"));
+
+  /* in-place variant, output aliasing the added vector */
+  PetscCall(VecCopy(r,y));
+  PetscCall(MatMultAdd(TA,x,y,y));
+  PetscCall(MatMultAdd(B,x,r,yref));
+  PetscCall(CheckEqual(y,yref,"MatMultAdd with y == r"));
+
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscCall(VecDestroy(&x));
+  PetscCall(VecDestroy(&y));
+  PetscCall(VecDestroy(&yref));
+  PetscCall(VecDestroy(&r));
+  PetscCall(VecDestroy(&c));
+  PetscCall(VecDestroy(&cref));
+  PetscCall(ISDestroy(&ris));
+  PetscCall(ISDestroy(&cis));
+  PetscCall(MatDestroy(&Aloc));
+  PetscCall(MatDestroy(&TA));
+  PetscCall(MatDestroy(&B));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+/*TEST
+  test:
+    nsize: {{1 2 3 4}}
+TEST*/
@@ -0,0 +1,162 @@
+
+/* Test the pivots selected by MatRegularize against the original MatGetValues/MatSetValues based elimination,
+   and that a rank-deficient nullspace basis R is an error */
+#include <permonmat.h>
+
+/* the original pivot selection: full pivoting Gaussian elimination of R (p x d, column-major) from the last column,
+   pivots are the original indices of the last d rows */
+static PetscErrorCode ReferencePivots(PetscInt p,PetscInt d,const PetscScalar R[],PetscBool pivot[])
+{
+  PetscScalar *a,*v1,*v2,vpivot,alpha,t;
+  PetscInt    *perm,i,j,II,J,ipivot=0,jpivot=0,tp;
+
+  PetscFunctionBegin;
+  PetscCall(PetscMalloc4(p*d,&a,p,&v1,p,&v2,p,&perm));
+  PetscCall(PetscArraycpy(a,R,p*d));
+  for (i=0; i<p; i++) perm[i] = i;
+  for (J=d-1, II=p-1; J>=0; J--, II--) {
+    vpivot = 0.0;
+    for (j=0; j<=J; j++) {
+      for (i=0; i<=II; i++) {
+        if (PetscAbsScalar(a[i+j*p]) > PetscAbsScalar(vpivot)) {
+          ipivot = i; jpivot = j; vpivot = a[i+j*p];
+        }
+      }
+    }
+    if (vpivot == 0.0) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_ARG_WRONG,"reference: R does not have full column rank");
+    /* swap rows ipivot and II */
+    for (j=0; j<=J; j++) {
+      v1[j] = a[ipivot+j*p]; v2[j] = a[II+j*p];
+    }
+    for (j=0; j<=J; j++) {
+      a[ipivot+j*p] = v2[j]; a[II+j*p] = v1[j];
+    }
+    tp = perm[ipivot]; perm[ipivot] = perm[II]; perm[II] = tp;
+    /* swap columns jpivot and J, v1 is then the column J */
+    for (i=0; i<=II; i++) {
+      v1[i] = a[i+jpivot*p]; v2[i] = a[i+J*p];
+    }
+    for (i=0; i<=II; i++) {
+      a[i+J*p] = v1[i]; a[i+jpivot*p] = v2[i];
+    }
+    /* columnwise elimination of the row II */
+    for (j=0; j<=J-1; j++) {
+      for (i=0; i<=II; i++) v2[i] = a[i+j*p];
+      if (PetscAbsScalar(v2[II]) < PETSC_MACHINE_EPSILON) continue;
+      alpha = -vpivot/v2[II];
+      for (i=0; i<=II; i++) {
+        t = v2[i]*alpha;
+        a[i+j*p] = t + v1[i];
+      }
+    }
+  }
+  for (i=0; i<p; i++) pivot[i] = PETSC_FALSE;
+  for (i=p-d; i<p; i++) pivot[perm[i]] = PETSC_TRUE;
+  PetscCall(PetscFree4(a,v1,v2,perm));
+  PetscFunctionReturn(0);
+}
+
+/* tridiagonal K of size p */
+static PetscErrorCode CreateK(PetscInt p,Mat *K)
+{
+  PetscInt i;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateSeqAIJ(PETSC_COMM_SELF,p,p,3,NULL,K));
+  for (i=0; i<p; i++) {
+    if (i>0)   PetscCall(MatSetValue(*K,i,i-1,-1.0,INSERT_VALUES));
+    if (i<p-1) PetscCall(MatSetValue(*K,i,i+1,-1.0,INSERT_VALUES));
+    PetscCall(MatSetValue(*K,i,i,2.0,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(*K,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(*K,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatSetOption(*K,MAT_SYMMETRIC,PETSC_TRUE));
+  PetscFunctionReturn(0);
+}
+
+/* regularization matrix Q = R_I*inv(R_I'*R_I)*R_I' of a square nonsingular R_I is the identity on the pivots I
+   and zero elsewhere, so its diagonal shows the pivots selected by MatRegularize */
+static PetscErrorCode CheckPivots(PetscInt p,PetscInt d,PetscScalar Rarr[],const char name[])
+{
+  Mat         K,R,Kreg,Q;
+  PetscBool   *pivot;
+  PetscInt    i,j,ncols;
+  const PetscInt    *cols;
+  const PetscScalar *vals;
+  PetscScalar qii;
+
+  PetscFunctionBegin;
+  PetscCall(PetscMalloc1(p,&pivot));
+  PetscCall(ReferencePivots(p,d,Rarr,pivot));
+  PetscCall(CreateK(p,&K));
+  PetscCall(MatCreateSeqDense(PETSC_COMM_SELF,p,d,Rarr,&R));
+  PetscCall(MatRegularize(K,R,MAT_REG_EXPLICIT,MAT_INITIAL_MATRIX,&Kreg));
+  PetscCall(PetscObjectQuery((PetscObject)R,"MatRegularize_Q_loc",(PetscObject*)&Q));
+  if (!Q) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_PLIB,"%s: regularization matrix is not composed with R",name);
+  for (i=0; i<p; i++) {
+    qii = 0.0;
+    PetscCall(MatGetRow(Q,i,&ncols,&cols,&vals));
+    for (j=0; j<ncols; j++) {
+      if (cols[j] == i) qii = vals[j];
+      else if (PetscAbsScalar(vals[j]) > PETSC_SMALL) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_PLIB,"%s: Q(%" PetscInt_FMT ",%" PetscInt_FMT ") = %g is not zero",name,i,cols[j],(double)PetscAbsScalar(vals[j]));
+    }
+    PetscCall(MatRestoreRow(Q,i,&ncols,&cols,&vals));
+    if (PetscAbsScalar(qii - (pivot[i] ? 1.0 : 0.0)) > PETSC_SMALL) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_PLIB,"%s: row %" PetscInt_FMT " is %s by the reference but Q(i,i) = %g",name,i,pivot[i] ? "a pivot" : "not a pivot",(double)PetscRealPart(qii));
+  }
+  PetscCall(MatDestroy(&Kreg));
+  PetscCall(MatDestroy(&R));
+  PetscCall(MatDestroy(&K));
+  PetscCall(PetscFree(pivot));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  PetscScalar    *R;
+  PetscInt       i,j,p=10,nn;
+  Mat            K,Rm,Kreg;
+  PetscErrorCode ierr;
+
+  PetscCall(PermonInitialize(&argc,&args,(char*)0,(char*)0));
+  PetscCall(PetscMalloc1(3*p,&R));
+
+  /* constant */
+  for (i=0; i<p; i++) R[i] = 1.0;
+  PetscCall(CheckPivots(p,1,R,"constant R"));
+
+  /* constant and linear */
+  for (i=0; i<p; i++) { R[i] = 1.0; R[i+p] = i; }
+  PetscCall(CheckPivots(p,2,R,"constant and linear R"));
+
+  /* 2D rigid body modes of p/2 nodes with coordinates (i, i%3) */
+  nn = p/2;
+  for (i=0; i<nn; i++) {
+    R[2*i]       = 1.0; R[2*i+1]       = 0.0;
+    R[2*i+p]     = 0.0; R[2*i+1+p]     = 1.0;
+    R[2*i+2*p]   = -(PetscScalar)(i%3); R[2*i+1+2*p] = i;
+  }
+  PetscCall(CheckPivots(p,3,R,"rigid body modes R"));
+
+  /* general dense R */
+  for (j=0; j<3; j++) for (i=0; i<p; i++) R[i+j*p] = PetscSinReal(3.0*i+7.0*j+1.0);
+  PetscCall(CheckPivots(p,3,R,"general R"));
+
+  /* two equal columns: the elimination leaves an exactly zero column */
+  for (i=0; i<p; i++) { R[i] = 1.0; R[i+p] = i; R[i+2*p] = 1.0; }
+  PetscCall(CreateK(p,&K));
+  PetscCall(MatCreateSeqDense(PETSC_COMM_SELF,p,3,R,&Rm));
+  PetscCall(PetscPushErrorHandler(PetscReturnErrorHandler,NULL));
+  ierr = MatRegularize(K,Rm,MAT_REG_EXPLICIT,MAT_INITIAL_MATRIX,&Kreg);
+  PetscCall(PetscPopErrorHandler());
+  if (ierr != PETSC_ERR_ARG_WRONG) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_PLIB,"MatRegularize with rank-deficient R did not fail with PETSC_ERR_ARG_WRONG");
+  PetscCall(MatDestroy(&Rm));
+  PetscCall(MatDestroy(&K));
+
+  PetscCall(PetscFree(R));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+/*TEST
+  test:
+TEST*/
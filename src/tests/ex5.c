@@ -0,0 +1,144 @@
+
+/* Test branch-free QPC box kernels against the reference ones */
+#include <permonqpc.h>
+
+static PetscErrorCode CheckVecEqual(Vec a,Vec b,const char name[],const char kind[])
+{
+  Vec       diff;
+  PetscReal norm;
+
+  PetscFunctionBegin;
+  PetscCall(VecDuplicate(a,&diff));
+  PetscCall(VecWAXPY(diff,-1.0,a,b));
+  PetscCall(VecNorm(diff,NORM_INFINITY,&norm));
+  if (norm > 0.0) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"%s differs for %s box: %g",name,kind,(double)norm);
+  PetscCall(VecDestroy(&diff));
+  PetscFunctionReturn(0);
+}
+
+static PetscErrorCode TestBox(PetscRandom rand,PetscInt n,PetscBool haslb,PetscBool hasub,const char kind[])
+{
+  QPC          qpc;
+  Vec          lb=NULL,ub=NULL,x,y,d,g,gf[2],gc[2],gP[2],gr[2],grg[2],Px[2];
+  PetscScalar  alpha[2];
+  PetscReal    dots[2][3];
+  PetscInt     k,i;
+
+  PetscFunctionBegin;
+  PetscCall(VecCreate(PETSC_COMM_WORLD,&x));
+  PetscCall(VecSetSizes(x,PETSC_DECIDE,n));
+  PetscCall(VecSetFromOptions(x));
+  PetscCall(VecDuplicate(x,&y));
+  PetscCall(VecDuplicate(x,&d));
+  PetscCall(VecDuplicate(x,&g));
+  for (k=0; k<2; k++) {
+    PetscCall(VecDuplicate(x,&gf[k]));
+    PetscCall(VecDuplicate(x,&gc[k]));
+    PetscCall(VecDuplicate(x,&gP[k]));
+    PetscCall(VecDuplicate(x,&gr[k]));
+    PetscCall(VecDuplicate(x,&grg[k]));
+    PetscCall(VecDuplicate(x,&Px[k]));
+  }
+  if (haslb) {
+    PetscCall(VecDuplicate(x,&lb));
+    PetscCall(VecSetRandom(lb,rand));
+    PetscCall(VecShift(lb,-1.0));
+    PetscCall(VecSetValue(lb,0,PETSC_NINFINITY,INSERT_VALUES));
+    PetscCall(VecSetValue(lb,n/3,PETSC_NINFINITY,INSERT_VALUES));
+    PetscCall(VecAssemblyBegin(lb));
+    PetscCall(VecAssemblyEnd(lb));
+  }
+  if (hasub) {
+    PetscCall(VecDuplicate(x,&ub));
+    PetscCall(VecSetRandom(ub,rand));
+    PetscCall(VecSetValue(ub,n-1,PETSC_INFINITY,INSERT_VALUES));
+    PetscCall(VecSetValue(ub,2*n/3,PETSC_INFINITY,INSERT_VALUES));
+    PetscCall(VecAssemblyBegin(ub));
+    PetscCall(VecAssemblyEnd(ub));
+  }
+  PetscCall(QPCCreateBox(PETSC_COMM_WORLD,NULL,lb,ub,&qpc));
+
+  /* y in (-1.5,1.5), so that many components of projected x lie on the bounds */
+  PetscCall(VecSetRandom(y,rand));
+  PetscCall(VecScale(y,3.0));
+  PetscCall(VecShift(y,-1.5));
+  /* d in (-2,2), so that also |d| > 1 is covered, with a zero and steps towards the infinite bounds */
+  PetscCall(VecSetRandom(d,rand));
+  PetscCall(VecScale(d,4.0));
+  PetscCall(VecShift(d,-2.0));
+  PetscCall(VecSetValue(d,n/2,0.0,INSERT_VALUES));
+  PetscCall(VecSetValue(d,0,1.5,INSERT_VALUES));
+  PetscCall(VecSetValue(d,n-1,-1.5,INSERT_VALUES));
+  PetscCall(VecSetValue(d,n/3,3.0,INSERT_VALUES));
+  PetscCall(VecSetValue(d,2*n/3,-3.0,INSERT_VALUES));
+  PetscCall(VecAssemblyBegin(d));
+  PetscCall(VecAssemblyEnd(d));
+  PetscCall(VecSetRandom(g,rand));
+  PetscCall(VecShift(g,-0.5));
+
+  for (k=0; k<2; k++) {
+    PetscCall(QPCBoxSetReferenceKernels(qpc,(PetscBool)k));
+    PetscCall(QPCProject(qpc,y,Px[k]));
+    PetscCall(VecCopy(Px[0],x));
+    PetscCall(QPCFeas(qpc,x,d,&alpha[k]));
+    PetscCall(QPCGrads(qpc,x,g,gf[k],gc[k]));
+    PetscCall(QPCGradReduced(qpc,x,gf[k],0.5,gr[k]));
+    /* g does not vanish on the active set */
+    PetscCall(QPCGradReduced(qpc,x,g,0.5,grg[k]));
+    PetscCall(QPCGradsNorms(qpc,x,g,gf[k],gc[k],gP[k],dots[k]));
+  }
+
+  PetscCall(CheckVecEqual(Px[0],Px[1],"QPCProject",kind));
+  if (alpha[0] != alpha[1]) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"QPCFeas differs for %s box: %g != %g",kind,(double)PetscRealPart(alpha[0]),(double)PetscRealPart(alpha[1]));
+  PetscCall(CheckVecEqual(gf[0],gf[1],"free gradient",kind));
+  PetscCall(CheckVecEqual(gc[0],gc[1],"chopped gradient",kind));
+  PetscCall(CheckVecEqual(gP[0],gP[1],"projected gradient",kind));
+  PetscCall(CheckVecEqual(gr[0],gr[1],"reduced free gradient",kind));
+  PetscCall(CheckVecEqual(grg[0],grg[1],"reduced gradient",kind));
+  for (i=0; i<3; i++) {
+    if (PetscAbsReal(dots[0][i]-dots[1][i]) > PETSC_SMALL*PetscMax(1.0,PetscAbsReal(dots[0][i]))) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"QPCGradsNorms dot %" PetscInt_FMT " differs for %s box",i,kind);
+  }
+
+  PetscCall(QPCDestroy(&qpc));
+  PetscCall(VecDestroy(&lb));
+  PetscCall(VecDestroy(&ub));
+  PetscCall(VecDestroy(&x));
+  PetscCall(VecDestroy(&y));
+  PetscCall(VecDestroy(&d));
+  PetscCall(VecDestroy(&g));
+  for (k=0; k<2; k++) {
+    PetscCall(VecDestroy(&gf[k]));
+    PetscCall(VecDestroy(&gc[k]));
+    PetscCall(VecDestroy(&gP[k]));
+    PetscCall(VecDestroy(&gr[k]));
+    PetscCall(VecDestroy(&grg[k]));
+    PetscCall(VecDestroy(&Px[k]));
+  }
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  PetscRandom    rand;
+  PetscInt       n = 100;
+
+  PetscCall(PermonInitialize(&argc,&args,(char *)0,(char *)0));
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-n",&n,NULL));
+
+  PetscCall(PetscRandomCreate(PETSC_COMM_WORLD,&rand));
+  PetscCall(PetscRandomSetFromOptions(rand));
+
+  PetscCall(TestBox(rand,n,PETSC_TRUE,PETSC_FALSE,"lower"));
+  PetscCall(TestBox(rand,n,PETSC_FALSE,PETSC_TRUE,"upper"));
+  PetscCall(TestBox(rand,n,PETSC_TRUE,PETSC_TRUE,"two-sided"));
+
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+
+/*TEST
+  test:
+    nsize: {{1 3}}
+TEST*/
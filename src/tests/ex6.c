@@ -0,0 +1,58 @@
+
+/* Test communication-avoiding MatOrthColumns variants, also on an ill-conditioned matrix */
+#include <permonmat.h>
+
+static PetscErrorCode TestOrth(Mat A,MatOrthType type)
+{
+  Mat       Q,S;
+  PetscBool flg;
+
+  PetscFunctionBegin;
+  /* MatOrthColumns itself checks that Q = A*S */
+  PetscCall(MatOrthColumns(A,type,MAT_ORTH_FORM_EXPLICIT,&Q,&S));
+  PetscCall(MatHasOrthonormalColumns(Q,PETSC_SMALL,PETSC_DECIDE,&flg));
+  if (!flg) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"Q from %s does not have orthonormal columns",MatOrthTypes[type]);
+  PetscCall(MatDestroy(&Q));
+  PetscCall(MatDestroy(&S));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  Mat            A;
+  PetscRandom    rand;
+  PetscInt       M = 200, N = 12, i, j, rlo, rhi;
+  PetscScalar    *a;
+  PetscReal      scale = 1.0;
+
+  PetscCall(PermonInitialize(&argc,&args,(char *)0,(char *)0));
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-m",&M,NULL));
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-n",&N,NULL));
+  PetscCall(PetscOptionsGetReal(NULL,NULL,"-scale",&scale,NULL));
+
+  PetscCall(PetscRandomCreate(PETSC_COMM_WORLD,&rand));
+  PetscCall(PetscRandomSetFromOptions(rand));
+  PetscCall(MatCreateDense(PETSC_COMM_WORLD,PETSC_DECIDE,PETSC_DECIDE,M,N,NULL,&A));
+  PetscCall(MatSetRandom(A,rand));
+  /* grade the columns by powers of scale to make A ill-conditioned */
+  PetscCall(MatGetOwnershipRange(A,&rlo,&rhi));
+  PetscCall(MatDenseGetArray(A,&a));
+  for (j=1; j<N; j++) for (i=0; i<rhi-rlo; i++) a[i+j*(rhi-rlo)] *= PetscPowReal(scale,(PetscReal)j);
+  PetscCall(MatDenseRestoreArray(A,&a));
+
+  PetscCall(TestOrth(A,MAT_ORTH_GS));
+  PetscCall(TestOrth(A,MAT_ORTH_CHOLQR2));
+  PetscCall(TestOrth(A,MAT_ORTH_TSQR));
+
+  PetscCall(MatDestroy(&A));
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+
+/*TEST
+  test:
+    nsize: {{1 2 5}}
+    args: -scale {{1.0 0.1}}
+TEST*/
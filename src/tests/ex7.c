@@ -0,0 +1,96 @@
+/* Test MatMatMult of MATPROD, MATSUM and MATBLOCKDIAG with a dense matrix against column-by-column MatMult */
+#include <permonmat.h>
+
+static PetscErrorCode CreateTridiag(MPI_Comm comm,PetscInt n,PetscScalar diag,PetscScalar off,Mat *A)
+{
+  PetscInt i,rlo,rhi;
+
+  PetscFunctionBegin;
+  PetscCall(MatCreateAIJ(comm,PETSC_DECIDE,PETSC_DECIDE,n,n,3,NULL,2,NULL,A));
+  PetscCall(MatGetOwnershipRange(*A,&rlo,&rhi));
+  for (i=rlo; i<rhi; i++) {
+    if (i > 0)   PetscCall(MatSetValue(*A,i,i-1,off,INSERT_VALUES));
+    PetscCall(MatSetValue(*A,i,i,diag+i,INSERT_VALUES));
+    if (i < n-1) PetscCall(MatSetValue(*A,i,i+1,off,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(*A,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(*A,MAT_FINAL_ASSEMBLY));
+  PetscFunctionReturn(0);
+}
+
+static PetscErrorCode CheckMatMatMult(Mat A,Mat B,const char kind[])
+{
+  Mat       C;
+  Vec       b,c,y;
+  PetscInt  j,N;
+  PetscReal norm,nrmy;
+
+  PetscFunctionBegin;
+  /* MAT_REUSE_MATRIX reruns the numeric phase on the same C, which is where a product created on C would bite */
+  PetscCall(MatMatMult(A,B,MAT_INITIAL_MATRIX,PETSC_DEFAULT,&C));
+  PetscCall(MatMatMult(A,B,MAT_REUSE_MATRIX,PETSC_DEFAULT,&C));
+  PetscCall(MatCreateVecs(A,NULL,&y));
+  PetscCall(MatGetSize(B,NULL,&N));
+  for (j=0; j<N; j++) {
+    PetscCall(MatDenseGetColumnVecRead(B,j,&b));
+    PetscCall(MatMult(A,b,y));
+    PetscCall(MatDenseRestoreColumnVecRead(B,j,&b));
+    PetscCall(VecNorm(y,NORM_INFINITY,&nrmy));
+    PetscCall(MatDenseGetColumnVecRead(C,j,&c));
+    PetscCall(VecAXPY(y,-1.0,c));
+    PetscCall(MatDenseRestoreColumnVecRead(C,j,&c));
+    PetscCall(VecNorm(y,NORM_INFINITY,&norm));
+    if (norm > PETSC_SMALL*PetscMax(1.0,nrmy)) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"MatMatMult of %s differs from MatMult in column %" PetscInt_FMT ": %g",kind,j,(double)norm);
+  }
+  PetscCall(VecDestroy(&y));
+  PetscCall(MatDestroy(&C));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  MPI_Comm       comm;
+  PetscRandom    rand;
+  Mat            A[2],Aprod,Asum,Ablk,Aloc,B;
+  PetscInt       n = 40,N = 5,nloc;
+
+  PetscCall(PermonInitialize(&argc,&args,(char *)0,(char *)0));
+  comm = PETSC_COMM_WORLD;
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-n",&n,NULL));
+  PetscCall(PetscOptionsGetInt(NULL,NULL,"-N",&N,NULL));
+
+  PetscCall(PetscRandomCreate(comm,&rand));
+  PetscCall(PetscRandomSetFromOptions(rand));
+
+  PetscCall(CreateTridiag(comm,n,4.0,-1.0,&A[0]));
+  PetscCall(CreateTridiag(comm,n,2.0,0.5,&A[1]));
+  PetscCall(MatCreateDense(comm,PETSC_DECIDE,PETSC_DECIDE,n,N,NULL,&B));
+  PetscCall(MatSetRandom(B,rand));
+
+  PetscCall(MatCreateProd(comm,2,A,&Aprod));
+  PetscCall(CheckMatMatMult(Aprod,B,"MATPROD"));
+  PetscCall(MatCreateSum(comm,2,A,&Asum));
+  PetscCall(CheckMatMatMult(Asum,B,"MATSUM"));
+
+  PetscCall(MatGetLocalSize(A[0],&nloc,NULL));
+  PetscCall(CreateTridiag(PETSC_COMM_SELF,nloc,3.0,-1.0,&Aloc));
+  PetscCall(MatCreateBlockDiag(comm,Aloc,&Ablk));
+  PetscCall(CheckMatMatMult(Ablk,B,"MATBLOCKDIAG"));
+
+  PetscCall(MatDestroy(&Aprod));
+  PetscCall(MatDestroy(&Asum));
+  PetscCall(MatDestroy(&Ablk));
+  PetscCall(MatDestroy(&Aloc));
+  PetscCall(MatDestroy(&A[0]));
+  PetscCall(MatDestroy(&A[1]));
+  PetscCall(MatDestroy(&B));
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+
+/*TEST
+  test:
+    nsize: {{1 2}}
+TEST*/
@@ -0,0 +1,147 @@
+/* Test the coarse problem registry (QPTReuseCPCtx) with two interleaved FETI geometries */
+#include <permonqps.h>
+
+typedef struct {
+  Mat A,B,R;
+  Vec b;
+} Geometry;
+
+/* 1D Laplacian on [0,1], one floating subdomain of ne elements per rank, gluing and Dirichlet conditions in B */
+static PetscErrorCode GeometryCreate(MPI_Comm comm,PetscInt ne,Geometry *g)
+{
+  Mat         Kloc,Rloc;
+  PetscMPIInt rank,size;
+  PetscInt    i,nloc,mloc,coff,row,idx[2];
+  PetscScalar h,kel[4],one = 1.0,mone = -1.0;
+
+  PetscFunctionBegin;
+  PetscCallMPI(MPI_Comm_rank(comm,&rank));
+  PetscCallMPI(MPI_Comm_size(comm,&size));
+  nloc = ne+1;
+  coff = rank*nloc;
+  h = 1.0/(size*ne);
+  kel[0] = kel[3] = 1.0/h; kel[1] = kel[2] = -1.0/h;
+
+  PetscCall(MatCreateSeqAIJ(PETSC_COMM_SELF,nloc,nloc,3,NULL,&Kloc));
+  for (i=0; i<ne; i++) {
+    idx[0] = i; idx[1] = i+1;
+    PetscCall(MatSetValues(Kloc,2,idx,2,idx,kel,ADD_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(Kloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(Kloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatCreateBlockDiag(comm,Kloc,&g->A));
+  PetscCall(MatDestroy(&Kloc));
+
+  PetscCall(MatCreateSeqDense(PETSC_COMM_SELF,nloc,1,NULL,&Rloc));
+  for (i=0; i<nloc; i++) PetscCall(MatSetValue(Rloc,i,0,1.0/PetscSqrtReal((PetscReal)nloc),INSERT_VALUES));
+  PetscCall(MatAssemblyBegin(Rloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(Rloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatCreateBlockDiag(comm,Rloc,&g->R));
+  PetscCall(MatDestroy(&Rloc));
+
+  /* rows owned by rank r: left Dirichlet (r = 0), gluing of r and r+1 (r < size-1), right Dirichlet (r = size-1) */
+  mloc = (rank == 0) + (rank < size-1) + (rank == size-1);
+  PetscCall(MatCreateAIJ(comm,mloc,nloc,PETSC_DETERMINE,PETSC_DETERMINE,2,NULL,1,NULL,&g->B));
+  PetscCall(MatGetOwnershipRange(g->B,&row,NULL));
+  if (rank == 0) {
+    PetscCall(MatSetValue(g->B,row++,coff,one,INSERT_VALUES));
+  }
+  if (rank < size-1) {
+    PetscCall(MatSetValue(g->B,row,coff+ne,one,INSERT_VALUES));
+    PetscCall(MatSetValue(g->B,row++,coff+nloc,mone,INSERT_VALUES));
+  }
+  if (rank == size-1) {
+    PetscCall(MatSetValue(g->B,row++,coff+ne,one,INSERT_VALUES));
+  }
+  PetscCall(MatAssemblyBegin(g->B,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(g->B,MAT_FINAL_ASSEMBLY));
+
+  PetscCall(MatCreateVecs(g->A,&g->b,NULL));
+  PetscCall(VecSet(g->b,h));
+  PetscFunctionReturn(0);
+}
+
+static PetscErrorCode GeometryDestroy(Geometry *g)
+{
+  PetscFunctionBegin;
+  PetscCall(MatDestroy(&g->A));
+  PetscCall(MatDestroy(&g->B));
+  PetscCall(MatDestroy(&g->R));
+  PetscCall(VecDestroy(&g->b));
+  PetscFunctionReturn(0);
+}
+
+/* prepare a new QP of geometry g through the registry, solve it and return the coarse problem it used */
+static PetscErrorCode SolveWithRegistry(Geometry *g,QPTReuseCPCtx ctx,QPPF *pf)
+{
+  QP        qp,dualQP;
+  QPS       qps;
+  PetscBool solved;
+
+  PetscFunctionBegin;
+  PetscCall(QPCreate(PETSC_COMM_WORLD,&qp));
+  PetscCall(QPSetOperator(qp,g->A));
+  PetscCall(QPSetOperatorNullSpace(qp,g->R));
+  PetscCall(QPSetRhs(qp,g->b));
+  PetscCall(QPSetEq(qp,g->B,NULL));
+  PetscCall(QPTFetiPrepareReuseCPWithCtx(qp,PETSC_TRUE,ctx));
+  PetscCall(QPChainFind(qp,QPTDualize,&dualQP));
+  PetscCall(QPGetQPPF(dualQP,pf));
+
+  PetscCall(QPSCreate(PETSC_COMM_WORLD,&qps));
+  PetscCall(QPSSetQP(qps,qp));
+  PetscCall(QPSSetFromOptions(qps));
+  PetscCall(QPSSolve(qps));
+  PetscCall(QPIsSolved(qp,&solved));
+  if (!solved) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_NOT_CONVERGED,"QPS did not converge with a coarse problem from the registry");
+  PetscCall(QPSDestroy(&qps));
+  PetscCall(QPDestroy(&qp));
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  Geometry      geom[2];
+  QPTReuseCPCtx ctx;
+  QPPF          pf,pf0[2];
+  PetscInt      ne[2] = {3,5},k,it;
+
+  PetscCall(PermonInitialize(&argc,&args,(char *)0,(char *)0));
+  PetscCall(QPTReuseCPCtxCreate(&ctx));
+  for (k=0; k<2; k++) PetscCall(GeometryCreate(PETSC_COMM_WORLD,ne[k],&geom[k]));
+
+  /* the first round stores a coarse problem per geometry, the next ones must take them from the registry */
+  for (it=0; it<3; it++) {
+    for (k=0; k<2; k++) {
+      PetscCall(SolveWithRegistry(&geom[k],ctx,&pf));
+      if (!it) {
+        pf0[k] = pf;
+        PetscCall(PetscObjectReference((PetscObject)pf));
+      } else if (pf != pf0[k]) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"coarse problem of geometry %" PetscInt_FMT " not reused in round %" PetscInt_FMT,k,it);
+    }
+  }
+  if (pf0[0] == pf0[1]) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"different geometries share a coarse problem");
+
+  /* a modified B invalidates the stored coarse problem of its geometry only */
+  PetscCall(MatScale(geom[0].B,2.0));
+  PetscCall(SolveWithRegistry(&geom[0],ctx,&pf));
+  if (pf == pf0[0]) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"outdated coarse problem reused after B has changed");
+  PetscCall(SolveWithRegistry(&geom[1],ctx,&pf));
+  if (pf != pf0[1]) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"coarse problem of the unchanged geometry not reused");
+
+  for (k=0; k<2; k++) {
+    PetscCall(QPPFDestroy(&pf0[k]));
+    PetscCall(GeometryDestroy(&geom[k]));
+  }
+  PetscCall(QPTReuseCPCtxDestroy(&ctx));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+
+/*TEST
+  test:
+    nsize: {{1 3}}
+    requires: mumps
+    args: -qpt_reuse_cp_max 2
+TEST*/
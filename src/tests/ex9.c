@@ -0,0 +1,123 @@
+/* Test MATBLOCKDIAG and MAT_INV_BLOCKDIAG with several subdomain blocks per rank */
+#include <permonmat.h>
+
+static PetscErrorCode CheckVecClose(Vec a,Vec b,const char name[])
+{
+  Vec       diff;
+  PetscReal norm,nrma;
+
+  PetscFunctionBegin;
+  PetscCall(VecDuplicate(a,&diff));
+  PetscCall(VecWAXPY(diff,-1.0,a,b));
+  PetscCall(VecNorm(diff,NORM_INFINITY,&norm));
+  PetscCall(VecNorm(a,NORM_INFINITY,&nrma));
+  if (norm > PETSC_SMALL*PetscMax(1.0,nrma)) SETERRQ(PETSC_COMM_WORLD,PETSC_ERR_PLIB,"%s differs: %g",name,(double)norm);
+  PetscCall(VecDestroy(&diff));
+  PetscFunctionReturn(0);
+}
+
+/* check that A has the subdomain blocks lens */
+static PetscErrorCode CheckBlocks(Mat A,PetscInt nblocks,const PetscInt lens[],const char name[])
+{
+  PetscInt       nb,i;
+  const PetscInt *lb;
+
+  PetscFunctionBegin;
+  PetscCall(MatBlockDiagGetLocalBlockSizes(A,&nb,&lb));
+  if (nb != nblocks) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_PLIB,"%s has %" PetscInt_FMT " blocks instead of %" PetscInt_FMT,name,nb,nblocks);
+  for (i=0; i<nb; i++) {
+    if (lb[i] != lens[i]) SETERRQ(PETSC_COMM_SELF,PETSC_ERR_PLIB,"%s block %" PetscInt_FMT " has size %" PetscInt_FMT " instead of %" PetscInt_FMT,name,i,lb[i],lens[i]);
+  }
+  PetscFunctionReturn(0);
+}
+
+int main(int argc,char **args)
+{
+  MPI_Comm       comm;
+  PetscRandom    rand;
+  Mat            Aloc,A,Aaij,Adense,Ainv;
+  Vec            x,y,yref,z;
+  PetscMPIInt    rank;
+  PetscInt       nblocks = 3,lens[3],b,i,off,n;
+  PetscScalar    v[3];
+
+  PetscCall(PermonInitialize(&argc,&args,(char *)0,(char *)0));
+  comm = PETSC_COMM_WORLD;
+  PetscCallMPI(MPI_Comm_rank(comm,&rank));
+  PetscCall(PetscRandomCreate(comm,&rand));
+  PetscCall(PetscRandomSetFromOptions(rand));
+
+  /* blocks of uneven sizes differing among ranks, each a shifted SPD tridiagonal matrix */
+  n = 0;
+  for (b=0; b<nblocks; b++) {
+    lens[b] = 4 + 3*b + rank;
+    n += lens[b];
+  }
+  PetscCall(MatCreateSeqAIJ(PETSC_COMM_SELF,n,n,3,NULL,&Aloc));
+  for (b=0,off=0; b<nblocks; off+=lens[b],b++) {
+    for (i=off; i<off+lens[b]; i++) {
+      v[0] = -1.0; v[1] = 4.0 + b; v[2] = -1.0;
+      if (i > off) PetscCall(MatSetValue(Aloc,i,i-1,v[0],INSERT_VALUES));
+      PetscCall(MatSetValue(Aloc,i,i,v[1],INSERT_VALUES));
+      if (i < off+lens[b]-1) PetscCall(MatSetValue(Aloc,i,i+1,v[2],INSERT_VALUES));
+    }
+  }
+  PetscCall(MatAssemblyBegin(Aloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatAssemblyEnd(Aloc,MAT_FINAL_ASSEMBLY));
+  PetscCall(MatCreateBlockDiag(comm,Aloc,&A));
+  PetscCall(MatBlockDiagSetLocalBlockSizes(A,nblocks,lens));
+  PetscCall(CheckBlocks(A,nblocks,lens,"MATBLOCKDIAG"));
+
+  /* MatMult over the blocks against the assembled matrix */
+  PetscCall(MatConvert(A,MATAIJ,MAT_INITIAL_MATRIX,&Aaij));
+  PetscCall(MatCreateVecs(A,&x,&y));
+  PetscCall(VecDuplicate(y,&yref));
+  PetscCall(VecDuplicate(x,&z));
+  PetscCall(VecSetRandom(x,rand));
+  PetscCall(MatMult(A,x,y));
+  PetscCall(MatMult(Aaij,x,yref));
+  PetscCall(CheckVecClose(yref,y,"MatMult with several blocks"));
+
+  /* the blocks survive MatDuplicate and PermonMatConvertBlocks */
+  {
+    Mat Ad;
+
+    PetscCall(MatDuplicate(A,MAT_COPY_VALUES,&Ad));
+    PetscCall(CheckBlocks(Ad,nblocks,lens,"MatDuplicate"));
+    PetscCall(MatDestroy(&Ad));
+  }
+  PetscCall(PermonMatConvertBlocks(A,MATDENSE,MAT_INITIAL_MATRIX,&Adense));
+  PetscCall(CheckBlocks(Adense,nblocks,lens,"PermonMatConvertBlocks"));
+  PetscCall(MatMult(Adense,x,y));
+  PetscCall(CheckVecClose(yref,y,"MatMult of converted blocks"));
+
+  /* MAT_INV_BLOCKDIAG factors each block separately; A*inv(A)*x = x */
+  PetscCall(MatCreateInv(A,MAT_INV_BLOCKDIAG,&Ainv));
+  PetscCall(MatSetFromOptions(Ainv));
+  PetscCall(MatInvSetUp(Ainv));
+  PetscCall(MatMult(Ainv,x,z));
+  PetscCall(MatMult(A,z,y));
+  PetscCall(CheckVecClose(x,y,"A*inv(A)*x"));
+  /* the solve on the whole local block gives the same result */
+  PetscCall(MatMult(Aaij,z,yref));
+  PetscCall(CheckVecClose(x,yref,"assembled A*inv(A)*x"));
+
+  PetscCall(MatDestroy(&Ainv));
+  PetscCall(MatDestroy(&Adense));
+  PetscCall(MatDestroy(&Aaij));
+  PetscCall(MatDestroy(&A));
+  PetscCall(MatDestroy(&Aloc));
+  PetscCall(VecDestroy(&x));
+  PetscCall(VecDestroy(&y));
+  PetscCall(VecDestroy(&yref));
+  PetscCall(VecDestroy(&z));
+  PetscCall(PetscRandomDestroy(&rand));
+  PetscCall(PermonFinalize());
+  return 0;
+}
+
+
+/*TEST
+  test:
+    nsize: {{1 2}}
+TEST*/
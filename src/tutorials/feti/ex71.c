@@ -414,4 +414,14 @@ int main(int argc,char **args)
       nsize: 7
       suffix: 2
       args: -pde_type Elasticity -dim 3 -qps_rtol 1e-6 -dual_pc_dual_type {{none lumped}separate output}
+    test:
+      nsize: 7
+      suffix: 3
+      filter: grep -o "CONVERGED due to CONVERGED_RTOL"
+      args: -pde_type Elasticity -dim 3 -qps_rtol 1e-6 -dual_pc_dual_type dirichlet
+    test:
+      nsize: 7
+      suffix: 4
+      filter: grep -o "CONVERGED due to CONVERGED_RTOL"
+      args: -pde_type Elasticity -dim 3 -qps_rtol 1e-6 -dual_pc_dual_multiplicity_scaling -dual_pc_dual_type {{lumped dirichlet}separate output}
  TEST*/